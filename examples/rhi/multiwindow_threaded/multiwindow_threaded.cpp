@@ -645,16 +645,16 @@ void Renderer::render(bool newlyExposed, bool wakeBeforePresent)
         const QRhiProfiler::CpuTime be = r->profiler()->frameBuildTimes(m_sc);
         const QRhiProfiler::GpuTime gp = r->profiler()->gpuFrameTimes(m_sc);
         if (r->isFeatureSupported(QRhi::Timestamps)) {
-            qDebug("[renderer %p] frame-to-frame: min %lld max %lld avg %f. "
-                   "frame build: min %lld max %lld avg %f. "
+            qDebug("[renderer %p] frame-to-frame: min %f max %f avg %f. "
+                   "frame build: min %f max %f avg %f. "
                    "gpu frame time: min %f max %f avg %f",
                    this,
                    ff.minTime, ff.maxTime, ff.avgTime,
                    be.minTime, be.maxTime, be.avgTime,
                    gp.minTime, gp.maxTime, gp.avgTime);
         } else {
-            qDebug("[renderer %p] frame-to-frame: min %lld max %lld avg %f. "
-                   "frame build: min %lld max %lld avg %f. ",
+            qDebug("[renderer %p] frame-to-frame: min %f max %f avg %f. "
+                   "frame build: min %f max %f avg %f. ",
                    this,
                    ff.minTime, ff.maxTime, ff.avgTime,
                    be.minTime, be.maxTime, be.avgTime);
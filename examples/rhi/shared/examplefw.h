@@ -389,8 +389,8 @@ void Window::render()
             const QRhiProfiler::GpuTime gp = m_r->profiler()->gpuFrameTimes(m_sc);
             if (m_r->isFeatureSupported(QRhi::Timestamps)) {
                 qDebug("ca. %d fps. "
-                       "frame-to-frame: min %lld max %lld avg %f. "
-                       "frame build: min %lld max %lld avg %f. "
+                       "frame-to-frame: min %f max %f avg %f. "
+                       "frame build: min %f max %f avg %f. "
                        "gpu frame time: min %f max %f avg %f",
                        m_frameCount,
                        ff.minTime, ff.maxTime, ff.avgTime,
@@ -398,8 +398,8 @@ void Window::render()
                        gp.minTime, gp.maxTime, gp.avgTime);
             } else {
                 qDebug("ca. %d fps. "
-                       "frame-to-frame: min %lld max %lld avg %f. "
-                       "frame build: min %lld max %lld avg %f. ",
+                       "frame-to-frame: min %f max %f avg %f. "
+                       "frame build: min %f max %f avg %f. ",
                        m_frameCount,
                        ff.minTime, ff.maxTime, ff.avgTime,
                        be.minTime, be.maxTime, be.avgTime);
@@ -65,6 +65,8 @@
 #include <QRhiProfiler>
 
 #define PROFILE_TO_FILE
+//#define PROFILE_TO_CHROME_TRACE
+//#define PROFILE_MARKER_TIMING
 //#define SKIP_PRESENT
 //#define USE_MSAA
 //#define USE_SRGB_SWAPCHAIN
@@ -87,7 +89,11 @@ void preInit()
 {
 #ifdef PROFILE_TO_FILE
     rhiFlags |= QRhi::EnableProfiling;
+#ifdef PROFILE_TO_CHROME_TRACE
+    const QString profFn = QFileInfo(QLatin1String("rhiprof.json")).absoluteFilePath();
+#else
     const QString profFn = QFileInfo(QLatin1String("rhiprof.txt")).absoluteFilePath();
+#endif
     qDebug("Writing profiling output to %s", qPrintable(profFn));
     d.profOut.setFileName(profFn);
     d.profOut.open(QIODevice::WriteOnly);
@@ -120,6 +126,12 @@ void preInit()
 void Window::customInit()
 {
 #ifdef PROFILE_TO_FILE
+#ifdef PROFILE_TO_CHROME_TRACE
+    m_r->profiler()->setOutputFormat(QRhiProfiler::ChromeTraceFormat);
+#endif
+#ifdef PROFILE_MARKER_TIMING
+    m_r->profiler()->setMarkerTimingEnabled(true);
+#endif
     m_r->profiler()->setDevice(&d.profOut);
 #endif
 
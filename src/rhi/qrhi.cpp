@@ -420,6 +420,36 @@ QT_BEGIN_NAMESPACE
     component 8-bit \c red format. This is the case for all backends except
     OpenGL, where \c{GL_ALPHA}, a one component 8-bit \c alpha format, is used
     instead. This is relevant for shader code that samples from the texture.
+
+    \value Compute Indicates that compute shaders, image load/store, and
+    storage buffers are supported. With OpenGL this requires OpenGL 4.3 or
+    OpenGL ES 3.1.
+
+    \value DrawIndirect Indicates that QRhiCommandBuffer::drawIndirect() and
+    QRhiCommandBuffer::drawIndexedIndirect() are supported. With OpenGL this
+    requires OpenGL 4.0 or OpenGL ES 3.1.
+
+    \value DrawIndirectMulti Indicates that indirect draws with a \c drawCount
+    larger than 1 are issued as a single multi-draw call (for example,
+    \c{glMultiDrawElementsIndirect} or a \c{vkCmdDrawIndexedIndirect} with
+    the \c multiDrawIndirect feature enabled). When not supported, but
+    DrawIndirect is, such draws are still possible, but are emulated by
+    issuing one indirect draw call per command, meaning the CPU side cost
+    scales with \c drawCount.
+
+    \value PushConstants Indicates that QRhiCommandBuffer::setPushConstants()
+    is supported. This is the case with Vulkan and OpenGL (where push constant
+    blocks are translated to plain uniforms), but not with D3D11 and Metal.
+
+    \value ThreeDimensionalTextures Indicates that textures with the
+    QRhiTexture::ThreeDimensional flag, created via the \c depth overload of
+    QRhi::newTexture(), are supported. With OpenGL this requires OpenGL 3.0 or
+    OpenGL ES 3.0.
+
+    \value TextureArrays Indicates that 2D texture arrays, created via
+    QRhi::newTextureArray(), are supported. With OpenGL this requires OpenGL
+    3.0 or OpenGL ES 3.0. Neither 3D textures nor texture arrays are
+    currently supported with D3D11 and Metal.
  */
 
 /*!
@@ -452,6 +482,15 @@ QT_BEGIN_NAMESPACE
     graphics API and sometimes the platform or implementation as well.
     Typically the value is in the range 4096 - 16384. Attempting to create
     textures larger than this is expected to fail.
+
+    \value PushConstantsSizeMax Maximum size of the push constant data in
+    bytes. At least 128 when QRhi::PushConstants is supported, 0 otherwise.
+    With OpenGL this is always 128, and is not queried from the
+    implementation. The emulating uniforms share the per-stage uniform
+    component limits with all other uniforms.
+
+    \value TextureArraySizeMax Maximum number of layers in a texture array.
+    At least 256 when QRhi::TextureArrays is supported, 0 otherwise.
  */
 
 /*!
@@ -1012,6 +1051,31 @@ QDebug operator<<(QDebug dbg, const QRhiVertexInputBinding &b)
     \value UNormByte4 Four component normalized unsigned byte vector
     \value UNormByte2 Two component normalized unsigned byte vector
     \value UNormByte Normalized unsigned byte
+    \value Half4 Four component half precision (16-bit) float vector
+    \value Half2 Two component half precision (16-bit) float vector
+    \value SNormByte4 Four component normalized signed byte vector
+    \value SNormByte2 Two component normalized signed byte vector
+    \value SNormShort4 Four component normalized signed 16-bit integer vector
+    \value SNormShort2 Two component normalized signed 16-bit integer vector
+    \value UInt4 Four component unsigned 32-bit integer vector
+    \value UInt3 Three component unsigned 32-bit integer vector
+    \value UInt2 Two component unsigned 32-bit integer vector
+    \value UInt Unsigned 32-bit integer
+    \value SInt4 Four component signed 32-bit integer vector
+    \value SInt3 Three component signed 32-bit integer vector
+    \value SInt2 Two component signed 32-bit integer vector
+    \value SInt Signed 32-bit integer
+    \value UNormA2B10G10R10 Four component normalized unsigned vector packed
+    into 32 bits, with 10 bits for each of red (lowest bits), green, and blue,
+    and 2 bits for alpha
+    \value SNormA2B10G10R10 Four component normalized signed vector packed
+    into 32 bits, typically used for normals and tangents
+
+    The integer formats are not normalized, and are expected to be consumed as
+    integers (for example, \c uvec4 or \c ivec4) in the vertex shader.
+
+    Not all formats are supported by all backends and graphics APIs. Use
+    QRhi::isVertexFormatSupported() to check.
  */
 
 /*!
@@ -1251,8 +1315,8 @@ QDebug operator<<(QDebug dbg, const QRhiGraphicsShaderStage &s)
     renderbuffers).
 
     When targeting a non-multisample texture, the layer() and level()
-    indicate the targeted layer (face index \c{0-5} for cubemaps) and mip
-    level.
+    indicate the targeted layer (face index \c{0-5} for cubemaps, array layer
+    for texture arrays, slice for 3D textures) and mip level.
 
     When texture() or renderBuffer() is multisample, resolveTexture() can be
     set optionally. When set, samples are resolved automatically into that
@@ -1261,6 +1325,14 @@ QDebug operator<<(QDebug dbg, const QRhiGraphicsShaderStage &s)
     non-multisample content out of them. Multisample textures allow sampling in
     shaders so for them this is just one option.
 
+    loadOp() and storeOp() specify what happens to the contents of the
+    attachment at the beginning and the end of a render pass. The default is
+    to clear and to store. Choosing QRhiColorAttachment::LoadOpDontCare or
+    QRhiColorAttachment::StoreOpDontCare when the previous or the resulting
+    contents are not needed avoids memory traffic, which matters most on
+    tiled and bandwidth-bound GPUs. The ops may be baked into native resources
+    by some backends, so they must be set before building the render target.
+
     \note when resolving is enabled, the multisample data may not be written
     out at all. This means that the multisample texture() must not be used
     afterwards with shaders for sampling when resolveTexture() is set.
@@ -1273,6 +1345,33 @@ QRhiColorAttachment::QRhiColorAttachment()
 {
 }
 
+/*!
+    \enum QRhiColorAttachment::LoadOp
+    Specifies what happens to the contents of an attachment when a render pass begins
+
+    \value LoadOpClear The contents are cleared to the clear value passed to
+    QRhiCommandBuffer::beginPass(). This is the default.
+
+    \value LoadOpLoad The existing contents are loaded. Implied by
+    QRhiTextureRenderTarget::PreserveColorContents and
+    QRhiTextureRenderTarget::PreserveDepthStencilContents.
+
+    \value LoadOpDontCare The existing contents are undefined at the beginning
+    of the pass. Use this when every pixel gets overwritten anyway.
+ */
+
+/*!
+    \enum QRhiColorAttachment::StoreOp
+    Specifies what happens to the contents of an attachment when a render pass ends
+
+    \value StoreOpStore The contents are written out to memory. This is the
+    default.
+
+    \value StoreOpDontCare The contents are not needed after the pass and may
+    be discarded. The results of a multisample resolve are written out
+    regardless.
+ */
+
 /*!
     Constructs a color attachment description that specifies \a texture as the
     associated color buffer.
@@ -1302,6 +1401,11 @@ QRhiColorAttachment::QRhiColorAttachment(QRhiRenderBuffer *renderBuffer)
 
     \note depthStencilBuffer() and depthTexture() cannot be both set (cannot be
     non-null at the same time).
+
+    depthStencilLoadOp() and depthStencilStoreOp() are the equivalents of
+    QRhiColorAttachment::loadOp() and QRhiColorAttachment::storeOp() for the
+    depth/stencil attachment. Depth/stencil renderbuffers may not be written
+    out with some backends regardless of the store op, see QRhiRenderBuffer.
  */
 
 /*!
@@ -1413,6 +1517,10 @@ QRhiTextureMipLevel::QRhiTextureMipLevel(const QByteArray &compressedData)
     \class QRhiTextureLayer
     \inmodule QtRhi
     \brief Describes one layer (face for cubemaps) in a texture upload operation.
+
+    For texture arrays the index of the QRhiTextureLayer in the upload
+    description is the array layer. For 3D textures it is the slice, meaning
+    each QRhiTextureLayer provides the images for one depth slice.
  */
 
 /*!
@@ -1505,6 +1613,9 @@ QRhiTextureUploadDescription::QRhiTextureUploadDescription(const QVector<QRhiTex
     \note The source and destination rectangles defined by pixelSize(),
     sourceTopLeft(), and destinationTopLeft() must fit the source and
     destination textures, respectively. The behavior is undefined otherwise.
+
+    For texture arrays the layers are array layers, for 3D textures they are
+    slices. One slice or array layer is copied at a time.
  */
 
 /*!
@@ -1531,6 +1642,16 @@ QRhiTextureCopyDescription::QRhiTextureCopyDescription()
     QRhiSwapChain::UsedAsTransferSource.
 
     layer() and level() are only applicable when the source is a QRhiTexture.
+    For texture arrays layer() is the array layer, for 3D textures it is the
+    slice.
+
+    When rect() is set to a non-empty rectangle, only that region of the
+    selected mip level is read back. The rectangle must lie fully inside the
+    level. This avoids copying and transferring the whole image when only a
+    small part (for example, a single pixel under the mouse cursor) is needed.
+    The \l{QRhiReadbackResult::pixelSize}{pixelSize} of the result is then the
+    size of the rectangle. By default the rectangle is empty, meaning the
+    entire level is read back.
 
     \note Multisample textures cannot be read back. Readbacks are supported for
     multisample swapchain buffers however.
@@ -1569,6 +1690,24 @@ QRhiReadbackDescription::QRhiReadbackDescription(QRhiTexture *texture)
     When \l completed is set, the function is invoked when the \l data is
     available. \l format and \l pixelSize are set upon completion together with
     \l data.
+
+    When \l destination is set, the pixel data is written to the memory it
+    points to instead of \l data, which is then left untouched. This allows
+    continuous readbacks, for example capturing every frame, without
+    allocating for each readback. \l destinationSize must be at least the
+    size of the read back data (tightly packed rows of the pixelSize, with
+    the bytes per pixel of the format), otherwise a warning is printed and
+    nothing is written. The memory must stay valid until \l completed is
+    invoked.
+ */
+
+/*!
+    \class QRhiBufferReadbackResult
+    \inmodule QtRhi
+    \brief Describes the results of a potentially asynchronous buffer readback operation.
+
+    When \l completed is set, the function is invoked when the \l data is
+    available.
  */
 
 /*!
@@ -1597,6 +1736,10 @@ QRhiResource::QRhiResource(QRhiImplementation *rhi)
  */
 QRhiResource::~QRhiResource()
 {
+    if (m_rhi) {
+        QRHI_CAP;
+        QRHI_CAP_F(resourceDestroyed(this));
+    }
 }
 
 /*!
@@ -1757,6 +1900,15 @@ quint64 QRhiResource::globalResourceId() const
     \value VertexBuffer Vertex buffer
     \value IndexBuffer Index buffer
     \value UniformBuffer Uniform (constant) buffer
+    \value StorageBuffer Storage buffer. Can be combined with VertexBuffer or
+    IndexBuffer to allow consuming the results of a compute shader in a
+    subsequent draw call. Only supported when QRhi::Compute is reported as
+    supported.
+    \value IndirectBuffer Indirect draw argument buffer, to be used with
+    QRhiCommandBuffer::drawIndirect() and
+    QRhiCommandBuffer::drawIndexedIndirect(). Can be combined with
+    StorageBuffer to allow generating the draw commands in a compute shader.
+    Only supported when QRhi::DrawIndirect is reported as supported.
  */
 
 /*!
@@ -1832,6 +1984,13 @@ QRhiBuffer::QRhiBuffer(QRhiImplementation *rhi, Type type_, UsageFlags usage_, i
     GLX, etc.), the flag is important since it avoids creating any actual
     resource as there is already a windowing system provided depth/stencil
     buffer as requested by QSurfaceFormat.
+
+    \value Transient Indicates that the contents never need to outlive a
+    render pass. For Color renderbuffers this is typical when the multisample
+    data is only used with a resolve. The renderbuffer is then never loaded or
+    stored, and backends may use transient, lazily allocated or memoryless
+    storage for it. DepthStencil renderbuffers are treated like this with
+    some backends regardless of the flag.
  */
 
 /*!
@@ -1896,6 +2055,31 @@ QRhiRenderBuffer::QRhiRenderBuffer(QRhiImplementation *rhi, Type type_, const QS
 
      \value UsedWithGenerateMips The texture is going to be used with
      QRhiResourceUpdateBatch::generateMips().
+
+     \value UsedWithLoadStore The texture is going to be used with image
+     load/store operations, for example in a compute shader. Only supported
+     when QRhi::Compute is reported as supported.
+
+     \value ThreeDimensional The texture is a 3D texture with depth() slices.
+     Such textures cannot be cubemaps, arrays, or multisample, and do not
+     support mipmaps. Only supported when QRhi::ThreeDimensionalTextures is
+     reported as supported. Prefer QRhi::newTexture() with a \c depth
+     argument instead of setting this flag manually.
+
+     \value TextureArray The texture is a 2D texture array with arraySize()
+     layers. Such textures cannot be cubemaps or multisample. Only supported
+     when QRhi::TextureArrays is reported as supported. Prefer
+     QRhi::newTextureArray() instead of setting this flag manually.
+
+     \value Transient The texture is a render target attachment whose contents
+     never need to outlive a render pass, for example a multisample color
+     buffer that is resolved, or a depth buffer. Such a texture cannot be
+     sampled, uploaded to, copied, or read back, and it is never loaded or
+     stored, regardless of the load and store ops of the attachment. Requires
+     RenderTarget. With Vulkan this becomes a transient attachment backed by
+     lazily allocated memory when the implementation offers such a memory
+     type, and with Metal on iOS memoryless storage is used. Other backends
+     treat the flag as a hint to discard the contents.
  */
 
 /*!
@@ -1917,6 +2101,27 @@ QRhiRenderBuffer::QRhiRenderBuffer(QRhiImplementation *rhi, Type type_, const QS
     \value RED_OR_ALPHA8 Either same as R8, or is a similar format with the component swizzled to alpha,
     depending on \l{QRhi::RedOrAlpha8IsRed}{RedOrAlpha8IsRed}.
 
+    \value RG8 Two component, unsigned normalized 8 bit per component.
+
+    \value RG16 Two component, unsigned normalized 16 bit per component.
+
+    \value RGBA16F Four component, 16-bit float per component.
+
+    \value RGBA32F Four component, 32-bit float per component.
+
+    \value R16F One component, 16-bit float.
+
+    \value R32F One component, 32-bit float.
+
+    \value B10G11R11_UFLOAT Three component, unsigned float packed into 32
+    bits, with 11 bits for red (lowest bits) and green, and 10 bits for blue.
+    No alpha. Half the size of RGBA16F, which makes it a good fit for HDR
+    color buffers that do not need alpha.
+
+    The float formats typically need OpenGL 3.0 or OpenGL ES 3.0, and
+    rendering into them may need further extensions with OpenGL ES. Check with
+    QRhi::isTextureFormatSupported().
+
     \value D16 16-bit depth (normalized unsigned integer)
 
     \value D32 32-bit depth (32-bit float)
@@ -1959,6 +2164,21 @@ QRhiTexture::QRhiTexture(QRhiImplementation *rhi, Format format_, const QSize &p
 {
 }
 
+/*!
+    \return the number of layers in the texture: 6 for cubemaps, arraySize()
+    for texture arrays, depth() for 3D textures, and 1 otherwise.
+ */
+int QRhiTexture::layerCount() const
+{
+    if (m_flags.testFlag(CubeMap))
+        return 6;
+    if (m_flags.testFlag(TextureArray))
+        return qMax(1, m_arraySize);
+    if (m_flags.testFlag(ThreeDimensional))
+        return qMax(1, m_depth);
+    return 1;
+}
+
 /*!
     \fn bool QRhiTexture::build()
 
@@ -2146,14 +2366,19 @@ QRhiRenderTarget::QRhiRenderTarget(QRhiImplementation *rhi)
     \value PreserveColorContents Indicates that the contents of the color
     attachments is to be loaded when starting a render pass, instead of
     clearing. This is potentially more expensive, especially on mobile (tiled)
-    GPUs, but allows preserving the existing contents between passes.
+    GPUs, but allows preserving the existing contents between passes. Takes
+    precedence over QRhiColorAttachment::loadOp().
 
     \value PreserveDepthStencilContents Indicates that the contents of the
     depth texture is to be loaded when starting a render pass, instead
     clearing. Only applicable when a texture is used as the depth buffer
     (QRhiTextureRenderTargetDescription::depthTexture() is set) because
     depth/stencil renderbuffers may not have any physical backing and data may
-    not be written out in the first place.
+    not be written out in the first place. Takes precedence over
+    QRhiTextureRenderTargetDescription::depthStencilLoadOp().
+
+    For finer control, including discarding contents at the end of the pass,
+    see QRhiColorAttachment::setLoadOp() and QRhiColorAttachment::setStoreOp().
  */
 
 /*!
@@ -2333,7 +2558,8 @@ bool QRhiShaderResourceBindings::isLayoutCompatible(const QRhiShaderResourceBind
     \brief Describes the shader resource for a single binding point.
 
     A QRhiShaderResourceBinding cannot be constructed directly. Instead, use
-    the static functions uniformBuffer(), sampledTexture() to get an instance.
+    the static functions uniformBuffer(), sampledTexture(), imageLoad(),
+    bufferLoad() and friends to get an instance.
  */
 
 /*!
@@ -2342,6 +2568,18 @@ bool QRhiShaderResourceBindings::isLayoutCompatible(const QRhiShaderResourceBind
 
     \value UniformBuffer Uniform buffer
     \value SampledTexture Combined image sampler
+    \value ImageLoad Image load (with GLSL this maps to doing imageLoad() on a
+    single level - and either one or all layers - of a texture exposed to the
+    shader as an image object)
+    \value ImageStore Image store (with GLSL this maps to doing imageStore() or
+    imageAtomic*() on a single level - and either one or all layers - of a
+    texture exposed to the shader as an image object)
+    \value ImageLoadStore Image load and store
+    \value BufferLoad Storage buffer load (with GLSL this maps to reading from
+    a shader storage buffer)
+    \value BufferStore Storage buffer store (with GLSL this maps to writing to
+    a shader storage buffer)
+    \value BufferLoadStore Storage buffer load and store
  */
 
 /*!
@@ -2353,6 +2591,7 @@ bool QRhiShaderResourceBindings::isLayoutCompatible(const QRhiShaderResourceBind
     \value GeometryStage Geometry stage
     \value TessellationControlStage Tessellation control (hull) stage
     \value TessellationEvaluationStage Tessellation evaluation (domain) stage
+    \value ComputeStage Compute stage
  */
 
 /*!
@@ -2505,6 +2744,155 @@ QRhiShaderResourceBinding QRhiShaderResourceBinding::sampledTexture(
     return b;
 }
 
+/*!
+    \return a shader resource binding for a read-only storage image with the
+    given \a binding number and pipeline \a stage. The image load operations
+    will have access to all layers of the specified \a level. (so if the texture
+    is a cubemap, the shader must use imageCube instead of image2D)
+
+    \note \a tex must have been created with QRhiTexture::UsedWithLoadStore.
+ */
+QRhiShaderResourceBinding QRhiShaderResourceBinding::imageLoad(
+        int binding, StageFlags stage, QRhiTexture *tex, int level)
+{
+    QRhiShaderResourceBinding b;
+    QRhiShaderResourceBindingPrivate *d = QRhiShaderResourceBindingPrivate::get(&b);
+    Q_ASSERT(d->ref.load() == 1);
+    d->binding = binding;
+    d->stage = stage;
+    d->type = ImageLoad;
+    d->u.simage.tex = tex;
+    d->u.simage.level = level;
+    return b;
+}
+
+/*!
+    \return a shader resource binding for a write-only storage image with the
+    given \a binding number and pipeline \a stage. The image store operations
+    will have access to all layers of the specified \a level.
+
+    \note \a tex must have been created with QRhiTexture::UsedWithLoadStore.
+ */
+QRhiShaderResourceBinding QRhiShaderResourceBinding::imageStore(
+        int binding, StageFlags stage, QRhiTexture *tex, int level)
+{
+    QRhiShaderResourceBinding b = imageLoad(binding, stage, tex, level);
+    QRhiShaderResourceBindingPrivate::get(&b)->type = ImageStore;
+    return b;
+}
+
+/*!
+    \return a shader resource binding for a read/write storage image with the
+    given \a binding number and pipeline \a stage. The image load/store
+    operations will have access to all layers of the specified \a level.
+
+    \note \a tex must have been created with QRhiTexture::UsedWithLoadStore.
+ */
+QRhiShaderResourceBinding QRhiShaderResourceBinding::imageLoadStore(
+        int binding, StageFlags stage, QRhiTexture *tex, int level)
+{
+    QRhiShaderResourceBinding b = imageLoad(binding, stage, tex, level);
+    QRhiShaderResourceBindingPrivate::get(&b)->type = ImageLoadStore;
+    return b;
+}
+
+/*!
+    \return a shader resource binding for a read-only storage buffer with the
+    given \a binding number and pipeline \a stage.
+
+    \note \a buf must have been created with QRhiBuffer::StorageBuffer.
+ */
+QRhiShaderResourceBinding QRhiShaderResourceBinding::bufferLoad(
+        int binding, StageFlags stage, QRhiBuffer *buf)
+{
+    QRhiShaderResourceBinding b;
+    QRhiShaderResourceBindingPrivate *d = QRhiShaderResourceBindingPrivate::get(&b);
+    Q_ASSERT(d->ref.load() == 1);
+    d->binding = binding;
+    d->stage = stage;
+    d->type = BufferLoad;
+    d->u.sbuf.buf = buf;
+    d->u.sbuf.offset = 0;
+    d->u.sbuf.maybeSize = 0; // entire buffer
+    return b;
+}
+
+/*!
+    \return a shader resource binding for a read-only storage buffer with the
+    given \a binding number and pipeline \a stage. This overload binds a
+    region only, as specified by \a offset and \a size.
+
+    \note \a buf must have been created with QRhiBuffer::StorageBuffer.
+ */
+QRhiShaderResourceBinding QRhiShaderResourceBinding::bufferLoad(
+        int binding, StageFlags stage, QRhiBuffer *buf, int offset, int size)
+{
+    Q_ASSERT(size > 0);
+    QRhiShaderResourceBinding b = bufferLoad(binding, stage, buf);
+    QRhiShaderResourceBindingPrivate *d = QRhiShaderResourceBindingPrivate::get(&b);
+    d->u.sbuf.offset = offset;
+    d->u.sbuf.maybeSize = size;
+    return b;
+}
+
+/*!
+    \return a shader resource binding for a write-only storage buffer with the
+    given \a binding number and pipeline \a stage.
+
+    \note \a buf must have been created with QRhiBuffer::StorageBuffer.
+ */
+QRhiShaderResourceBinding QRhiShaderResourceBinding::bufferStore(
+        int binding, StageFlags stage, QRhiBuffer *buf)
+{
+    QRhiShaderResourceBinding b = bufferLoad(binding, stage, buf);
+    QRhiShaderResourceBindingPrivate::get(&b)->type = BufferStore;
+    return b;
+}
+
+/*!
+    \return a shader resource binding for a write-only storage buffer with the
+    given \a binding number and pipeline \a stage. This overload binds a
+    region only, as specified by \a offset and \a size.
+
+    \note \a buf must have been created with QRhiBuffer::StorageBuffer.
+ */
+QRhiShaderResourceBinding QRhiShaderResourceBinding::bufferStore(
+        int binding, StageFlags stage, QRhiBuffer *buf, int offset, int size)
+{
+    QRhiShaderResourceBinding b = bufferLoad(binding, stage, buf, offset, size);
+    QRhiShaderResourceBindingPrivate::get(&b)->type = BufferStore;
+    return b;
+}
+
+/*!
+    \return a shader resource binding for a read-write storage buffer with the
+    given \a binding number and pipeline \a stage.
+
+    \note \a buf must have been created with QRhiBuffer::StorageBuffer.
+ */
+QRhiShaderResourceBinding QRhiShaderResourceBinding::bufferLoadStore(
+        int binding, StageFlags stage, QRhiBuffer *buf)
+{
+    QRhiShaderResourceBinding b = bufferLoad(binding, stage, buf);
+    QRhiShaderResourceBindingPrivate::get(&b)->type = BufferLoadStore;
+    return b;
+}
+
+/*!
+    \return a shader resource binding for a read-write storage buffer with the
+    given \a binding number and pipeline \a stage. This overload binds a
+    region only, as specified by \a offset and \a size.
+
+    \note \a buf must have been created with QRhiBuffer::StorageBuffer.
+ */
+QRhiShaderResourceBinding QRhiShaderResourceBinding::bufferLoadStore(
+        int binding, StageFlags stage, QRhiBuffer *buf, int offset, int size)
+{
+    QRhiShaderResourceBinding b = bufferLoad(binding, stage, buf, offset, size);
+    QRhiShaderResourceBindingPrivate::get(&b)->type = BufferLoadStore;
+    return b;
+}
+
 /*!
     \return \c true if the contents of the two QRhiShaderResourceBinding
     objects \a a and \a b are equal. This includes the resources (buffer,
@@ -2543,6 +2931,29 @@ bool operator==(const QRhiShaderResourceBinding &a, const QRhiShaderResourceBind
             return false;
         }
         break;
+    case QRhiShaderResourceBinding::ImageLoad:
+        Q_FALLTHROUGH();
+    case QRhiShaderResourceBinding::ImageStore:
+        Q_FALLTHROUGH();
+    case QRhiShaderResourceBinding::ImageLoadStore:
+        if (a.d->u.simage.tex != b.d->u.simage.tex
+                || a.d->u.simage.level != b.d->u.simage.level)
+        {
+            return false;
+        }
+        break;
+    case QRhiShaderResourceBinding::BufferLoad:
+        Q_FALLTHROUGH();
+    case QRhiShaderResourceBinding::BufferStore:
+        Q_FALLTHROUGH();
+    case QRhiShaderResourceBinding::BufferLoadStore:
+        if (a.d->u.sbuf.buf != b.d->u.sbuf.buf
+                || a.d->u.sbuf.offset != b.d->u.sbuf.offset
+                || a.d->u.sbuf.maybeSize != b.d->u.sbuf.maybeSize)
+        {
+            return false;
+        }
+        break;
     default:
         Q_UNREACHABLE();
         return false;
@@ -2597,6 +3008,45 @@ QDebug operator<<(QDebug dbg, const QRhiShaderResourceBinding &b)
                       << " sampler=" << d->u.stex.sampler
                       << ')';
         break;
+    case QRhiShaderResourceBinding::ImageLoad:
+        dbg.nospace() << " ImageLoad("
+                      << "texture=" << d->u.simage.tex
+                      << " level=" << d->u.simage.level
+                      << ')';
+        break;
+    case QRhiShaderResourceBinding::ImageStore:
+        dbg.nospace() << " ImageStore("
+                      << "texture=" << d->u.simage.tex
+                      << " level=" << d->u.simage.level
+                      << ')';
+        break;
+    case QRhiShaderResourceBinding::ImageLoadStore:
+        dbg.nospace() << " ImageLoadStore("
+                      << "texture=" << d->u.simage.tex
+                      << " level=" << d->u.simage.level
+                      << ')';
+        break;
+    case QRhiShaderResourceBinding::BufferLoad:
+        dbg.nospace() << " BufferLoad("
+                      << "buffer=" << d->u.sbuf.buf
+                      << " offset=" << d->u.sbuf.offset
+                      << " maybeSize=" << d->u.sbuf.maybeSize
+                      << ')';
+        break;
+    case QRhiShaderResourceBinding::BufferStore:
+        dbg.nospace() << " BufferStore("
+                      << "buffer=" << d->u.sbuf.buf
+                      << " offset=" << d->u.sbuf.offset
+                      << " maybeSize=" << d->u.sbuf.maybeSize
+                      << ')';
+        break;
+    case QRhiShaderResourceBinding::BufferLoadStore:
+        dbg.nospace() << " BufferLoadStore("
+                      << "buffer=" << d->u.sbuf.buf
+                      << " offset=" << d->u.sbuf.offset
+                      << " maybeSize=" << d->u.sbuf.maybeSize
+                      << ')';
+        break;
     default:
         Q_UNREACHABLE();
         break;
@@ -2807,6 +3257,41 @@ QRhiGraphicsPipeline::QRhiGraphicsPipeline(QRhiImplementation *rhi)
     Regardless of the return value, calling release() is always safe.
  */
 
+/*!
+    \class QRhiComputePipeline
+    \inmodule QtRhi
+    \brief Compute pipeline state resource.
+
+    \note Setting the shader resource bindings is mandatory. The referenced
+    QRhiShaderResourceBindings must already be built by the time build() is
+    called.
+
+    \note Setting the shader is mandatory. The QBakedShader must contain a
+    compute shader (QBakedShader::ComputeStage).
+
+    Compute pipelines can only be used when QRhi::Compute is reported as
+    supported.
+ */
+
+/*!
+    \internal
+ */
+QRhiComputePipeline::QRhiComputePipeline(QRhiImplementation *rhi)
+    : QRhiResource(rhi)
+{
+}
+
+/*!
+    \fn bool QRhiComputePipeline::build()
+
+    Creates the corresponding native graphics resources. If there are already
+    resources present due to an earlier build() with no corresponding
+    release(), then release() is called implicitly first.
+
+    \return \c true when successful, \c false when a graphics operation failed.
+    Regardless of the return value, calling release() is always safe.
+ */
+
 /*!
     \class QRhiSwapChain
     \inmodule QtRhi
@@ -3098,6 +3583,11 @@ QRhiImplementation::~QRhiImplementation()
     qDeleteAll(resUpdPool);
 
     if (rsh) {
+        // What is still alive is not accounted for anymore, also not when
+        // orphaned shareable resources live on.
+        for (int i = 0; i < MemoryCategoryCount; ++i)
+            rsh->memoryBytes[i].fetchAndAddRelaxed(-memoryBytes[i]);
+
         for (QRhiResource *res : qAsConst(resources)) {
             if (res->isShareable()) {
                 res->m_orphanedWithRsh = rsh;
@@ -3129,6 +3619,147 @@ void QRhiImplementation::sendVMemStatsToProfiler()
     // nothing to do in the default implementation
 }
 
+static inline bool isTransientAttachment(QRhiTexture *tex, QRhiRenderBuffer *rb)
+{
+    return (tex && tex->flags().testFlag(QRhiTexture::Transient))
+            || (rb && rb->flags().testFlag(QRhiRenderBuffer::Transient));
+}
+
+/*!
+    \internal
+
+    \return the load operation for \a att in \a rt, taking
+    QRhiTextureRenderTarget::PreserveColorContents into account. Transient
+    attachments never load.
+ */
+QRhiColorAttachment::LoadOp QRhiImplementation::colorLoadOp(const QRhiTextureRenderTarget *rt,
+                                                            const QRhiColorAttachment &att)
+{
+    QRhiColorAttachment::LoadOp op = att.loadOp();
+    if (rt->flags().testFlag(QRhiTextureRenderTarget::PreserveColorContents))
+        op = QRhiColorAttachment::LoadOpLoad;
+
+    if (op == QRhiColorAttachment::LoadOpLoad && isTransientAttachment(att.texture(), att.renderBuffer()))
+        return QRhiColorAttachment::LoadOpClear;
+
+    return op;
+}
+
+/*!
+    \internal
+
+    \return the store operation for \a att. Transient attachments are never
+    stored.
+ */
+QRhiColorAttachment::StoreOp QRhiImplementation::colorStoreOp(const QRhiColorAttachment &att)
+{
+    if (isTransientAttachment(att.texture(), att.renderBuffer()))
+        return QRhiColorAttachment::StoreOpDontCare;
+
+    return att.storeOp();
+}
+
+/*!
+    \internal
+
+    \return the store operation for the depth/stencil attachment of \a rt.
+    Transient attachments are never stored.
+ */
+QRhiColorAttachment::StoreOp QRhiImplementation::depthStencilStoreOp(const QRhiTextureRenderTarget *rt)
+{
+    const QRhiTextureRenderTargetDescription desc = rt->description();
+    if (isTransientAttachment(desc.depthTexture(), desc.depthStencilBuffer()))
+        return QRhiColorAttachment::StoreOpDontCare;
+
+    return desc.depthStencilStoreOp();
+}
+
+/*!
+    \internal
+
+    \return the load operation for the depth/stencil attachment of \a rt,
+    taking QRhiTextureRenderTarget::PreserveDepthStencilContents into account.
+    Transient attachments never load.
+ */
+QRhiColorAttachment::LoadOp QRhiImplementation::depthStencilLoadOp(const QRhiTextureRenderTarget *rt)
+{
+    const QRhiTextureRenderTargetDescription desc = rt->description();
+    QRhiColorAttachment::LoadOp op = desc.depthStencilLoadOp();
+    if (rt->flags().testFlag(QRhiTextureRenderTarget::PreserveDepthStencilContents))
+        op = QRhiColorAttachment::LoadOpLoad;
+
+    if (op == QRhiColorAttachment::LoadOpLoad && isTransientAttachment(desc.depthTexture(), desc.depthStencilBuffer()))
+        return QRhiColorAttachment::LoadOpClear;
+
+    return op;
+}
+
+/*!
+    \internal
+
+    Stores the region of the level of size \a levelSize that is to be read
+    back according to \a rb in \a rect. This is the full level when no
+    rectangle was specified.
+
+    \return false (after printing a warning) if the rectangle is not fully
+    inside the level.
+ */
+bool QRhiImplementation::readbackRect(const QRhiReadbackDescription &rb, const QSize &levelSize, QRect *rect)
+{
+    const QRect levelRect(QPoint(0, 0), levelSize);
+    if (rb.rect().isEmpty()) {
+        *rect = levelRect;
+        return true;
+    }
+    if (!levelRect.contains(rb.rect())) {
+        qWarning("Readback rectangle (%d, %d) %dx%d is outside the %dx%d level",
+                 rb.rect().x(), rb.rect().y(), rb.rect().width(), rb.rect().height(),
+                 levelSize.width(), levelSize.height());
+        return false;
+    }
+    *rect = rb.rect();
+    return true;
+}
+
+/*!
+    \internal
+
+    Copies \a size bytes of read back pixel data from \a src either to the
+    caller-provided QRhiReadbackResult::destination, when set, or to
+    QRhiReadbackResult::data of \a result.
+ */
+void QRhiImplementation::storeReadbackData(QRhiReadbackResult *result, const void *src, quint32 size)
+{
+    if (result->destination) {
+        if (result->destinationSize < size) {
+            qWarning("Readback destination of %u bytes is too small, need %u bytes",
+                     result->destinationSize, size);
+            return;
+        }
+        memcpy(result->destination, src, size);
+    } else {
+        result->data.resize(int(size));
+        memcpy(result->data.data(), src, size);
+    }
+}
+
+// Returns how many of the drawCount commands, starting at offset and stride
+// bytes apart, fit in buf. Warns about the first one that does not. The
+// positions are 64-bit since offset + i * stride may not fit in 32 bits.
+quint32 QRhiImplementation::indirectDrawCountInRange(QRhiBuffer *buf, quint32 offset, quint32 drawCount,
+                                                     quint32 stride, quint32 commandSize) const
+{
+    const quint64 size = quint64(buf->size());
+    quint64 count = 0;
+    if (quint64(offset) + commandSize <= size)
+        count = stride ? (size - commandSize - offset) / stride + 1 : drawCount;
+    if (count >= drawCount)
+        return drawCount;
+
+    qWarning("Indirect draw command %u is out of range (buffer size %d)", quint32(count), buf->size());
+    return quint32(count);
+}
+
 bool QRhiImplementation::isCompressedFormat(QRhiTexture::Format format) const
 {
     return (format >= QRhiTexture::BC1 && format <= QRhiTexture::BC7)
@@ -3278,6 +3909,31 @@ void QRhiImplementation::textureFormatInfo(QRhiTexture::Format format, const QSi
     case QRhiTexture::R16:
         bpc = 2;
         break;
+    case QRhiTexture::RED_OR_ALPHA8:
+        bpc = 1;
+        break;
+
+    case QRhiTexture::RG8:
+        bpc = 2;
+        break;
+    case QRhiTexture::RG16:
+        bpc = 4;
+        break;
+    case QRhiTexture::RGBA16F:
+        bpc = 8;
+        break;
+    case QRhiTexture::RGBA32F:
+        bpc = 16;
+        break;
+    case QRhiTexture::R16F:
+        bpc = 2;
+        break;
+    case QRhiTexture::R32F:
+        bpc = 4;
+        break;
+    case QRhiTexture::B10G11R11_UFLOAT:
+        bpc = 4;
+        break;
 
     case QRhiTexture::D16:
         bpc = 2;
@@ -3313,6 +3969,85 @@ quint32 QRhiImplementation::approxByteSizeForTexture(QRhiTexture::Format format,
     return approxSize;
 }
 
+quint32 QRhiImplementation::approxByteSizeForRenderBuffer(QRhiRenderBuffer::Type type, const QSize &size, int sampleCount)
+{
+    // just make up something, ds is likely D24S8 while color is RGBA8 or similar
+    const QRhiTexture::Format assumedFormat = type == QRhiRenderBuffer::DepthStencil ? QRhiTexture::D32 : QRhiTexture::RGBA8;
+    quint32 byteSize = approxByteSizeForTexture(assumedFormat, size, 1, 1);
+    if (sampleCount > 1)
+        byteSize *= sampleCount;
+    return byteSize;
+}
+
+void QRhiImplementation::addMemory(MemoryCategory category, quint64 key, int slot, qint64 byteSize)
+{
+    // a rebuild without release (staging slot reuse, swapchain-like resizes)
+    // replaces the previous size
+    qint64 &allocation(memoryAllocations[category][qMakePair(key, slot)]);
+    const qint64 delta = byteSize - allocation;
+    allocation = byteSize;
+    memoryBytes[category] += delta;
+    if (rsh)
+        rsh->memoryBytes[category].fetchAndAddRelaxed(delta);
+
+    if (memoryBudget > 0 && !overMemoryBudget && memoryStatistics().totalBytes() > memoryBudget) {
+        overMemoryBudget = true;
+        memoryPressurePending = true;
+    }
+}
+
+void QRhiImplementation::removeMemory(MemoryCategory category, quint64 key, int slot)
+{
+    auto it = memoryAllocations[category].find(qMakePair(key, slot));
+    if (it == memoryAllocations[category].end())
+        return;
+
+    const qint64 delta = -it.value();
+    memoryAllocations[category].erase(it);
+    memoryBytes[category] += delta;
+    if (rsh)
+        rsh->memoryBytes[category].fetchAndAddRelaxed(delta);
+
+    if (overMemoryBudget && memoryStatistics().totalBytes() <= memoryBudget)
+        overMemoryBudget = false;
+}
+
+static inline QRhiMemoryStatistics toMemoryStatistics(const qint64 *bytes)
+{
+    QRhiMemoryStatistics s;
+    s.bufferBytes = bytes[QRhiImplementation::BufferMemory];
+    s.textureBytes = bytes[QRhiImplementation::TextureMemory];
+    s.renderBufferBytes = bytes[QRhiImplementation::RenderBufferMemory];
+    s.stagingBytes = bytes[QRhiImplementation::StagingMemory];
+    s.readbackBytes = bytes[QRhiImplementation::ReadbackMemory];
+    return s;
+}
+
+QRhiMemoryStatistics QRhiImplementation::memoryStatistics() const
+{
+    return toMemoryStatistics(memoryBytes);
+}
+
+void QRhiImplementation::invokeMemoryPressureCallback()
+{
+    if (!memoryPressurePending)
+        return;
+
+    memoryPressurePending = false;
+    if (memoryPressureCallback)
+        memoryPressureCallback(memoryStatistics());
+}
+
+/*!
+    \class QRhiMemoryStatistics
+    \inmodule QtRhi
+    \brief Contains the approximate memory usage of native graphics resources.
+
+    The values are in bytes. totalBytes() returns the sum of all of them.
+
+    \sa QRhi::memoryStatistics(), QRhiResourceSharingHost::memoryStatistics()
+ */
+
 /*!
     \class QRhiResourceSharingHost
     \inmodule QtRhi
@@ -3464,6 +4199,25 @@ QRhiResourceSharingHost::~QRhiResourceSharingHost()
     delete d;
 }
 
+/*!
+    \return the sum of the memory statistics of all QRhi instances currently
+    using this QRhiResourceSharingHost.
+
+    Shareable resources that outlive the QRhi that created them are no longer
+    accounted for once that QRhi is destroyed.
+
+    This function is safe to call from any thread.
+
+    \sa QRhi::memoryStatistics()
+ */
+QRhiMemoryStatistics QRhiResourceSharingHost::memoryStatistics() const
+{
+    qint64 bytes[QRhiImplementation::MemoryCategoryCount];
+    for (int i = 0; i < QRhiImplementation::MemoryCategoryCount; ++i)
+        bytes[i] = d->memoryBytes[i].loadAcquire();
+    return toMemoryStatistics(bytes);
+}
+
 /*!
     \internal
  */
@@ -3796,6 +4550,30 @@ void QRhiResourceUpdateBatch::readBackTexture(const QRhiReadbackDescription &rb,
     d->textureOps.append(QRhiResourceUpdateBatchPrivate::TextureOp::textureRead(rb, result));
 }
 
+/*!
+   Enqueues reading back \a size bytes from \a buf starting at \a offset.
+   When \a size is 0, everything from \a offset to the end of the buffer is
+   read.
+
+   Like with readBackTexture(), the operation is asynchronous. The data is
+   available in \a result once its \l{QRhiBufferReadbackResult::completed}{completed}
+   callback is invoked, which happens at the latest when the frame slot is
+   reused. The readback is performed after the buffer updates enqueued on the
+   same batch, but before the texture operations.
+
+   The contents of a QRhiBuffer::Dynamic buffer are returned as they are for
+   the current frame slot.
+
+   \note Not all backends and graphics APIs support reading back buffers. With
+   OpenGL ES 2.0 for example only uniform buffers can be read back. A warning
+   is printed and \a result is left untouched in this case.
+ */
+void QRhiResourceUpdateBatch::readBackBuffer(QRhiBuffer *buf, int offset, int size, QRhiBufferReadbackResult *result)
+{
+    Q_ASSERT(offset + size <= buf->size());
+    d->bufferReadbacks.append(QRhiResourceUpdateBatchPrivate::BufferReadback(buf, offset, size, result));
+}
+
 /*!
    Enqueues a mipmap generation operation for the texture \a tex.
 
@@ -3855,6 +4633,7 @@ void QRhiResourceUpdateBatchPrivate::free()
 
     dynamicBufferUpdates.clear();
     staticBufferUploads.clear();
+    bufferReadbacks.clear();
     textureOps.clear();
 
     rhi->resUpdPoolMap.clearBit(poolIndex);
@@ -3865,6 +4644,7 @@ void QRhiResourceUpdateBatchPrivate::merge(QRhiResourceUpdateBatchPrivate *other
 {
     dynamicBufferUpdates += other->dynamicBufferUpdates;
     staticBufferUploads += other->staticBufferUploads;
+    bufferReadbacks += other->bufferReadbacks;
     textureOps += other->textureOps;
 }
 
@@ -3877,6 +4657,10 @@ void QRhiResourceUpdateBatchPrivate::merge(QRhiResourceUpdateBatchPrivate *other
  */
 void QRhiCommandBuffer::resourceUpdate(QRhiResourceUpdateBatch *resourceUpdates)
 {
+    QRHI_PROF;
+    QRHI_PROF_F(countResourceUpdates(resourceUpdates));
+    QRHI_CAP;
+    QRHI_CAP_F(resourceUpdate(resourceUpdates));
     m_rhi->resourceUpdate(this, resourceUpdates);
 }
 
@@ -3915,6 +4699,11 @@ void QRhiCommandBuffer::beginPass(QRhiRenderTarget *rt,
                                   const QRhiDepthStencilClearValue &depthStencilClearValue,
                                   QRhiResourceUpdateBatch *resourceUpdates)
 {
+    QRHI_PROF;
+    QRHI_PROF_F(countResourceUpdates(resourceUpdates));
+    QRHI_PROF_F(frameStats.passes++);
+    QRHI_CAP;
+    QRHI_CAP_F(beginPass(rt, colorClearValue, depthStencilClearValue, resourceUpdates));
     m_rhi->beginPass(this, rt, colorClearValue, depthStencilClearValue, resourceUpdates);
 }
 
@@ -3926,9 +4715,55 @@ void QRhiCommandBuffer::beginPass(QRhiRenderTarget *rt,
  */
 void QRhiCommandBuffer::endPass(QRhiResourceUpdateBatch *resourceUpdates)
 {
+    QRHI_PROF;
+    QRHI_PROF_F(countResourceUpdates(resourceUpdates));
+    QRHI_CAP;
+    QRHI_CAP_F(endPass(resourceUpdates));
     m_rhi->endPass(this, resourceUpdates);
 }
 
+/*!
+    Records starting a new compute pass.
+
+    \a resourceUpdates, when not null, specifies a resource update batch that
+    is to be committed and then released.
+
+    Writes performed by earlier render passes and resource updates are made
+    visible to the compute shaders of the pass. Likewise, the results of the
+    dispatches in the pass are made visible to subsequent passes, for example
+    to the vertex input and the shaders of a render pass, once endComputePass()
+    is recorded. Consecutive dispatch() calls within a pass are also ordered so
+    that a dispatch sees the writes of the previous ones.
+
+    \note Compute passes cannot be nested into render passes, and vice versa.
+
+    \note Only available when QRhi::Compute is reported as supported.
+ */
+void QRhiCommandBuffer::beginComputePass(QRhiResourceUpdateBatch *resourceUpdates)
+{
+    QRHI_PROF;
+    QRHI_PROF_F(countResourceUpdates(resourceUpdates));
+    QRHI_PROF_F(frameStats.passes++);
+    QRHI_CAP;
+    QRHI_CAP_F(beginComputePass(resourceUpdates));
+    m_rhi->beginComputePass(this, resourceUpdates);
+}
+
+/*!
+    Records ending the current compute pass.
+
+    \a resourceUpdates, when not null, specifies a resource update batch that
+    is to be committed and then released.
+ */
+void QRhiCommandBuffer::endComputePass(QRhiResourceUpdateBatch *resourceUpdates)
+{
+    QRHI_PROF;
+    QRHI_PROF_F(countResourceUpdates(resourceUpdates));
+    QRHI_CAP;
+    QRHI_CAP_F(endComputePass(resourceUpdates));
+    m_rhi->endComputePass(this, resourceUpdates);
+}
+
 /*!
     Records setting a new graphics pipeline \a ps.
 
@@ -3944,15 +4779,38 @@ void QRhiCommandBuffer::endPass(QRhiResourceUpdateBatch *resourceUpdates)
  */
 void QRhiCommandBuffer::setGraphicsPipeline(QRhiGraphicsPipeline *ps)
 {
+    QRHI_PROF;
+    QRHI_PROF_F(frameStats.pipelineBinds++);
+    QRHI_CAP;
+    QRHI_CAP_F(setGraphicsPipeline(ps));
     m_rhi->setGraphicsPipeline(this, ps);
 }
 
+/*!
+    Records setting a new compute pipeline \a ps.
+
+    \note This function must be called before recording setShaderResources()
+    or dispatch() commands on the command buffer.
+
+    \note This function can only be called inside a compute pass, meaning
+    between a beginComputePass() and endComputePass() call.
+ */
+void QRhiCommandBuffer::setComputePipeline(QRhiComputePipeline *ps)
+{
+    QRHI_PROF;
+    QRHI_PROF_F(frameStats.pipelineBinds++);
+    QRHI_CAP;
+    QRHI_CAP_F(setComputePipeline(ps));
+    m_rhi->setComputePipeline(this, ps);
+}
+
 /*!
     Records binding a set of shader resources, such as, uniform buffers or
     textures, that are made visible to one or more shader stages.
 
-    \a srb can be null in which case the current graphics pipeline's associated
-    QRhiGraphicsPipeline::shaderResourceBindings() is used. When \a srb is
+    \a srb can be null in which case the current graphics or compute pipeline's
+    associated QRhiGraphicsPipeline::shaderResourceBindings() or
+    QRhiComputePipeline::shaderResourceBindings() is used. When \a srb is
     non-null, it must be
     \l{QRhiShaderResourceBindings::isLayoutCompatible()}{layout-compatible},
     meaning the layout (number of bindings, the type and binding number of each
@@ -3986,11 +4844,15 @@ void QRhiCommandBuffer::setGraphicsPipeline(QRhiGraphicsPipeline *ps)
     to avoid calls to this function is not necessary on the applications' side.
 
     \note This function can only be called inside a pass, meaning between a
-    beginPass() end endPass() call.
+    beginPass() end endPass(), or beginComputePass() and endComputePass() call.
  */
 void QRhiCommandBuffer::setShaderResources(QRhiShaderResourceBindings *srb,
                                            const QVector<DynamicOffset> &dynamicOffsets)
 {
+    QRHI_PROF;
+    QRHI_PROF_F(frameStats.shaderResourceBinds++);
+    QRHI_CAP;
+    QRHI_CAP_F(setShaderResources(srb, dynamicOffsets));
     m_rhi->setShaderResources(this, srb, dynamicOffsets);
 }
 
@@ -4050,6 +4912,10 @@ void QRhiCommandBuffer::setVertexInput(int startBinding, const QVector<VertexInp
                                        QRhiBuffer *indexBuf, quint32 indexOffset,
                                        IndexFormat indexFormat)
 {
+    QRHI_PROF;
+    QRHI_PROF_F(frameStats.vertexInputBinds++);
+    QRHI_CAP;
+    QRHI_CAP_F(setVertexInput(startBinding, bindings, indexBuf, indexOffset, indexFormat));
     m_rhi->setVertexInput(this, startBinding, bindings, indexBuf, indexOffset, indexFormat);
 }
 
@@ -4069,6 +4935,8 @@ void QRhiCommandBuffer::setVertexInput(int startBinding, const QVector<VertexInp
  */
 void QRhiCommandBuffer::setViewport(const QRhiViewport &viewport)
 {
+    QRHI_CAP;
+    QRHI_CAP_F(setViewport(viewport));
     m_rhi->setViewport(this, viewport);
 }
 
@@ -4088,6 +4956,8 @@ void QRhiCommandBuffer::setViewport(const QRhiViewport &viewport)
  */
 void QRhiCommandBuffer::setScissor(const QRhiScissor &scissor)
 {
+    QRHI_CAP;
+    QRHI_CAP_F(setScissor(scissor));
     m_rhi->setScissor(this, scissor);
 }
 
@@ -4102,6 +4972,8 @@ void QRhiCommandBuffer::setScissor(const QRhiScissor &scissor)
  */
 void QRhiCommandBuffer::setBlendConstants(const QVector4D &c)
 {
+    QRHI_CAP;
+    QRHI_CAP_F(setBlendConstants(c));
     m_rhi->setBlendConstants(this, c);
 }
 
@@ -4116,9 +4988,59 @@ void QRhiCommandBuffer::setBlendConstants(const QVector4D &c)
  */
 void QRhiCommandBuffer::setStencilRef(quint32 refValue)
 {
+    QRHI_CAP;
+    QRHI_CAP_F(setStencilRef(refValue));
     m_rhi->setStencilRef(this, refValue);
 }
 
+/*!
+    Records updating \a size bytes of push constant data at \a offset from
+    \a data. The data is copied, so \a data does not need to stay valid after
+    the function returns.
+
+    Push constants are a small block of data, declared in the shader as a \c
+    push_constant uniform block, that is set directly in the command buffer,
+    without going through a QRhiBuffer and the shader resource bindings.
+    This makes them suitable for small, frequently changing per-draw data,
+    such as a model matrix or an object index.
+
+    \a stages specifies the shader stages that read the data. Some backends
+    update the data for all stages that declare a push constant block
+    overlapping the range, regardless of \a stages.
+
+    \a offset and \a size must be multiples of 4, and \c{offset + size} must
+    not exceed the value reported for QRhi::PushConstantsSizeMax, which is
+    guaranteed to be at least 128 bytes when QRhi::PushConstants is supported.
+
+    The data is associated with the currently bound pipeline, so this must be
+    called after setGraphicsPipeline() or setComputePipeline(). Push constant
+    values are not guaranteed to be preserved when a different pipeline is
+    bound.
+
+    \note With OpenGL push constant blocks are translated to plain uniforms,
+    with one uniform per block member in each program. \a stages is ignored,
+    every stage of the current pipeline that declares the block gets the data.
+    The range must be within the largest push constant block the shaders of
+    the current pipeline declare, otherwise the update is ignored with a
+    warning. The members are set with glUniform calls when the command buffer
+    is executed, so this is not cheaper than updating a uniform buffer.
+
+    \note Only supported when QRhi::PushConstants is reported as supported.
+
+    \note This function can only be called inside a pass or compute pass.
+ */
+void QRhiCommandBuffer::setPushConstants(QRhiShaderResourceBinding::StageFlags stages,
+                                         quint32 offset, quint32 size, const void *data)
+{
+    Q_ASSERT(offset % 4 == 0 && size % 4 == 0);
+    if (size == 0)
+        return;
+
+    QRHI_CAP;
+    QRHI_CAP_F(setPushConstants(stages, offset, size, data));
+    m_rhi->setPushConstants(this, stages, offset, size, data);
+}
+
 /*!
     Records a non-indexed draw.
 
@@ -4133,6 +5055,10 @@ void QRhiCommandBuffer::setStencilRef(quint32 refValue)
 void QRhiCommandBuffer::draw(quint32 vertexCount,
                              quint32 instanceCount, quint32 firstVertex, quint32 firstInstance)
 {
+    QRHI_PROF;
+    QRHI_PROF_F(frameStats.drawCalls++);
+    QRHI_CAP;
+    QRHI_CAP_F(draw(vertexCount, instanceCount, firstVertex, firstInstance));
     m_rhi->draw(this, vertexCount, instanceCount, firstVertex, firstInstance);
 }
 
@@ -4161,9 +5087,130 @@ void QRhiCommandBuffer::drawIndexed(quint32 indexCount,
                                     quint32 instanceCount, quint32 firstIndex,
                                     qint32 vertexOffset, quint32 firstInstance)
 {
+    QRHI_PROF;
+    QRHI_PROF_F(frameStats.drawCalls++);
+    QRHI_CAP;
+    QRHI_CAP_F(drawIndexed(indexCount, instanceCount, firstIndex, vertexOffset, firstInstance));
     m_rhi->drawIndexed(this, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
 }
 
+/*!
+    \class QRhiCommandBuffer::DrawIndirectCommand
+    \inmodule QtRhi
+    \brief The layout of an entry in an indirect buffer for drawIndirect().
+
+    The layout matches \c VkDrawIndirectCommand, \c
+    DrawArraysIndirectCommand in OpenGL, \c
+    D3D11_DRAW_INSTANCED_INDIRECT_ARGS, and \c
+    MTLDrawPrimitivesIndirectArguments.
+ */
+
+/*!
+    \class QRhiCommandBuffer::DrawIndexedIndirectCommand
+    \inmodule QtRhi
+    \brief The layout of an entry in an indirect buffer for drawIndexedIndirect().
+
+    The layout matches \c VkDrawIndexedIndirectCommand, \c
+    DrawElementsIndirectCommand in OpenGL, \c
+    D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS, and \c
+    MTLDrawIndexedPrimitivesIndirectArguments.
+ */
+
+/*!
+    Records \a drawCount non-indexed draws with the parameters sourced from
+    \a indirectBuffer, starting at the byte offset \a indirectBufferOffset.
+    Each entry is a DrawIndirectCommand, and consecutive entries are \a stride
+    bytes apart.
+
+    \a indirectBuffer must have been created with QRhiBuffer::IndirectBuffer.
+    \a indirectBufferOffset and \a stride must be multiples of 4. When \a
+    drawCount is larger than 1, \a stride must be at least the size of
+    DrawIndirectCommand.
+
+    The contents of the buffer are read by the GPU when executing the command
+    buffer, so the commands can be generated on the GPU, for instance by a
+    compute shader performing culling, without a round trip to the CPU.
+    Commands that would be read from beyond the end of the buffer are skipped
+    with a warning.
+
+    \note A non-zero \c firstInstance may not be supported by all
+    implementations.
+
+    \note Only supported when QRhi::DrawIndirect is reported as supported.
+    Check QRhi::DrawIndirectMulti to find out if a \a drawCount larger than 1
+    results in a single call to the underlying API.
+
+    \note This function can only be called inside a pass, meaning between a
+    beginPass() end endPass() call.
+ */
+void QRhiCommandBuffer::drawIndirect(QRhiBuffer *indirectBuffer, quint32 indirectBufferOffset,
+                                     quint32 drawCount, quint32 stride)
+{
+    if (drawCount == 0)
+        return;
+
+    QRHI_PROF;
+    QRHI_PROF_F(frameStats.drawCalls += int(drawCount));
+    QRHI_CAP;
+    QRHI_CAP_F(drawIndirect(QRhiCapture::DrawIndirect, indirectBuffer, indirectBufferOffset, drawCount, stride));
+    m_rhi->drawIndirect(this, indirectBuffer, indirectBufferOffset, drawCount, stride);
+}
+
+/*!
+    Records \a drawCount indexed draws with the parameters sourced from \a
+    indirectBuffer, starting at the byte offset \a indirectBufferOffset. Each
+    entry is a DrawIndexedIndirectCommand, and consecutive entries are \a
+    stride bytes apart.
+
+    The index buffer is the one specified in the last setVertexInput() call.
+
+    \a indirectBuffer must have been created with QRhiBuffer::IndirectBuffer.
+    \a indirectBufferOffset and \a stride must be multiples of 4. When \a
+    drawCount is larger than 1, \a stride must be at least the size of
+    DrawIndexedIndirectCommand. Commands that would be read from beyond the end
+    of the buffer are skipped with a warning.
+
+    \note With OpenGL there is no way to specify an index buffer offset for
+    indirect draws, so the \c indexOffset passed to setVertexInput() must be
+    0. Use the \c firstIndex member of the commands instead. Otherwise the
+    draw is ignored with a warning.
+
+    \note Only supported when QRhi::DrawIndirect is reported as supported.
+    Check QRhi::DrawIndirectMulti to find out if a \a drawCount larger than 1
+    results in a single call to the underlying API.
+
+    \note This function can only be called inside a pass, meaning between a
+    beginPass() end endPass() call.
+ */
+void QRhiCommandBuffer::drawIndexedIndirect(QRhiBuffer *indirectBuffer, quint32 indirectBufferOffset,
+                                            quint32 drawCount, quint32 stride)
+{
+    if (drawCount == 0)
+        return;
+
+    QRHI_PROF;
+    QRHI_PROF_F(frameStats.drawCalls += int(drawCount));
+    QRHI_CAP;
+    QRHI_CAP_F(drawIndirect(QRhiCapture::DrawIndexedIndirect, indirectBuffer, indirectBufferOffset, drawCount, stride));
+    m_rhi->drawIndexedIndirect(this, indirectBuffer, indirectBufferOffset, drawCount, stride);
+}
+
+/*!
+    Records dispatching compute work items, with \a x, \a y, and \a z
+    specifying the number of local workgroups in the corresponding dimension.
+
+    \note This function can only be called inside a compute pass, meaning
+    between a beginComputePass() and endComputePass() call.
+ */
+void QRhiCommandBuffer::dispatch(int x, int y, int z)
+{
+    QRHI_PROF;
+    QRHI_PROF_F(frameStats.dispatchCalls++);
+    QRHI_CAP;
+    QRHI_CAP_F(dispatch(x, y, z));
+    m_rhi->dispatch(this, x, y, z);
+}
+
 /*!
     Records a named debug group on the command buffer. This is shown in
     graphics debugging tools such as \l{https://renderdoc.org/}{RenderDoc} and
@@ -4174,9 +5221,15 @@ void QRhiCommandBuffer::drawIndexed(quint32 indexCount,
     QRhi::EnableDebugMarkers is not set.
 
     \note Can be called anywhere within the frame, both inside and outside of passes.
+
+    \sa QRhiProfiler::setMarkerTimingEnabled()
  */
 void QRhiCommandBuffer::debugMarkBegin(const QByteArray &name)
 {
+    QRHI_PROF;
+    QRHI_PROF_F(debugMarkBegin(this, name));
+    QRHI_CAP;
+    QRHI_CAP_F(debugMarkBegin(name));
     m_rhi->debugMarkBegin(this, name);
 }
 
@@ -4190,6 +5243,10 @@ void QRhiCommandBuffer::debugMarkBegin(const QByteArray &name)
  */
 void QRhiCommandBuffer::debugMarkEnd()
 {
+    QRHI_PROF;
+    QRHI_PROF_F(debugMarkEnd(this));
+    QRHI_CAP;
+    QRHI_CAP_F(debugMarkEnd());
     m_rhi->debugMarkEnd(this);
 }
 
@@ -4205,6 +5262,8 @@ void QRhiCommandBuffer::debugMarkEnd()
  */
 void QRhiCommandBuffer::debugMarkMsg(const QByteArray &msg)
 {
+    QRHI_CAP;
+    QRHI_CAP_F(debugMarkMsg(msg));
     m_rhi->debugMarkMsg(this, msg);
 }
 
@@ -4291,6 +5350,20 @@ bool QRhi::isTextureFormatSupported(QRhiTexture::Format format, QRhiTexture::Fla
     return d->isTextureFormatSupported(format, flags);
 }
 
+/*!
+    \return \c true if the specified vertex attribute \a format can be used in
+    the vertex input layout of a graphics pipeline.
+
+    Float, Float2, Float3, Float4, UNormByte2, and UNormByte4 are always
+    supported. The half precision, integer, and packed formats require, for
+    example, OpenGL 3.0 (3.3 for the packed formats) or OpenGL ES 3.0. With
+    D3D11 SNormA2B10G10R10 is not supported.
+ */
+bool QRhi::isVertexFormatSupported(QRhiVertexInputAttribute::Format format) const
+{
+    return d->isVertexFormatSupported(format);
+}
+
 /*!
     \return \c true if the specified \a feature is supported
  */
@@ -4337,6 +5410,94 @@ QRhiProfiler *QRhi::profiler()
     return &d->profiler;
 }
 
+/*!
+    \return the capture object for this QRhi. Setting an output device on it
+    records the resources and commands issued through this QRhi, to be
+    replayed later with the \c qrhireplay tool.
+
+    \sa QRhiCapture
+ */
+QRhiCapture *QRhi::capture()
+{
+    return &d->capture;
+}
+
+/*!
+    \return the approximate amount of memory currently used by the native
+    resources created via this QRhi, grouped by resource type.
+
+    The accounting is always active, independently of
+    \l{QRhi::EnableProfiling}{EnableProfiling}. The values are estimates based
+    on the sizes the backends request from the graphics API: textures and
+    renderbuffers are calculated from their format, size, mip and layer
+    count, and sample count, while buffers include all the copies a
+    QRhiBuffer::Dynamic buffer has in order to allow multiple frames in
+    flight. With OpenGL, uniform buffers only exist as a copy in system
+    memory, which is counted in \c bufferBytes as well. \c stagingBytes and
+    \c readbackBytes cover the temporary buffers used for uploading textures
+    and buffers and reading them back. What the driver actually allocates may
+    differ due to alignment, padding, or compression. Swapchain buffers are not included. Resources created via
+    QRhiTexture::buildFrom() are not owned by the QRhi and are not counted
+    either.
+
+    \sa QRhiResourceSharingHost::memoryStatistics(), setMemoryBudget()
+ */
+QRhiMemoryStatistics QRhi::memoryStatistics() const
+{
+    return d->memoryStatistics();
+}
+
+/*!
+    \return the memory budget in bytes. The default is 0, meaning there is no
+    budget.
+
+    \sa setMemoryBudget()
+ */
+qint64 QRhi::memoryBudget() const
+{
+    return d->memoryBudget;
+}
+
+/*!
+    Sets the memory budget to \a bytes. 0 disables the budget.
+
+    When the total of memoryStatistics() grows above the budget, the callback
+    set via setMemoryPressureCallback() is invoked, so that the application
+    can release resources, for example evict textures from a cache, before
+    the driver starts paging. The callback is not invoked while in the middle
+    of building a resource, but rather in the next beginFrame() or
+    beginOffscreenFrame(), before the frame starts. It is therefore safe to
+    release resources from the callback.
+
+    The callback is invoked once each time the usage goes above the budget.
+    It gets invoked again only after the usage has dropped back to or below
+    the budget and exceeds it again.
+ */
+void QRhi::setMemoryBudget(qint64 bytes)
+{
+    d->memoryBudget = qMax<qint64>(0, bytes);
+    d->overMemoryBudget = d->memoryBudget > 0 && d->memoryStatistics().totalBytes() > d->memoryBudget;
+    d->memoryPressurePending = d->overMemoryBudget;
+}
+
+/*!
+    \typedef QRhi::MemoryPressureCallback
+
+    Synonym for std::function<void(const QRhiMemoryStatistics &)>. The
+    argument is the memoryStatistics() at the time of invoking the callback.
+ */
+
+/*!
+    Sets the \a callback to invoke on the QRhi's thread when the memory
+    budget is exceeded.
+
+    \sa setMemoryBudget()
+ */
+void QRhi::setMemoryPressureCallback(MemoryPressureCallback callback)
+{
+    d->memoryPressureCallback = callback;
+}
+
 /*!
     \return a new graphics pipeline resource.
 
@@ -4347,6 +5508,19 @@ QRhiGraphicsPipeline *QRhi::newGraphicsPipeline()
     return d->createGraphicsPipeline();
 }
 
+/*!
+    \return a new compute pipeline resource.
+
+    \note Compute is only available when the \l{QRhi::Compute}{Compute} feature
+    is reported as supported.
+
+    \sa QRhiResource::release(), QRhiResource::releaseAndDestroy()
+ */
+QRhiComputePipeline *QRhi::newComputePipeline()
+{
+    return d->createComputePipeline();
+}
+
 /*!
     \return a new shader resource binding collection resource.
 
@@ -4400,6 +5574,52 @@ QRhiTexture *QRhi::newTexture(QRhiTexture::Format format,
     return d->createTexture(format, pixelSize, sampleCount, flags);
 }
 
+/*!
+    \return a new 3D texture with the specified \a format, \a width, \a
+    height, \a depth, \a sampleCount, and \a flags. QRhiTexture::ThreeDimensional
+    is set implicitly.
+
+    \note Only supported when QRhi::ThreeDimensionalTextures is reported as
+    supported.
+
+    \sa QRhiResource::release(), QRhiResource::releaseAndDestroy()
+ */
+QRhiTexture *QRhi::newTexture(QRhiTexture::Format format,
+                              int width, int height, int depth,
+                              int sampleCount,
+                              QRhiTexture::Flags flags)
+{
+    QRhiTexture *t = d->createTexture(format, QSize(width, height), sampleCount,
+                                      flags | QRhiTexture::ThreeDimensional);
+    t->setDepth(depth);
+    return t;
+}
+
+/*!
+    \return a new 2D texture array with the specified \a format, \a
+    arraySize, \a pixelSize, \a sampleCount, and \a flags.
+    QRhiTexture::TextureArray is set implicitly.
+
+    All layers of the array can then be bound with a single shader resource
+    binding, and indexed in the shader (\c sampler2DArray), instead of using
+    one texture, and so one QRhiShaderResourceBindings, per layer.
+
+    \note Only supported when QRhi::TextureArrays is reported as supported.
+
+    \sa QRhiResource::release(), QRhiResource::releaseAndDestroy()
+ */
+QRhiTexture *QRhi::newTextureArray(QRhiTexture::Format format,
+                                   int arraySize,
+                                   const QSize &pixelSize,
+                                   int sampleCount,
+                                   QRhiTexture::Flags flags)
+{
+    QRhiTexture *t = d->createTexture(format, pixelSize, sampleCount,
+                                      flags | QRhiTexture::TextureArray);
+    t->setArraySize(arraySize);
+    return t;
+}
+
 /*!
     \return a new sampler with the specified magnification filter \a magFilter,
     minification filter \a minFilter, mipmapping mode \a mipmapMpde, and S/T/R
@@ -4474,8 +5694,17 @@ QRhiSwapChain *QRhi::newSwapChain()
 QRhi::FrameOpResult QRhi::beginFrame(QRhiSwapChain *swapChain, BeginFrameFlags flags)
 {
     Q_ASSERT(!d->inFrame);
+    d->invokeMemoryPressureCallback();
     d->inFrame = true;
-    return d->beginFrame(swapChain, flags);
+    QRhi::FrameOpResult r = d->beginFrame(swapChain, flags);
+    if (r == FrameOpSuccess) {
+        QRhiProfilerPrivate *rhiP = d->profilerPrivateOrNull();
+        QRHI_PROF_F(beginFrame(swapChain));
+        QRhiCapturePrivate::get(&d->capture)->startIfPending(d);
+        QRhiCapturePrivate *rhiC = d->capturePrivateOrNull();
+        QRHI_CAP_F(beginFrame(swapChain));
+    }
+    return r;
 }
 
 /*!
@@ -4494,7 +5723,12 @@ QRhi::FrameOpResult QRhi::beginFrame(QRhiSwapChain *swapChain, BeginFrameFlags f
 QRhi::FrameOpResult QRhi::endFrame(QRhiSwapChain *swapChain, EndFrameFlags flags)
 {
     Q_ASSERT(d->inFrame);
+    QRhiProfilerPrivate *rhiP = d->profilerPrivateOrNull();
+    QRHI_PROF_F(endFrame(swapChain));
+    QRhiCapturePrivate *rhiC = d->capturePrivateOrNull();
+    QRHI_CAP_F(endFrame(swapChain));
     QRhi::FrameOpResult r = d->endFrame(swapChain, flags);
+    QRHI_PROF_F(framePresented(swapChain));
 
     // releaseAndDestroyLater is a high level QRhi concept the backends know
     // nothing about - handle it here.
@@ -4546,7 +5780,16 @@ QRhi::FrameOpResult QRhi::endFrame(QRhiSwapChain *swapChain, EndFrameFlags flags
  */
 QRhi::FrameOpResult QRhi::beginOffscreenFrame(QRhiCommandBuffer **cb)
 {
-    return d->beginOffscreenFrame(cb);
+    d->invokeMemoryPressureCallback();
+    QRhi::FrameOpResult r = d->beginOffscreenFrame(cb);
+    if (r == FrameOpSuccess) {
+        QRhiProfilerPrivate *rhiP = d->profilerPrivateOrNull();
+        QRHI_PROF_F(beginOffscreenFrame());
+        QRhiCapturePrivate::get(&d->capture)->startIfPending(d);
+        QRhiCapturePrivate *rhiC = d->capturePrivateOrNull();
+        QRHI_CAP_F(beginOffscreenFrame());
+    }
+    return r;
 }
 
 /*!
@@ -4556,7 +5799,12 @@ QRhi::FrameOpResult QRhi::beginOffscreenFrame(QRhiCommandBuffer **cb)
  */
 QRhi::FrameOpResult QRhi::endOffscreenFrame()
 {
-    return d->endOffscreenFrame();
+    QRhiCapturePrivate *rhiC = d->capturePrivateOrNull();
+    QRHI_CAP_F(endOffscreenFrame());
+    QRhi::FrameOpResult r = d->endOffscreenFrame();
+    QRhiProfilerPrivate *rhiP = d->profilerPrivateOrNull();
+    QRHI_PROF_F(endOffscreenFrame());
+    return r;
 }
 
 /*!
@@ -4572,6 +5820,8 @@ QRhi::FrameOpResult QRhi::endOffscreenFrame()
  */
 QRhi::FrameOpResult QRhi::finish()
 {
+    QRhiCapturePrivate *rhiC = d->capturePrivateOrNull();
+    QRHI_CAP_F(finish());
     return d->finish();
 }
 
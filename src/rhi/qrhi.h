@@ -41,6 +41,7 @@
 #include <QVector4D>
 #include <QVector2D>
 #include <QSize>
+#include <QRect>
 #include <QMatrix4x4>
 #include <QVector>
 #include <QThread>
@@ -60,6 +61,7 @@ class QRhiCommandBuffer;
 class QRhiResourceUpdateBatch;
 class QRhiResourceUpdateBatchPrivate;
 class QRhiProfiler;
+class QRhiCapture;
 class QRhiShaderResourceBindingPrivate;
 class QRhiResourceSharingHostPrivate;
 
@@ -210,7 +212,23 @@ public:
         Float,
         UNormByte4,
         UNormByte2,
-        UNormByte
+        UNormByte,
+        Half4,
+        Half2,
+        SNormByte4,
+        SNormByte2,
+        SNormShort4,
+        SNormShort2,
+        UInt4,
+        UInt3,
+        UInt2,
+        UInt,
+        SInt4,
+        SInt3,
+        SInt2,
+        SInt,
+        UNormA2B10G10R10,
+        SNormA2B10G10R10
     };
 
     QRhiVertexInputAttribute();
@@ -316,7 +334,13 @@ class Q_RHI_EXPORT QRhiShaderResourceBinding
 public:
     enum Type {
         UniformBuffer,
-        SampledTexture
+        SampledTexture,
+        ImageLoad,
+        ImageStore,
+        ImageLoadStore,
+        BufferLoad,
+        BufferStore,
+        BufferLoadStore
     };
 
     enum StageFlag {
@@ -324,7 +348,8 @@ public:
         FragmentStage = 1 << 1,
         GeometryStage = 1 << 2,
         TessellationControlStage = 1 << 3,
-        TessellationEvaluationStage = 1 << 4
+        TessellationEvaluationStage = 1 << 4,
+        ComputeStage = 1 << 5
     };
     Q_DECLARE_FLAGS(StageFlags, StageFlag)
 
@@ -341,6 +366,17 @@ public:
     static QRhiShaderResourceBinding uniformBufferWithDynamicOffset(int binding, StageFlags stage, QRhiBuffer *buf, int size);
     static QRhiShaderResourceBinding sampledTexture(int binding, StageFlags stage, QRhiTexture *tex, QRhiSampler *sampler);
 
+    static QRhiShaderResourceBinding imageLoad(int binding, StageFlags stage, QRhiTexture *tex, int level);
+    static QRhiShaderResourceBinding imageStore(int binding, StageFlags stage, QRhiTexture *tex, int level);
+    static QRhiShaderResourceBinding imageLoadStore(int binding, StageFlags stage, QRhiTexture *tex, int level);
+
+    static QRhiShaderResourceBinding bufferLoad(int binding, StageFlags stage, QRhiBuffer *buf);
+    static QRhiShaderResourceBinding bufferLoad(int binding, StageFlags stage, QRhiBuffer *buf, int offset, int size);
+    static QRhiShaderResourceBinding bufferStore(int binding, StageFlags stage, QRhiBuffer *buf);
+    static QRhiShaderResourceBinding bufferStore(int binding, StageFlags stage, QRhiBuffer *buf, int offset, int size);
+    static QRhiShaderResourceBinding bufferLoadStore(int binding, StageFlags stage, QRhiBuffer *buf);
+    static QRhiShaderResourceBinding bufferLoadStore(int binding, StageFlags stage, QRhiBuffer *buf, int offset, int size);
+
 private:
     QRhiShaderResourceBindingPrivate *d;
     friend class QRhiShaderResourceBindingPrivate;
@@ -364,6 +400,17 @@ Q_RHI_EXPORT QDebug operator<<(QDebug, const QRhiShaderResourceBinding &);
 class Q_RHI_EXPORT QRhiColorAttachment
 {
 public:
+    enum LoadOp {
+        LoadOpClear,
+        LoadOpLoad,
+        LoadOpDontCare
+    };
+
+    enum StoreOp {
+        StoreOpStore,
+        StoreOpDontCare
+    };
+
     QRhiColorAttachment();
     QRhiColorAttachment(QRhiTexture *texture);
     QRhiColorAttachment(QRhiRenderBuffer *renderBuffer);
@@ -389,6 +436,12 @@ public:
     int resolveLevel() const { return m_resolveLevel; }
     void setResolveLevel(int level) { m_resolveLevel = level; }
 
+    LoadOp loadOp() const { return m_loadOp; }
+    void setLoadOp(LoadOp op) { m_loadOp = op; }
+
+    StoreOp storeOp() const { return m_storeOp; }
+    void setStoreOp(StoreOp op) { m_storeOp = op; }
+
 private:
     QRhiTexture *m_texture = nullptr;
     QRhiRenderBuffer *m_renderBuffer = nullptr;
@@ -397,6 +450,8 @@ private:
     QRhiTexture *m_resolveTexture = nullptr;
     int m_resolveLayer = 0;
     int m_resolveLevel = 0;
+    LoadOp m_loadOp = LoadOpClear;
+    StoreOp m_storeOp = StoreOpStore;
     Q_DECL_UNUSED_MEMBER quint64 m_reserved;
 };
 
@@ -419,10 +474,18 @@ public:
     QRhiTexture *depthTexture() const { return m_depthTexture; }
     void setDepthTexture(QRhiTexture *texture) { m_depthTexture = texture; }
 
+    QRhiColorAttachment::LoadOp depthStencilLoadOp() const { return m_depthStencilLoadOp; }
+    void setDepthStencilLoadOp(QRhiColorAttachment::LoadOp op) { m_depthStencilLoadOp = op; }
+
+    QRhiColorAttachment::StoreOp depthStencilStoreOp() const { return m_depthStencilStoreOp; }
+    void setDepthStencilStoreOp(QRhiColorAttachment::StoreOp op) { m_depthStencilStoreOp = op; }
+
 private:
     QVector<QRhiColorAttachment> m_colorAttachments;
     QRhiRenderBuffer *m_depthStencilBuffer = nullptr;
     QRhiTexture *m_depthTexture = nullptr;
+    QRhiColorAttachment::LoadOp m_depthStencilLoadOp = QRhiColorAttachment::LoadOpClear;
+    QRhiColorAttachment::StoreOp m_depthStencilStoreOp = QRhiColorAttachment::StoreOpStore;
     Q_DECL_UNUSED_MEMBER quint64 m_reserved;
 };
 
@@ -547,10 +610,14 @@ public:
     int level() const { return m_level; }
     void setLevel(int level) { m_level = level; }
 
+    QRect rect() const { return m_rect; }
+    void setRect(const QRect &rect) { m_rect = rect; }
+
 private:
     QRhiTexture *m_texture = nullptr;
     int m_layer = 0;
     int m_level = 0;
+    QRect m_rect;
     Q_DECL_UNUSED_MEMBER quint64 m_reserved;
 };
 
@@ -599,7 +666,9 @@ public:
     enum UsageFlag {
         VertexBuffer = 1 << 0,
         IndexBuffer = 1 << 1,
-        UniformBuffer = 1 << 2
+        UniformBuffer = 1 << 2,
+        StorageBuffer = 1 << 3,
+        IndirectBuffer = 1 << 4
     };
     Q_DECLARE_FLAGS(UsageFlags, UsageFlag)
 
@@ -634,7 +703,11 @@ public:
         MipMapped = 1 << 3,
         sRGB = 1 << 4,
         UsedAsTransferSource = 1 << 5,
-        UsedWithGenerateMips = 1 << 6
+        UsedWithGenerateMips = 1 << 6,
+        UsedWithLoadStore = 1 << 7,
+        ThreeDimensional = 1 << 8,
+        TextureArray = 1 << 9,
+        Transient = 1 << 10
     };
     Q_DECLARE_FLAGS(Flags, Flag)
 
@@ -647,6 +720,14 @@ public:
         R16,
         RED_OR_ALPHA8,
 
+        RG8,
+        RG16,
+        RGBA16F,
+        RGBA32F,
+        R16F,
+        R32F,
+        B10G11R11_UFLOAT,
+
         D16,
         D32,
 
@@ -690,6 +771,14 @@ public:
     int sampleCount() const { return m_sampleCount; }
     void setSampleCount(int s) { m_sampleCount = s; }
 
+    int depth() const { return m_depth; }
+    void setDepth(int depth) { m_depth = depth; }
+
+    int arraySize() const { return m_arraySize; }
+    void setArraySize(int arraySize) { m_arraySize = arraySize; }
+
+    int layerCount() const;
+
     virtual bool build() = 0;
     virtual const QRhiNativeHandles *nativeHandles();
     virtual bool buildFrom(const QRhiNativeHandles *src);
@@ -701,6 +790,8 @@ protected:
     QSize m_pixelSize;
     int m_sampleCount;
     Flags m_flags;
+    int m_depth = 1;
+    int m_arraySize = 0;
     Q_DECL_UNUSED_MEMBER quint64 m_reserved;
 };
 
@@ -765,7 +856,8 @@ public:
     };
 
     enum Flag {
-        UsedWithSwapChainOnly = 1 << 0
+        UsedWithSwapChainOnly = 1 << 0,
+        Transient = 1 << 1
     };
     Q_DECLARE_FLAGS(Flags, Flag)
 
@@ -1065,6 +1157,28 @@ Q_DECLARE_OPERATORS_FOR_FLAGS(QRhiGraphicsPipeline::Flags)
 Q_DECLARE_OPERATORS_FOR_FLAGS(QRhiGraphicsPipeline::ColorMask)
 Q_DECLARE_TYPEINFO(QRhiGraphicsPipeline::TargetBlend, Q_MOVABLE_TYPE);
 
+class Q_RHI_EXPORT QRhiComputePipeline : public QRhiResource
+{
+public:
+    QBakedShader shader() const { return m_shader; }
+    void setShader(const QBakedShader &s) { m_shader = s; }
+
+    QBakedShaderKey::ShaderVariant shaderVariant() const { return m_shaderVariant; }
+    void setShaderVariant(QBakedShaderKey::ShaderVariant v) { m_shaderVariant = v; }
+
+    QRhiShaderResourceBindings *shaderResourceBindings() const { return m_shaderResourceBindings; }
+    void setShaderResourceBindings(QRhiShaderResourceBindings *srb) { m_shaderResourceBindings = srb; }
+
+    virtual bool build() = 0;
+
+protected:
+    QRhiComputePipeline(QRhiImplementation *rhi);
+    QBakedShader m_shader;
+    QBakedShaderKey::ShaderVariant m_shaderVariant = QBakedShaderKey::StandardShader;
+    QRhiShaderResourceBindings *m_shaderResourceBindings = nullptr;
+    Q_DECL_UNUSED_MEMBER quint64 m_reserved;
+};
+
 class Q_RHI_EXPORT QRhiSwapChain : public QRhiResource
 {
 public:
@@ -1133,7 +1247,11 @@ public:
                    QRhiResourceUpdateBatch *resourceUpdates = nullptr);
     void endPass(QRhiResourceUpdateBatch *resourceUpdates = nullptr);
 
+    void beginComputePass(QRhiResourceUpdateBatch *resourceUpdates = nullptr);
+    void endComputePass(QRhiResourceUpdateBatch *resourceUpdates = nullptr);
+
     void setGraphicsPipeline(QRhiGraphicsPipeline *ps);
+    void setComputePipeline(QRhiComputePipeline *ps);
     using DynamicOffset = QPair<int, quint32>; // binding, offset
     void setShaderResources(QRhiShaderResourceBindings *srb = nullptr,
                             const QVector<DynamicOffset> &dynamicOffsets = QVector<DynamicOffset>());
@@ -1147,6 +1265,9 @@ public:
     void setBlendConstants(const QVector4D &c);
     void setStencilRef(quint32 refValue);
 
+    void setPushConstants(QRhiShaderResourceBinding::StageFlags stages,
+                          quint32 offset, quint32 size, const void *data);
+
     void draw(quint32 vertexCount,
               quint32 instanceCount = 1,
               quint32 firstVertex = 0,
@@ -1158,6 +1279,33 @@ public:
                      qint32 vertexOffset = 0,
                      quint32 firstInstance = 0);
 
+    struct DrawIndirectCommand {
+        quint32 vertexCount;
+        quint32 instanceCount;
+        quint32 firstVertex;
+        quint32 firstInstance;
+    };
+
+    struct DrawIndexedIndirectCommand {
+        quint32 indexCount;
+        quint32 instanceCount;
+        quint32 firstIndex;
+        qint32 vertexOffset;
+        quint32 firstInstance;
+    };
+
+    void drawIndirect(QRhiBuffer *indirectBuffer,
+                      quint32 indirectBufferOffset = 0,
+                      quint32 drawCount = 1,
+                      quint32 stride = sizeof(DrawIndirectCommand));
+
+    void drawIndexedIndirect(QRhiBuffer *indirectBuffer,
+                             quint32 indirectBufferOffset = 0,
+                             quint32 drawCount = 1,
+                             quint32 stride = sizeof(DrawIndexedIndirectCommand));
+
+    void dispatch(int x, int y, int z);
+
     void debugMarkBegin(const QByteArray &name);
     void debugMarkEnd();
     void debugMarkMsg(const QByteArray &msg);
@@ -1173,6 +1321,14 @@ struct Q_RHI_EXPORT QRhiReadbackResult
     QRhiTexture::Format format;
     QSize pixelSize;
     QByteArray data;
+    void *destination = nullptr;
+    quint32 destinationSize = 0;
+}; // non-movable due to the std::function
+
+struct Q_RHI_EXPORT QRhiBufferReadbackResult
+{
+    std::function<void()> completed = nullptr;
+    QByteArray data;
 }; // non-movable due to the std::function
 
 class Q_RHI_EXPORT QRhiResourceUpdateBatch
@@ -1191,6 +1347,7 @@ public:
     void uploadTexture(QRhiTexture *tex, const QImage &image);
     void copyTexture(QRhiTexture *dst, QRhiTexture *src, const QRhiTextureCopyDescription &desc = QRhiTextureCopyDescription());
     void readBackTexture(const QRhiReadbackDescription &rb, QRhiReadbackResult *result);
+    void readBackBuffer(QRhiBuffer *buf, int offset, int size, QRhiBufferReadbackResult *result);
     void generateMips(QRhiTexture *tex);
 
 private:
@@ -1201,12 +1358,29 @@ private:
     friend class QRhi;
 };
 
+struct Q_RHI_EXPORT QRhiMemoryStatistics
+{
+    qint64 bufferBytes = 0;
+    qint64 textureBytes = 0;
+    qint64 renderBufferBytes = 0;
+    qint64 stagingBytes = 0;
+    qint64 readbackBytes = 0;
+
+    qint64 totalBytes() const {
+        return bufferBytes + textureBytes + renderBufferBytes + stagingBytes + readbackBytes;
+    }
+};
+
+Q_DECLARE_TYPEINFO(QRhiMemoryStatistics, Q_MOVABLE_TYPE);
+
 class Q_RHI_EXPORT QRhiResourceSharingHost
 {
 public:
     QRhiResourceSharingHost();
     ~QRhiResourceSharingHost();
 
+    QRhiMemoryStatistics memoryStatistics() const;
+
 private:
     Q_DISABLE_COPY(QRhiResourceSharingHost)
     QRhiResourceSharingHostPrivate *d;
@@ -1255,7 +1429,13 @@ public:
         NonDynamicUniformBuffers,
         NonFourAlignedEffectiveIndexBufferOffset,
         NPOTTextureRepeat,
-        RedOrAlpha8IsRed
+        RedOrAlpha8IsRed,
+        Compute,
+        DrawIndirect,
+        DrawIndirectMulti,
+        PushConstants,
+        ThreeDimensionalTextures,
+        TextureArrays
     };
 
     enum BeginFrameFlag {
@@ -1269,7 +1449,9 @@ public:
 
     enum ResourceSizeLimit {
         TextureSizeMin = 1,
-        TextureSizeMax
+        TextureSizeMax,
+        PushConstantsSizeMax,
+        TextureArraySizeMax
     };
 
     ~QRhi();
@@ -1283,6 +1465,7 @@ public:
     QThread *thread() const;
 
     QRhiGraphicsPipeline *newGraphicsPipeline();
+    QRhiComputePipeline *newComputePipeline();
     QRhiShaderResourceBindings *newShaderResourceBindings();
 
     QRhiBuffer *newBuffer(QRhiBuffer::Type type,
@@ -1299,6 +1482,17 @@ public:
                             int sampleCount = 1,
                             QRhiTexture::Flags flags = QRhiTexture::Flags());
 
+    QRhiTexture *newTexture(QRhiTexture::Format format,
+                            int width, int height, int depth,
+                            int sampleCount = 1,
+                            QRhiTexture::Flags flags = QRhiTexture::Flags());
+
+    QRhiTexture *newTextureArray(QRhiTexture::Format format,
+                                 int arraySize,
+                                 const QSize &pixelSize,
+                                 int sampleCount = 1,
+                                 QRhiTexture::Flags flags = QRhiTexture::Flags());
+
     QRhiSampler *newSampler(QRhiSampler::Filter magFilter, QRhiSampler::Filter minFilter,
                             QRhiSampler::Filter mipmapMode,
                             QRhiSampler::AddressMode u, QRhiSampler::AddressMode v, QRhiSampler::AddressMode w = QRhiSampler::ClampToEdge);
@@ -1331,12 +1525,20 @@ public:
     QMatrix4x4 clipSpaceCorrMatrix() const;
 
     bool isTextureFormatSupported(QRhiTexture::Format format, QRhiTexture::Flags flags = QRhiTexture::Flags()) const;
+    bool isVertexFormatSupported(QRhiVertexInputAttribute::Format format) const;
     bool isFeatureSupported(QRhi::Feature feature) const;
     int resourceSizeLimit(ResourceSizeLimit limit) const;
 
     const QRhiNativeHandles *nativeHandles();
 
     QRhiProfiler *profiler();
+    QRhiCapture *capture();
+
+    QRhiMemoryStatistics memoryStatistics() const;
+    qint64 memoryBudget() const;
+    void setMemoryBudget(qint64 bytes);
+    using MemoryPressureCallback = std::function<void(const QRhiMemoryStatistics &)>;
+    void setMemoryPressureCallback(MemoryPressureCallback callback);
 
 protected:
     QRhi();
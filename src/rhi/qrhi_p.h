@@ -44,9 +44,11 @@
 #include "qtrhiglobal_p.h"
 #include "qrhi.h"
 #include "qrhiprofiler_p.h"
+#include "qrhicapture_p.h"
 #include <QBitArray>
 #include <QAtomicInt>
 #include <QAtomicInteger>
+#include <QHash>
 
 QT_BEGIN_NAMESPACE
 
@@ -54,6 +56,8 @@ QT_BEGIN_NAMESPACE
 #define QRHI_RES_RHI(t) t *rhiD = static_cast<t *>(m_rhi)
 #define QRHI_PROF QRhiProfilerPrivate *rhiP = m_rhi->profilerPrivateOrNull()
 #define QRHI_PROF_F(f) for (bool qrhip_enabled = rhiP != nullptr; qrhip_enabled; qrhip_enabled = false) rhiP->f
+#define QRHI_CAP QRhiCapturePrivate *rhiC = m_rhi->capturePrivateOrNull()
+#define QRHI_CAP_F(f) for (bool qrhic_enabled = rhiC != nullptr; qrhic_enabled; qrhic_enabled = false) rhiC->f
 
 class QRhiImplementation
 {
@@ -64,6 +68,7 @@ public:
     virtual void destroy() = 0;
 
     virtual QRhiGraphicsPipeline *createGraphicsPipeline() = 0;
+    virtual QRhiComputePipeline *createComputePipeline() = 0;
     virtual QRhiShaderResourceBindings *createShaderResourceBindings() = 0;
     virtual QRhiBuffer *createBuffer(QRhiBuffer::Type type,
                                      QRhiBuffer::UsageFlags usage,
@@ -99,8 +104,13 @@ public:
                            QRhiResourceUpdateBatch *resourceUpdates) = 0;
     virtual void endPass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) = 0;
 
+    virtual void beginComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) = 0;
+    virtual void endComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) = 0;
+
     virtual void setGraphicsPipeline(QRhiCommandBuffer *cb,
                                      QRhiGraphicsPipeline *ps) = 0;
+    virtual void setComputePipeline(QRhiCommandBuffer *cb,
+                                    QRhiComputePipeline *ps) = 0;
 
     virtual void setShaderResources(QRhiCommandBuffer *cb,
                                     QRhiShaderResourceBindings *srb,
@@ -115,6 +125,8 @@ public:
     virtual void setScissor(QRhiCommandBuffer *cb, const QRhiScissor &scissor) = 0;
     virtual void setBlendConstants(QRhiCommandBuffer *cb, const QVector4D &c) = 0;
     virtual void setStencilRef(QRhiCommandBuffer *cb, quint32 refValue) = 0;
+    virtual void setPushConstants(QRhiCommandBuffer *cb, QRhiShaderResourceBinding::StageFlags stages,
+                                  quint32 offset, quint32 size, const void *data) = 0;
 
     virtual void draw(QRhiCommandBuffer *cb, quint32 vertexCount,
                       quint32 instanceCount, quint32 firstVertex, quint32 firstInstance) = 0;
@@ -122,6 +134,13 @@ public:
                              quint32 instanceCount, quint32 firstIndex,
                              qint32 vertexOffset, quint32 firstInstance) = 0;
 
+    virtual void drawIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                              quint32 indirectBufferOffset, quint32 drawCount, quint32 stride) = 0;
+    virtual void drawIndexedIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                                     quint32 indirectBufferOffset, quint32 drawCount, quint32 stride) = 0;
+
+    virtual void dispatch(QRhiCommandBuffer *cb, int x, int y, int z) = 0;
+
     virtual void debugMarkBegin(QRhiCommandBuffer *cb, const QByteArray &name) = 0;
     virtual void debugMarkEnd(QRhiCommandBuffer *cb) = 0;
     virtual void debugMarkMsg(QRhiCommandBuffer *cb, const QByteArray &msg) = 0;
@@ -132,6 +151,7 @@ public:
     virtual bool isYUpInNDC() const = 0;
     virtual QMatrix4x4 clipSpaceCorrMatrix() const = 0;
     virtual bool isTextureFormatSupported(QRhiTexture::Format format, QRhiTexture::Flags flags) const = 0;
+    virtual bool isVertexFormatSupported(QRhiVertexInputAttribute::Format format) const = 0;
     virtual bool isFeatureSupported(QRhi::Feature feature) const = 0;
     virtual int resourceSizeLimit(QRhi::ResourceSizeLimit limit) const = 0;
     virtual const QRhiNativeHandles *nativeHandles() = 0;
@@ -139,6 +159,12 @@ public:
     virtual void sendVMemStatsToProfiler();
 
     bool isCompressedFormat(QRhiTexture::Format format) const;
+    static QRhiColorAttachment::LoadOp colorLoadOp(const QRhiTextureRenderTarget *rt, const QRhiColorAttachment &att);
+    static QRhiColorAttachment::LoadOp depthStencilLoadOp(const QRhiTextureRenderTarget *rt);
+    static QRhiColorAttachment::StoreOp colorStoreOp(const QRhiColorAttachment &att);
+    static QRhiColorAttachment::StoreOp depthStencilStoreOp(const QRhiTextureRenderTarget *rt);
+    static bool readbackRect(const QRhiReadbackDescription &rb, const QSize &levelSize, QRect *rect);
+    static void storeReadbackData(QRhiReadbackResult *result, const void *src, quint32 size);
     void compressedFormatInfo(QRhiTexture::Format format, const QSize &size,
                               quint32 *bpl, quint32 *byteSize,
                               QSize *blockDim) const;
@@ -146,6 +172,49 @@ public:
                            quint32 *bpl, quint32 *byteSize) const;
     quint32 approxByteSizeForTexture(QRhiTexture::Format format, const QSize &baseSize,
                                      int mipCount, int layerCount);
+    quint32 approxByteSizeForRenderBuffer(QRhiRenderBuffer::Type type, const QSize &size, int sampleCount);
+    quint32 indirectDrawCountInRange(QRhiBuffer *buf, quint32 offset, quint32 drawCount,
+                                     quint32 stride, quint32 commandSize) const;
+
+    // Live memory accounting, see QRhi::memoryStatistics(). The backends
+    // report allocations next to the corresponding QRhiProfiler calls, but
+    // regardless of QRhi::EnableProfiling.
+    enum MemoryCategory {
+        BufferMemory,
+        TextureMemory,
+        RenderBufferMemory,
+        StagingMemory,
+        ReadbackMemory,
+        MemoryCategoryCount
+    };
+    void addMemory(MemoryCategory category, quint64 key, int slot, qint64 byteSize);
+    void removeMemory(MemoryCategory category, quint64 key, int slot = 0);
+    void addBufferMemory(QRhiBuffer *buf, quint32 realSize, int backingCount)
+    {
+        addMemory(BufferMemory, quint64(quintptr(buf)), 0, qint64(realSize) * backingCount);
+    }
+    void removeBufferMemory(QRhiBuffer *buf) { removeMemory(BufferMemory, quint64(quintptr(buf))); }
+    void addTextureMemory(QRhiTexture *tex, int mipCount, int layerCount, int sampleCount)
+    {
+        addMemory(TextureMemory, quint64(quintptr(tex)), 0,
+                  qint64(approxByteSizeForTexture(tex->format(), tex->pixelSize(), mipCount, layerCount)) * qMax(1, sampleCount));
+    }
+    void removeTextureMemory(QRhiTexture *tex) { removeMemory(TextureMemory, quint64(quintptr(tex))); }
+    void addRenderBufferMemory(QRhiRenderBuffer *rb, int sampleCount)
+    {
+        addMemory(RenderBufferMemory, quint64(quintptr(rb)), 0,
+                  approxByteSizeForRenderBuffer(rb->type(), rb->pixelSize(), sampleCount));
+    }
+    void removeRenderBufferMemory(QRhiRenderBuffer *rb) { removeMemory(RenderBufferMemory, quint64(quintptr(rb))); }
+    void addStagingMemory(QRhiResource *res, int slot, quint32 size)
+    {
+        addMemory(StagingMemory, quint64(quintptr(res)), slot, size);
+    }
+    void removeStagingMemory(QRhiResource *res, int slot) { removeMemory(StagingMemory, quint64(quintptr(res)), slot); }
+    void addReadbackMemory(quint64 id, quint32 size) { addMemory(ReadbackMemory, id, 0, size); }
+    void removeReadbackMemory(quint64 id) { removeMemory(ReadbackMemory, id); }
+    QRhiMemoryStatistics memoryStatistics() const;
+    void invokeMemoryPressureCallback();
 
     QRhiProfilerPrivate *profilerPrivateOrNull()
     {
@@ -154,16 +223,29 @@ public:
         return p->rhiDWhenEnabled ? p : nullptr;
     }
 
-    // only really care about resources that own native graphics resources underneath
+    QRhiCapturePrivate *capturePrivateOrNull()
+    {
+        // return null when there is no capture in progress
+        QRhiCapturePrivate *p = QRhiCapturePrivate::get(&capture);
+        return p->active ? p : nullptr;
+    }
+
+    // only really care about resources that own native graphics resources
+    // underneath, and the pipelines, since the capture relies on seeing their
+    // build() and release()
     void registerResource(QRhiResource *res)
     {
         res->m_orphanedWithRsh = nullptr;
         resources.insert(res);
+        QRhiCapturePrivate *rhiC = capturePrivateOrNull();
+        QRHI_CAP_F(resourceRebuilt(res));
     }
 
     void unregisterResource(QRhiResource *res)
     {
         resources.remove(res);
+        QRhiCapturePrivate *rhiC = capturePrivateOrNull();
+        QRHI_CAP_F(resourceRebuilt(res));
     }
 
     QSet<QRhiResource *> activeResources() const
@@ -199,11 +281,18 @@ private:
     QRhi::Implementation implType;
     QThread *implThread;
     QRhiProfiler profiler;
+    QRhiCapture capture;
     QVector<QRhiResourceUpdateBatch *> resUpdPool;
     QBitArray resUpdPoolMap;
     QSet<QRhiResource *> resources;
     QSet<QRhiResource *> pendingReleaseAndDestroyResources;
     bool inFrame = false;
+    QHash<QPair<quint64, int>, qint64> memoryAllocations[MemoryCategoryCount];
+    qint64 memoryBytes[MemoryCategoryCount] = {};
+    qint64 memoryBudget = 0;
+    bool overMemoryBudget = false;
+    bool memoryPressurePending = false;
+    QRhi::MemoryPressureCallback memoryPressureCallback;
 
     friend class QRhi;
     friend class QRhiResourceUpdateBatchPrivate;
@@ -296,8 +385,21 @@ public:
         }
     };
 
+    struct BufferReadback {
+        BufferReadback() { }
+        BufferReadback(QRhiBuffer *buf_, int offset_, int size_, QRhiBufferReadbackResult *result_)
+            : buf(buf_), offset(offset_), size(size_ ? size_ : buf_->size() - offset_), result(result_)
+        { }
+
+        QRhiBuffer *buf = nullptr;
+        int offset = 0;
+        int size = 0;
+        QRhiBufferReadbackResult *result = nullptr;
+    };
+
     QVector<DynamicBufferUpdate> dynamicBufferUpdates;
     QVector<StaticBufferUpload> staticBufferUploads;
+    QVector<BufferReadback> bufferReadbacks;
     QVector<TextureOp> textureOps;
 
     QRhiResourceUpdateBatch *q = nullptr;
@@ -312,6 +414,7 @@ public:
 
 Q_DECLARE_TYPEINFO(QRhiResourceUpdateBatchPrivate::DynamicBufferUpdate, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(QRhiResourceUpdateBatchPrivate::StaticBufferUpload, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QRhiResourceUpdateBatchPrivate::BufferReadback, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(QRhiResourceUpdateBatchPrivate::TextureOp, Q_MOVABLE_TYPE);
 
 class Q_RHI_PRIVATE_EXPORT QRhiShaderResourceBindingPrivate
@@ -320,6 +423,9 @@ public:
     QRhiShaderResourceBindingPrivate()
         : ref(1)
     {
+        // qHash() hashes the raw union, so the bytes not covered by a smaller
+        // member must not be left uninitialized
+        memset(&u, 0, sizeof(u));
     }
 
     QRhiShaderResourceBindingPrivate(const QRhiShaderResourceBindingPrivate *other)
@@ -348,9 +454,20 @@ public:
         QRhiTexture *tex;
         QRhiSampler *sampler;
     };
+    struct StorageImageData {
+        QRhiTexture *tex;
+        int level;
+    };
+    struct StorageBufferData {
+        QRhiBuffer *buf;
+        int offset;
+        int maybeSize;
+    };
     union {
         UniformBufferData ubuf;
         SampledTextureData stex;
+        StorageImageData simage;
+        StorageBufferData sbuf;
     } u;
 };
 
@@ -0,0 +1,779 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the Qt RHI module
+**
+** $QT_BEGIN_LICENSE:LGPL3$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or later as published by the Free
+** Software Foundation and appearing in the file LICENSE.GPL included in
+** the packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 2.0 requirements will be
+** met: http://www.gnu.org/licenses/gpl-2.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qrhicapture_p.h"
+#include "qrhi_p.h"
+
+QT_BEGIN_NAMESPACE
+
+/*!
+    \class QRhiCapture
+    \inmodule QtRhi
+
+    \brief Records the resources and commands issued through a QRhi.
+
+    A QRhiCapture is present for each QRhi. Query it via QRhi::capture(). Once
+    an output device is set, the descriptions of the resources, the contents
+    of the resource update batches, and the commands recorded on the command
+    buffers are written to the device in a compact binary form, starting
+    with the next QRhi::beginFrame() or QRhi::beginOffscreenFrame().
+
+    The resulting stream can be replayed with the \c qrhireplay tool on any
+    backend. The replay uses offscreen frames, with the swapchains replaced
+    by textures of the same size, and reports the frame times. This allows
+    benchmarking backend changes with the frames of a real application
+    without having to run the application itself.
+
+    \note Resources are described when they are first used by a recorded
+    command, and again when their properties change. The contents of
+    buffers and textures uploaded before the capture started are not part of
+    the stream. For a complete capture, set the device before creating the
+    resources. A resource that is rebuilt with the same properties is not
+    recorded again either. Graphics and compute pipelines are only examined
+    when they are first used and after they are rebuilt, changing their
+    properties without calling build() is not reflected in the stream.
+
+    \note The uniform data is recorded as-is. When replaying on another
+    backend, clip space corrections baked into the matrices remain those of
+    the original backend. This does not affect the amount of work performed.
+
+    Capturing has a per-call cost and is meant for debugging and
+    benchmarking sessions. When no device is set, no data is collected.
+
+    \note The output device is written directly on the thread of the QRhi.
+    Call setDevice() with null to stop capturing.
+
+    \section2 Stream Format
+
+    The stream is written with QDataStream, using the QDataStream::Qt_5_10
+    format. It starts with Magic, Version, and the QRhi::Implementation of
+    the captured QRhi as quint32, quint32, and qint32 values. This is
+    followed by records, each consisting of a quint8 StreamOp and a
+    QByteArray with the op-specific payload. Readers should skip records
+    with an unknown op. Resources are referenced by
+    QRhiResource::globalResourceId(), with 0 meaning null.
+
+    A resource update batch is serialized as a quint32 count followed by that
+    many updates, each starting with a quint8 UpdateOp. The updates are
+    grouped in the order dynamic buffer updates, static buffer uploads,
+    buffer readbacks, and texture operations, which is the order the
+    backends process them in.
+ */
+
+/*!
+    \enum QRhiCapture::StreamOp
+    Describes a record in the capture stream.
+
+    \value Buffer Description of a QRhiBuffer
+    \value Texture Description of a QRhiTexture
+    \value Sampler Description of a QRhiSampler
+    \value RenderBuffer Description of a QRhiRenderBuffer
+    \value TextureRenderTarget Description of a QRhiTextureRenderTarget
+    \value SwapChain Size, sample count and flags of a QRhiSwapChain
+    \value SwapChainRenderTarget Maps a swapchain render target to its swapchain
+    \value ShaderResourceBindings Description of a QRhiShaderResourceBindings
+    \value GraphicsPipeline Description of a QRhiGraphicsPipeline, including the shaders
+    \value ComputePipeline Description of a QRhiComputePipeline, including the shader
+    \value DestroyResource A previously described resource was destroyed
+    \value BeginFrame QRhi::beginFrame() with a timestamp in nanoseconds
+    \value EndFrame QRhi::endFrame() with a timestamp in nanoseconds
+    \value BeginOffscreenFrame QRhi::beginOffscreenFrame() with a timestamp in nanoseconds
+    \value EndOffscreenFrame QRhi::endOffscreenFrame() with a timestamp in nanoseconds
+    \value Finish QRhi::finish()
+    \value ResourceUpdate QRhiCommandBuffer::resourceUpdate()
+    \value BeginPass QRhiCommandBuffer::beginPass()
+    \value EndPass QRhiCommandBuffer::endPass()
+    \value BeginComputePass QRhiCommandBuffer::beginComputePass()
+    \value EndComputePass QRhiCommandBuffer::endComputePass()
+    \value SetGraphicsPipeline QRhiCommandBuffer::setGraphicsPipeline()
+    \value SetComputePipeline QRhiCommandBuffer::setComputePipeline()
+    \value SetShaderResources QRhiCommandBuffer::setShaderResources()
+    \value SetVertexInput QRhiCommandBuffer::setVertexInput()
+    \value SetViewport QRhiCommandBuffer::setViewport()
+    \value SetScissor QRhiCommandBuffer::setScissor()
+    \value SetBlendConstants QRhiCommandBuffer::setBlendConstants()
+    \value SetStencilRef QRhiCommandBuffer::setStencilRef()
+    \value SetPushConstants QRhiCommandBuffer::setPushConstants()
+    \value Draw QRhiCommandBuffer::draw()
+    \value DrawIndexed QRhiCommandBuffer::drawIndexed()
+    \value DrawIndirect QRhiCommandBuffer::drawIndirect()
+    \value DrawIndexedIndirect QRhiCommandBuffer::drawIndexedIndirect()
+    \value Dispatch QRhiCommandBuffer::dispatch()
+    \value DebugMarkBegin QRhiCommandBuffer::debugMarkBegin()
+    \value DebugMarkEnd QRhiCommandBuffer::debugMarkEnd()
+    \value DebugMarkMsg QRhiCommandBuffer::debugMarkMsg()
+ */
+
+/*!
+    \enum QRhiCapture::UpdateOp
+    Describes an entry in a serialized resource update batch.
+
+    \value DynamicBufferUpdate QRhiResourceUpdateBatch::updateDynamicBuffer(), with the data
+    \value StaticBufferUpload QRhiResourceUpdateBatch::uploadStaticBuffer(), with the data
+    \value BufferReadback QRhiResourceUpdateBatch::readBackBuffer()
+    \value TextureUpload QRhiResourceUpdateBatch::uploadTexture(), with the image or compressed data
+    \value TextureCopy QRhiResourceUpdateBatch::copyTexture()
+    \value TextureReadback QRhiResourceUpdateBatch::readBackTexture()
+    \value GenerateMips QRhiResourceUpdateBatch::generateMips()
+ */
+
+/*!
+    \internal
+ */
+QRhiCapture::QRhiCapture()
+    : d(new QRhiCapturePrivate)
+{
+}
+
+/*!
+    Destructor.
+ */
+QRhiCapture::~QRhiCapture()
+{
+    delete d;
+}
+
+/*!
+    \return the current output device, or null if there is none.
+ */
+QIODevice *QRhiCapture::device() const
+{
+    return d->outputDevice;
+}
+
+/*!
+    Sets the output \a device. Capturing starts with the next
+    QRhi::beginFrame() or QRhi::beginOffscreenFrame(). Setting a new device
+    or null stops the current capture. A frame interrupted this way is left
+    incomplete in the stream and is ignored by the replay.
+
+    \note The device must be open for writing.
+ */
+void QRhiCapture::setDevice(QIODevice *device)
+{
+    d->stop();
+    d->outputDevice = device;
+    d->pending = device != nullptr;
+}
+
+/*!
+    \return true when a capture is in progress, meaning a device is set and
+    a frame has started since then.
+ */
+bool QRhiCapture::isActive() const
+{
+    return d->active;
+}
+
+void QRhiCapturePrivate::startIfPending(QRhiImplementation *rhiD)
+{
+    if (!pending)
+        return;
+
+    pending = false;
+    active = true;
+    knownResources.clear();
+    knownShaders.clear();
+    describedPipelines.clear();
+    currentSwapChain = nullptr;
+    currentRenderTarget = 0;
+    ts.start();
+
+    stream.setDevice(outputDevice);
+    stream.setVersion(STREAM_VERSION);
+    stream << QRhiCapture::Magic << QRhiCapture::Version << qint32(rhiD->q->backend());
+}
+
+void QRhiCapturePrivate::stop()
+{
+    pending = false;
+    active = false;
+    stream.setDevice(nullptr);
+    knownResources.clear();
+    knownShaders.clear();
+    describedPipelines.clear();
+}
+
+void QRhiCapturePrivate::writeRecord(QRhiCapture::StreamOp op, const Record &rec)
+{
+    stream << quint8(op) << rec.data;
+}
+
+void QRhiCapturePrivate::writeRecord(QRhiCapture::StreamOp op)
+{
+    stream << quint8(op) << QByteArray();
+}
+
+bool QRhiCapturePrivate::isKnown(quint64 id, const QByteArray &key)
+{
+    auto it = knownResources.find(id);
+    if (it != knownResources.end() && it.value() == key)
+        return true;
+
+    knownResources[id] = key;
+    return false;
+}
+
+quint64 QRhiCapturePrivate::ensureBuffer(QRhiBuffer *buf)
+{
+    if (!buf)
+        return 0;
+
+    const quint64 id = buf->globalResourceId();
+    Record rec;
+    rec.ds << id << qint32(buf->type()) << qint32(buf->usage()) << qint32(buf->size());
+    if (!isKnown(id, rec.data))
+        writeRecord(QRhiCapture::Buffer, rec);
+    return id;
+}
+
+quint64 QRhiCapturePrivate::ensureTexture(QRhiTexture *tex)
+{
+    if (!tex)
+        return 0;
+
+    const quint64 id = tex->globalResourceId();
+    Record rec;
+    rec.ds << id << qint32(tex->format()) << tex->pixelSize() << qint32(tex->depth())
+           << qint32(tex->arraySize()) << qint32(tex->sampleCount()) << qint32(tex->flags());
+    if (!isKnown(id, rec.data))
+        writeRecord(QRhiCapture::Texture, rec);
+    return id;
+}
+
+quint64 QRhiCapturePrivate::ensureSampler(QRhiSampler *sampler)
+{
+    if (!sampler)
+        return 0;
+
+    const quint64 id = sampler->globalResourceId();
+    Record rec;
+    rec.ds << id << qint32(sampler->magFilter()) << qint32(sampler->minFilter())
+           << qint32(sampler->mipmapMode()) << qint32(sampler->addressU())
+           << qint32(sampler->addressV()) << qint32(sampler->addressW());
+    if (!isKnown(id, rec.data))
+        writeRecord(QRhiCapture::Sampler, rec);
+    return id;
+}
+
+quint64 QRhiCapturePrivate::ensureRenderBuffer(QRhiRenderBuffer *rb)
+{
+    if (!rb)
+        return 0;
+
+    const quint64 id = rb->globalResourceId();
+    Record rec;
+    rec.ds << id << qint32(rb->type()) << rb->pixelSize() << qint32(rb->sampleCount()) << qint32(rb->flags());
+    if (!isKnown(id, rec.data))
+        writeRecord(QRhiCapture::RenderBuffer, rec);
+    return id;
+}
+
+quint64 QRhiCapturePrivate::ensureSwapChain(QRhiSwapChain *sc)
+{
+    if (!sc)
+        return 0;
+
+    const quint64 id = sc->globalResourceId();
+    Record rec;
+    rec.ds << id << sc->currentPixelSize() << qint32(sc->sampleCount()) << qint32(sc->flags())
+           << bool(sc->depthStencil() != nullptr);
+    if (!isKnown(id, rec.data))
+        writeRecord(QRhiCapture::SwapChain, rec);
+    return id;
+}
+
+quint64 QRhiCapturePrivate::ensureRenderTarget(QRhiRenderTarget *rt)
+{
+    if (!rt)
+        return 0;
+
+    const quint64 id = rt->globalResourceId();
+    if (rt->type() == QRhiRenderTarget::RtRef) {
+        // not a QRhiTextureRenderTarget, so must be the current swapchain's
+        Record rec;
+        rec.ds << id << ensureSwapChain(currentSwapChain);
+        if (!isKnown(id, rec.data))
+            writeRecord(QRhiCapture::SwapChainRenderTarget, rec);
+        return id;
+    }
+
+    QRhiTextureRenderTarget *texRt = static_cast<QRhiTextureRenderTarget *>(rt);
+    const QRhiTextureRenderTargetDescription desc = texRt->description();
+    const QVector<QRhiColorAttachment> colorAttachments = desc.colorAttachments();
+    Record rec;
+    rec.ds << id << qint32(texRt->flags()) << qint32(colorAttachments.count());
+    for (const QRhiColorAttachment &att : colorAttachments) {
+        rec.ds << ensureTexture(att.texture()) << ensureRenderBuffer(att.renderBuffer())
+               << qint32(att.layer()) << qint32(att.level())
+               << ensureTexture(att.resolveTexture()) << qint32(att.resolveLayer()) << qint32(att.resolveLevel())
+               << qint32(att.loadOp()) << qint32(att.storeOp());
+    }
+    rec.ds << ensureRenderBuffer(desc.depthStencilBuffer()) << ensureTexture(desc.depthTexture())
+           << qint32(desc.depthStencilLoadOp()) << qint32(desc.depthStencilStoreOp());
+    if (!isKnown(id, rec.data))
+        writeRecord(QRhiCapture::TextureRenderTarget, rec);
+    return id;
+}
+
+quint64 QRhiCapturePrivate::ensureShaderResourceBindings(QRhiShaderResourceBindings *srb)
+{
+    if (!srb)
+        return 0;
+
+    const quint64 id = srb->globalResourceId();
+    const QVector<QRhiShaderResourceBinding> bindings = srb->bindings();
+    Record rec;
+    rec.ds << id << qint32(bindings.count());
+    for (const QRhiShaderResourceBinding &binding : bindings) {
+        const QRhiShaderResourceBindingPrivate *b = QRhiShaderResourceBindingPrivate::get(&binding);
+        rec.ds << qint32(b->binding) << qint32(b->stage) << qint32(b->type);
+        switch (b->type) {
+        case QRhiShaderResourceBinding::UniformBuffer:
+            rec.ds << ensureBuffer(b->u.ubuf.buf) << qint32(b->u.ubuf.offset) << qint32(b->u.ubuf.maybeSize)
+                   << b->u.ubuf.hasDynamicOffset;
+            break;
+        case QRhiShaderResourceBinding::SampledTexture:
+            rec.ds << ensureTexture(b->u.stex.tex) << ensureSampler(b->u.stex.sampler);
+            break;
+        case QRhiShaderResourceBinding::ImageLoad:
+        case QRhiShaderResourceBinding::ImageStore:
+        case QRhiShaderResourceBinding::ImageLoadStore:
+            rec.ds << ensureTexture(b->u.simage.tex) << qint32(b->u.simage.level);
+            break;
+        case QRhiShaderResourceBinding::BufferLoad:
+        case QRhiShaderResourceBinding::BufferStore:
+        case QRhiShaderResourceBinding::BufferLoadStore:
+            rec.ds << ensureBuffer(b->u.sbuf.buf) << qint32(b->u.sbuf.offset) << qint32(b->u.sbuf.maybeSize);
+            break;
+        default:
+            Q_UNREACHABLE();
+            break;
+        }
+    }
+    if (!isKnown(id, rec.data))
+        writeRecord(QRhiCapture::ShaderResourceBindings, rec);
+    return id;
+}
+
+quint64 QRhiCapturePrivate::ensureGraphicsPipeline(QRhiGraphicsPipeline *ps)
+{
+    if (!ps)
+        return 0;
+
+    auto it = describedPipelines.constFind(ps);
+    if (it != describedPipelines.constEnd())
+        return it.value();
+
+    const quint64 id = ps->globalResourceId();
+    describedPipelines.insert(ps, id);
+    const quint64 srbId = ensureShaderResourceBindings(ps->shaderResourceBindings());
+
+    // Rebuilding with the same properties is common, compare with the last
+    // description before recording a new one. The shaders are compared
+    // separately, serializing them for the key would be wasteful.
+    Record key;
+    key.ds << id << qint32(ps->flags()) << qint32(ps->topology()) << qint32(ps->cullMode())
+           << qint32(ps->frontFace());
+    const QVector<QRhiGraphicsPipeline::TargetBlend> targetBlends = ps->targetBlends();
+    key.ds << qint32(targetBlends.count());
+    for (const QRhiGraphicsPipeline::TargetBlend &b : targetBlends) {
+        key.ds << qint32(b.colorWrite) << b.enable
+               << qint32(b.srcColor) << qint32(b.dstColor) << qint32(b.opColor)
+               << qint32(b.srcAlpha) << qint32(b.dstAlpha) << qint32(b.opAlpha);
+    }
+    const QRhiGraphicsPipeline::StencilOpState stencilFront = ps->stencilFront();
+    const QRhiGraphicsPipeline::StencilOpState stencilBack = ps->stencilBack();
+    key.ds << ps->hasDepthTest() << ps->hasDepthWrite() << qint32(ps->depthOp())
+           << ps->hasStencilTest()
+           << qint32(stencilFront.failOp) << qint32(stencilFront.depthFailOp)
+           << qint32(stencilFront.passOp) << qint32(stencilFront.compareOp)
+           << qint32(stencilBack.failOp) << qint32(stencilBack.depthFailOp)
+           << qint32(stencilBack.passOp) << qint32(stencilBack.compareOp)
+           << ps->stencilReadMask() << ps->stencilWriteMask() << qint32(ps->sampleCount());
+    const QRhiVertexInputLayout inputLayout = ps->vertexInputLayout();
+    const QVector<QRhiVertexInputBinding> inputBindings = inputLayout.bindings();
+    key.ds << qint32(inputBindings.count());
+    for (const QRhiVertexInputBinding &b : inputBindings)
+        key.ds << b.stride() << qint32(b.classification()) << qint32(b.instanceStepRate());
+    const QVector<QRhiVertexInputAttribute> inputAttributes = inputLayout.attributes();
+    key.ds << qint32(inputAttributes.count());
+    for (const QRhiVertexInputAttribute &a : inputAttributes)
+        key.ds << qint32(a.binding()) << qint32(a.location()) << qint32(a.format()) << a.offset();
+    key.ds << srbId;
+
+    const QVector<QRhiGraphicsShaderStage> stages = ps->shaderStages();
+    QVector<QBakedShader> shaders;
+    shaders.reserve(stages.count());
+    key.ds << qint32(stages.count());
+    for (const QRhiGraphicsShaderStage &stage : stages) {
+        key.ds << qint32(stage.type()) << qint32(stage.shaderVariant());
+        shaders.append(stage.shader());
+    }
+
+    if (isKnown(id, key.data) && knownShaders.value(id) == shaders)
+        return id;
+
+    knownShaders[id] = shaders;
+
+    // The render pass descriptor cannot be described on its own. Record the
+    // render target of the current pass instead, the pipeline must be
+    // compatible with that.
+    Record rec;
+    rec.ds << id << currentRenderTarget;
+    rec.ds.writeRawData(key.data.constData() + sizeof(quint64), key.data.size() - int(sizeof(quint64)));
+    for (const QBakedShader &shader : qAsConst(shaders))
+        rec.ds << shader.serialized();
+    writeRecord(QRhiCapture::GraphicsPipeline, rec);
+    return id;
+}
+
+quint64 QRhiCapturePrivate::ensureComputePipeline(QRhiComputePipeline *ps)
+{
+    if (!ps)
+        return 0;
+
+    auto it = describedPipelines.constFind(ps);
+    if (it != describedPipelines.constEnd())
+        return it.value();
+
+    const quint64 id = ps->globalResourceId();
+    describedPipelines.insert(ps, id);
+    const quint64 srbId = ensureShaderResourceBindings(ps->shaderResourceBindings());
+    Record key;
+    key.ds << id << srbId << qint32(ps->shaderVariant());
+    const QVector<QBakedShader> shaders = { ps->shader() };
+    if (isKnown(id, key.data) && knownShaders.value(id) == shaders)
+        return id;
+
+    knownShaders[id] = shaders;
+
+    Record rec;
+    rec.ds.writeRawData(key.data.constData(), key.data.size());
+    rec.ds << ps->shader().serialized();
+    writeRecord(QRhiCapture::ComputePipeline, rec);
+    return id;
+}
+
+void QRhiCapturePrivate::resourceRebuilt(QRhiResource *res)
+{
+    describedPipelines.remove(res);
+}
+
+void QRhiCapturePrivate::resourceDestroyed(QRhiResource *res)
+{
+    describedPipelines.remove(res);
+    const quint64 id = res->globalResourceId();
+    if (!knownResources.remove(id))
+        return;
+
+    knownShaders.remove(id);
+    Record rec;
+    rec.ds << id;
+    writeRecord(QRhiCapture::DestroyResource, rec);
+}
+
+void QRhiCapturePrivate::writeBatch(QDataStream &ds, QRhiResourceUpdateBatch *resourceUpdates)
+{
+    if (!resourceUpdates) {
+        ds << quint32(0);
+        return;
+    }
+
+    // Any resource not yet described gets its record written before the
+    // record containing the batch since ds is not the output stream.
+    QRhiResourceUpdateBatchPrivate *ud = QRhiResourceUpdateBatchPrivate::get(resourceUpdates);
+    ds << quint32(ud->dynamicBufferUpdates.count() + ud->staticBufferUploads.count()
+                  + ud->bufferReadbacks.count() + ud->textureOps.count());
+
+    for (const QRhiResourceUpdateBatchPrivate::DynamicBufferUpdate &u : qAsConst(ud->dynamicBufferUpdates))
+        ds << quint8(QRhiCapture::DynamicBufferUpdate) << ensureBuffer(u.buf) << qint32(u.offset) << u.data;
+
+    for (const QRhiResourceUpdateBatchPrivate::StaticBufferUpload &u : qAsConst(ud->staticBufferUploads))
+        ds << quint8(QRhiCapture::StaticBufferUpload) << ensureBuffer(u.buf) << qint32(u.offset) << u.data;
+
+    for (const QRhiResourceUpdateBatchPrivate::BufferReadback &u : qAsConst(ud->bufferReadbacks))
+        ds << quint8(QRhiCapture::BufferReadback) << ensureBuffer(u.buf) << qint32(u.offset) << qint32(u.size);
+
+    for (const QRhiResourceUpdateBatchPrivate::TextureOp &u : qAsConst(ud->textureOps)) {
+        switch (u.type) {
+        case QRhiResourceUpdateBatchPrivate::TextureOp::TexUpload:
+        {
+            ds << quint8(QRhiCapture::TextureUpload) << ensureTexture(u.upload.tex);
+            const QVector<QRhiTextureLayer> layers = u.upload.desc.layers();
+            ds << qint32(layers.count());
+            for (const QRhiTextureLayer &layer : layers) {
+                const QVector<QRhiTextureMipLevel> mipImages = layer.mipImages();
+                ds << qint32(mipImages.count());
+                for (const QRhiTextureMipLevel &mipImage : mipImages) {
+                    // QDataStream would encode a QImage as PNG, store the raw pixels instead
+                    const QImage image = mipImage.image();
+                    ds << !image.isNull();
+                    if (!image.isNull()) {
+                        ds << qint32(image.format()) << image.size() << qint32(image.bytesPerLine());
+                        ds.writeBytes(reinterpret_cast<const char *>(image.constBits()), uint(image.sizeInBytes()));
+                    } else {
+                        ds << mipImage.compressedData();
+                    }
+                    ds << mipImage.destinationTopLeft() << mipImage.sourceSize() << mipImage.sourceTopLeft();
+                }
+            }
+        }
+            break;
+        case QRhiResourceUpdateBatchPrivate::TextureOp::TexCopy:
+            ds << quint8(QRhiCapture::TextureCopy)
+               << ensureTexture(u.copy.dst) << ensureTexture(u.copy.src)
+               << u.copy.desc.pixelSize()
+               << qint32(u.copy.desc.sourceLayer()) << qint32(u.copy.desc.sourceLevel())
+               << u.copy.desc.sourceTopLeft()
+               << qint32(u.copy.desc.destinationLayer()) << qint32(u.copy.desc.destinationLevel())
+               << u.copy.desc.destinationTopLeft();
+            break;
+        case QRhiResourceUpdateBatchPrivate::TextureOp::TexRead:
+            // texture id 0 means the current swapchain's backbuffer
+            ds << quint8(QRhiCapture::TextureReadback)
+               << ensureTexture(u.read.rb.texture())
+               << qint32(u.read.rb.layer()) << qint32(u.read.rb.level()) << u.read.rb.rect();
+            break;
+        case QRhiResourceUpdateBatchPrivate::TextureOp::TexMipGen:
+            ds << quint8(QRhiCapture::GenerateMips) << ensureTexture(u.mipgen.tex);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void QRhiCapturePrivate::writeBatchRecord(QRhiCapture::StreamOp op, QRhiResourceUpdateBatch *resourceUpdates)
+{
+    Record rec;
+    writeBatch(rec.ds, resourceUpdates);
+    writeRecord(op, rec);
+}
+
+void QRhiCapturePrivate::beginFrame(QRhiSwapChain *sc)
+{
+    currentSwapChain = sc;
+    Record rec;
+    rec.ds << ensureSwapChain(sc) << ts.nsecsElapsed();
+    writeRecord(QRhiCapture::BeginFrame, rec);
+}
+
+void QRhiCapturePrivate::endFrame(QRhiSwapChain *sc)
+{
+    Record rec;
+    rec.ds << sc->globalResourceId() << ts.nsecsElapsed();
+    writeRecord(QRhiCapture::EndFrame, rec);
+    currentSwapChain = nullptr;
+}
+
+void QRhiCapturePrivate::beginOffscreenFrame()
+{
+    currentSwapChain = nullptr;
+    Record rec;
+    rec.ds << ts.nsecsElapsed();
+    writeRecord(QRhiCapture::BeginOffscreenFrame, rec);
+}
+
+void QRhiCapturePrivate::endOffscreenFrame()
+{
+    Record rec;
+    rec.ds << ts.nsecsElapsed();
+    writeRecord(QRhiCapture::EndOffscreenFrame, rec);
+}
+
+void QRhiCapturePrivate::finish()
+{
+    writeRecord(QRhiCapture::Finish);
+}
+
+void QRhiCapturePrivate::resourceUpdate(QRhiResourceUpdateBatch *resourceUpdates)
+{
+    writeBatchRecord(QRhiCapture::ResourceUpdate, resourceUpdates);
+}
+
+void QRhiCapturePrivate::beginPass(QRhiRenderTarget *rt,
+                                   const QRhiColorClearValue &colorClearValue,
+                                   const QRhiDepthStencilClearValue &depthStencilClearValue,
+                                   QRhiResourceUpdateBatch *resourceUpdates)
+{
+    currentRenderTarget = ensureRenderTarget(rt);
+    Record rec;
+    rec.ds << currentRenderTarget << colorClearValue.rgba()
+           << depthStencilClearValue.depthClearValue() << depthStencilClearValue.stencilClearValue();
+    writeBatch(rec.ds, resourceUpdates);
+    writeRecord(QRhiCapture::BeginPass, rec);
+}
+
+void QRhiCapturePrivate::endPass(QRhiResourceUpdateBatch *resourceUpdates)
+{
+    writeBatchRecord(QRhiCapture::EndPass, resourceUpdates);
+    currentRenderTarget = 0;
+}
+
+void QRhiCapturePrivate::beginComputePass(QRhiResourceUpdateBatch *resourceUpdates)
+{
+    writeBatchRecord(QRhiCapture::BeginComputePass, resourceUpdates);
+}
+
+void QRhiCapturePrivate::endComputePass(QRhiResourceUpdateBatch *resourceUpdates)
+{
+    writeBatchRecord(QRhiCapture::EndComputePass, resourceUpdates);
+}
+
+void QRhiCapturePrivate::setGraphicsPipeline(QRhiGraphicsPipeline *ps)
+{
+    Record rec;
+    rec.ds << ensureGraphicsPipeline(ps);
+    writeRecord(QRhiCapture::SetGraphicsPipeline, rec);
+}
+
+void QRhiCapturePrivate::setComputePipeline(QRhiComputePipeline *ps)
+{
+    Record rec;
+    rec.ds << ensureComputePipeline(ps);
+    writeRecord(QRhiCapture::SetComputePipeline, rec);
+}
+
+void QRhiCapturePrivate::setShaderResources(QRhiShaderResourceBindings *srb,
+                                            const QVector<QRhiCommandBuffer::DynamicOffset> &dynamicOffsets)
+{
+    Record rec;
+    rec.ds << ensureShaderResourceBindings(srb) << qint32(dynamicOffsets.count());
+    for (const QRhiCommandBuffer::DynamicOffset &dynOfs : dynamicOffsets)
+        rec.ds << qint32(dynOfs.first) << dynOfs.second;
+    writeRecord(QRhiCapture::SetShaderResources, rec);
+}
+
+void QRhiCapturePrivate::setVertexInput(int startBinding, const QVector<QRhiCommandBuffer::VertexInput> &bindings,
+                                        QRhiBuffer *indexBuf, quint32 indexOffset,
+                                        QRhiCommandBuffer::IndexFormat indexFormat)
+{
+    Record rec;
+    rec.ds << qint32(startBinding) << qint32(bindings.count());
+    for (const QRhiCommandBuffer::VertexInput &input : bindings)
+        rec.ds << ensureBuffer(input.first) << input.second;
+    rec.ds << ensureBuffer(indexBuf) << indexOffset << qint32(indexFormat);
+    writeRecord(QRhiCapture::SetVertexInput, rec);
+}
+
+void QRhiCapturePrivate::setViewport(const QRhiViewport &viewport)
+{
+    Record rec;
+    rec.ds << viewport.viewport() << viewport.minDepth() << viewport.maxDepth();
+    writeRecord(QRhiCapture::SetViewport, rec);
+}
+
+void QRhiCapturePrivate::setScissor(const QRhiScissor &scissor)
+{
+    Record rec;
+    rec.ds << scissor.scissor();
+    writeRecord(QRhiCapture::SetScissor, rec);
+}
+
+void QRhiCapturePrivate::setBlendConstants(const QVector4D &c)
+{
+    Record rec;
+    rec.ds << c;
+    writeRecord(QRhiCapture::SetBlendConstants, rec);
+}
+
+void QRhiCapturePrivate::setStencilRef(quint32 refValue)
+{
+    Record rec;
+    rec.ds << refValue;
+    writeRecord(QRhiCapture::SetStencilRef, rec);
+}
+
+void QRhiCapturePrivate::setPushConstants(QRhiShaderResourceBinding::StageFlags stages,
+                                          quint32 offset, quint32 size, const void *data)
+{
+    Record rec;
+    rec.ds << qint32(stages) << offset;
+    rec.ds.writeBytes(static_cast<const char *>(data), size);
+    writeRecord(QRhiCapture::SetPushConstants, rec);
+}
+
+void QRhiCapturePrivate::draw(quint32 vertexCount, quint32 instanceCount, quint32 firstVertex, quint32 firstInstance)
+{
+    Record rec;
+    rec.ds << vertexCount << instanceCount << firstVertex << firstInstance;
+    writeRecord(QRhiCapture::Draw, rec);
+}
+
+void QRhiCapturePrivate::drawIndexed(quint32 indexCount, quint32 instanceCount, quint32 firstIndex,
+                                     qint32 vertexOffset, quint32 firstInstance)
+{
+    Record rec;
+    rec.ds << indexCount << instanceCount << firstIndex << vertexOffset << firstInstance;
+    writeRecord(QRhiCapture::DrawIndexed, rec);
+}
+
+void QRhiCapturePrivate::drawIndirect(QRhiCapture::StreamOp op, QRhiBuffer *indirectBuffer, quint32 indirectBufferOffset,
+                                      quint32 drawCount, quint32 stride)
+{
+    Record rec;
+    rec.ds << ensureBuffer(indirectBuffer) << indirectBufferOffset << drawCount << stride;
+    writeRecord(op, rec);
+}
+
+void QRhiCapturePrivate::dispatch(int x, int y, int z)
+{
+    Record rec;
+    rec.ds << qint32(x) << qint32(y) << qint32(z);
+    writeRecord(QRhiCapture::Dispatch, rec);
+}
+
+void QRhiCapturePrivate::debugMarkBegin(const QByteArray &name)
+{
+    Record rec;
+    rec.ds << name;
+    writeRecord(QRhiCapture::DebugMarkBegin, rec);
+}
+
+void QRhiCapturePrivate::debugMarkEnd()
+{
+    writeRecord(QRhiCapture::DebugMarkEnd);
+}
+
+void QRhiCapturePrivate::debugMarkMsg(const QByteArray &msg)
+{
+    Record rec;
+    rec.ds << msg;
+    writeRecord(QRhiCapture::DebugMarkMsg, rec);
+}
+
+QT_END_NAMESPACE
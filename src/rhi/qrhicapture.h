@@ -0,0 +1,121 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the Qt RHI module
+**
+** $QT_BEGIN_LICENSE:LGPL3$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see http://www.qt.io/terms-conditions. For further
+** information use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPLv3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or later as published by the Free
+** Software Foundation and appearing in the file LICENSE.GPL included in
+** the packaging of this file. Please review the following information to
+** ensure the GNU General Public License version 2.0 requirements will be
+** met: http://www.gnu.org/licenses/gpl-2.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QRHICAPTURE_H
+#define QRHICAPTURE_H
+
+#include <QtRhi/qrhi.h>
+
+QT_BEGIN_NAMESPACE
+
+class QRhiCapturePrivate;
+class QIODevice;
+
+class Q_RHI_EXPORT QRhiCapture
+{
+public:
+    enum StreamOp {
+        Buffer = 1,
+        Texture,
+        Sampler,
+        RenderBuffer,
+        TextureRenderTarget,
+        SwapChain,
+        SwapChainRenderTarget,
+        ShaderResourceBindings,
+        GraphicsPipeline,
+        ComputePipeline,
+        DestroyResource,
+        BeginFrame,
+        EndFrame,
+        BeginOffscreenFrame,
+        EndOffscreenFrame,
+        Finish,
+        ResourceUpdate,
+        BeginPass,
+        EndPass,
+        BeginComputePass,
+        EndComputePass,
+        SetGraphicsPipeline,
+        SetComputePipeline,
+        SetShaderResources,
+        SetVertexInput,
+        SetViewport,
+        SetScissor,
+        SetBlendConstants,
+        SetStencilRef,
+        SetPushConstants,
+        Draw,
+        DrawIndexed,
+        DrawIndirect,
+        DrawIndexedIndirect,
+        Dispatch,
+        DebugMarkBegin,
+        DebugMarkEnd,
+        DebugMarkMsg
+    };
+
+    enum UpdateOp {
+        DynamicBufferUpdate = 1,
+        StaticBufferUpload,
+        BufferReadback,
+        TextureUpload,
+        TextureCopy,
+        TextureReadback,
+        GenerateMips
+    };
+
+    static const quint32 Magic = 0x51524350; // QRCP
+    static const quint32 Version = 1;
+
+    ~QRhiCapture();
+
+    QIODevice *device() const;
+    void setDevice(QIODevice *device);
+
+    bool isActive() const;
+
+private:
+    Q_DISABLE_COPY(QRhiCapture)
+    QRhiCapture();
+    QRhiCapturePrivate *d;
+    friend class QRhiImplementation;
+    friend class QRhiCapturePrivate;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,148 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing/
+**
+** This file is part of the Qt RHI module
+**
+** $QT_BEGIN_LICENSE:GPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QRHICAPTURE_P_H
+#define QRHICAPTURE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qtrhiglobal_p.h"
+#include "qrhicapture.h"
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QHash>
+
+QT_BEGIN_NAMESPACE
+
+class QRhiImplementation;
+
+class QRhiCapturePrivate
+{
+public:
+    static QRhiCapturePrivate *get(QRhiCapture *c) { return c->d; }
+
+    static const QDataStream::Version STREAM_VERSION = QDataStream::Qt_5_10;
+
+    void startIfPending(QRhiImplementation *rhiD);
+    void stop();
+
+    void resourceDestroyed(QRhiResource *res);
+    void resourceRebuilt(QRhiResource *res);
+
+    void beginFrame(QRhiSwapChain *sc);
+    void endFrame(QRhiSwapChain *sc);
+    void beginOffscreenFrame();
+    void endOffscreenFrame();
+    void finish();
+
+    void resourceUpdate(QRhiResourceUpdateBatch *resourceUpdates);
+    void beginPass(QRhiRenderTarget *rt,
+                   const QRhiColorClearValue &colorClearValue,
+                   const QRhiDepthStencilClearValue &depthStencilClearValue,
+                   QRhiResourceUpdateBatch *resourceUpdates);
+    void endPass(QRhiResourceUpdateBatch *resourceUpdates);
+    void beginComputePass(QRhiResourceUpdateBatch *resourceUpdates);
+    void endComputePass(QRhiResourceUpdateBatch *resourceUpdates);
+    void setGraphicsPipeline(QRhiGraphicsPipeline *ps);
+    void setComputePipeline(QRhiComputePipeline *ps);
+    void setShaderResources(QRhiShaderResourceBindings *srb,
+                            const QVector<QRhiCommandBuffer::DynamicOffset> &dynamicOffsets);
+    void setVertexInput(int startBinding, const QVector<QRhiCommandBuffer::VertexInput> &bindings,
+                        QRhiBuffer *indexBuf, quint32 indexOffset,
+                        QRhiCommandBuffer::IndexFormat indexFormat);
+    void setViewport(const QRhiViewport &viewport);
+    void setScissor(const QRhiScissor &scissor);
+    void setBlendConstants(const QVector4D &c);
+    void setStencilRef(quint32 refValue);
+    void setPushConstants(QRhiShaderResourceBinding::StageFlags stages,
+                          quint32 offset, quint32 size, const void *data);
+    void draw(quint32 vertexCount, quint32 instanceCount, quint32 firstVertex, quint32 firstInstance);
+    void drawIndexed(quint32 indexCount, quint32 instanceCount, quint32 firstIndex,
+                     qint32 vertexOffset, quint32 firstInstance);
+    void drawIndirect(QRhiCapture::StreamOp op, QRhiBuffer *indirectBuffer, quint32 indirectBufferOffset,
+                      quint32 drawCount, quint32 stride);
+    void dispatch(int x, int y, int z);
+    void debugMarkBegin(const QByteArray &name);
+    void debugMarkEnd();
+    void debugMarkMsg(const QByteArray &msg);
+
+    QIODevice *outputDevice = nullptr;
+    bool pending = false;
+    bool active = false;
+    QDataStream stream;
+    QElapsedTimer ts;
+
+private:
+    struct Record {
+        Record() : ds(&data, QIODevice::WriteOnly) { ds.setVersion(STREAM_VERSION); }
+        QByteArray data;
+        QDataStream ds;
+    };
+
+    void writeRecord(QRhiCapture::StreamOp op, const Record &rec);
+    void writeRecord(QRhiCapture::StreamOp op);
+    bool isKnown(quint64 id, const QByteArray &key);
+
+    // Resources are described lazily, when first referenced by a recorded
+    // command, and again whenever their description changes. The returned
+    // value is the id used in the stream, 0 for null.
+    quint64 ensureBuffer(QRhiBuffer *buf);
+    quint64 ensureTexture(QRhiTexture *tex);
+    quint64 ensureSampler(QRhiSampler *sampler);
+    quint64 ensureRenderBuffer(QRhiRenderBuffer *rb);
+    quint64 ensureRenderTarget(QRhiRenderTarget *rt);
+    quint64 ensureSwapChain(QRhiSwapChain *sc);
+    quint64 ensureShaderResourceBindings(QRhiShaderResourceBindings *srb);
+    quint64 ensureGraphicsPipeline(QRhiGraphicsPipeline *ps);
+    quint64 ensureComputePipeline(QRhiComputePipeline *ps);
+
+    void writeBatch(QDataStream &ds, QRhiResourceUpdateBatch *resourceUpdates);
+    void writeBatchRecord(QRhiCapture::StreamOp op, QRhiResourceUpdateBatch *resourceUpdates);
+
+    QHash<quint64, QByteArray> knownResources;
+    QHash<quint64, QVector<QBakedShader> > knownShaders;
+    // Pipelines are immutable until the next build(), so the ids of the ones
+    // already described are returned as-is until they get rebuilt or released.
+    QHash<const QRhiResource *, quint64> describedPipelines;
+    QRhiSwapChain *currentSwapChain = nullptr;
+    quint64 currentRenderTarget = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -374,6 +374,11 @@ bool QRhiD3D11::isTextureFormatSupported(QRhiTexture::Format format, QRhiTexture
     return true;
 }
 
+bool QRhiD3D11::isVertexFormatSupported(QRhiVertexInputAttribute::Format format) const
+{
+    return format != QRhiVertexInputAttribute::SNormA2B10G10R10;
+}
+
 bool QRhiD3D11::isFeatureSupported(QRhi::Feature feature) const
 {
     switch (feature) {
@@ -403,6 +408,18 @@ bool QRhiD3D11::isFeatureSupported(QRhi::Feature feature) const
         return true;
     case QRhi::RedOrAlpha8IsRed:
         return true;
+    case QRhi::Compute:
+        return false;
+    case QRhi::DrawIndirect:
+        return true;
+    case QRhi::DrawIndirectMulti:
+        return false;
+    case QRhi::PushConstants:
+        return false;
+    case QRhi::ThreeDimensionalTextures:
+        return false;
+    case QRhi::TextureArrays:
+        return false;
     default:
         Q_UNREACHABLE();
         return false;
@@ -416,6 +433,10 @@ int QRhiD3D11::resourceSizeLimit(QRhi::ResourceSizeLimit limit) const
         return 1;
     case QRhi::TextureSizeMax:
         return D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION;
+    case QRhi::PushConstantsSizeMax:
+        return 0;
+    case QRhi::TextureArraySizeMax:
+        return 0;
     default:
         Q_UNREACHABLE();
         return 0;
@@ -457,11 +478,23 @@ QRhiGraphicsPipeline *QRhiD3D11::createGraphicsPipeline()
     return new QD3D11GraphicsPipeline(this);
 }
 
+QRhiComputePipeline *QRhiD3D11::createComputePipeline()
+{
+    return new QD3D11ComputePipeline(this);
+}
+
 QRhiShaderResourceBindings *QRhiD3D11::createShaderResourceBindings()
 {
     return new QD3D11ShaderResourceBindings(this);
 }
 
+void QRhiD3D11::setComputePipeline(QRhiCommandBuffer *cb, QRhiComputePipeline *ps)
+{
+    Q_UNUSED(cb);
+    Q_UNUSED(ps);
+    Q_ASSERT(inComputePass);
+}
+
 void QRhiD3D11::setGraphicsPipeline(QRhiCommandBuffer *cb, QRhiGraphicsPipeline *ps)
 {
     Q_ASSERT(inPass);
@@ -533,6 +566,19 @@ void QRhiD3D11::setShaderResources(QRhiCommandBuffer *cb, QRhiShaderResourceBind
             }
         }
             break;
+        case QRhiShaderResourceBinding::ImageLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageLoadStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferLoadStore:
+            // ### compute is not supported in this backend
+            break;
         default:
             Q_UNREACHABLE();
             break;
@@ -699,6 +745,18 @@ void QRhiD3D11::setStencilRef(QRhiCommandBuffer *cb, quint32 refValue)
     cbD->commands.append(cmd);
 }
 
+void QRhiD3D11::setPushConstants(QRhiCommandBuffer *cb, QRhiShaderResourceBinding::StageFlags stages,
+                                 quint32 offset, quint32 size, const void *data)
+{
+    Q_UNUSED(cb);
+    Q_UNUSED(stages);
+    Q_UNUSED(offset);
+    Q_UNUSED(size);
+    Q_UNUSED(data);
+    Q_ASSERT(inPass || inComputePass);
+    // ### push constants are not supported in this backend
+}
+
 void QRhiD3D11::draw(QRhiCommandBuffer *cb, quint32 vertexCount,
                      quint32 instanceCount, quint32 firstVertex, quint32 firstInstance)
 {
@@ -730,12 +788,142 @@ void QRhiD3D11::drawIndexed(QRhiCommandBuffer *cb, quint32 indexCount,
     cbD->commands.append(cmd);
 }
 
+void QRhiD3D11::drawIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                             quint32 indirectBufferOffset, quint32 drawCount, quint32 stride)
+{
+    Q_ASSERT(inPass);
+    QD3D11CommandBuffer *cbD = QRHI_RES(QD3D11CommandBuffer, cb);
+    QD3D11Buffer *bufD = QRHI_RES(QD3D11Buffer, indirectBuffer);
+    Q_ASSERT(bufD->m_usage.testFlag(QRhiBuffer::IndirectBuffer));
+    drawCount = indirectDrawCountInRange(bufD, indirectBufferOffset, drawCount, stride,
+                                         sizeof(QRhiCommandBuffer::DrawIndirectCommand));
+    if (!drawCount)
+        return;
+    if (bufD->m_type == QRhiBuffer::Dynamic)
+        executeBufferHostWritesForCurrentFrame(bufD);
+
+    QD3D11CommandBuffer::Command cmd;
+    cmd.cmd = QD3D11CommandBuffer::Command::DrawIndirect;
+    cmd.args.drawIndirect.ps = QRHI_RES(QD3D11GraphicsPipeline, cbD->currentPipeline);
+    cmd.args.drawIndirect.buffer = bufD->buffer;
+    cmd.args.drawIndirect.offset = indirectBufferOffset;
+    cmd.args.drawIndirect.drawCount = drawCount;
+    cmd.args.drawIndirect.stride = stride;
+    cbD->commands.append(cmd);
+}
+
+void QRhiD3D11::drawIndexedIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                                    quint32 indirectBufferOffset, quint32 drawCount, quint32 stride)
+{
+    Q_ASSERT(inPass);
+    QD3D11CommandBuffer *cbD = QRHI_RES(QD3D11CommandBuffer, cb);
+    QD3D11Buffer *bufD = QRHI_RES(QD3D11Buffer, indirectBuffer);
+    Q_ASSERT(bufD->m_usage.testFlag(QRhiBuffer::IndirectBuffer));
+    drawCount = indirectDrawCountInRange(bufD, indirectBufferOffset, drawCount, stride,
+                                         sizeof(QRhiCommandBuffer::DrawIndexedIndirectCommand));
+    if (!drawCount)
+        return;
+    if (bufD->m_type == QRhiBuffer::Dynamic)
+        executeBufferHostWritesForCurrentFrame(bufD);
+
+    QD3D11CommandBuffer::Command cmd;
+    cmd.cmd = QD3D11CommandBuffer::Command::DrawIndexedIndirect;
+    cmd.args.drawIndirect.ps = QRHI_RES(QD3D11GraphicsPipeline, cbD->currentPipeline);
+    cmd.args.drawIndirect.buffer = bufD->buffer;
+    cmd.args.drawIndirect.offset = indirectBufferOffset;
+    cmd.args.drawIndirect.drawCount = drawCount;
+    cmd.args.drawIndirect.stride = stride;
+    cbD->commands.append(cmd);
+}
+
+void QRhiD3D11::dispatch(QRhiCommandBuffer *cb, int x, int y, int z)
+{
+    Q_UNUSED(cb);
+    Q_UNUSED(x);
+    Q_UNUSED(y);
+    Q_UNUSED(z);
+    Q_ASSERT(inComputePass);
+}
+
+void QRhiD3D11::writeMarkerTimestamp(QD3D11CommandBuffer *cbD, bool begin)
+{
+    // Only the swapchain frames are timed, within the disjoint query of the
+    // frame. Scopes are numbered in debugMarkBegin order, like in the
+    // profiler, also when running out of queries.
+    QD3D11SwapChain *swapChainD = contextState.currentSwapChain;
+    if (!swapChainD || cbD != &swapChainD->cb)
+        return;
+
+    QD3D11SwapChain::MarkerTiming &mt(swapChainD->markerTiming[swapChainD->currentFrameSlot]);
+    if (!mt.active)
+        return;
+
+    int query = -1;
+    if (mt.queryCount < QD3D11SwapChain::MAX_MARKER_TIMESTAMPS) {
+        if (mt.queryCount == mt.queries.count()) {
+            D3D11_QUERY_DESC queryDesc;
+            memset(&queryDesc, 0, sizeof(queryDesc));
+            queryDesc.Query = D3D11_QUERY_TIMESTAMP;
+            ID3D11Query *q = nullptr;
+            HRESULT hr = dev->CreateQuery(&queryDesc, &q);
+            if (SUCCEEDED(hr))
+                mt.queries.append(q);
+            else
+                qWarning("Failed to create marker timestamp query: %s", qPrintable(comErrorMessage(hr)));
+        }
+        if (mt.queryCount < mt.queries.count()) {
+            query = mt.queryCount++;
+            QD3D11CommandBuffer::Command cmd;
+            cmd.cmd = QD3D11CommandBuffer::Command::Timestamp;
+            cmd.args.timestamp.query = mt.queries[query];
+            cbD->commands.append(cmd);
+        }
+    }
+
+    if (begin) {
+        mt.stack.append({ mt.scopeCount++, query, -1 });
+    } else if (!mt.stack.isEmpty()) {
+        QD3D11SwapChain::MarkerTiming::Scope s = mt.stack.takeLast();
+        s.endQuery = query;
+        mt.scopes.append(s);
+    }
+}
+
+void QRhiD3D11::resolveMarkerTimestamps(QD3D11SwapChain *swapChainD, int frameSlot, const D3D11_QUERY_DATA_TIMESTAMP_DISJOINT &dj)
+{
+    QD3D11SwapChain::MarkerTiming &mt(swapChainD->markerTiming[frameSlot]);
+    const quint64 serial = mt.serial;
+    mt.serial = 0;
+    QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
+    if (!rhiP || dj.Disjoint || !dj.Frequency || !mt.queryCount)
+        return;
+
+    QVarLengthArray<quint64, 64> timestamps(mt.queryCount);
+    for (int i = 0; i < mt.queryCount; ++i) {
+        // the end of frame timestamp is available, so are these
+        if (context->GetData(mt.queries[i], &timestamps[i], sizeof(quint64), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+            return;
+    }
+
+    QVector<QRhiProfilerPrivate::MarkerGpuTime> times(mt.scopeCount);
+    for (const QD3D11SwapChain::MarkerTiming::Scope &s : qAsConst(mt.scopes)) {
+        if (s.beginQuery < 0 || s.endQuery < 0)
+            continue;
+        times[s.scope].start = (timestamps[s.beginQuery] - timestamps[0]) / float(dj.Frequency) * 1000.0f;
+        times[s.scope].duration = (timestamps[s.endQuery] - timestamps[s.beginQuery]) / float(dj.Frequency) * 1000.0f;
+    }
+
+    QRHI_PROF_F(resolveMarkerGpuTimes(swapChainD, serial, times));
+}
+
 void QRhiD3D11::debugMarkBegin(QRhiCommandBuffer *cb, const QByteArray &name)
 {
+    QD3D11CommandBuffer *cbD = QRHI_RES(QD3D11CommandBuffer, cb);
+    writeMarkerTimestamp(cbD, true);
+
     if (!debugMarkers || !annotations)
         return;
 
-    QD3D11CommandBuffer *cbD = QRHI_RES(QD3D11CommandBuffer, cb);
     QD3D11CommandBuffer::Command cmd;
     cmd.cmd = QD3D11CommandBuffer::Command::DebugMarkBegin;
     strncpy(cmd.args.debugMark.s, name.constData(), sizeof(cmd.args.debugMark.s));
@@ -745,10 +933,12 @@ void QRhiD3D11::debugMarkBegin(QRhiCommandBuffer *cb, const QByteArray &name)
 
 void QRhiD3D11::debugMarkEnd(QRhiCommandBuffer *cb)
 {
+    QD3D11CommandBuffer *cbD = QRHI_RES(QD3D11CommandBuffer, cb);
+    writeMarkerTimestamp(cbD, false);
+
     if (!debugMarkers || !annotations)
         return;
 
-    QD3D11CommandBuffer *cbD = QRHI_RES(QD3D11CommandBuffer, cb);
     QD3D11CommandBuffer::Command cmd;
     cmd.cmd = QD3D11CommandBuffer::Command::DebugMarkEnd;
     cbD->commands.append(cmd);
@@ -801,10 +991,26 @@ QRhi::FrameOpResult QRhiD3D11::beginFrame(QRhiSwapChain *swapChain, QRhi::BeginF
                 // finally got a value, just report it, the profiler cares about min/max/avg anyway
                 QRHI_PROF_F(swapChainFrameGpuTime(swapChain, elapsedMs));
             }
+            if (swapChainD->markerTiming[currentFrameSlot].serial)
+                resolveMarkerTimestamps(swapChainD, currentFrameSlot, dj);
             swapChainD->timestampActive[currentFrameSlot] = false;
         } // else leave timestampActive set to true, will retry in a subsequent beginFrame
     }
 
+    // Time the debug marker scopes when the frame timestamps get recorded
+    // for this frame. Otherwise the previous results are still pending.
+    QD3D11SwapChain::MarkerTiming &mt(swapChainD->markerTiming[currentFrameSlot]);
+    mt.active = false;
+    if (rhiP && rhiP->markerTiming && swapChainD->timestampDisjointQuery[currentFrameSlot]
+            && !swapChainD->timestampActive[currentFrameSlot])
+    {
+        mt.active = true;
+        mt.queryCount = 0;
+        mt.scopeCount = 0;
+        mt.stack.clear();
+        mt.scopes.clear();
+    }
+
     swapChainD->cb.resetState();
 
     swapChainD->rt.d.rtv[0] = swapChainD->sampleDesc.Count > 1 ?
@@ -856,6 +1062,10 @@ QRhi::FrameOpResult QRhiD3D11::endFrame(QRhiSwapChain *swapChain, QRhi::EndFrame
     }
 
     QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
+    QD3D11SwapChain::MarkerTiming &mt(swapChainD->markerTiming[currentFrameSlot]);
+    if (rhiP && mt.active && recordTimestamps && !mt.scopes.isEmpty())
+        mt.serial = rhiP->requestMarkerGpuTimes(swapChain);
+    mt.active = false;
     // this must be done before the Present
     QRHI_PROF_F(endSwapChainFrame(swapChain, swapChainD->frameCount + 1));
 
@@ -919,6 +1129,21 @@ static inline DXGI_FORMAT toD3DTextureFormat(QRhiTexture::Format format, QRhiTex
     case QRhiTexture::RED_OR_ALPHA8:
         return DXGI_FORMAT_R8_UNORM;
 
+    case QRhiTexture::RG8:
+        return DXGI_FORMAT_R8G8_UNORM;
+    case QRhiTexture::RG16:
+        return DXGI_FORMAT_R16G16_UNORM;
+    case QRhiTexture::RGBA16F:
+        return DXGI_FORMAT_R16G16B16A16_FLOAT;
+    case QRhiTexture::RGBA32F:
+        return DXGI_FORMAT_R32G32B32A32_FLOAT;
+    case QRhiTexture::R16F:
+        return DXGI_FORMAT_R16_FLOAT;
+    case QRhiTexture::R32F:
+        return DXGI_FORMAT_R32_FLOAT;
+    case QRhiTexture::B10G11R11_UFLOAT:
+        return DXGI_FORMAT_R11G11B10_FLOAT; // same bit layout despite the name
+
     case QRhiTexture::D16:
         return DXGI_FORMAT_R16_TYPELESS;
     case QRhiTexture::D32:
@@ -1002,6 +1227,20 @@ static inline QRhiTexture::Format colorTextureFormatFromDxgiFormat(DXGI_FORMAT f
         return QRhiTexture::R8;
     case DXGI_FORMAT_R16_UNORM:
         return QRhiTexture::R16;
+    case DXGI_FORMAT_R8G8_UNORM:
+        return QRhiTexture::RG8;
+    case DXGI_FORMAT_R16G16_UNORM:
+        return QRhiTexture::RG16;
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        return QRhiTexture::RGBA16F;
+    case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        return QRhiTexture::RGBA32F;
+    case DXGI_FORMAT_R16_FLOAT:
+        return QRhiTexture::R16F;
+    case DXGI_FORMAT_R32_FLOAT:
+        return QRhiTexture::R32F;
+    case DXGI_FORMAT_R11G11B10_FLOAT:
+        return QRhiTexture::B10G11R11_UFLOAT;
     default: // this cannot assert, must warn and return unknown
         qWarning("DXGI_FORMAT %d is not a recognized uncompressed color format", format);
         break;
@@ -1081,6 +1320,50 @@ void QRhiD3D11::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdate
         cbD->commands.append(cmd);
     }
 
+    for (const QRhiResourceUpdateBatchPrivate::BufferReadback &u : ud->bufferReadbacks) {
+        QD3D11Buffer *bufD = QRHI_RES(QD3D11Buffer, u.buf);
+        ActiveBufferReadback aRb;
+        aRb.result = u.result;
+        aRb.size = u.size;
+
+        if (bufD->m_type == QRhiBuffer::Dynamic) {
+            // dynBuf has the up-to-date contents
+            u.result->data = bufD->dynBuf.mid(u.offset, u.size);
+        } else {
+            D3D11_BUFFER_DESC desc;
+            memset(&desc, 0, sizeof(desc));
+            desc.ByteWidth = u.size;
+            desc.Usage = D3D11_USAGE_STAGING;
+            desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+            HRESULT hr = dev->CreateBuffer(&desc, nullptr, &aRb.stagingBuf);
+            if (FAILED(hr)) {
+                qWarning("Failed to create readback staging buffer: %s", qPrintable(comErrorMessage(hr)));
+                continue;
+            }
+            QRHI_PROF_F(newReadbackBuffer(quint64(quintptr(aRb.stagingBuf)), bufD, u.size));
+            addReadbackMemory(quint64(quintptr(aRb.stagingBuf)), u.size);
+
+            QD3D11CommandBuffer::Command cmd;
+            cmd.cmd = QD3D11CommandBuffer::Command::CopySubRes;
+            cmd.args.copySubRes.dst = aRb.stagingBuf;
+            cmd.args.copySubRes.dstSubRes = 0;
+            cmd.args.copySubRes.dstX = 0;
+            cmd.args.copySubRes.dstY = 0;
+            cmd.args.copySubRes.src = bufD->buffer;
+            cmd.args.copySubRes.srcSubRes = 0;
+            cmd.args.copySubRes.hasSrcBox = true;
+            D3D11_BOX box;
+            box.left = u.offset;
+            box.top = box.front = 0;
+            box.back = box.bottom = 1;
+            box.right = u.offset + u.size;
+            cmd.args.copySubRes.srcBox = box;
+            cbD->commands.append(cmd);
+        }
+
+        activeBufferReadbacks.append(aRb);
+    }
+
     for (const QRhiResourceUpdateBatchPrivate::TextureOp &u : ud->textureOps) {
         if (u.type == QRhiResourceUpdateBatchPrivate::TextureOp::TexUpload) {
             QD3D11Texture *texD = QRHI_RES(QD3D11Texture, u.upload.tex);
@@ -1188,6 +1471,7 @@ void QRhiD3D11::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdate
             UINT subres = 0;
             QD3D11Texture *texD = QRHI_RES(QD3D11Texture, u.read.rb.texture());
             QD3D11SwapChain *swapChainD = nullptr;
+            QRect rect;
 
             if (texD) {
                 if (texD->sampleDesc.Count > 1) {
@@ -1197,11 +1481,15 @@ void QRhiD3D11::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdate
                 src = texD->tex;
                 dxgiFormat = texD->dxgiFormat;
                 pixelSize = u.read.rb.level() > 0 ? q->sizeForMipLevel(u.read.rb.level(), texD->m_pixelSize) : texD->m_pixelSize;
+                if (!readbackRect(u.read.rb, pixelSize, &rect))
+                    continue;
                 format = texD->m_format;
                 subres = D3D11CalcSubresource(u.read.rb.level(), u.read.rb.layer(), texD->mipLevelCount);
             } else {
                 Q_ASSERT(contextState.currentSwapChain);
                 swapChainD = QRHI_RES(QD3D11SwapChain, contextState.currentSwapChain);
+                if (!readbackRect(u.read.rb, swapChainD->pixelSize, &rect))
+                    continue;
                 if (swapChainD->sampleDesc.Count > 1) {
                     // Unlike with textures, reading back a multisample swapchain image
                     // has to be supported. Insert a resolve.
@@ -1221,6 +1509,7 @@ void QRhiD3D11::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdate
                 if (format == QRhiTexture::UnknownFormat)
                     continue;
             }
+            pixelSize = rect.size();
             quint32 bufSize = 0;
             textureFormatInfo(format, pixelSize, nullptr, &bufSize);
 
@@ -1243,6 +1532,7 @@ void QRhiD3D11::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdate
             QRHI_PROF_F(newReadbackBuffer(quint64(quintptr(stagingTex)),
                                           texD ? static_cast<QRhiResource *>(texD) : static_cast<QRhiResource *>(swapChainD),
                                           bufSize));
+            addReadbackMemory(quint64(quintptr(stagingTex)), bufSize);
 
             QD3D11CommandBuffer::Command cmd;
             cmd.cmd = QD3D11CommandBuffer::Command::CopySubRes;
@@ -1252,7 +1542,16 @@ void QRhiD3D11::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdate
             cmd.args.copySubRes.dstY = 0;
             cmd.args.copySubRes.src = src;
             cmd.args.copySubRes.srcSubRes = subres;
-            cmd.args.copySubRes.hasSrcBox = false;
+            cmd.args.copySubRes.hasSrcBox = true;
+            D3D11_BOX srcBox;
+            srcBox.left = rect.left();
+            srcBox.top = rect.top();
+            srcBox.front = 0;
+            // back, right, bottom are exclusive
+            srcBox.right = srcBox.left + rect.width();
+            srcBox.bottom = srcBox.top + rect.height();
+            srcBox.back = 1;
+            cmd.args.copySubRes.srcBox = srcBox;
             cbD->commands.append(cmd);
 
             aRb.stagingTex = stagingTex;
@@ -1283,20 +1582,21 @@ void QRhiD3D11::finishActiveReadbacks()
         const QRhiD3D11::ActiveReadback &aRb(activeReadbacks[i]);
         aRb.result->format = aRb.format;
         aRb.result->pixelSize = aRb.pixelSize;
-        aRb.result->data.resize(aRb.bufSize);
 
         D3D11_MAPPED_SUBRESOURCE mp;
         HRESULT hr = context->Map(aRb.stagingTex, 0, D3D11_MAP_READ, 0, &mp);
         if (FAILED(hr)) {
             qWarning("Failed to map readback staging texture: %s", qPrintable(comErrorMessage(hr)));
             aRb.stagingTex->Release();
+            removeReadbackMemory(quint64(quintptr(aRb.stagingTex)));
             continue;
         }
-        memcpy(aRb.result->data.data(), mp.pData, aRb.result->data.size());
+        storeReadbackData(aRb.result, mp.pData, aRb.bufSize);
         context->Unmap(aRb.stagingTex, 0);
 
         aRb.stagingTex->Release();
         QRHI_PROF_F(releaseReadbackBuffer(quint64(quintptr(aRb.stagingTex))));
+        removeReadbackMemory(quint64(quintptr(aRb.stagingTex)));
 
         if (aRb.result->completed)
             completedCallbacks.append(aRb.result->completed);
@@ -1304,6 +1604,29 @@ void QRhiD3D11::finishActiveReadbacks()
         activeReadbacks.removeAt(i);
     }
 
+    for (int i = activeBufferReadbacks.count() - 1; i >= 0; --i) {
+        const QRhiD3D11::ActiveBufferReadback &aRb(activeBufferReadbacks[i]);
+        if (aRb.stagingBuf) {
+            D3D11_MAPPED_SUBRESOURCE mp;
+            HRESULT hr = context->Map(aRb.stagingBuf, 0, D3D11_MAP_READ, 0, &mp);
+            if (SUCCEEDED(hr)) {
+                aRb.result->data.resize(aRb.size);
+                memcpy(aRb.result->data.data(), mp.pData, aRb.size);
+                context->Unmap(aRb.stagingBuf, 0);
+            } else {
+                qWarning("Failed to map readback staging buffer: %s", qPrintable(comErrorMessage(hr)));
+            }
+            aRb.stagingBuf->Release();
+            QRHI_PROF_F(releaseReadbackBuffer(quint64(quintptr(aRb.stagingBuf))));
+            removeReadbackMemory(quint64(quintptr(aRb.stagingBuf)));
+        }
+
+        if (aRb.result->completed)
+            completedCallbacks.append(aRb.result->completed);
+
+        activeBufferReadbacks.removeAt(i);
+    }
+
     lock.unlock();
     for (auto f : completedCallbacks)
         f();
@@ -1324,7 +1647,7 @@ static inline QD3D11RenderTargetData *rtData(QRhiRenderTarget *rt)
 
 void QRhiD3D11::resourceUpdate(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
 {
-    Q_ASSERT(inFrame && !inPass);
+    Q_ASSERT(inFrame && !inPass && !inComputePass);
 
     enqueueResourceUpdates(cb, resourceUpdates);
 }
@@ -1335,19 +1658,31 @@ void QRhiD3D11::beginPass(QRhiCommandBuffer *cb,
                           const QRhiDepthStencilClearValue &depthStencilClearValue,
                           QRhiResourceUpdateBatch *resourceUpdates)
 {
-    Q_ASSERT(!inPass);
+    Q_ASSERT(!inPass && !inComputePass);
 
     if (resourceUpdates)
         enqueueResourceUpdates(cb, resourceUpdates);
 
     QD3D11CommandBuffer *cbD = QRHI_RES(QD3D11CommandBuffer, cb);
-    bool needsColorClear = true;
+    quint32 colorClearMask = 0xFF;
+    quint32 colorDiscardMask = 0;
     bool needsDsClear = true;
+    bool needsDsDiscard = false;
     QD3D11RenderTargetData *rtD = rtData(rt);
     if (rt->type() == QRhiRenderTarget::RtTexture) {
         QD3D11TextureRenderTarget *rtTex = QRHI_RES(QD3D11TextureRenderTarget, rt);
-        needsColorClear = !rtTex->m_flags.testFlag(QRhiTextureRenderTarget::PreserveColorContents);
-        needsDsClear = !rtTex->m_flags.testFlag(QRhiTextureRenderTarget::PreserveDepthStencilContents);
+        const QVector<QRhiColorAttachment> colorAttachments = rtTex->m_desc.colorAttachments();
+        colorClearMask = 0;
+        for (int att = 0, attCount = colorAttachments.count(); att != attCount; ++att) {
+            const QRhiColorAttachment::LoadOp op = colorLoadOp(rtTex, colorAttachments[att]);
+            if (op == QRhiColorAttachment::LoadOpClear)
+                colorClearMask |= 1 << att;
+            else if (op == QRhiColorAttachment::LoadOpDontCare)
+                colorDiscardMask |= 1 << att;
+        }
+        const QRhiColorAttachment::LoadOp dsOp = depthStencilLoadOp(rtTex);
+        needsDsClear = dsOp == QRhiColorAttachment::LoadOpClear;
+        needsDsDiscard = rtD->dsAttCount && dsOp == QRhiColorAttachment::LoadOpDontCare;
     }
 
     cbD->currentTarget = rt;
@@ -1357,11 +1692,21 @@ void QRhiD3D11::beginPass(QRhiCommandBuffer *cb,
     fbCmd.args.setRenderTarget.rt = rt;
     cbD->commands.append(fbCmd);
 
+    if (colorDiscardMask || needsDsDiscard) {
+        QD3D11CommandBuffer::Command discardCmd;
+        discardCmd.cmd = QD3D11CommandBuffer::Command::DiscardViews;
+        discardCmd.args.discardViews.rt = rt;
+        discardCmd.args.discardViews.colorAttMask = colorDiscardMask;
+        discardCmd.args.discardViews.depthStencil = needsDsDiscard;
+        cbD->commands.append(discardCmd);
+    }
+
     QD3D11CommandBuffer::Command clearCmd;
     clearCmd.cmd = QD3D11CommandBuffer::Command::Clear;
     clearCmd.args.clear.rt = rt;
     clearCmd.args.clear.mask = 0;
-    if (rtD->colorAttCount && needsColorClear)
+    clearCmd.args.clear.colorAttMask = colorClearMask;
+    if (rtD->colorAttCount && colorClearMask)
         clearCmd.args.clear.mask |= QD3D11CommandBuffer::Command::Color;
     if (rtD->dsAttCount && needsDsClear)
         clearCmd.args.clear.mask |= QD3D11CommandBuffer::Command::Depth | QD3D11CommandBuffer::Command::Stencil;
@@ -1429,6 +1774,26 @@ void QRhiD3D11::endPass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resource
             cmd.args.resolveSubRes.format = dstTexD->dxgiFormat;
             cbD->commands.append(cmd);
         }
+
+        // the multisample contents are not needed anymore once resolved
+        quint32 colorDiscardMask = 0;
+        for (int att = 0, attCount = colorAttachments.count(); att != attCount; ++att) {
+            if (colorAttachments[att].resolveTexture()
+                    || colorStoreOp(colorAttachments[att]) == QRhiColorAttachment::StoreOpDontCare)
+            {
+                colorDiscardMask |= 1 << att;
+            }
+        }
+        const bool dsDiscard = rtTex->d.dsAttCount
+                && depthStencilStoreOp(rtTex) == QRhiColorAttachment::StoreOpDontCare;
+        if (colorDiscardMask || dsDiscard) {
+            QD3D11CommandBuffer::Command cmd;
+            cmd.cmd = QD3D11CommandBuffer::Command::DiscardViews;
+            cmd.args.discardViews.rt = rtTex;
+            cmd.args.discardViews.colorAttMask = colorDiscardMask;
+            cmd.args.discardViews.depthStencil = dsDiscard;
+            cbD->commands.append(cmd);
+        }
     }
 
     cbD->currentTarget = nullptr;
@@ -1437,6 +1802,27 @@ void QRhiD3D11::endPass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resource
         enqueueResourceUpdates(cb, resourceUpdates);
 }
 
+void QRhiD3D11::beginComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
+{
+    Q_ASSERT(!inPass && !inComputePass);
+
+    // ### compute is not supported in this backend, the pass only serves as a
+    // resource update point
+    if (resourceUpdates)
+        enqueueResourceUpdates(cb, resourceUpdates);
+
+    inComputePass = true;
+}
+
+void QRhiD3D11::endComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
+{
+    Q_ASSERT(inComputePass);
+    inComputePass = false;
+
+    if (resourceUpdates)
+        enqueueResourceUpdates(cb, resourceUpdates);
+}
+
 void QRhiD3D11::updateShaderResourceBindings(QD3D11ShaderResourceBindings *srbD)
 {
     srbD->vsubufs.clear();
@@ -1503,6 +1889,19 @@ void QRhiD3D11::updateShaderResourceBindings(QD3D11ShaderResourceBindings *srbD)
             }
         }
             break;
+        case QRhiShaderResourceBinding::ImageLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageLoadStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferLoadStore:
+            // ### compute is not supported in this backend
+            break;
         default:
             Q_UNREACHABLE();
             break;
@@ -1668,8 +2067,10 @@ void QRhiD3D11::executeCommandBuffer(QD3D11CommandBuffer *cbD, QD3D11SwapChain *
         {
             QD3D11RenderTargetData *rtD = rtData(cmd.args.clear.rt);
             if (cmd.args.clear.mask & QD3D11CommandBuffer::Command::Color) {
-                for (int i = 0; i < rtD->colorAttCount; ++i)
-                    context->ClearRenderTargetView(rtD->rtv[i], cmd.args.clear.c);
+                for (int i = 0; i < rtD->colorAttCount; ++i) {
+                    if (cmd.args.clear.colorAttMask & (1 << i))
+                        context->ClearRenderTargetView(rtD->rtv[i], cmd.args.clear.c);
+                }
             }
             uint ds = 0;
             if (cmd.args.clear.mask & QD3D11CommandBuffer::Command::Depth)
@@ -1680,6 +2081,18 @@ void QRhiD3D11::executeCommandBuffer(QD3D11CommandBuffer *cbD, QD3D11SwapChain *
                 context->ClearDepthStencilView(rtD->dsv, ds, cmd.args.clear.d, cmd.args.clear.s);
         }
             break;
+        case QD3D11CommandBuffer::Command::DiscardViews:
+        {
+            // ID3D11DeviceContext1, so this is always available
+            QD3D11RenderTargetData *rtD = rtData(cmd.args.discardViews.rt);
+            for (int i = 0; i < rtD->colorAttCount; ++i) {
+                if (cmd.args.discardViews.colorAttMask & (1 << i))
+                    context->DiscardView(rtD->rtv[i]);
+            }
+            if (cmd.args.discardViews.depthStencil && rtD->dsv)
+                context->DiscardView(rtD->dsv);
+        }
+            break;
         case QD3D11CommandBuffer::Command::Viewport:
         {
             D3D11_VIEWPORT v;
@@ -1764,6 +2177,28 @@ void QRhiD3D11::executeCommandBuffer(QD3D11CommandBuffer *cbD, QD3D11SwapChain *
                 qWarning("No graphics pipeline active for drawIndexed; ignored");
             }
             break;
+        case QD3D11CommandBuffer::Command::DrawIndirect:
+            if (cmd.args.drawIndirect.ps) {
+                // there is no multi-draw in D3D11
+                for (quint32 i = 0; i < cmd.args.drawIndirect.drawCount; ++i) {
+                    // in range, checked when recording
+                    const quint64 cmdOfs = quint64(cmd.args.drawIndirect.offset) + quint64(i) * cmd.args.drawIndirect.stride;
+                    context->DrawInstancedIndirect(cmd.args.drawIndirect.buffer, UINT(cmdOfs));
+                }
+            } else {
+                qWarning("No graphics pipeline active for drawIndirect; ignored");
+            }
+            break;
+        case QD3D11CommandBuffer::Command::DrawIndexedIndirect:
+            if (cmd.args.drawIndirect.ps) {
+                for (quint32 i = 0; i < cmd.args.drawIndirect.drawCount; ++i) {
+                    const quint64 cmdOfs = quint64(cmd.args.drawIndirect.offset) + quint64(i) * cmd.args.drawIndirect.stride;
+                    context->DrawIndexedInstancedIndirect(cmd.args.drawIndirect.buffer, UINT(cmdOfs));
+                }
+            } else {
+                qWarning("No graphics pipeline active for drawIndexedIndirect; ignored");
+            }
+            break;
         case QD3D11CommandBuffer::Command::UpdateSubRes:
             context->UpdateSubresource(cmd.args.updateSubRes.dst, cmd.args.updateSubRes.dstSubRes,
                                        cmd.args.updateSubRes.hasDstBox ? &cmd.args.updateSubRes.dstBox : nullptr,
@@ -1792,6 +2227,9 @@ void QRhiD3D11::executeCommandBuffer(QD3D11CommandBuffer *cbD, QD3D11SwapChain *
         case QD3D11CommandBuffer::Command::DebugMarkMsg:
             annotations->SetMarker(reinterpret_cast<LPCWSTR>(QString::fromLatin1(cmd.args.debugMark.s).utf16()));
             break;
+        case QD3D11CommandBuffer::Command::Timestamp:
+            context->End(cmd.args.timestamp.query);
+            break;
         default:
             break;
         }
@@ -1822,6 +2260,7 @@ void QD3D11Buffer::release()
         QRHI_RES_RHI(QRhiD3D11);
         QRHI_PROF;
         QRHI_PROF_F(releaseBuffer(this));
+        rhiD->removeBufferMemory(this);
         rhiD->unregisterResource(this);
     }
 }
@@ -1855,6 +2294,8 @@ bool QD3D11Buffer::build()
     desc.Usage = m_type == Dynamic ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
     desc.BindFlags = toD3DBufferUsage(m_usage);
     desc.CPUAccessFlags = m_type == Dynamic ? D3D11_CPU_ACCESS_WRITE : 0;
+    if (m_usage.testFlag(QRhiBuffer::IndirectBuffer))
+        desc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS;
 
     QRHI_RES_RHI(QRhiD3D11);
     HRESULT hr = rhiD->dev->CreateBuffer(&desc, nullptr, &buffer);
@@ -1873,6 +2314,7 @@ bool QD3D11Buffer::build()
 
     QRHI_PROF;
     QRHI_PROF_F(newBuffer(this, roundedSize, 1, m_type == Dynamic ? 1 : 0));
+    rhiD->addBufferMemory(this, roundedSize, m_type == Dynamic ? 2 : 1);
 
     generation += 1;
     rhiD->registerResource(this);
@@ -1912,6 +2354,7 @@ void QD3D11RenderBuffer::release()
         QRHI_RES_RHI(QRhiD3D11);
         QRHI_PROF;
         QRHI_PROF_F(releaseRenderBuffer(this));
+        rhiD->removeRenderBufferMemory(this);
         rhiD->unregisterResource(this);
     }
 }
@@ -1985,6 +2428,7 @@ bool QD3D11RenderBuffer::build()
 
     QRHI_PROF;
     QRHI_PROF_F(newRenderBuffer(this, false, false, sampleDesc.Count));
+    rhiD->addRenderBufferMemory(this, sampleDesc.Count);
 
     rhiD->registerResource(this);
     return true;
@@ -2025,6 +2469,7 @@ void QD3D11Texture::release()
         QRHI_RES_RHI(QRhiD3D11);
         QRHI_PROF;
         QRHI_PROF_F(releaseTexture(this));
+        rhiD->removeTextureMemory(this);
         rhiD->unregisterResource(this);
     }
 }
@@ -2063,6 +2508,11 @@ bool QD3D11Texture::prepareBuild(QSize *adjustedSize)
     if (tex)
         release();
 
+    if (m_flags.testFlag(ThreeDimensional) || m_flags.testFlag(TextureArray)) {
+        qWarning("3D and array textures are not supported");
+        return false;
+    }
+
     const QSize size = m_pixelSize.isEmpty() ? QSize(1, 1) : m_pixelSize;
     const bool isDepth = isDepthTextureFormat(m_format);
     const bool isCube = m_flags.testFlag(CubeMap);
@@ -2178,7 +2628,8 @@ bool QD3D11Texture::build()
         tex->SetPrivateData(WKPDID_D3DDebugObjectName, m_objectName.size(), m_objectName.constData());
 
     QRHI_PROF;
-    QRHI_PROF_F(newTexture(this, true, mipLevelCount, isCube ? 6 : 1, sampleDesc.Count));
+    QRHI_PROF_F(newTexture(this, true, false, mipLevelCount, isCube ? 6 : 1, sampleDesc.Count));
+    rhiD->addTextureMemory(this, mipLevelCount, isCube ? 6 : 1, sampleDesc.Count);
 
     owns = true;
     rhiD->registerResource(this);
@@ -2200,7 +2651,7 @@ bool QD3D11Texture::buildFrom(const QRhiNativeHandles *src)
         return false;
 
     QRHI_PROF;
-    QRHI_PROF_F(newTexture(this, false, mipLevelCount, m_flags.testFlag(CubeMap) ? 6 : 1, sampleDesc.Count));
+    QRHI_PROF_F(newTexture(this, false, false, mipLevelCount, m_flags.testFlag(CubeMap) ? 6 : 1, sampleDesc.Count));
 
     owns = false;
     QRHI_RES_RHI(QRhiD3D11);
@@ -2659,6 +3110,38 @@ static inline DXGI_FORMAT toD3DAttributeFormat(QRhiVertexInputAttribute::Format
         return DXGI_FORMAT_R8G8_UNORM;
     case QRhiVertexInputAttribute::UNormByte:
         return DXGI_FORMAT_R8_UNORM;
+    case QRhiVertexInputAttribute::Half4:
+        return DXGI_FORMAT_R16G16B16A16_FLOAT;
+    case QRhiVertexInputAttribute::Half2:
+        return DXGI_FORMAT_R16G16_FLOAT;
+    case QRhiVertexInputAttribute::SNormByte4:
+        return DXGI_FORMAT_R8G8B8A8_SNORM;
+    case QRhiVertexInputAttribute::SNormByte2:
+        return DXGI_FORMAT_R8G8_SNORM;
+    case QRhiVertexInputAttribute::SNormShort4:
+        return DXGI_FORMAT_R16G16B16A16_SNORM;
+    case QRhiVertexInputAttribute::SNormShort2:
+        return DXGI_FORMAT_R16G16_SNORM;
+    case QRhiVertexInputAttribute::UInt4:
+        return DXGI_FORMAT_R32G32B32A32_UINT;
+    case QRhiVertexInputAttribute::UInt3:
+        return DXGI_FORMAT_R32G32B32_UINT;
+    case QRhiVertexInputAttribute::UInt2:
+        return DXGI_FORMAT_R32G32_UINT;
+    case QRhiVertexInputAttribute::UInt:
+        return DXGI_FORMAT_R32_UINT;
+    case QRhiVertexInputAttribute::SInt4:
+        return DXGI_FORMAT_R32G32B32A32_SINT;
+    case QRhiVertexInputAttribute::SInt3:
+        return DXGI_FORMAT_R32G32B32_SINT;
+    case QRhiVertexInputAttribute::SInt2:
+        return DXGI_FORMAT_R32G32_SINT;
+    case QRhiVertexInputAttribute::SInt:
+        return DXGI_FORMAT_R32_SINT;
+    case QRhiVertexInputAttribute::UNormA2B10G10R10:
+        return DXGI_FORMAT_R10G10B10A2_UNORM;
+    case QRhiVertexInputAttribute::SNormA2B10G10R10:
+        return DXGI_FORMAT_UNKNOWN; // no signed variant in DXGI
     default:
         Q_UNREACHABLE();
         return DXGI_FORMAT_R32G32B32A32_FLOAT;
@@ -2961,6 +3444,21 @@ bool QD3D11GraphicsPipeline::build()
     return true;
 }
 
+QD3D11ComputePipeline::QD3D11ComputePipeline(QRhiImplementation *rhi)
+    : QRhiComputePipeline(rhi)
+{
+}
+
+void QD3D11ComputePipeline::release()
+{
+}
+
+bool QD3D11ComputePipeline::build()
+{
+    qWarning("Compute pipelines are not supported by the D3D11 backend");
+    return false;
+}
+
 QD3D11CommandBuffer::QD3D11CommandBuffer(QRhiImplementation *rhi)
     : QRhiCommandBuffer(rhi)
 {
@@ -3032,6 +3530,9 @@ void QD3D11SwapChain::release()
                 timestampQuery[idx] = nullptr;
             }
         }
+        for (ID3D11Query *q : qAsConst(markerTiming[i].queries))
+            q->Release();
+        markerTiming[i] = MarkerTiming();
     }
 
     swapChain->Release();
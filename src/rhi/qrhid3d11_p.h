@@ -242,6 +242,13 @@ struct QD3D11GraphicsPipeline : public QRhiGraphicsPipeline
     friend class QRhiD3D11;
 };
 
+struct QD3D11ComputePipeline : public QRhiComputePipeline
+{
+    QD3D11ComputePipeline(QRhiImplementation *rhi);
+    void release() override;
+    bool build() override;
+};
+
 struct QD3D11SwapChain;
 
 struct QD3D11CommandBuffer : public QRhiCommandBuffer
@@ -253,6 +260,7 @@ struct QD3D11CommandBuffer : public QRhiCommandBuffer
         enum Cmd {
             SetRenderTarget,
             Clear,
+            DiscardViews,
             Viewport,
             Scissor,
             BindVertexBuffers,
@@ -263,13 +271,16 @@ struct QD3D11CommandBuffer : public QRhiCommandBuffer
             BlendConstants,
             Draw,
             DrawIndexed,
+            DrawIndirect,
+            DrawIndexedIndirect,
             UpdateSubRes,
             CopySubRes,
             ResolveSubRes,
             GenMip,
             DebugMarkBegin,
             DebugMarkEnd,
-            DebugMarkMsg
+            DebugMarkMsg,
+            Timestamp
         };
         enum ClearFlag { Color = 1, Depth = 2, Stencil = 4 };
         Cmd cmd;
@@ -285,10 +296,16 @@ struct QD3D11CommandBuffer : public QRhiCommandBuffer
             struct {
                 QRhiRenderTarget *rt;
                 int mask;
+                quint32 colorAttMask; // which color attachments Color applies to
                 float c[4];
                 float d;
                 quint32 s;
             } clear;
+            struct {
+                QRhiRenderTarget *rt;
+                quint32 colorAttMask;
+                bool depthStencil;
+            } discardViews;
             struct {
                 float x, y, w, h;
                 float d0, d1;
@@ -340,6 +357,13 @@ struct QD3D11CommandBuffer : public QRhiCommandBuffer
                 qint32 vertexOffset;
                 quint32 firstInstance;
             } drawIndexed;
+            struct {
+                QD3D11GraphicsPipeline *ps;
+                ID3D11Buffer *buffer;
+                quint32 offset;
+                quint32 drawCount;
+                quint32 stride;
+            } drawIndirect; // for both DrawIndirect and DrawIndexedIndirect
             struct {
                 ID3D11Resource *dst;
                 UINT dstSubRes;
@@ -371,6 +395,9 @@ struct QD3D11CommandBuffer : public QRhiCommandBuffer
             struct {
                 char s[64];
             } debugMark;
+            struct {
+                ID3D11Query *query;
+            } timestamp;
         } args;
     };
 
@@ -455,6 +482,22 @@ struct QD3D11SwapChain : public QRhiSwapChain
     bool timestampActive[BUFFER_COUNT];
     ID3D11Query *timestampDisjointQuery[BUFFER_COUNT];
     ID3D11Query *timestampQuery[BUFFER_COUNT * 2];
+    // debug marker scope timing, see QRhiProfiler::setMarkerTimingEnabled()
+    static const int MAX_MARKER_TIMESTAMPS = 128;
+    struct MarkerTiming {
+        struct Scope {
+            int scope;
+            int beginQuery;
+            int endQuery;
+        };
+        bool active = false;
+        QVector<ID3D11Query *> queries;
+        int queryCount = 0;
+        int scopeCount = 0;
+        QVector<Scope> stack;
+        QVector<Scope> scopes;
+        quint64 serial = 0;
+    } markerTiming[BUFFER_COUNT];
     UINT swapInterval = 1;
 };
 
@@ -467,6 +510,7 @@ public:
     void destroy() override;
 
     QRhiGraphicsPipeline *createGraphicsPipeline() override;
+    QRhiComputePipeline *createComputePipeline() override;
     QRhiShaderResourceBindings *createShaderResourceBindings() override;
     QRhiBuffer *createBuffer(QRhiBuffer::Type type,
                              QRhiBuffer::UsageFlags usage,
@@ -501,9 +545,13 @@ public:
                    const QRhiDepthStencilClearValue &depthStencilClearValue,
                    QRhiResourceUpdateBatch *resourceUpdates) override;
     void endPass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) override;
+    void beginComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) override;
+    void endComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) override;
 
     void setGraphicsPipeline(QRhiCommandBuffer *cb,
                              QRhiGraphicsPipeline *ps) override;
+    void setComputePipeline(QRhiCommandBuffer *cb,
+                            QRhiComputePipeline *ps) override;
 
     void setShaderResources(QRhiCommandBuffer *cb,
                             QRhiShaderResourceBindings *srb,
@@ -518,6 +566,8 @@ public:
     void setScissor(QRhiCommandBuffer *cb, const QRhiScissor &scissor) override;
     void setBlendConstants(QRhiCommandBuffer *cb, const QVector4D &c) override;
     void setStencilRef(QRhiCommandBuffer *cb, quint32 refValue) override;
+    void setPushConstants(QRhiCommandBuffer *cb, QRhiShaderResourceBinding::StageFlags stages,
+                          quint32 offset, quint32 size, const void *data) override;
 
     void draw(QRhiCommandBuffer *cb, quint32 vertexCount,
               quint32 instanceCount, quint32 firstVertex, quint32 firstInstance) override;
@@ -526,9 +576,18 @@ public:
                      quint32 instanceCount, quint32 firstIndex,
                      qint32 vertexOffset, quint32 firstInstance) override;
 
+    void drawIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                      quint32 indirectBufferOffset, quint32 drawCount, quint32 stride) override;
+    void drawIndexedIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                             quint32 indirectBufferOffset, quint32 drawCount, quint32 stride) override;
+
+    void dispatch(QRhiCommandBuffer *cb, int x, int y, int z) override;
+
     void debugMarkBegin(QRhiCommandBuffer *cb, const QByteArray &name) override;
     void debugMarkEnd(QRhiCommandBuffer *cb) override;
     void debugMarkMsg(QRhiCommandBuffer *cb, const QByteArray &msg) override;
+    void writeMarkerTimestamp(QD3D11CommandBuffer *cbD, bool begin);
+    void resolveMarkerTimestamps(QD3D11SwapChain *swapChainD, int frameSlot, const D3D11_QUERY_DATA_TIMESTAMP_DISJOINT &dj);
 
     QVector<int> supportedSampleCounts() const override;
     int ubufAlignment() const override;
@@ -536,6 +595,7 @@ public:
     bool isYUpInNDC() const override;
     QMatrix4x4 clipSpaceCorrMatrix() const override;
     bool isTextureFormatSupported(QRhiTexture::Format format, QRhiTexture::Flags flags) const override;
+    bool isVertexFormatSupported(QRhiVertexInputAttribute::Format format) const override;
     bool isFeatureSupported(QRhi::Feature feature) const override;
     int resourceSizeLimit(QRhi::ResourceSizeLimit limit) const override;
     const QRhiNativeHandles *nativeHandles() override;
@@ -563,6 +623,7 @@ public:
 
     bool inFrame = false;
     bool inPass = false;
+    bool inComputePass = false;
 
     struct {
         int vsLastActiveSrvBinding = 0;
@@ -585,9 +646,17 @@ public:
         QRhiTexture::Format format;
     };
     QVector<ActiveReadback> activeReadbacks;
+
+    struct ActiveBufferReadback {
+        QRhiBufferReadbackResult *result;
+        ID3D11Buffer *stagingBuf = nullptr; // null when already copied from a Dynamic buffer
+        int size;
+    };
+    QVector<ActiveBufferReadback> activeBufferReadbacks;
 };
 
 Q_DECLARE_TYPEINFO(QRhiD3D11::ActiveReadback, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QRhiD3D11::ActiveBufferReadback, Q_MOVABLE_TYPE);
 
 QT_END_NAMESPACE
 
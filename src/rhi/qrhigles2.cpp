@@ -126,6 +126,41 @@ QT_BEGIN_NAMESPACE
 
     The QRhi does not take ownership of the QOpenGLContext passed in via
     QRhiGles2NativeHandles.
+
+    \section2 Threaded command execution
+
+    OpenGL commands are not issued directly while recording a frame. Rather,
+    they are queued and executed in QRhi::endFrame(). Setting \l
+    threadedExecution to \c true moves the execution of swapchain frames,
+    including the buffer swap, to a dedicated render thread, owned by the QRhi.
+    QRhi::endFrame() then returns as soon as the recorded commands are handed
+    over, and the application can start recording the next frame while the
+    previous one is still being executed.
+
+    In this mode the OpenGL context is moved to the render thread for the
+    duration of executing a frame. Operations that need the context on the
+    QRhi's thread, such as building resources, wait for the render thread to
+    become idle. Releasing a resource, or destroying it via
+    QRhiResource::releaseAndDestroyLater(), waits as well, since the
+    previous frame may still reference it. Offscreen frames and QRhi::finish() are always executed
+    synchronously.
+
+    \note QRhiReadbackResult::completed and QRhiBufferReadbackResult::completed
+    callbacks for readbacks in swapchain
+    frames are invoked on the QRhi's thread, in a subsequent
+    QRhi::beginFrame() or QRhi::finish().
+
+    \note The render thread reads the QRhi resources referenced by the frame
+    while executing it. Calling setters on a resource used by the previous
+    frame is therefore only safe once that frame has finished executing,
+    meaning after the next QRhi::endFrame() or QRhi::finish() returns. build()
+    waits for the render thread implicitly.
+
+    \note Threaded execution is not available when importing an existing
+    OpenGL context, or when the platform does not support using OpenGL
+    contexts on multiple threads, as reported by
+    QOpenGLContext::supportsThreadedOpenGL(). A warning is printed and the
+    commands are executed on the QRhi's thread instead.
  */
 
 /*!
@@ -169,6 +204,10 @@ QT_BEGIN_NAMESPACE
 #define GL_R16                            0x822A
 #endif
 
+#ifndef GL_RGBA8
+#define GL_RGBA8                          0x8058
+#endif
+
 #ifndef GL_RED
 #define GL_RED                            0x1903
 #endif
@@ -185,6 +224,150 @@ QT_BEGIN_NAMESPACE
 #define GL_FRAMEBUFFER_SRGB_CAPABLE 0x8DBA
 #endif
 
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER                 0x91B9
+#endif
+
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER          0x90D2
+#endif
+
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+
+#ifndef GL_ELEMENT_ARRAY_BARRIER_BIT
+#define GL_ELEMENT_ARRAY_BARRIER_BIT      0x00000002
+#endif
+
+#ifndef GL_UNIFORM_BARRIER_BIT
+#define GL_UNIFORM_BARRIER_BIT            0x00000004
+#endif
+
+#ifndef GL_TEXTURE_FETCH_BARRIER_BIT
+#define GL_TEXTURE_FETCH_BARRIER_BIT      0x00000008
+#endif
+
+#ifndef GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#endif
+
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT            0x00000040
+#endif
+
+#ifndef GL_TEXTURE_UPDATE_BARRIER_BIT
+#define GL_TEXTURE_UPDATE_BARRIER_BIT     0x00000100
+#endif
+
+#ifndef GL_BUFFER_UPDATE_BARRIER_BIT
+#define GL_BUFFER_UPDATE_BARRIER_BIT      0x00000200
+#endif
+
+#ifndef GL_FRAMEBUFFER_BARRIER_BIT
+#define GL_FRAMEBUFFER_BARRIER_BIT        0x00000400
+#endif
+
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT     0x00002000
+#endif
+
+#ifndef GL_READ_ONLY
+#define GL_READ_ONLY                      0x88B8
+#endif
+
+#ifndef GL_WRITE_ONLY
+#define GL_WRITE_ONLY                     0x88B9
+#endif
+
+#ifndef GL_READ_WRITE
+#define GL_READ_WRITE                     0x88BA
+#endif
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER           0x8F3F
+#endif
+
+#ifndef GL_TEXTURE_3D
+#define GL_TEXTURE_3D                     0x806F
+#endif
+
+#ifndef GL_TEXTURE_2D_ARRAY
+#define GL_TEXTURE_2D_ARRAY               0x8C1A
+#endif
+
+#ifndef GL_MAX_ARRAY_TEXTURE_LAYERS
+#define GL_MAX_ARRAY_TEXTURE_LAYERS       0x88FF
+#endif
+
+#ifndef GL_HALF_FLOAT
+#define GL_HALF_FLOAT                     0x140B
+#endif
+
+#ifndef GL_UNSIGNED_INT_2_10_10_10_REV
+#define GL_UNSIGNED_INT_2_10_10_10_REV    0x8368
+#endif
+
+#ifndef GL_INT_2_10_10_10_REV
+#define GL_INT_2_10_10_10_REV             0x8D9F
+#endif
+
+#ifndef GL_RG
+#define GL_RG                             0x8227
+#endif
+
+#ifndef GL_RG8
+#define GL_RG8                            0x822B
+#endif
+
+#ifndef GL_RG16
+#define GL_RG16                           0x822C
+#endif
+
+#ifndef GL_R16F
+#define GL_R16F                           0x822D
+#endif
+
+#ifndef GL_R32F
+#define GL_R32F                           0x822E
+#endif
+
+#ifndef GL_RGBA16F
+#define GL_RGBA16F                        0x881A
+#endif
+
+#ifndef GL_RGBA32F
+#define GL_RGBA32F                        0x8814
+#endif
+
+#ifndef GL_R11F_G11F_B10F
+#define GL_R11F_G11F_B10F                 0x8C3A
+#endif
+
+#ifndef GL_UNSIGNED_INT_10F_11F_11F_REV
+#define GL_UNSIGNED_INT_10F_11F_11F_REV   0x8C3B
+#endif
+
+#ifndef GL_MAP_READ_BIT
+#define GL_MAP_READ_BIT                   0x0001
+#endif
+
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP                      0x8E28
+#endif
+
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT                   0x8866
+#endif
+
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE         0x8867
+#endif
+
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT               0x8FBB
+#endif
+
 static QSurfaceFormat qrhigles2_effectiveFormat()
 {
     QSurfaceFormat fmt = QSurfaceFormat::defaultFormat();
@@ -234,10 +417,29 @@ QRhiGles2::QRhiGles2(QRhiGles2InitParams *params, QRhiGles2NativeHandles *import
             importedContext = false;
         }
     }
+
+    threadedExecution = params->threadedExecution;
+    if (threadedExecution && importedContext) {
+        qWarning("Threaded execution is not supported with an imported OpenGL context");
+        threadedExecution = false;
+    }
+    if (threadedExecution && !QOpenGLContext::supportsThreadedOpenGL()) {
+        qWarning("Threaded execution is not supported by the platform's OpenGL implementation");
+        threadedExecution = false;
+    }
+}
+
+void QRhiGles2::waitRenderThread() const
+{
+    if (renderThread)
+        renderThread->waitIdle();
 }
 
 bool QRhiGles2::ensureContext(QSurface *surface) const
 {
+    // the context may be on the render thread, wait until it gets moved back
+    waitRenderThread();
+
     bool nativeWindowGone = false;
     if (surface && surface->surfaceClass() == QSurface::Window && !surface->surfaceHandle()) {
         surface = fallbackSurface;
@@ -337,6 +539,147 @@ bool QRhiGles2::create(QRhi::Flags flags)
     caps.r8Format = f->hasOpenGLFeature(QOpenGLFunctions::TextureRGFormats);
     caps.r16Format = f->hasOpenGLExtension(QOpenGLExtensions::Sized16Formats);
 
+    if (actualFormat.renderableType() == QSurfaceFormat::OpenGLES)
+        caps.samplerObjects = actualFormat.version() >= qMakePair(3, 0);
+    else
+        caps.samplerObjects = actualFormat.version() >= qMakePair(3, 3);
+
+    // glDrawArrays/ElementsInstanced and glVertexAttribDivisor, core in
+    // OpenGL 3.3 and ES 3.0, otherwise available via extensions
+    const char *instancingSuffix = nullptr;
+    if (actualFormat.renderableType() == QSurfaceFormat::OpenGLES) {
+        if (actualFormat.version() >= qMakePair(3, 0))
+            instancingSuffix = "";
+        else if (ctx->hasExtension(QByteArrayLiteral("GL_EXT_instanced_arrays")))
+            instancingSuffix = "EXT";
+        else if (ctx->hasExtension(QByteArrayLiteral("GL_ANGLE_instanced_arrays")))
+            instancingSuffix = "ANGLE";
+    } else {
+        if (actualFormat.version() >= qMakePair(3, 3))
+            instancingSuffix = "";
+        else if (ctx->hasExtension(QByteArrayLiteral("GL_ARB_instanced_arrays"))
+                 && (actualFormat.version() >= qMakePair(3, 1)
+                     || ctx->hasExtension(QByteArrayLiteral("GL_ARB_draw_instanced"))))
+            instancingSuffix = "ARB";
+    }
+    if (instancingSuffix) {
+        const QByteArray suffix(instancingSuffix);
+        glDrawArraysInstanced = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLenum, GLint, GLsizei, GLsizei)>(
+                    ctx->getProcAddress(QByteArrayLiteral("glDrawArraysInstanced") + suffix));
+        glDrawElementsInstanced = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLenum, GLsizei, GLenum, const void *, GLsizei)>(
+                    ctx->getProcAddress(QByteArrayLiteral("glDrawElementsInstanced") + suffix));
+        glVertexAttribDivisor = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLuint, GLuint)>(
+                    ctx->getProcAddress(QByteArrayLiteral("glVertexAttribDivisor") + suffix));
+    }
+    caps.instancing = glDrawArraysInstanced && glDrawElementsInstanced && glVertexAttribDivisor;
+
+    // firstInstance for non-indirect draws
+    if (caps.instancing) {
+        const bool ext = actualFormat.renderableType() == QSurfaceFormat::OpenGLES;
+        if (ext ? ctx->hasExtension(QByteArrayLiteral("GL_EXT_base_instance"))
+                : (actualFormat.version() >= qMakePair(4, 2)
+                   || ctx->hasExtension(QByteArrayLiteral("GL_ARB_base_instance"))))
+        {
+            glDrawArraysInstancedBaseInstance = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLenum, GLint, GLsizei, GLsizei, GLuint)>(
+                        ctx->getProcAddress(ext ? "glDrawArraysInstancedBaseInstanceEXT" : "glDrawArraysInstancedBaseInstance"));
+            glDrawElementsInstancedBaseInstance = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLenum, GLsizei, GLenum, const void *, GLsizei, GLuint)>(
+                        ctx->getProcAddress(ext ? "glDrawElementsInstancedBaseInstanceEXT" : "glDrawElementsInstancedBaseInstance"));
+        }
+    }
+    caps.baseInstance = glDrawArraysInstancedBaseInstance && glDrawElementsInstancedBaseInstance;
+
+    if (actualFormat.renderableType() == QSurfaceFormat::OpenGLES)
+        caps.texStorage = actualFormat.version() >= qMakePair(3, 0);
+    else
+        caps.texStorage = actualFormat.version() >= qMakePair(4, 2) || ctx->hasExtension(QByteArrayLiteral("GL_ARB_texture_storage"));
+
+    // glDispatchCompute, glMemoryBarrier, glBindImageTexture, SSBOs
+    if (actualFormat.renderableType() == QSurfaceFormat::OpenGLES)
+        caps.compute = actualFormat.version() >= qMakePair(3, 1);
+    else
+        caps.compute = actualFormat.version() >= qMakePair(4, 3);
+    caps.gles = actualFormat.renderableType() == QSurfaceFormat::OpenGLES;
+
+    if (actualFormat.renderableType() == QSurfaceFormat::OpenGLES) {
+        caps.drawIndirect = actualFormat.version() >= qMakePair(3, 1);
+        caps.multiDrawIndirect = caps.drawIndirect && ctx->hasExtension(QByteArrayLiteral("GL_EXT_multi_draw_indirect"));
+    } else {
+        caps.drawIndirect = actualFormat.version() >= qMakePair(4, 0);
+        caps.multiDrawIndirect = actualFormat.version() >= qMakePair(4, 3)
+                || ctx->hasExtension(QByteArrayLiteral("GL_ARB_multi_draw_indirect"));
+    }
+    if (caps.multiDrawIndirect) {
+        const bool ext = actualFormat.renderableType() == QSurfaceFormat::OpenGLES;
+        glMultiDrawArraysIndirect = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLenum, const void *, GLsizei, GLsizei)>(
+                    ctx->getProcAddress(ext ? "glMultiDrawArraysIndirectEXT" : "glMultiDrawArraysIndirect"));
+        glMultiDrawElementsIndirect = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLenum, GLenum, const void *, GLsizei, GLsizei)>(
+                    ctx->getProcAddress(ext ? "glMultiDrawElementsIndirectEXT" : "glMultiDrawElementsIndirect"));
+        caps.multiDrawIndirect = glMultiDrawArraysIndirect && glMultiDrawElementsIndirect;
+    }
+    if (caps.drawIndirect && actualFormat.renderableType() == QSurfaceFormat::OpenGLES)
+        f->glGenVertexArrays(1, &vao);
+
+    const char *invalidateFuncName = nullptr;
+    if (actualFormat.renderableType() == QSurfaceFormat::OpenGLES) {
+        if (actualFormat.version() >= qMakePair(3, 0))
+            invalidateFuncName = "glInvalidateFramebuffer";
+        else if (ctx->hasExtension(QByteArrayLiteral("GL_EXT_discard_framebuffer")))
+            invalidateFuncName = "glDiscardFramebufferEXT";
+    } else if (actualFormat.version() >= qMakePair(4, 3)
+               || ctx->hasExtension(QByteArrayLiteral("GL_ARB_invalidate_subdata")))
+    {
+        invalidateFuncName = "glInvalidateFramebuffer";
+    }
+    if (invalidateFuncName) {
+        glInvalidateFramebuffer = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLenum, GLsizei, const GLenum *)>(
+                    ctx->getProcAddress(invalidateFuncName));
+    }
+    caps.invalidateFramebuffer = glInvalidateFramebuffer != nullptr;
+
+    // glTexImage3D, glTexSubImage3D, glFramebufferTextureLayer, etc.
+    caps.texture3D = actualFormat.version() >= qMakePair(3, 0);
+    caps.textureArrays = caps.texture3D;
+    if (caps.textureArrays)
+        f->glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &caps.maxTextureArraySize);
+
+    // sampling; rendering into these may need EXT_color_buffer_(half_)float on ES
+    caps.floatFormats = actualFormat.version() >= qMakePair(3, 0);
+
+    // glMapBufferRange with GL_MAP_READ_BIT, for buffer readbacks
+    caps.mapBufferRead = actualFormat.version() >= qMakePair(3, 0);
+
+    // GL_TIMESTAMP queries via glQueryCounter. On ES this comes with the
+    // disjoint flag that has to be checked before trusting the results.
+    caps.timestampDisjoint = actualFormat.renderableType() == QSurfaceFormat::OpenGLES;
+    if (caps.timestampDisjoint) {
+        caps.timestamps = ctx->hasExtension(QByteArrayLiteral("GL_EXT_disjoint_timer_query"));
+    } else {
+        caps.timestamps = actualFormat.version() >= qMakePair(3, 3)
+                || ctx->hasExtension(QByteArrayLiteral("GL_ARB_timer_query"));
+    }
+    if (caps.timestamps) {
+        const bool ext = caps.timestampDisjoint;
+        glGenQueries = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLsizei, GLuint *)>(
+                    ctx->getProcAddress(ext ? "glGenQueriesEXT" : "glGenQueries"));
+        glDeleteQueries = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLsizei, const GLuint *)>(
+                    ctx->getProcAddress(ext ? "glDeleteQueriesEXT" : "glDeleteQueries"));
+        glQueryCounter = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLuint, GLenum)>(
+                    ctx->getProcAddress(ext ? "glQueryCounterEXT" : "glQueryCounter"));
+        glGetQueryObjectuiv = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLuint, GLenum, GLuint *)>(
+                    ctx->getProcAddress(ext ? "glGetQueryObjectuivEXT" : "glGetQueryObjectuiv"));
+        glGetQueryObjectui64v = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLuint, GLenum, quint64 *)>(
+                    ctx->getProcAddress(ext ? "glGetQueryObjectui64vEXT" : "glGetQueryObjectui64v"));
+        caps.timestamps = glGenQueries && glDeleteQueries && glQueryCounter
+                && glGetQueryObjectuiv && glGetQueryObjectui64v;
+    }
+
+    caps.halfAttributes = actualFormat.version() >= qMakePair(3, 0);
+    caps.intAttributes = caps.halfAttributes;
+    if (actualFormat.renderableType() == QSurfaceFormat::OpenGLES)
+        caps.packedAttributes = actualFormat.version() >= qMakePair(3, 0);
+    else
+        caps.packedAttributes = actualFormat.version() >= qMakePair(3, 3);
+
     caps.srgbCapableDefaultFramebuffer = false;
     if (ctx->hasExtension(QByteArrayLiteral("GL_ARB_framebuffer_sRGB"))) {
         GLint srgbCapable = 0;
@@ -353,6 +696,11 @@ bool QRhiGles2::create(QRhi::Flags flags)
         rsh->rhiCount += 1;
     }
 
+    if (threadedExecution) {
+        renderThread = new QGles2RenderThread(this);
+        renderThread->start();
+    }
+
     return true;
 }
 
@@ -361,9 +709,21 @@ void QRhiGles2::destroy()
     if (!f)
         return;
 
+    if (renderThread) {
+        renderThread->waitIdle();
+        renderThread->stop();
+        delete renderThread;
+        renderThread = nullptr;
+    }
+
     ensureContext();
     executeDeferredReleases();
 
+    if (vao) {
+        f->glDeleteVertexArrays(1, &vao);
+        vao = 0;
+    }
+
     QMutexLocker lock(rsh ? &rsh->mtx : nullptr);
 
     if (rsh) {
@@ -390,8 +750,13 @@ void QRhiGles2::destroy()
 
 void QRhiGles2::executeDeferredReleases()
 {
-    for (int i = releaseQueue.count() - 1; i >= 0; --i) {
-        const QRhiGles2::DeferredReleaseEntry &e(releaseQueue[i]);
+    executeDeferredReleases(&releaseQueue);
+}
+
+void QRhiGles2::executeDeferredReleases(QVector<QRhiGles2::DeferredReleaseEntry> *queue)
+{
+    for (int i = queue->count() - 1; i >= 0; --i) {
+        const QRhiGles2::DeferredReleaseEntry &e((*queue)[i]);
         switch (e.type) {
         case QRhiGles2::DeferredReleaseEntry::Buffer:
             f->glDeleteBuffers(1, &e.buffer.buffer);
@@ -408,11 +773,17 @@ void QRhiGles2::executeDeferredReleases()
         case QRhiGles2::DeferredReleaseEntry::TextureRenderTarget:
             f->glDeleteFramebuffers(1, &e.textureRenderTarget.framebuffer);
             break;
+        case QRhiGles2::DeferredReleaseEntry::Sampler:
+            f->glDeleteSamplers(1, &e.sampler.sampler);
+            break;
+        case QRhiGles2::DeferredReleaseEntry::Query:
+            glDeleteQueries(1, &e.query.query);
+            break;
         default:
             Q_UNREACHABLE();
             break;
         }
-        releaseQueue.removeAt(i);
+        queue->removeAt(i);
     }
 }
 
@@ -431,7 +802,9 @@ void QRhiGles2::executeDeferredReleasesOnRshNow(QVector<QRhiGles2::DeferredRelea
         case QRhiGles2::DeferredReleaseEntry::RenderBuffer:
             f->glDeleteRenderbuffers(1, &e.renderbuffer.renderbuffer);
             break;
-        // samplers have no backing GL object
+        case QRhiGles2::DeferredReleaseEntry::Sampler:
+            f->glDeleteSamplers(1, &e.sampler.sampler);
+            break;
         default:
             Q_UNREACHABLE();
             break;
@@ -475,6 +848,51 @@ QMatrix4x4 QRhiGles2::clipSpaceCorrMatrix() const
     return QMatrix4x4(); // identity
 }
 
+static inline bool isReadBackInNativeFormat(QRhiTexture::Format format)
+{
+    // The 8-bit formats are read back as RGBA8 like before, the rest gets
+    // the texture's own layout, matching the other backends.
+    switch (format) {
+    case QRhiTexture::RG16:
+    case QRhiTexture::RGBA16F:
+    case QRhiTexture::RGBA32F:
+    case QRhiTexture::R16F:
+    case QRhiTexture::R32F:
+    case QRhiTexture::B10G11R11_UFLOAT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static inline bool isLayeredTarget(GLenum target)
+{
+    // targets where a layer is addressed by a z offset instead of a face target
+    return target == GL_TEXTURE_3D || target == GL_TEXTURE_2D_ARRAY;
+}
+
+static inline bool isImageLoadStoreFormat(QRhiTexture::Format format, bool gles)
+{
+    // OpenGL ES 3.1 supports a subset of the OpenGL 4.3 image formats
+    switch (format) {
+    case QRhiTexture::RGBA8:
+    case QRhiTexture::RGBA16F:
+    case QRhiTexture::RGBA32F:
+    case QRhiTexture::R32F:
+        return true;
+    case QRhiTexture::R8:
+    case QRhiTexture::R16:
+    case QRhiTexture::RG8:
+    case QRhiTexture::RG16:
+    case QRhiTexture::R16F:
+    case QRhiTexture::B10G11R11_UFLOAT:
+        return !gles;
+    default:
+        // compressed formats, BGRA8 and the unsized alpha format
+        return false;
+    }
+}
+
 static inline GLenum toGlCompressedTextureFormat(QRhiTexture::Format format, QRhiTexture::Flags flags)
 {
     const bool srgb = flags.testFlag(QRhiTexture::sRGB);
@@ -547,6 +965,19 @@ bool QRhiGles2::isTextureFormatSupported(QRhiTexture::Format format, QRhiTexture
     case QRhiTexture::R16:
         return caps.r16Format;
 
+    case QRhiTexture::RG8:
+        return caps.r8Format;
+
+    case QRhiTexture::RG16:
+        return caps.r16Format;
+
+    case QRhiTexture::RGBA16F:
+    case QRhiTexture::RGBA32F:
+    case QRhiTexture::R16F:
+    case QRhiTexture::R32F:
+    case QRhiTexture::B10G11R11_UFLOAT:
+        return caps.floatFormats;
+
     default:
         break;
     }
@@ -554,6 +985,29 @@ bool QRhiGles2::isTextureFormatSupported(QRhiTexture::Format format, QRhiTexture
     return true;
 }
 
+bool QRhiGles2::isVertexFormatSupported(QRhiVertexInputAttribute::Format format) const
+{
+    switch (format) {
+    case QRhiVertexInputAttribute::Half4:
+    case QRhiVertexInputAttribute::Half2:
+        return caps.halfAttributes;
+    case QRhiVertexInputAttribute::UInt4:
+    case QRhiVertexInputAttribute::UInt3:
+    case QRhiVertexInputAttribute::UInt2:
+    case QRhiVertexInputAttribute::UInt:
+    case QRhiVertexInputAttribute::SInt4:
+    case QRhiVertexInputAttribute::SInt3:
+    case QRhiVertexInputAttribute::SInt2:
+    case QRhiVertexInputAttribute::SInt:
+        return caps.intAttributes;
+    case QRhiVertexInputAttribute::UNormA2B10G10R10:
+    case QRhiVertexInputAttribute::SNormA2B10G10R10:
+        return caps.packedAttributes;
+    default:
+        return true;
+    }
+}
+
 bool QRhiGles2::isFeatureSupported(QRhi::Feature feature) const
 {
     switch (feature) {
@@ -564,11 +1018,11 @@ bool QRhiGles2::isFeatureSupported(QRhi::Feature feature) const
     case QRhi::DebugMarkers:
         return false;
     case QRhi::Timestamps:
-        return false;
+        return caps.timestamps;
     case QRhi::Instancing:
-        return false;
+        return caps.instancing;
     case QRhi::CustomInstanceStepRate:
-        return false;
+        return caps.instancing;
     case QRhi::PrimitiveRestart:
         return caps.fixedIndexPrimitiveRestart;
     case QRhi::GeometryShaders:
@@ -583,6 +1037,18 @@ bool QRhiGles2::isFeatureSupported(QRhi::Feature feature) const
         return caps.npotTextureRepeat;
     case QRhi::RedOrAlpha8IsRed:
         return false;
+    case QRhi::Compute:
+        return caps.compute;
+    case QRhi::DrawIndirect:
+        return caps.drawIndirect;
+    case QRhi::DrawIndirectMulti:
+        return caps.multiDrawIndirect;
+    case QRhi::PushConstants:
+        return true;
+    case QRhi::ThreeDimensionalTextures:
+        return caps.texture3D;
+    case QRhi::TextureArrays:
+        return caps.textureArrays;
     default:
         Q_UNREACHABLE();
         return false;
@@ -596,6 +1062,10 @@ int QRhiGles2::resourceSizeLimit(QRhi::ResourceSizeLimit limit) const
         return 1;
     case QRhi::TextureSizeMax:
         return caps.maxTextureSize;
+    case QRhi::PushConstantsSizeMax:
+        return 128; // plain uniforms, use the minimum Vulkan guarantees
+    case QRhi::TextureArraySizeMax:
+        return caps.maxTextureArraySize;
     default:
         Q_UNREACHABLE();
         return 0;
@@ -637,6 +1107,11 @@ QRhiGraphicsPipeline *QRhiGles2::createGraphicsPipeline()
     return new QGles2GraphicsPipeline(this);
 }
 
+QRhiComputePipeline *QRhiGles2::createComputePipeline()
+{
+    return new QGles2ComputePipeline(this);
+}
+
 QRhiShaderResourceBindings *QRhiGles2::createShaderResourceBindings()
 {
     return new QGles2ShaderResourceBindings(this);
@@ -654,23 +1129,42 @@ void QRhiGles2::setGraphicsPipeline(QRhiCommandBuffer *cb, QRhiGraphicsPipeline
         cbD->currentPipeline = ps;
         cbD->currentPipelineGeneration = psD->generation;
 
-        QGles2CommandBuffer::Command cmd;
-        cmd.cmd = QGles2CommandBuffer::Command::BindGraphicsPipeline;
+        QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::BindGraphicsPipeline));
         cmd.args.bindGraphicsPipeline.ps = ps;
-        cbD->commands.append(cmd);
+    }
+}
+
+void QRhiGles2::setComputePipeline(QRhiCommandBuffer *cb, QRhiComputePipeline *ps)
+{
+    Q_ASSERT(inComputePass);
+
+    QGles2CommandBuffer *cbD = QRHI_RES(QGles2CommandBuffer, cb);
+    QGles2ComputePipeline *psD = QRHI_RES(QGles2ComputePipeline, ps);
+    const bool pipelineChanged = cbD->currentComputePipeline != ps || cbD->currentComputePipelineGeneration != psD->generation;
+
+    if (pipelineChanged) {
+        cbD->currentComputePipeline = ps;
+        cbD->currentComputePipelineGeneration = psD->generation;
+
+        QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::BindComputePipeline));
+        cmd.args.bindComputePipeline.ps = ps;
     }
 }
 
 void QRhiGles2::setShaderResources(QRhiCommandBuffer *cb, QRhiShaderResourceBindings *srb,
                                    const QVector<QRhiCommandBuffer::DynamicOffset> &dynamicOffsets)
 {
-    Q_ASSERT(inPass);
+    Q_ASSERT(inPass || inComputePass);
 
     QGles2CommandBuffer *cbD = QRHI_RES(QGles2CommandBuffer, cb);
-    Q_ASSERT(cbD->currentPipeline);
+    Q_ASSERT(inComputePass ? cbD->currentComputePipeline != nullptr : cbD->currentPipeline != nullptr);
 
-    if (!srb)
-        srb = QRHI_RES(QGles2GraphicsPipeline, cbD->currentPipeline)->m_shaderResourceBindings;
+    if (!srb) {
+        if (inComputePass)
+            srb = QRHI_RES(QGles2ComputePipeline, cbD->currentComputePipeline)->m_shaderResourceBindings;
+        else
+            srb = QRHI_RES(QGles2GraphicsPipeline, cbD->currentPipeline)->m_shaderResourceBindings;
+    }
 
     QGles2ShaderResourceBindings *srbD = QRHI_RES(QGles2ShaderResourceBindings, srb);
     bool hasDynamicOffsetInSrb = false;
@@ -692,27 +1186,20 @@ void QRhiGles2::setShaderResources(QRhiCommandBuffer *cb, QRhiShaderResourceBind
         cbD->currentSrb = srb;
         cbD->currentSrbGeneration = srbD->generation;
 
-        QGles2CommandBuffer::Command cmd;
-        cmd.cmd = QGles2CommandBuffer::Command::BindShaderResources;
-        cmd.args.bindShaderResources.ps = cbD->currentPipeline;
+        const int dynCount = hasDynamicOffsetInSrb ? dynamicOffsets.count() : 0;
+        // the first pair is part of the args already, the rest is trailing data
+        const int extraSize = qMax(0, dynCount - 1) * 2 * int(sizeof(uint));
+        QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::BindShaderResources, extraSize));
+        cmd.args.bindShaderResources.maybeGraphicsPs = inComputePass ? nullptr : cbD->currentPipeline;
+        cmd.args.bindShaderResources.maybeComputePs = inComputePass ? cbD->currentComputePipeline : nullptr;
         cmd.args.bindShaderResources.srb = srb;
-        cmd.args.bindShaderResources.dynamicOffsetCount = 0;
-        if (hasDynamicOffsetInSrb) {
-            const int dynCount = dynamicOffsets.count();
-            if (dynCount < QGles2CommandBuffer::Command::MAX_UBUF_BINDINGS) {
-                cmd.args.bindShaderResources.dynamicOffsetCount = dynCount;
-                uint *p = cmd.args.bindShaderResources.dynamicOffsetPairs;
-                for (int i = 0; i < dynCount; ++i) {
-                    const QRhiCommandBuffer::DynamicOffset &dynOfs(dynamicOffsets[i]);
-                    *p++ = dynOfs.first;
-                    *p++ = dynOfs.second;
-                }
-            } else {
-                qWarning("Too many dynamic offsets (%d, max is %d)",
-                         dynCount, QGles2CommandBuffer::Command::MAX_UBUF_BINDINGS);
-            }
+        cmd.args.bindShaderResources.dynamicOffsetCount = dynCount;
+        uint *p = cmd.args.bindShaderResources.dynamicOffsetPairs;
+        for (int i = 0; i < dynCount; ++i) {
+            const QRhiCommandBuffer::DynamicOffset &dynOfs(dynamicOffsets[i]);
+            *p++ = dynOfs.first;
+            *p++ = dynOfs.second;
         }
-        cbD->commands.append(cmd);
     }
 }
 
@@ -727,32 +1214,30 @@ void QRhiGles2::setVertexInput(QRhiCommandBuffer *cb, int startBinding, const QV
         quint32 ofs = bindings[i].second;
         QGles2Buffer *bufD = QRHI_RES(QGles2Buffer, buf);
         Q_ASSERT(bufD->m_usage.testFlag(QRhiBuffer::VertexBuffer));
-        QGles2CommandBuffer::Command cmd;
-        cmd.cmd = QGles2CommandBuffer::Command::BindVertexBuffer;
+        QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::BindVertexBuffer));
         cmd.args.bindVertexBuffer.ps = cbD->currentPipeline;
         cmd.args.bindVertexBuffer.buffer = bufD->buffer;
         cmd.args.bindVertexBuffer.offset = ofs;
         cmd.args.bindVertexBuffer.binding = startBinding + i;
-        cbD->commands.append(cmd);
     }
 
     if (indexBuf) {
         QGles2Buffer *ibufD = QRHI_RES(QGles2Buffer, indexBuf);
         Q_ASSERT(ibufD->m_usage.testFlag(QRhiBuffer::IndexBuffer));
-        QGles2CommandBuffer::Command cmd;
-        cmd.cmd = QGles2CommandBuffer::Command::BindIndexBuffer;
+        QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::BindIndexBuffer));
         cmd.args.bindIndexBuffer.buffer = ibufD->buffer;
         cmd.args.bindIndexBuffer.offset = indexOffset;
+        cbD->currentIndexOffset = indexOffset;
         cmd.args.bindIndexBuffer.type = indexFormat == QRhiCommandBuffer::IndexUInt16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
-        cbD->commands.append(cmd);
     }
 }
 
 void QRhiGles2::setViewport(QRhiCommandBuffer *cb, const QRhiViewport &viewport)
 {
     Q_ASSERT(inPass);
-    QGles2CommandBuffer::Command cmd;
-    cmd.cmd = QGles2CommandBuffer::Command::Viewport;
+    QGles2CommandBuffer *cbD = QRHI_RES(QGles2CommandBuffer, cb);
+
+    QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::Viewport));
     const QVector4D r = viewport.viewport();
     cmd.args.viewport.x = r.x();
     cmd.args.viewport.y = r.y();
@@ -760,32 +1245,31 @@ void QRhiGles2::setViewport(QRhiCommandBuffer *cb, const QRhiViewport &viewport)
     cmd.args.viewport.h = r.w();
     cmd.args.viewport.d0 = viewport.minDepth();
     cmd.args.viewport.d1 = viewport.maxDepth();
-    QRHI_RES(QGles2CommandBuffer, cb)->commands.append(cmd);
 }
 
 void QRhiGles2::setScissor(QRhiCommandBuffer *cb, const QRhiScissor &scissor)
 {
     Q_ASSERT(inPass);
-    QGles2CommandBuffer::Command cmd;
-    cmd.cmd = QGles2CommandBuffer::Command::Scissor;
+    QGles2CommandBuffer *cbD = QRHI_RES(QGles2CommandBuffer, cb);
+
+    QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::Scissor));
     const QVector4D r = scissor.scissor();
     cmd.args.scissor.x = r.x();
     cmd.args.scissor.y = r.y();
     cmd.args.scissor.w = r.z();
     cmd.args.scissor.h = r.w();
-    QRHI_RES(QGles2CommandBuffer, cb)->commands.append(cmd);
 }
 
 void QRhiGles2::setBlendConstants(QRhiCommandBuffer *cb, const QVector4D &c)
 {
     Q_ASSERT(inPass);
-    QGles2CommandBuffer::Command cmd;
-    cmd.cmd = QGles2CommandBuffer::Command::BlendConstants;
+    QGles2CommandBuffer *cbD = QRHI_RES(QGles2CommandBuffer, cb);
+
+    QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::BlendConstants));
     cmd.args.blendConstants.r = c.x();
     cmd.args.blendConstants.g = c.y();
     cmd.args.blendConstants.b = c.z();
     cmd.args.blendConstants.a = c.w();
-    QRHI_RES(QGles2CommandBuffer, cb)->commands.append(cmd);
 }
 
 void QRhiGles2::setStencilRef(QRhiCommandBuffer *cb, quint32 refValue)
@@ -793,61 +1277,191 @@ void QRhiGles2::setStencilRef(QRhiCommandBuffer *cb, quint32 refValue)
     Q_ASSERT(inPass);
     QGles2CommandBuffer *cbD = QRHI_RES(QGles2CommandBuffer, cb);
 
-    QGles2CommandBuffer::Command cmd;
-    cmd.cmd = QGles2CommandBuffer::Command::StencilRef;
+    QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::StencilRef));
     cmd.args.stencilRef.ref = refValue;
     cmd.args.stencilRef.ps = cbD->currentPipeline;
-    cbD->commands.append(cmd);
+}
+
+void QRhiGles2::setPushConstants(QRhiCommandBuffer *cb, QRhiShaderResourceBinding::StageFlags stages,
+                                 quint32 offset, quint32 size, const void *data)
+{
+    Q_UNUSED(stages); // uniforms are per program
+    Q_ASSERT(inPass || inComputePass);
+    QGles2CommandBuffer *cbD = QRHI_RES(QGles2CommandBuffer, cb);
+
+    // The members are plain uniforms, there is no storage beyond the block
+    // declared in the shaders.
+    quint32 blockSize = 0;
+    if (inComputePass && cbD->currentComputePipeline)
+        blockSize = QRHI_RES(QGles2ComputePipeline, cbD->currentComputePipeline)->pushConstantsSize;
+    else if (!inComputePass && cbD->currentPipeline)
+        blockSize = QRHI_RES(QGles2GraphicsPipeline, cbD->currentPipeline)->pushConstantsSize;
+    if (quint64(offset) + size > blockSize) {
+        qWarning("Push constant range %u-%u is outside the %u byte push constant block of the pipeline; ignored",
+                 offset, offset + size, blockSize);
+        return;
+    }
+
+    const int extraSize = int(size) - int(sizeof(quint32));
+    QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::PushConstants,
+                                                        qMax(0, extraSize)));
+    cmd.args.pushConstants.maybeGraphicsPs = inComputePass ? nullptr : cbD->currentPipeline;
+    cmd.args.pushConstants.maybeComputePs = inComputePass ? cbD->currentComputePipeline : nullptr;
+    cmd.args.pushConstants.offset = offset;
+    cmd.args.pushConstants.size = size;
+    memcpy(cmd.args.pushConstants.data, data, size);
 }
 
 void QRhiGles2::draw(QRhiCommandBuffer *cb, quint32 vertexCount,
                      quint32 instanceCount, quint32 firstVertex, quint32 firstInstance)
 {
     Q_ASSERT(inPass);
-    Q_UNUSED(instanceCount); // no instancing
-    Q_UNUSED(firstInstance);
+    if (firstInstance && !caps.baseInstance)
+        qWarning("firstInstance %u is not supported by the OpenGL implementation, using 0", firstInstance);
+
     QGles2CommandBuffer *cbD = QRHI_RES(QGles2CommandBuffer, cb);
 
-    QGles2CommandBuffer::Command cmd;
-    cmd.cmd = QGles2CommandBuffer::Command::Draw;
+    QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::Draw));
     cmd.args.draw.ps = cbD->currentPipeline;
     cmd.args.draw.vertexCount = vertexCount;
     cmd.args.draw.firstVertex = firstVertex;
-    cbD->commands.append(cmd);
+    cmd.args.draw.instanceCount = instanceCount;
+    cmd.args.draw.firstInstance = caps.baseInstance ? firstInstance : 0;
 }
 
 void QRhiGles2::drawIndexed(QRhiCommandBuffer *cb, quint32 indexCount,
                             quint32 instanceCount, quint32 firstIndex, qint32 vertexOffset, quint32 firstInstance)
 {
     Q_ASSERT(inPass);
-    Q_UNUSED(instanceCount); // no instancing
-    Q_UNUSED(firstInstance);
     Q_UNUSED(vertexOffset); // no glDrawElementsBaseVertex
+    if (firstInstance && !caps.baseInstance)
+        qWarning("firstInstance %u is not supported by the OpenGL implementation, using 0", firstInstance);
+
     QGles2CommandBuffer *cbD = QRHI_RES(QGles2CommandBuffer, cb);
 
-    QGles2CommandBuffer::Command cmd;
-    cmd.cmd = QGles2CommandBuffer::Command::DrawIndexed;
+    QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::DrawIndexed));
     cmd.args.drawIndexed.ps = cbD->currentPipeline;
     cmd.args.drawIndexed.indexCount = indexCount;
     cmd.args.drawIndexed.firstIndex = firstIndex;
-    cbD->commands.append(cmd);
+    cmd.args.drawIndexed.instanceCount = instanceCount;
+    cmd.args.drawIndexed.firstInstance = caps.baseInstance ? firstInstance : 0;
+}
+
+void QRhiGles2::drawIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                             quint32 indirectBufferOffset, quint32 drawCount, quint32 stride)
+{
+    Q_ASSERT(inPass);
+    QGles2CommandBuffer *cbD = QRHI_RES(QGles2CommandBuffer, cb);
+    QGles2Buffer *bufD = QRHI_RES(QGles2Buffer, indirectBuffer);
+    Q_ASSERT(bufD->m_usage.testFlag(QRhiBuffer::IndirectBuffer));
+
+    drawCount = indirectDrawCountInRange(bufD, indirectBufferOffset, drawCount, stride,
+                                         sizeof(QRhiCommandBuffer::DrawIndirectCommand));
+    if (!drawCount)
+        return;
+
+    QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::DrawIndirect));
+    cmd.args.drawIndirect.ps = cbD->currentPipeline;
+    cmd.args.drawIndirect.buffer = bufD->buffer;
+    cmd.args.drawIndirect.offset = indirectBufferOffset;
+    cmd.args.drawIndirect.drawCount = drawCount;
+    cmd.args.drawIndirect.stride = stride;
+}
+
+void QRhiGles2::drawIndexedIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                                    quint32 indirectBufferOffset, quint32 drawCount, quint32 stride)
+{
+    Q_ASSERT(inPass);
+    QGles2CommandBuffer *cbD = QRHI_RES(QGles2CommandBuffer, cb);
+    QGles2Buffer *bufD = QRHI_RES(QGles2Buffer, indirectBuffer);
+    Q_ASSERT(bufD->m_usage.testFlag(QRhiBuffer::IndirectBuffer));
+
+    // there is nowhere to pass the index buffer offset
+    if (cbD->currentIndexOffset) {
+        qWarning("Index buffer offset %u is not supported with drawIndexedIndirect; ignored",
+                 cbD->currentIndexOffset);
+        return;
+    }
+
+    drawCount = indirectDrawCountInRange(bufD, indirectBufferOffset, drawCount, stride,
+                                         sizeof(QRhiCommandBuffer::DrawIndexedIndirectCommand));
+    if (!drawCount)
+        return;
+
+    QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::DrawIndexedIndirect));
+    cmd.args.drawIndirect.ps = cbD->currentPipeline;
+    cmd.args.drawIndirect.buffer = bufD->buffer;
+    cmd.args.drawIndirect.offset = indirectBufferOffset;
+    cmd.args.drawIndirect.drawCount = drawCount;
+    cmd.args.drawIndirect.stride = stride;
+}
+
+void QRhiGles2::dispatch(QRhiCommandBuffer *cb, int x, int y, int z)
+{
+    Q_ASSERT(inComputePass);
+    QGles2CommandBuffer *cbD = QRHI_RES(QGles2CommandBuffer, cb);
+
+    QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::Dispatch));
+    cmd.args.dispatch.x = GLuint(x);
+    cmd.args.dispatch.y = GLuint(y);
+    cmd.args.dispatch.z = GLuint(z);
+
+    // Make the writes visible to whatever may consume the written resources,
+    // in this or in later passes. Resources the shader only reads need no
+    // barrier.
+    GLbitfield barriers = 0;
+    QGles2ShaderResourceBindings *srbD = QRHI_RES(QGles2ShaderResourceBindings, cbD->currentSrb);
+    for (int i = 0, ie = srbD ? srbD->m_bindings.count() : 0; i != ie; ++i) {
+        const QRhiShaderResourceBindingPrivate *b = QRhiShaderResourceBindingPrivate::get(&srbD->m_bindings[i]);
+        switch (b->type) {
+        case QRhiShaderResourceBinding::ImageStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageLoadStore:
+            barriers |= GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT
+                    | GL_TEXTURE_UPDATE_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT;
+            break;
+        case QRhiShaderResourceBinding::BufferStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferLoadStore:
+        {
+            barriers |= GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT;
+            const QRhiBuffer::UsageFlags usage = b->u.sbuf.buf->usage();
+            if (usage.testFlag(QRhiBuffer::VertexBuffer))
+                barriers |= GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT;
+            if (usage.testFlag(QRhiBuffer::IndexBuffer))
+                barriers |= GL_ELEMENT_ARRAY_BARRIER_BIT;
+            if (usage.testFlag(QRhiBuffer::UniformBuffer))
+                barriers |= GL_UNIFORM_BARRIER_BIT;
+            if (usage.testFlag(QRhiBuffer::IndirectBuffer))
+                barriers |= GL_COMMAND_BARRIER_BIT;
+        }
+            break;
+        default:
+            break;
+        }
+    }
+    cmd.args.dispatch.barriers = barriers;
+
+    // executeCommands() may run on the render thread, so count here instead
+    if (barriers) {
+        QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
+        QRHI_PROF_F(frameStats.barriers++);
+    }
 }
 
 void QRhiGles2::debugMarkBegin(QRhiCommandBuffer *cb, const QByteArray &name)
 {
+    writeMarkerTimestamp(QRHI_RES(QGles2CommandBuffer, cb), true);
+
     if (!debugMarkers)
         return;
 
-    Q_UNUSED(cb);
     Q_UNUSED(name);
 }
 
 void QRhiGles2::debugMarkEnd(QRhiCommandBuffer *cb)
 {
-    if (!debugMarkers)
-        return;
-
-    Q_UNUSED(cb);
+    writeMarkerTimestamp(QRHI_RES(QGles2CommandBuffer, cb), false);
 }
 
 void QRhiGles2::debugMarkMsg(QRhiCommandBuffer *cb, const QByteArray &msg)
@@ -859,23 +1473,153 @@ void QRhiGles2::debugMarkMsg(QRhiCommandBuffer *cb, const QByteArray &msg)
     Q_UNUSED(msg);
 }
 
-QRhi::FrameOpResult QRhiGles2::beginFrame(QRhiSwapChain *swapChain, QRhi::BeginFrameFlags flags)
+void QRhiGles2::beginFrameTimestamps(QGles2SwapChain *swapChainD)
 {
-    Q_UNUSED(flags);
-    Q_ASSERT(!inFrame);
-
-    QGles2SwapChain *swapChainD = QRHI_RES(QGles2SwapChain, swapChain);
-    if (!ensureContext(swapChainD->surface))
-        return QRhi::FrameOpError;
+    QGles2CommandBuffer *cbD = &swapChainD->cb;
+
+    // Poll the results of the earlier frames. Nothing waits for the queries
+    // to become available, a frame is simply polled again in the next
+    // beginFrame if its results are not there yet.
+    for (int i = 0; i < QGles2SwapChain::TIMESTAMP_FRAMES; ++i) {
+        QGles2SwapChain::TimestampFrame &tf(swapChainD->timestampFrames[i]);
+        if (!tf.pending)
+            continue;
+        QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::ResolveTimestamps));
+        cmd.args.resolveTimestamps.swapChain = swapChainD;
+        cmd.args.resolveTimestamps.queries = tf.queries;
+        cmd.args.resolveTimestamps.queryCount = tf.queryCount;
+        cmd.args.resolveTimestamps.frame = i;
+        cmd.args.resolveTimestamps.serial = tf.serial;
+    }
 
-    inFrame = true;
-    currentSwapChain = swapChainD;
+    // when all query sets are still in flight, this frame is not timed
+    QGles2SwapChain::TimestampFrame &tf(swapChainD->timestampFrames[swapChainD->currentTimestampFrame]);
+    if (tf.pending)
+        return;
 
     QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
-    QRHI_PROF_F(beginSwapChainFrame(swapChain));
-
-    executeDeferredReleases();
-    QRHI_RES(QGles2CommandBuffer, &swapChainD->cb)->resetState();
+    tf.active = true;
+    tf.markerTiming = rhiP && rhiP->markerTiming;
+    tf.serial = ++timestampSerial;
+    tf.queryCount = 2;
+    tf.scopeCount = 0;
+    tf.stack.clear();
+    tf.scopes.clear();
+    tf.markerSerial = 0;
+
+    QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::QueryCounter));
+    cmd.args.queryCounter.query = &tf.queries[0];
+}
+
+void QRhiGles2::endFrameTimestamps(QGles2SwapChain *swapChainD)
+{
+    QGles2SwapChain::TimestampFrame &tf(swapChainD->timestampFrames[swapChainD->currentTimestampFrame]);
+    if (!tf.active)
+        return;
+
+    tf.active = false;
+    tf.pending = true;
+
+    QGles2CommandBuffer::Command &cmd(swapChainD->cb.commands.get(QGles2CommandBuffer::Command::QueryCounter));
+    cmd.args.queryCounter.query = &tf.queries[1];
+
+    QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
+    if (rhiP && tf.markerTiming && !tf.scopes.isEmpty())
+        tf.markerSerial = rhiP->requestMarkerGpuTimes(swapChainD);
+
+    swapChainD->currentTimestampFrame = (swapChainD->currentTimestampFrame + 1) % QGles2SwapChain::TIMESTAMP_FRAMES;
+}
+
+void QRhiGles2::writeMarkerTimestamp(QGles2CommandBuffer *cbD, bool begin)
+{
+    // Only the timed swapchain frames get their scopes timed. Scopes are
+    // numbered in debugMarkBegin order, like in the profiler, also when
+    // running out of queries.
+    if (!currentSwapChain || cbD != &currentSwapChain->cb)
+        return;
+
+    QGles2SwapChain::TimestampFrame &tf(currentSwapChain->timestampFrames[currentSwapChain->currentTimestampFrame]);
+    if (!tf.active || !tf.markerTiming)
+        return;
+
+    int query = -1;
+    if (tf.queryCount < QGles2SwapChain::MAX_TIMESTAMPS) {
+        query = tf.queryCount++;
+        QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::QueryCounter));
+        cmd.args.queryCounter.query = &tf.queries[query];
+    }
+
+    if (begin) {
+        tf.stack.append({ tf.scopeCount++, query, -1 });
+    } else if (!tf.stack.isEmpty()) {
+        QGles2SwapChain::TimestampFrame::Scope s = tf.stack.takeLast();
+        s.endQuery = query;
+        tf.scopes.append(s);
+    }
+}
+
+void QRhiGles2::resolveTimestamps(QGles2SwapChain *swapChainD, int frame, quint64 serial,
+                                  bool disjoint, const QVector<quint64> &timestamps)
+{
+    QGles2SwapChain::TimestampFrame &tf(swapChainD->timestampFrames[frame]);
+    // With threaded execution a frame may get polled successfully more than
+    // once before the results arrive here. Only the first one counts.
+    if (!tf.pending || tf.serial != serial)
+        return;
+
+    tf.pending = false;
+    const quint64 markerSerial = tf.markerSerial;
+    tf.markerSerial = 0;
+
+    QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
+    if (!rhiP || disjoint)
+        return;
+
+    // GL_TIMESTAMP is in nanoseconds
+    const float elapsedMs = float(timestamps[1] - timestamps[0]) / 1000000.0f;
+    QRHI_PROF_F(swapChainFrameGpuTime(swapChainD, elapsedMs));
+
+    if (!markerSerial)
+        return;
+
+    QVector<QRhiProfilerPrivate::MarkerGpuTime> times(tf.scopeCount);
+    for (const QGles2SwapChain::TimestampFrame::Scope &s : qAsConst(tf.scopes)) {
+        if (s.beginQuery < 0 || s.endQuery < 0)
+            continue;
+        times[s.scope].start = float(timestamps[s.beginQuery] - timestamps[0]) / 1000000.0f;
+        times[s.scope].duration = float(timestamps[s.endQuery] - timestamps[s.beginQuery]) / 1000000.0f;
+    }
+
+    QRHI_PROF_F(resolveMarkerGpuTimes(swapChainD, markerSerial, times));
+}
+
+QRhi::FrameOpResult QRhiGles2::beginFrame(QRhiSwapChain *swapChain, QRhi::BeginFrameFlags flags)
+{
+    Q_UNUSED(flags);
+    Q_ASSERT(!inFrame);
+
+    QGles2SwapChain *swapChainD = QRHI_RES(QGles2SwapChain, swapChain);
+    // Recording needs no context. With threaded execution the previous frame
+    // may still be executing, and the deferred releases are going to be
+    // performed on the render thread after executing this frame.
+    if (!renderThread && !ensureContext(swapChainD->surface))
+        return QRhi::FrameOpError;
+
+    inFrame = true;
+    currentSwapChain = swapChainD;
+
+    QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
+    QRHI_PROF_F(beginSwapChainFrame(swapChain));
+
+    if (renderThread)
+        renderThread->invokeReadbackCallbacks();
+    else
+        executeDeferredReleases();
+
+    QRHI_RES(QGles2CommandBuffer, &swapChainD->cb)->resetState();
+
+    if (rhiP && caps.timestamps)
+        beginFrameTimestamps(swapChainD);
 
     return QRhi::FrameOpSuccess;
 }
@@ -888,6 +1632,25 @@ QRhi::FrameOpResult QRhiGles2::endFrame(QRhiSwapChain *swapChain, QRhi::EndFrame
     QGles2SwapChain *swapChainD = QRHI_RES(QGles2SwapChain, swapChain);
     Q_ASSERT(currentSwapChain == swapChainD);
 
+    endFrameTimestamps(swapChainD);
+
+    if (renderThread) {
+        QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
+        QRHI_PROF_F(endSwapChainFrame(swapChain, swapChainD->frameCount + 1));
+
+        const bool present = swapChainD->surface && !flags.testFlag(QRhi::SkipPresent);
+        renderThread->submit(&swapChainD->cb, swapChainD->surface, present);
+
+        // QRhi destroys the releaseAndDestroyLater() resources right after
+        // this, while the frame may still be using them.
+        if (!pendingReleaseAndDestroyResources.isEmpty())
+            renderThread->waitIdle();
+
+        swapChainD->frameCount += 1;
+        currentSwapChain = nullptr;
+        return QRhi::FrameOpSuccess;
+    }
+
     if (!ensureContext(swapChainD->surface))
         return QRhi::FrameOpError;
 
@@ -943,6 +1706,10 @@ QRhi::FrameOpResult QRhiGles2::endOffscreenFrame()
 QRhi::FrameOpResult QRhiGles2::finish()
 {
     Q_ASSERT(!inPass);
+    if (renderThread) {
+        renderThread->waitIdle();
+        renderThread->invokeReadbackCallbacks();
+    }
     if (inFrame) {
         if (ofr.active) {
             Q_ASSERT(!currentSwapChain);
@@ -970,16 +1737,23 @@ void QRhiGles2::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdate
         QGles2Buffer *bufD = QRHI_RES(QGles2Buffer, u.buf);
         Q_ASSERT(bufD->m_type == QRhiBuffer::Dynamic);
         if (bufD->m_usage.testFlag(QRhiBuffer::UniformBuffer)) {
-            memcpy(bufD->ubuf.data() + u.offset, u.data.constData(), u.data.size());
+            if (renderThread) {
+                // ubuf may be read by the render thread at this point
+                QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::UniformBufferSubData));
+                cmd.args.uniformBufferSubData.buf = u.buf;
+                cmd.args.uniformBufferSubData.offset = u.offset;
+                cmd.args.uniformBufferSubData.size = u.data.size();
+                cmd.args.uniformBufferSubData.data = cbD->retainData(u.data);
+            } else {
+                memcpy(bufD->ubuf.data() + u.offset, u.data.constData(), u.data.size());
+            }
         } else {
-            QGles2CommandBuffer::Command cmd;
-            cmd.cmd = QGles2CommandBuffer::Command::BufferSubData;
+            QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::BufferSubData));
             cmd.args.bufferSubData.target = bufD->target;
             cmd.args.bufferSubData.buffer = bufD->buffer;
             cmd.args.bufferSubData.offset = u.offset;
             cmd.args.bufferSubData.size = u.data.size();
             cmd.args.bufferSubData.data = cbD->retainData(u.data);
-            cbD->commands.append(cmd);
         }
     }
 
@@ -988,26 +1762,55 @@ void QRhiGles2::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdate
         Q_ASSERT(bufD->m_type != QRhiBuffer::Dynamic);
         Q_ASSERT(u.offset + u.data.size() <= bufD->m_size);
         if (bufD->m_usage.testFlag(QRhiBuffer::UniformBuffer)) {
-            memcpy(bufD->ubuf.data() + u.offset, u.data.constData(), u.data.size());
+            if (renderThread) {
+                // ubuf may be read by the render thread at this point
+                QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::UniformBufferSubData));
+                cmd.args.uniformBufferSubData.buf = u.buf;
+                cmd.args.uniformBufferSubData.offset = u.offset;
+                cmd.args.uniformBufferSubData.size = u.data.size();
+                cmd.args.uniformBufferSubData.data = cbD->retainData(u.data);
+            } else {
+                memcpy(bufD->ubuf.data() + u.offset, u.data.constData(), u.data.size());
+            }
         } else {
-            QGles2CommandBuffer::Command cmd;
-            cmd.cmd = QGles2CommandBuffer::Command::BufferSubData;
+            QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::BufferSubData));
             cmd.args.bufferSubData.target = bufD->target;
             cmd.args.bufferSubData.buffer = bufD->buffer;
             cmd.args.bufferSubData.offset = u.offset;
             cmd.args.bufferSubData.size = u.data.size();
             cmd.args.bufferSubData.data = cbD->retainData(u.data);
-            cbD->commands.append(cmd);
         }
     }
 
+    for (const QRhiResourceUpdateBatchPrivate::BufferReadback &u : ud->bufferReadbacks) {
+        QGles2Buffer *bufD = QRHI_RES(QGles2Buffer, u.buf);
+        if (bufD->buffer && !caps.mapBufferRead) {
+            qWarning("Reading back non-uniform buffers is not supported with OpenGL ES 2.0");
+            continue;
+        }
+        QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::GetBufferSubData));
+        cmd.args.getBufferSubData.result = u.result;
+        cmd.args.getBufferSubData.buf = u.buf;
+        cmd.args.getBufferSubData.target = bufD->target;
+        cmd.args.getBufferSubData.buffer = bufD->buffer;
+        cmd.args.getBufferSubData.offset = u.offset;
+        cmd.args.getBufferSubData.size = u.size;
+        // without a render thread ubuf already has the contents of later updates
+        // by the time the stream is executed, hence the snapshot
+        cmd.args.getBufferSubData.data = !bufD->buffer && !renderThread
+                ? cbD->retainData(bufD->ubuf.mid(u.offset, u.size)) : nullptr;
+    }
+
     for (const QRhiResourceUpdateBatchPrivate::TextureOp &u : ud->textureOps) {
         if (u.type == QRhiResourceUpdateBatchPrivate::TextureOp::TexUpload) {
             QGles2Texture *texD = QRHI_RES(QGles2Texture, u.upload.tex);
             const bool isCompressed = isCompressedFormat(texD->m_format);
             const bool isCubeMap = texD->m_flags.testFlag(QRhiTexture::CubeMap);
             const GLenum faceTargetBase = isCubeMap ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : texD->target;
+            // 3D and array textures use the layer as the z offset instead
+            const bool isLayered = isLayeredTarget(texD->target);
             const QVector<QRhiTextureLayer> layers = u.upload.desc.layers();
+            QVarLengthArray<QGles2CommandBuffer::Command::SubImageRegion, 16> subImageRegions;
             for (int layer = 0, layerCount = layers.count(); layer != layerCount; ++layer) {
                 const QRhiTextureLayer &layerDesc(layers[layer]);
                 const QVector<QRhiTextureMipLevel> mipImages = layerDesc.mipImages();
@@ -1019,60 +1822,66 @@ void QRhiGles2::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdate
                         const QSize size = mipDesc.sourceSize().isEmpty() ? q->sizeForMipLevel(level, texD->m_pixelSize)
                                                                           : mipDesc.sourceSize();
                         if (texD->specified) {
-                            QGles2CommandBuffer::Command cmd;
-                            cmd.cmd = QGles2CommandBuffer::Command::CompressedSubImage;
+                            QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::CompressedSubImage));
                             cmd.args.compressedSubImage.target = texD->target;
                             cmd.args.compressedSubImage.texture = texD->texture;
-                            cmd.args.compressedSubImage.faceTarget = faceTargetBase + layer;
+                            cmd.args.compressedSubImage.faceTarget = isLayered ? texD->target : faceTargetBase + layer;
                             cmd.args.compressedSubImage.level = level;
                             cmd.args.compressedSubImage.dx = dp.x();
                             cmd.args.compressedSubImage.dy = dp.y();
+                            cmd.args.compressedSubImage.dz = isLayered ? layer : 0;
                             cmd.args.compressedSubImage.w = size.width();
                             cmd.args.compressedSubImage.h = size.height();
                             cmd.args.compressedSubImage.glintformat = texD->glintformat;
                             cmd.args.compressedSubImage.size = compressedData.size();
                             cmd.args.compressedSubImage.data = cbD->retainData(compressedData);
-                            cbD->commands.append(cmd);
                         } else {
-                            QGles2CommandBuffer::Command cmd;
-                            cmd.cmd = QGles2CommandBuffer::Command::CompressedImage;
+                            QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::CompressedImage));
                             cmd.args.compressedImage.target = texD->target;
                             cmd.args.compressedImage.texture = texD->texture;
-                            cmd.args.compressedImage.faceTarget = faceTargetBase + layer;
+                            cmd.args.compressedImage.faceTarget = isLayered ? texD->target : faceTargetBase + layer;
                             cmd.args.compressedImage.level = level;
                             cmd.args.compressedImage.glintformat = texD->glintformat;
                             cmd.args.compressedImage.w = size.width();
                             cmd.args.compressedImage.h = size.height();
                             cmd.args.compressedImage.size = compressedData.size();
                             cmd.args.compressedImage.data = cbD->retainData(compressedData);
-                            cbD->commands.append(cmd);
                         }
                     } else {
                         QImage img = mipDesc.image();
                         QSize size = img.size();
-                        QGles2CommandBuffer::Command cmd;
-                        cmd.cmd = QGles2CommandBuffer::Command::SubImage;
                         if (!mipDesc.sourceSize().isEmpty() || !mipDesc.sourceTopLeft().isNull()) {
                             const QPoint sp = mipDesc.sourceTopLeft();
                             if (!mipDesc.sourceSize().isEmpty())
                                 size = mipDesc.sourceSize();
                             img = img.copy(sp.x(), sp.y(), size.width(), size.height());
                         }
-                        cmd.args.subImage.target = texD->target;
-                        cmd.args.subImage.texture = texD->texture;
-                        cmd.args.subImage.faceTarget = faceTargetBase + layer;
-                        cmd.args.subImage.level = level;
-                        cmd.args.subImage.dx = dp.x();
-                        cmd.args.subImage.dy = dp.y();
-                        cmd.args.subImage.w = size.width();
-                        cmd.args.subImage.h = size.height();
-                        cmd.args.subImage.glformat = texD->glformat;
-                        cmd.args.subImage.gltype = texD->gltype;
-                        cmd.args.subImage.data = cbD->retainImage(img);
-                        cbD->commands.append(cmd);
+                        QGles2CommandBuffer::Command::SubImageRegion region;
+                        region.faceTarget = isLayered ? texD->target : faceTargetBase + layer;
+                        region.level = level;
+                        region.dx = dp.x();
+                        region.dy = dp.y();
+                        region.dz = isLayered ? layer : 0;
+                        region.w = size.width();
+                        region.h = size.height();
+                        region.data = cbD->retainImage(img);
+                        subImageRegions.append(region);
                     }
                 }
             }
+            if (!subImageRegions.isEmpty()) {
+                // one command for the whole upload, binding the texture only once
+                const int regionCount = subImageRegions.count();
+                const int extraSize = (regionCount - 1) * int(sizeof(QGles2CommandBuffer::Command::SubImageRegion));
+                QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::SubImage, extraSize));
+                cmd.args.subImage.target = texD->target;
+                cmd.args.subImage.texture = texD->texture;
+                cmd.args.subImage.glformat = texD->glformat;
+                cmd.args.subImage.gltype = texD->gltype;
+                cmd.args.subImage.regionCount = regionCount;
+                memcpy(cmd.args.subImage.regions, subImageRegions.constData(),
+                       size_t(regionCount) * sizeof(QGles2CommandBuffer::Command::SubImageRegion));
+            }
             texD->specified = true;
         } else if (u.type == QRhiResourceUpdateBatchPrivate::TextureOp::TexCopy) {
             Q_ASSERT(u.copy.src && u.copy.dst);
@@ -1091,50 +1900,74 @@ void QRhiGles2::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdate
                     ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : srcD->target;
             const GLenum dstFaceTargetBase = dstD->m_flags.testFlag(QRhiTexture::CubeMap)
                     ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : dstD->target;
+            const bool srcIsLayered = isLayeredTarget(srcD->target);
+            const bool dstIsLayered = isLayeredTarget(dstD->target);
 
-            QGles2CommandBuffer::Command cmd;
-            cmd.cmd = QGles2CommandBuffer::Command::CopyTex;
+            QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::CopyTex));
 
-            cmd.args.copyTex.srcFaceTarget = srcFaceTargetBase + u.copy.desc.sourceLayer();
+            cmd.args.copyTex.srcFaceTarget = srcIsLayered ? srcD->target : srcFaceTargetBase + u.copy.desc.sourceLayer();
             cmd.args.copyTex.srcTexture = srcD->texture;
             cmd.args.copyTex.srcLevel = u.copy.desc.sourceLevel();
             cmd.args.copyTex.srcX = sx;
             cmd.args.copyTex.srcY = sy;
+            cmd.args.copyTex.srcZ = srcIsLayered ? u.copy.desc.sourceLayer() : 0;
 
             cmd.args.copyTex.dstTarget = dstD->target;
             cmd.args.copyTex.dstTexture = dstD->texture;
-            cmd.args.copyTex.dstFaceTarget = dstFaceTargetBase + u.copy.desc.destinationLayer();
+            cmd.args.copyTex.dstFaceTarget = dstIsLayered ? dstD->target : dstFaceTargetBase + u.copy.desc.destinationLayer();
             cmd.args.copyTex.dstLevel = u.copy.desc.destinationLevel();
             cmd.args.copyTex.dstX = dx;
             cmd.args.copyTex.dstY = dy;
+            cmd.args.copyTex.dstZ = dstIsLayered ? u.copy.desc.destinationLayer() : 0;
 
             cmd.args.copyTex.w = size.width();
             cmd.args.copyTex.h = size.height();
 
-            cbD->commands.append(cmd);
         } else if (u.type == QRhiResourceUpdateBatchPrivate::TextureOp::TexRead) {
-            QGles2CommandBuffer::Command cmd;
-            cmd.cmd = QGles2CommandBuffer::Command::ReadPixels;
-            cmd.args.readPixels.result = u.read.result;
             QGles2Texture *texD = QRHI_RES(QGles2Texture, u.read.rb.texture());
+            QSize levelSize;
+            if (texD) {
+                levelSize = u.read.rb.level() > 0 ? q->sizeForMipLevel(u.read.rb.level(), texD->m_pixelSize)
+                                                  : texD->m_pixelSize;
+            } else if (currentSwapChain) {
+                levelSize = currentSwapChain->pixelSize;
+            }
+            QRect rect;
+            if (!readbackRect(u.read.rb, levelSize, &rect))
+                continue;
+            QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::ReadPixels));
+            cmd.args.readPixels.result = u.read.result;
             cmd.args.readPixels.texture = texD ? texD->texture : 0;
+            // the origin is bottom-left
+            cmd.args.readPixels.x = rect.x();
+            cmd.args.readPixels.y = levelSize.height() - (rect.y() + rect.height());
+            // not known anymore when executing on the render thread in case of the swapchain
+            cmd.args.readPixels.w = rect.width();
+            cmd.args.readPixels.h = rect.height();
             if (texD) {
-                cmd.args.readPixels.w = texD->m_pixelSize.width();
-                cmd.args.readPixels.h = texD->m_pixelSize.height();
                 cmd.args.readPixels.format = texD->m_format;
                 const GLenum faceTargetBase = texD->m_flags.testFlag(QRhiTexture::CubeMap)
                         ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : texD->target;
-                cmd.args.readPixels.readTarget = faceTargetBase + u.read.rb.layer();
+                const bool isLayered = isLayeredTarget(texD->target);
+                cmd.args.readPixels.readTarget = isLayered ? texD->target : faceTargetBase + u.read.rb.layer();
                 cmd.args.readPixels.level = u.read.rb.level();
+                cmd.args.readPixels.slice = isLayered ? u.read.rb.layer() : 0;
+                if (isReadBackInNativeFormat(texD->m_format)) {
+                    cmd.args.readPixels.glformat = texD->glformat;
+                    cmd.args.readPixels.gltype = texD->gltype;
+                } else {
+                    cmd.args.readPixels.glformat = GL_RGBA;
+                    cmd.args.readPixels.gltype = GL_UNSIGNED_BYTE;
+                }
+            } else {
+                cmd.args.readPixels.glformat = GL_RGBA;
+                cmd.args.readPixels.gltype = GL_UNSIGNED_BYTE;
             }
-            cbD->commands.append(cmd);
         } else if (u.type == QRhiResourceUpdateBatchPrivate::TextureOp::TexMipGen) {
-            QGles2CommandBuffer::Command cmd;
-            cmd.cmd = QGles2CommandBuffer::Command::GenMip;
+            QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::GenMip));
             QGles2Texture *texD = QRHI_RES(QGles2Texture, u.mipgen.tex);
             cmd.args.genMip.target = texD->target;
             cmd.args.genMip.texture = texD->texture;
-            cbD->commands.append(cmd);
         }
     }
 
@@ -1357,12 +2190,23 @@ static inline GLenum toGlWrapMode(QRhiSampler::AddressMode m)
 
 void QRhiGles2::executeCommandBuffer(QRhiCommandBuffer *cb)
 {
-    QGles2CommandBuffer *cbD = QRHI_RES(QGles2CommandBuffer, cb);
+    executeCommands(QRHI_RES(QGles2CommandBuffer, cb)->commands);
+}
+
+// May be called on the render thread. The QRhi's thread is then recording the
+// next frame, so QRhiGles2 state not owned by the render thread for the
+// duration of the frame (like currentSwapChain) must not be touched here.
+void QRhiGles2::executeCommands(const QGles2CommandBuffer::CommandStream &commands,
+                                QVector<std::function<void()>> *deferredReadbackCallbacks)
+{
+    if (vao)
+        f->glBindVertexArray(vao);
+
     GLenum indexType = GL_UNSIGNED_SHORT;
     quint32 indexStride = sizeof(quint16);
     quint32 indexOffset = 0;
 
-    for (const QGles2CommandBuffer::Command &cmd : qAsConst(cbD->commands)) {
+    for (const QGles2CommandBuffer::Command &cmd : commands) {
         switch (cmd.cmd) {
         case QGles2CommandBuffer::Command::Viewport:
             f->glViewport(cmd.args.viewport.x, cmd.args.viewport.y, cmd.args.viewport.w, cmd.args.viewport.h);
@@ -1402,6 +2246,7 @@ void QRhiGles2::executeCommandBuffer(QRhiCommandBuffer *cb)
                     int size = 1;
                     GLenum type = GL_FLOAT;
                     bool normalize = false;
+                    bool integer = false;
                     switch (a.format()) {
                     case QRhiVertexInputAttribute::Float4:
                         type = GL_FLOAT;
@@ -1434,13 +2279,103 @@ void QRhiGles2::executeCommandBuffer(QRhiCommandBuffer *cb)
                         normalize = true;
                         size = 1;
                         break;
+                    case QRhiVertexInputAttribute::Half4:
+                        type = GL_HALF_FLOAT;
+                        size = 4;
+                        break;
+                    case QRhiVertexInputAttribute::Half2:
+                        type = GL_HALF_FLOAT;
+                        size = 2;
+                        break;
+                    case QRhiVertexInputAttribute::SNormByte4:
+                        type = GL_BYTE;
+                        normalize = true;
+                        size = 4;
+                        break;
+                    case QRhiVertexInputAttribute::SNormByte2:
+                        type = GL_BYTE;
+                        normalize = true;
+                        size = 2;
+                        break;
+                    case QRhiVertexInputAttribute::SNormShort4:
+                        type = GL_SHORT;
+                        normalize = true;
+                        size = 4;
+                        break;
+                    case QRhiVertexInputAttribute::SNormShort2:
+                        type = GL_SHORT;
+                        normalize = true;
+                        size = 2;
+                        break;
+                    case QRhiVertexInputAttribute::UInt4:
+                        type = GL_UNSIGNED_INT;
+                        integer = true;
+                        size = 4;
+                        break;
+                    case QRhiVertexInputAttribute::UInt3:
+                        type = GL_UNSIGNED_INT;
+                        integer = true;
+                        size = 3;
+                        break;
+                    case QRhiVertexInputAttribute::UInt2:
+                        type = GL_UNSIGNED_INT;
+                        integer = true;
+                        size = 2;
+                        break;
+                    case QRhiVertexInputAttribute::UInt:
+                        type = GL_UNSIGNED_INT;
+                        integer = true;
+                        size = 1;
+                        break;
+                    case QRhiVertexInputAttribute::SInt4:
+                        type = GL_INT;
+                        integer = true;
+                        size = 4;
+                        break;
+                    case QRhiVertexInputAttribute::SInt3:
+                        type = GL_INT;
+                        integer = true;
+                        size = 3;
+                        break;
+                    case QRhiVertexInputAttribute::SInt2:
+                        type = GL_INT;
+                        integer = true;
+                        size = 2;
+                        break;
+                    case QRhiVertexInputAttribute::SInt:
+                        type = GL_INT;
+                        integer = true;
+                        size = 1;
+                        break;
+                    case QRhiVertexInputAttribute::UNormA2B10G10R10:
+                        type = GL_UNSIGNED_INT_2_10_10_10_REV;
+                        normalize = true;
+                        size = 4;
+                        break;
+                    case QRhiVertexInputAttribute::SNormA2B10G10R10:
+                        type = GL_INT_2_10_10_10_REV;
+                        normalize = true;
+                        size = 4;
+                        break;
                     default:
                         break;
                     }
                     quint32 ofs = a.offset() + cmd.args.bindVertexBuffer.offset;
-                    f->glVertexAttribPointer(a.location(), size, type, normalize, stride,
-                                             reinterpret_cast<const GLvoid *>(quintptr(ofs)));
+                    if (integer) {
+                        f->glVertexAttribIPointer(a.location(), size, type, stride,
+                                                  reinterpret_cast<const GLvoid *>(quintptr(ofs)));
+                    } else {
+                        f->glVertexAttribPointer(a.location(), size, type, normalize, stride,
+                                                 reinterpret_cast<const GLvoid *>(quintptr(ofs)));
+                    }
                     f->glEnableVertexAttribArray(a.location());
+                    if (caps.instancing) {
+                        // the divisor is attribute state, reset it for per-vertex data too
+                        const QRhiVertexInputBinding &binding(bindings[a.binding()]);
+                        const GLuint divisor = binding.classification() == QRhiVertexInputBinding::PerInstance
+                                ? GLuint(binding.instanceStepRate()) : 0;
+                        glVertexAttribDivisor(a.location(), divisor);
+                    }
                 }
             } else {
                 qWarning("No graphics pipeline active for setVertexInput; ignored");
@@ -1456,10 +2391,19 @@ void QRhiGles2::executeCommandBuffer(QRhiCommandBuffer *cb)
         case QGles2CommandBuffer::Command::Draw:
         {
             QGles2GraphicsPipeline *psD = QRHI_RES(QGles2GraphicsPipeline, cmd.args.draw.ps);
-            if (psD)
-                f->glDrawArrays(psD->drawMode, cmd.args.draw.firstVertex, cmd.args.draw.vertexCount);
-            else
+            if (psD) {
+                if (cmd.args.draw.firstInstance) {
+                    glDrawArraysInstancedBaseInstance(psD->drawMode, cmd.args.draw.firstVertex, cmd.args.draw.vertexCount,
+                                                      cmd.args.draw.instanceCount, cmd.args.draw.firstInstance);
+                } else if (cmd.args.draw.instanceCount == 1 || !caps.instancing) {
+                    f->glDrawArrays(psD->drawMode, cmd.args.draw.firstVertex, cmd.args.draw.vertexCount);
+                } else {
+                    glDrawArraysInstanced(psD->drawMode, cmd.args.draw.firstVertex, cmd.args.draw.vertexCount,
+                                          cmd.args.draw.instanceCount);
+                }
+            } else {
                 qWarning("No graphics pipeline active for draw; ignored");
+            }
         }
             break;
         case QGles2CommandBuffer::Command::DrawIndexed:
@@ -1467,20 +2411,92 @@ void QRhiGles2::executeCommandBuffer(QRhiCommandBuffer *cb)
             QGles2GraphicsPipeline *psD = QRHI_RES(QGles2GraphicsPipeline, cmd.args.drawIndexed.ps);
             if (psD) {
                 quint32 ofs = cmd.args.drawIndexed.firstIndex * indexStride + indexOffset;
-                f->glDrawElements(psD->drawMode,
-                                  cmd.args.drawIndexed.indexCount,
-                                  indexType,
-                                  reinterpret_cast<const GLvoid *>(quintptr(ofs)));
+                if (cmd.args.drawIndexed.firstInstance) {
+                    glDrawElementsInstancedBaseInstance(psD->drawMode,
+                                                        cmd.args.drawIndexed.indexCount,
+                                                        indexType,
+                                                        reinterpret_cast<const GLvoid *>(quintptr(ofs)),
+                                                        cmd.args.drawIndexed.instanceCount,
+                                                        cmd.args.drawIndexed.firstInstance);
+                } else if (cmd.args.drawIndexed.instanceCount == 1 || !caps.instancing) {
+                    f->glDrawElements(psD->drawMode,
+                                      cmd.args.drawIndexed.indexCount,
+                                      indexType,
+                                      reinterpret_cast<const GLvoid *>(quintptr(ofs)));
+                } else {
+                    glDrawElementsInstanced(psD->drawMode,
+                                            cmd.args.drawIndexed.indexCount,
+                                            indexType,
+                                            reinterpret_cast<const GLvoid *>(quintptr(ofs)),
+                                            cmd.args.drawIndexed.instanceCount);
+                }
             } else {
                 qWarning("No graphics pipeline active for drawIndexed; ignored");
             }
         }
             break;
+        case QGles2CommandBuffer::Command::DrawIndirect:
+        {
+            QGles2GraphicsPipeline *psD = QRHI_RES(QGles2GraphicsPipeline, cmd.args.drawIndirect.ps);
+            if (psD) {
+                f->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, cmd.args.drawIndirect.buffer);
+                const quint32 ofs = cmd.args.drawIndirect.offset;
+                if (caps.multiDrawIndirect) {
+                    glMultiDrawArraysIndirect(psD->drawMode, reinterpret_cast<const GLvoid *>(quintptr(ofs)),
+                                              cmd.args.drawIndirect.drawCount, cmd.args.drawIndirect.stride);
+                } else {
+                    for (quint32 i = 0; i < cmd.args.drawIndirect.drawCount; ++i) {
+                        // in range, checked when recording
+                        const quint64 cmdOfs = quint64(ofs) + quint64(i) * cmd.args.drawIndirect.stride;
+                        f->glDrawArraysIndirect(psD->drawMode, reinterpret_cast<const GLvoid *>(quintptr(cmdOfs)));
+                    }
+                }
+            } else {
+                qWarning("No graphics pipeline active for drawIndirect; ignored");
+            }
+        }
+            break;
+        case QGles2CommandBuffer::Command::DrawIndexedIndirect:
+        {
+            QGles2GraphicsPipeline *psD = QRHI_RES(QGles2GraphicsPipeline, cmd.args.drawIndirect.ps);
+            if (psD) {
+                f->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, cmd.args.drawIndirect.buffer);
+                const quint32 ofs = cmd.args.drawIndirect.offset;
+                if (caps.multiDrawIndirect) {
+                    glMultiDrawElementsIndirect(psD->drawMode, indexType, reinterpret_cast<const GLvoid *>(quintptr(ofs)),
+                                                cmd.args.drawIndirect.drawCount, cmd.args.drawIndirect.stride);
+                } else {
+                    for (quint32 i = 0; i < cmd.args.drawIndirect.drawCount; ++i) {
+                        const quint64 cmdOfs = quint64(ofs) + quint64(i) * cmd.args.drawIndirect.stride;
+                        f->glDrawElementsIndirect(psD->drawMode, indexType, reinterpret_cast<const GLvoid *>(quintptr(cmdOfs)));
+                    }
+                }
+            } else {
+                qWarning("No graphics pipeline active for drawIndexedIndirect; ignored");
+            }
+        }
+            break;
         case QGles2CommandBuffer::Command::BindGraphicsPipeline:
             executeBindGraphicsPipeline(cmd.args.bindGraphicsPipeline.ps);
             break;
+        case QGles2CommandBuffer::Command::BindComputePipeline:
+            f->glUseProgram(QRHI_RES(QGles2ComputePipeline, cmd.args.bindComputePipeline.ps)->program);
+            break;
+        case QGles2CommandBuffer::Command::Dispatch:
+            f->glDispatchCompute(cmd.args.dispatch.x, cmd.args.dispatch.y, cmd.args.dispatch.z);
+            if (cmd.args.dispatch.barriers)
+                f->glMemoryBarrier(cmd.args.dispatch.barriers);
+            break;
+        case QGles2CommandBuffer::Command::PushConstants:
+            executeSetPushConstants(cmd.args.pushConstants.maybeGraphicsPs,
+                                    cmd.args.pushConstants.maybeComputePs,
+                                    cmd.args.pushConstants.offset,
+                                    cmd.args.pushConstants.size,
+                                    cmd.args.pushConstants.data);
+            break;
         case QGles2CommandBuffer::Command::BindShaderResources:
-            setChangedUniforms(cmd.args.bindShaderResources.ps,
+            setChangedUniforms(cmd.args.bindShaderResources.maybeGraphicsPs,
+                               cmd.args.bindShaderResources.maybeComputePs,
                                cmd.args.bindShaderResources.srb,
                                cmd.args.bindShaderResources.dynamicOffsetPairs,
                                cmd.args.bindShaderResources.dynamicOffsetCount);
@@ -1497,6 +2513,11 @@ void QRhiGles2::executeCommandBuffer(QRhiCommandBuffer *cb)
                     f->glDisable(GL_FRAMEBUFFER_SRGB);
             }
             break;
+        case QGles2CommandBuffer::Command::InvalidateFramebuffer:
+            f->glBindFramebuffer(GL_FRAMEBUFFER, cmd.args.invalidateFramebuffer.fbo);
+            glInvalidateFramebuffer(GL_FRAMEBUFFER, cmd.args.invalidateFramebuffer.attCount,
+                                    cmd.args.invalidateFramebuffer.att);
+            break;
         case QGles2CommandBuffer::Command::Clear:
             f->glDisable(GL_SCISSOR_TEST);
             if (cmd.args.clear.mask & GL_COLOR_BUFFER_BIT) {
@@ -1521,13 +2542,25 @@ void QRhiGles2::executeCommandBuffer(QRhiCommandBuffer *cb)
             GLuint fbo;
             f->glGenFramebuffers(1, &fbo);
             f->glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-            f->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                                      cmd.args.copyTex.srcFaceTarget, cmd.args.copyTex.srcTexture, cmd.args.copyTex.srcLevel);
+            if (isLayeredTarget(cmd.args.copyTex.srcFaceTarget)) {
+                f->glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, cmd.args.copyTex.srcTexture,
+                                             cmd.args.copyTex.srcLevel, cmd.args.copyTex.srcZ);
+            } else {
+                f->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                          cmd.args.copyTex.srcFaceTarget, cmd.args.copyTex.srcTexture, cmd.args.copyTex.srcLevel);
+            }
             f->glBindTexture(cmd.args.copyTex.dstTarget, cmd.args.copyTex.dstTexture);
-            f->glCopyTexSubImage2D(cmd.args.copyTex.dstFaceTarget, cmd.args.copyTex.dstLevel,
-                                   cmd.args.copyTex.dstX, cmd.args.copyTex.dstY,
-                                   cmd.args.copyTex.srcX, cmd.args.copyTex.srcY,
-                                   cmd.args.copyTex.w, cmd.args.copyTex.h);
+            if (isLayeredTarget(cmd.args.copyTex.dstFaceTarget)) {
+                f->glCopyTexSubImage3D(cmd.args.copyTex.dstFaceTarget, cmd.args.copyTex.dstLevel,
+                                       cmd.args.copyTex.dstX, cmd.args.copyTex.dstY, cmd.args.copyTex.dstZ,
+                                       cmd.args.copyTex.srcX, cmd.args.copyTex.srcY,
+                                       cmd.args.copyTex.w, cmd.args.copyTex.h);
+            } else {
+                f->glCopyTexSubImage2D(cmd.args.copyTex.dstFaceTarget, cmd.args.copyTex.dstLevel,
+                                       cmd.args.copyTex.dstX, cmd.args.copyTex.dstY,
+                                       cmd.args.copyTex.srcX, cmd.args.copyTex.srcY,
+                                       cmd.args.copyTex.w, cmd.args.copyTex.h);
+            }
             f->glBindFramebuffer(GL_FRAMEBUFFER, ctx->defaultFramebufferObject());
             f->glDeleteFramebuffers(1, &fbo);
         }
@@ -1542,32 +2575,144 @@ void QRhiGles2::executeCommandBuffer(QRhiCommandBuffer *cb)
                 result->format = cmd.args.readPixels.format;
                 f->glGenFramebuffers(1, &fbo);
                 f->glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-                f->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                                          cmd.args.readPixels.readTarget, cmd.args.readPixels.texture, cmd.args.readPixels.level);
+                if (isLayeredTarget(cmd.args.readPixels.readTarget)) {
+                    f->glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, cmd.args.readPixels.texture,
+                                                 cmd.args.readPixels.level, cmd.args.readPixels.slice);
+                } else {
+                    f->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                              cmd.args.readPixels.readTarget, cmd.args.readPixels.texture, cmd.args.readPixels.level);
+                }
             } else {
-                result->pixelSize = currentSwapChain->pixelSize;
+                result->pixelSize = QSize(cmd.args.readPixels.w, cmd.args.readPixels.h);
                 result->format = QRhiTexture::RGBA8;
                 // readPixels handles multisample resolving implicitly
             }
-            result->data.resize(result->pixelSize.width() * result->pixelSize.height() * 4);
-            f->glReadPixels(0, 0, result->pixelSize.width(), result->pixelSize.height(),
-                            GL_RGBA, GL_UNSIGNED_BYTE,
-                            result->data.data());
+            quint32 byteSize = result->pixelSize.width() * result->pixelSize.height() * 4;
+            const bool nativeFormat = tex && isReadBackInNativeFormat(result->format);
+            if (nativeFormat)
+                textureFormatInfo(result->format, result->pixelSize, nullptr, &byteSize);
+            void *dst = nullptr;
+            if (result->destination) {
+                // read directly into the caller-provided memory
+                if (result->destinationSize >= byteSize)
+                    dst = result->destination;
+                else
+                    qWarning("Readback destination of %u bytes is too small, need %u bytes",
+                             result->destinationSize, byteSize);
+            } else {
+                result->data.resize(int(byteSize));
+                dst = result->data.data();
+            }
+            if (dst) {
+                // byteSize assumes tightly packed rows, which the default
+                // alignment of 4 only guarantees for 4 byte pixels
+                GLint packAlignment = 4;
+                if (nativeFormat) {
+                    f->glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+                    f->glPixelStorei(GL_PACK_ALIGNMENT, 1);
+                }
+                f->glReadPixels(cmd.args.readPixels.x, cmd.args.readPixels.y,
+                                result->pixelSize.width(), result->pixelSize.height(),
+                                cmd.args.readPixels.glformat, cmd.args.readPixels.gltype,
+                                dst);
+                if (nativeFormat)
+                    f->glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+            }
             if (fbo) {
                 f->glBindFramebuffer(GL_FRAMEBUFFER, ctx->defaultFramebufferObject());
                 f->glDeleteFramebuffers(1, &fbo);
             }
-            if (result->completed)
-                result->completed();
+            if (result->completed) {
+                if (deferredReadbackCallbacks)
+                    deferredReadbackCallbacks->append(result->completed);
+                else
+                    result->completed();
+            }
+        }
+            break;
+        case QGles2CommandBuffer::Command::GetBufferSubData:
+        {
+            QRhiBufferReadbackResult *result = cmd.args.getBufferSubData.result;
+            result->data.resize(cmd.args.getBufferSubData.size);
+            if (cmd.args.getBufferSubData.buffer) {
+                f->glBindBuffer(cmd.args.getBufferSubData.target, cmd.args.getBufferSubData.buffer);
+                const void *p = f->glMapBufferRange(cmd.args.getBufferSubData.target,
+                                                    cmd.args.getBufferSubData.offset,
+                                                    cmd.args.getBufferSubData.size,
+                                                    GL_MAP_READ_BIT);
+                if (p) {
+                    memcpy(result->data.data(), p, size_t(cmd.args.getBufferSubData.size));
+                    f->glUnmapBuffer(cmd.args.getBufferSubData.target);
+                } else {
+                    qWarning("Failed to map buffer for readback");
+                }
+            } else if (cmd.args.getBufferSubData.data) {
+                memcpy(result->data.data(), cmd.args.getBufferSubData.data, size_t(cmd.args.getBufferSubData.size));
+            } else {
+                // uniform buffers live in system memory
+                QGles2Buffer *bufD = QRHI_RES(QGles2Buffer, cmd.args.getBufferSubData.buf);
+                memcpy(result->data.data(), bufD->ubuf.constData() + cmd.args.getBufferSubData.offset,
+                       size_t(cmd.args.getBufferSubData.size));
+            }
+            if (result->completed) {
+                if (deferredReadbackCallbacks)
+                    deferredReadbackCallbacks->append(result->completed);
+                else
+                    result->completed();
+            }
+        }
+            break;
+        case QGles2CommandBuffer::Command::QueryCounter:
+            if (!*cmd.args.queryCounter.query)
+                glGenQueries(1, cmd.args.queryCounter.query);
+            glQueryCounter(*cmd.args.queryCounter.query, GL_TIMESTAMP);
+            break;
+        case QGles2CommandBuffer::Command::ResolveTimestamps:
+        {
+            const GLuint *queries = cmd.args.resolveTimestamps.queries;
+            const int queryCount = cmd.args.resolveTimestamps.queryCount;
+            bool available = true;
+            for (int i = 0; i < queryCount && available; ++i) {
+                GLuint queryAvailable = 0;
+                glGetQueryObjectuiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &queryAvailable);
+                available = queryAvailable != 0;
+            }
+            if (!available) // try again in a later frame, never block here
+                break;
+            QVector<quint64> timestamps(queryCount);
+            for (int i = 0; i < queryCount; ++i)
+                glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &timestamps[i]);
+            bool disjoint = false;
+            if (caps.timestampDisjoint) {
+                GLint gpuDisjoint = 0;
+                f->glGetIntegerv(GL_GPU_DISJOINT_EXT, &gpuDisjoint);
+                disjoint = gpuDisjoint != 0;
+            }
+            QGles2SwapChain *swapChainD = QRHI_RES(QGles2SwapChain, cmd.args.resolveTimestamps.swapChain);
+            const int frame = cmd.args.resolveTimestamps.frame;
+            const quint64 serial = cmd.args.resolveTimestamps.serial;
+            // the results are reported on the QRhi's thread, like readbacks
+            auto resolve = [this, swapChainD, frame, serial, disjoint, timestamps] {
+                resolveTimestamps(swapChainD, frame, serial, disjoint, timestamps);
+            };
+            if (deferredReadbackCallbacks)
+                deferredReadbackCallbacks->append(resolve);
+            else
+                resolve();
         }
             break;
         case QGles2CommandBuffer::Command::SubImage:
             f->glBindTexture(cmd.args.subImage.target, cmd.args.subImage.texture);
-            f->glTexSubImage2D(cmd.args.subImage.faceTarget, cmd.args.subImage.level,
-                               cmd.args.subImage.dx, cmd.args.subImage.dy,
-                               cmd.args.subImage.w, cmd.args.subImage.h,
-                               cmd.args.subImage.glformat, cmd.args.subImage.gltype,
-                               cmd.args.subImage.data);
+            for (int i = 0; i < cmd.args.subImage.regionCount; ++i) {
+                const QGles2CommandBuffer::Command::SubImageRegion &r(cmd.args.subImage.regions[i]);
+                if (isLayeredTarget(r.faceTarget)) {
+                    f->glTexSubImage3D(r.faceTarget, r.level, r.dx, r.dy, r.dz, r.w, r.h, 1,
+                                       cmd.args.subImage.glformat, cmd.args.subImage.gltype, r.data);
+                } else {
+                    f->glTexSubImage2D(r.faceTarget, r.level, r.dx, r.dy, r.w, r.h,
+                                       cmd.args.subImage.glformat, cmd.args.subImage.gltype, r.data);
+                }
+            }
             break;
         case QGles2CommandBuffer::Command::CompressedImage:
             f->glBindTexture(cmd.args.compressedImage.target, cmd.args.compressedImage.texture);
@@ -1578,11 +2723,20 @@ void QRhiGles2::executeCommandBuffer(QRhiCommandBuffer *cb)
             break;
         case QGles2CommandBuffer::Command::CompressedSubImage:
             f->glBindTexture(cmd.args.compressedSubImage.target, cmd.args.compressedSubImage.texture);
-            f->glCompressedTexSubImage2D(cmd.args.compressedSubImage.faceTarget, cmd.args.compressedSubImage.level,
-                                         cmd.args.compressedSubImage.dx, cmd.args.compressedSubImage.dy,
-                                         cmd.args.compressedSubImage.w, cmd.args.compressedSubImage.h,
-                                         cmd.args.compressedSubImage.glintformat,
-                                         cmd.args.compressedSubImage.size, cmd.args.compressedSubImage.data);
+            if (isLayeredTarget(cmd.args.compressedSubImage.faceTarget)) {
+                f->glCompressedTexSubImage3D(cmd.args.compressedSubImage.faceTarget, cmd.args.compressedSubImage.level,
+                                             cmd.args.compressedSubImage.dx, cmd.args.compressedSubImage.dy,
+                                             cmd.args.compressedSubImage.dz,
+                                             cmd.args.compressedSubImage.w, cmd.args.compressedSubImage.h, 1,
+                                             cmd.args.compressedSubImage.glintformat,
+                                             cmd.args.compressedSubImage.size, cmd.args.compressedSubImage.data);
+            } else {
+                f->glCompressedTexSubImage2D(cmd.args.compressedSubImage.faceTarget, cmd.args.compressedSubImage.level,
+                                             cmd.args.compressedSubImage.dx, cmd.args.compressedSubImage.dy,
+                                             cmd.args.compressedSubImage.w, cmd.args.compressedSubImage.h,
+                                             cmd.args.compressedSubImage.glintformat,
+                                             cmd.args.compressedSubImage.size, cmd.args.compressedSubImage.data);
+            }
             break;
         case QGles2CommandBuffer::Command::BlitFromRenderbuffer:
         {
@@ -1593,8 +2747,13 @@ void QRhiGles2::executeCommandBuffer(QRhiCommandBuffer *cb)
                                          GL_RENDERBUFFER, cmd.args.blitFromRb.renderbuffer);
             f->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo[1]);
 
-            f->glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, cmd.args.blitFromRb.target,
-                                      cmd.args.blitFromRb.texture, cmd.args.blitFromRb.dstLevel);
+            if (isLayeredTarget(cmd.args.blitFromRb.target)) {
+                f->glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, cmd.args.blitFromRb.texture,
+                                             cmd.args.blitFromRb.dstLevel, cmd.args.blitFromRb.dstLayer);
+            } else {
+                f->glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, cmd.args.blitFromRb.target,
+                                          cmd.args.blitFromRb.texture, cmd.args.blitFromRb.dstLevel);
+            }
             f->glBlitFramebuffer(0, 0, cmd.args.blitFromRb.w, cmd.args.blitFromRb.h,
                                  0, 0, cmd.args.blitFromRb.w, cmd.args.blitFromRb.h,
                                  GL_COLOR_BUFFER_BIT,
@@ -1606,6 +2765,14 @@ void QRhiGles2::executeCommandBuffer(QRhiCommandBuffer *cb)
             f->glBindTexture(cmd.args.genMip.target, cmd.args.genMip.texture);
             f->glGenerateMipmap(cmd.args.genMip.target);
             break;
+        case QGles2CommandBuffer::Command::UniformBufferSubData:
+        {
+            QGles2Buffer *bufD = QRHI_RES(QGles2Buffer, cmd.args.uniformBufferSubData.buf);
+            memcpy(bufD->ubuf.data() + cmd.args.uniformBufferSubData.offset,
+                   cmd.args.uniformBufferSubData.data,
+                   cmd.args.uniformBufferSubData.size);
+        }
+            break;
         default:
             break;
         }
@@ -1677,10 +2844,91 @@ void QRhiGles2::executeBindGraphicsPipeline(QRhiGraphicsPipeline *ps)
     f->glUseProgram(psD->program);
 }
 
-void QRhiGles2::setChangedUniforms(QRhiGraphicsPipeline *ps, QRhiShaderResourceBindings *srb,
+void QRhiGles2::setUniformValue(const QGles2UniformDescription &uniform)
+{
+    switch (uniform.type) {
+    case QShaderDescription::Float:
+        f->glUniform1f(uniform.glslLocation, *reinterpret_cast<const float *>(uniform.data.constData()));
+        break;
+    case QShaderDescription::Vec2:
+        f->glUniform2fv(uniform.glslLocation, 1, reinterpret_cast<const float *>(uniform.data.constData()));
+        break;
+    case QShaderDescription::Vec3:
+        f->glUniform3fv(uniform.glslLocation, 1, reinterpret_cast<const float *>(uniform.data.constData()));
+        break;
+    case QShaderDescription::Vec4:
+        f->glUniform4fv(uniform.glslLocation, 1, reinterpret_cast<const float *>(uniform.data.constData()));
+        break;
+    case QShaderDescription::Mat2:
+        f->glUniformMatrix2fv(uniform.glslLocation, 1, GL_FALSE, reinterpret_cast<const float *>(uniform.data.constData()));
+        break;
+    case QShaderDescription::Mat3:
+        f->glUniformMatrix3fv(uniform.glslLocation, 1, GL_FALSE, reinterpret_cast<const float *>(uniform.data.constData()));
+        break;
+    case QShaderDescription::Mat4:
+        f->glUniformMatrix4fv(uniform.glslLocation, 1, GL_FALSE, reinterpret_cast<const float *>(uniform.data.constData()));
+        break;
+    case QShaderDescription::Int:
+        f->glUniform1i(uniform.glslLocation, *reinterpret_cast<const qint32 *>(uniform.data.constData()));
+        break;
+    case QShaderDescription::Int2:
+        f->glUniform2iv(uniform.glslLocation, 1, reinterpret_cast<const qint32 *>(uniform.data.constData()));
+        break;
+    case QShaderDescription::Int3:
+        f->glUniform3iv(uniform.glslLocation, 1, reinterpret_cast<const qint32 *>(uniform.data.constData()));
+        break;
+    case QShaderDescription::Int4:
+        f->glUniform4iv(uniform.glslLocation, 1, reinterpret_cast<const qint32 *>(uniform.data.constData()));
+        break;
+    // ### more types
+    default:
+        break;
+    }
+}
+
+void QRhiGles2::executeSetPushConstants(QRhiGraphicsPipeline *maybeGraphicsPs, QRhiComputePipeline *maybeComputePs,
+                                        quint32 offset, quint32 size, const void *data)
+{
+    QVector<QGles2UniformDescription> *pushConstants;
+    if (maybeGraphicsPs) {
+        pushConstants = &QRHI_RES(QGles2GraphicsPipeline, maybeGraphicsPs)->pushConstants;
+    } else if (maybeComputePs) {
+        pushConstants = &QRHI_RES(QGles2ComputePipeline, maybeComputePs)->pushConstants;
+    } else {
+        qWarning("No pipeline active for setPushConstants; ignored");
+        return;
+    }
+
+    // The members keep their last values, so a partial update of a member
+    // merges with what was set before.
+    const char *src = static_cast<const char *>(data);
+    const quint32 end = offset + size;
+    for (QGles2UniformDescription &pc : *pushConstants) {
+        const quint32 pcEnd = pc.offset + uint(pc.data.size());
+        if (pc.offset >= end || pcEnd <= offset)
+            continue;
+        const quint32 from = qMax(offset, pc.offset);
+        const quint32 to = qMin(end, pcEnd);
+        memcpy(pc.data.data() + (from - pc.offset), src + (from - offset), to - from);
+        setUniformValue(pc);
+    }
+}
+
+void QRhiGles2::setChangedUniforms(QRhiGraphicsPipeline *maybeGraphicsPs, QRhiComputePipeline *maybeComputePs,
+                                   QRhiShaderResourceBindings *srb,
                                    const uint *dynOfsPairs, int dynOfsCount)
 {
-    QGles2GraphicsPipeline *psD = QRHI_RES(QGles2GraphicsPipeline, ps);
+    QVector<QGles2UniformDescription> *uniforms;
+    const QVector<QGles2SamplerDescription> *samplers;
+    if (maybeGraphicsPs) {
+        QGles2GraphicsPipeline *psD = QRHI_RES(QGles2GraphicsPipeline, maybeGraphicsPs);
+        uniforms = &psD->uniforms;
+        samplers = &psD->samplers;
+    } else {
+        QGles2ComputePipeline *psD = QRHI_RES(QGles2ComputePipeline, maybeComputePs);
+        uniforms = &psD->uniforms;
+        samplers = &psD->samplers;
+    }
     QGles2ShaderResourceBindings *srbD = QRHI_RES(QGles2ShaderResourceBindings, srb);
 
     for (int i = 0, ie = srbD->m_bindings.count(); i != ie; ++i) {
@@ -1702,48 +2950,10 @@ void QRhiGles2::setChangedUniforms(QRhiGraphicsPipeline *ps, QRhiShaderResourceB
             QGles2Buffer *bufD = QRHI_RES(QGles2Buffer, b->u.ubuf.buf);
             const QByteArray bufView = QByteArray::fromRawData(bufD->ubuf.constData() + viewOffset,
                                                                b->u.ubuf.maybeSize ? b->u.ubuf.maybeSize : bufD->m_size);
-            for (QGles2GraphicsPipeline::Uniform &uniform : psD->uniforms) {
+            for (QGles2UniformDescription &uniform : *uniforms) {
                 if (uniform.binding == b->binding) {
                     memcpy(uniform.data.data(), bufView.constData() + uniform.offset, uniform.data.size());
-
-                    switch (uniform.type) {
-                    case QShaderDescription::Float:
-                        f->glUniform1f(uniform.glslLocation, *reinterpret_cast<const float *>(uniform.data.constData()));
-                        break;
-                    case QShaderDescription::Vec2:
-                        f->glUniform2fv(uniform.glslLocation, 1, reinterpret_cast<const float *>(uniform.data.constData()));
-                        break;
-                    case QShaderDescription::Vec3:
-                        f->glUniform3fv(uniform.glslLocation, 1, reinterpret_cast<const float *>(uniform.data.constData()));
-                        break;
-                    case QShaderDescription::Vec4:
-                        f->glUniform4fv(uniform.glslLocation, 1, reinterpret_cast<const float *>(uniform.data.constData()));
-                        break;
-                    case QShaderDescription::Mat2:
-                        f->glUniformMatrix2fv(uniform.glslLocation, 1, GL_FALSE, reinterpret_cast<const float *>(uniform.data.constData()));
-                        break;
-                    case QShaderDescription::Mat3:
-                        f->glUniformMatrix3fv(uniform.glslLocation, 1, GL_FALSE, reinterpret_cast<const float *>(uniform.data.constData()));
-                        break;
-                    case QShaderDescription::Mat4:
-                        f->glUniformMatrix4fv(uniform.glslLocation, 1, GL_FALSE, reinterpret_cast<const float *>(uniform.data.constData()));
-                        break;
-                    case QShaderDescription::Int:
-                        f->glUniform1i(uniform.glslLocation, *reinterpret_cast<const qint32 *>(uniform.data.constData()));
-                        break;
-                    case QShaderDescription::Int2:
-                        f->glUniform2iv(uniform.glslLocation, 1, reinterpret_cast<const qint32 *>(uniform.data.constData()));
-                        break;
-                    case QShaderDescription::Int3:
-                        f->glUniform3iv(uniform.glslLocation, 1, reinterpret_cast<const qint32 *>(uniform.data.constData()));
-                        break;
-                    case QShaderDescription::Int4:
-                        f->glUniform4iv(uniform.glslLocation, 1, reinterpret_cast<const qint32 *>(uniform.data.constData()));
-                        break;
-                    // ### more types
-                    default:
-                        break;
-                    }
+                    setUniformValue(uniform);
                 }
             }
         }
@@ -1763,13 +2973,16 @@ void QRhiGles2::setChangedUniforms(QRhiGraphicsPipeline *ps, QRhiShaderResourceB
                 bd.stex.samplerGeneration = samplerD->generation;
             }
 
-            int texUnit = 0;
-            for (QGles2GraphicsPipeline::Sampler &sampler : psD->samplers) {
+            bool changedUnit = false;
+            for (const QGles2SamplerDescription &sampler : *samplers) {
                 if (sampler.binding == b->binding) {
-                    f->glActiveTexture(GL_TEXTURE0 + texUnit);
+                    f->glActiveTexture(GL_TEXTURE0 + sampler.texUnit);
                     f->glBindTexture(texD->target, texD->texture);
 
-                    if (textureChanged || samplerChanged) {
+                    if (caps.samplerObjects) {
+                        // the sampler uniform already refers to texUnit, see gatherSamplers()
+                        f->glBindSampler(sampler.texUnit, samplerD->samplerObject);
+                    } else if (textureChanged || samplerChanged) {
                         f->glTexParameteri(texD->target, GL_TEXTURE_MIN_FILTER, samplerD->glminfilter);
                         f->glTexParameteri(texD->target, GL_TEXTURE_MAG_FILTER, samplerD->glmagfilter);
                         f->glTexParameteri(texD->target, GL_TEXTURE_WRAP_S, samplerD->glwraps);
@@ -1777,14 +2990,50 @@ void QRhiGles2::setChangedUniforms(QRhiGraphicsPipeline *ps, QRhiShaderResourceB
                         f->glTexParameteri(texD->target, GL_TEXTURE_WRAP_R, samplerD->glwrapr);
                     }
 
-                    f->glUniform1i(sampler.glslLocation, texUnit);
-                    ++texUnit;
+                    changedUnit = true;
                 }
             }
-            if (texUnit)
+            if (changedUnit)
                 f->glActiveTexture(GL_TEXTURE0);
         }
             break;
+        case QRhiShaderResourceBinding::ImageLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageLoadStore:
+        {
+            QGles2Texture *texD = QRHI_RES(QGles2Texture, b->u.simage.tex);
+            if (!isImageLoadStoreFormat(texD->m_format, caps.gles)) {
+                qWarning("Texture format %d cannot be used with image load/store", texD->m_format);
+                break;
+            }
+            const bool layered = texD->m_flags.testFlag(QRhiTexture::CubeMap) || isLayeredTarget(texD->target);
+            GLenum access = GL_READ_WRITE;
+            if (b->type == QRhiShaderResourceBinding::ImageLoad)
+                access = GL_READ_ONLY;
+            else if (b->type == QRhiShaderResourceBinding::ImageStore)
+                access = GL_WRITE_ONLY;
+            // the image unit is the binding point, as specified in the shader
+            f->glBindImageTexture(GLuint(b->binding), texD->texture,
+                                  b->u.simage.level, layered, 0,
+                                  access, texD->glsizedintformat);
+        }
+            break;
+        case QRhiShaderResourceBinding::BufferLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferLoadStore:
+        {
+            QGles2Buffer *bufD = QRHI_RES(QGles2Buffer, b->u.sbuf.buf);
+            if (b->u.sbuf.offset == 0 && b->u.sbuf.maybeSize == 0)
+                f->glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GLuint(b->binding), bufD->buffer);
+            else
+                f->glBindBufferRange(GL_SHADER_STORAGE_BUFFER, GLuint(b->binding), bufD->buffer,
+                                     b->u.sbuf.offset, b->u.sbuf.maybeSize ? b->u.sbuf.maybeSize : bufD->m_size);
+        }
+            break;
         default:
             Q_UNREACHABLE();
             break;
@@ -1794,7 +3043,7 @@ void QRhiGles2::setChangedUniforms(QRhiGraphicsPipeline *ps, QRhiShaderResourceB
 
 void QRhiGles2::resourceUpdate(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
 {
-    Q_ASSERT(inFrame && !inPass);
+    Q_ASSERT(inFrame && !inPass && !inComputePass);
 
     enqueueResourceUpdates(cb, resourceUpdates);
 }
@@ -1805,7 +3054,7 @@ void QRhiGles2::beginPass(QRhiCommandBuffer *cb,
                           const QRhiDepthStencilClearValue &depthStencilClearValue,
                           QRhiResourceUpdateBatch *resourceUpdates)
 {
-    Q_ASSERT(!inPass);
+    Q_ASSERT(!inPass && !inComputePass);
 
     if (resourceUpdates)
         enqueueResourceUpdates(cb, resourceUpdates);
@@ -1814,8 +3063,7 @@ void QRhiGles2::beginPass(QRhiCommandBuffer *cb,
     bool needsColorClear = true;
     bool needsDsClear = true;
     QGles2RenderTargetData *rtD = nullptr;
-    QGles2CommandBuffer::Command fbCmd;
-    fbCmd.cmd = QGles2CommandBuffer::Command::BindFramebuffer;
+    QGles2CommandBuffer::Command &fbCmd(cbD->commands.get(QGles2CommandBuffer::Command::BindFramebuffer));
     switch (rt->type()) {
     case QRhiRenderTarget::RtRef:
         rtD = &QRHI_RES(QGles2ReferenceRenderTarget, rt)->d;
@@ -1825,9 +3073,14 @@ void QRhiGles2::beginPass(QRhiCommandBuffer *cb,
     {
         QGles2TextureRenderTarget *rtTex = QRHI_RES(QGles2TextureRenderTarget, rt);
         rtD = &rtTex->d;
-        needsColorClear = !rtTex->m_flags.testFlag(QRhiTextureRenderTarget::PreserveColorContents);
-        needsDsClear = !rtTex->m_flags.testFlag(QRhiTextureRenderTarget::PreserveDepthStencilContents);
+        const QRhiColorAttachment::LoadOp colorOp = colorLoadOp(rtTex, rtTex->m_desc.colorAttachments().constFirst());
+        const QRhiColorAttachment::LoadOp dsOp = depthStencilLoadOp(rtTex);
+        needsColorClear = colorOp == QRhiColorAttachment::LoadOpClear;
+        needsDsClear = dsOp == QRhiColorAttachment::LoadOpClear;
         fbCmd.args.bindFramebuffer.fbo = rtTex->framebuffer;
+        invalidateAttachments(cbD, rtTex,
+                              colorOp == QRhiColorAttachment::LoadOpDontCare,
+                              rtD->attCount > 1 && dsOp == QRhiColorAttachment::LoadOpDontCare);
     }
         break;
     default:
@@ -1835,13 +3088,11 @@ void QRhiGles2::beginPass(QRhiCommandBuffer *cb,
         break;
     }
     fbCmd.args.bindFramebuffer.srgb = rtD->srgbUpdateAndBlend;
-    cbD->commands.append(fbCmd);
 
     cbD->currentTarget = rt;
 
     Q_ASSERT(rtD->attCount == 1 || rtD->attCount == 2);
-    QGles2CommandBuffer::Command clearCmd;
-    clearCmd.cmd = QGles2CommandBuffer::Command::Clear;
+    QGles2CommandBuffer::Command &clearCmd(cbD->commands.get(QGles2CommandBuffer::Command::Clear));
     clearCmd.args.clear.mask = 0;
     if (rtD->attCount > 0 && needsColorClear)
         clearCmd.args.clear.mask |= GL_COLOR_BUFFER_BIT;
@@ -1853,11 +3104,27 @@ void QRhiGles2::beginPass(QRhiCommandBuffer *cb,
     clearCmd.args.clear.d = depthStencilClearValue.depthClearValue();
     clearCmd.args.clear.s = depthStencilClearValue.stencilClearValue();
 
-    cbD->commands.append(clearCmd);
-
     inPass = true;
 }
 
+void QRhiGles2::invalidateAttachments(QGles2CommandBuffer *cbD, QGles2TextureRenderTarget *rtTex,
+                                      bool color, bool depthStencil)
+{
+    if (!caps.invalidateFramebuffer || (!color && !depthStencil))
+        return;
+
+    QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::InvalidateFramebuffer));
+    cmd.args.invalidateFramebuffer.fbo = rtTex->framebuffer;
+    int &n(cmd.args.invalidateFramebuffer.attCount);
+    n = 0;
+    if (color)
+        cmd.args.invalidateFramebuffer.att[n++] = GL_COLOR_ATTACHMENT0;
+    if (depthStencil) {
+        cmd.args.invalidateFramebuffer.att[n++] = GL_DEPTH_ATTACHMENT;
+        cmd.args.invalidateFramebuffer.att[n++] = GL_STENCIL_ATTACHMENT;
+    }
+}
+
 void QRhiGles2::endPass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
 {
     Q_ASSERT(inPass);
@@ -1877,18 +3144,23 @@ void QRhiGles2::endPass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resource
                 qWarning("Resolve source (%dx%d) and target (%dx%d) size does not match",
                          rbD->pixelSize().width(), rbD->pixelSize().height(), size.width(), size.height());
             }
-            QGles2CommandBuffer::Command cmd;
-            cmd.cmd = QGles2CommandBuffer::Command::BlitFromRenderbuffer;
+            QGles2CommandBuffer::Command &cmd(cbD->commands.get(QGles2CommandBuffer::Command::BlitFromRenderbuffer));
             cmd.args.blitFromRb.renderbuffer = rbD->renderbuffer;
             cmd.args.blitFromRb.w = size.width();
             cmd.args.blitFromRb.h = size.height();
             QGles2Texture *colorTexD = QRHI_RES(QGles2Texture, colorAtt.resolveTexture());
             const GLenum faceTargetBase = colorTexD->m_flags.testFlag(QRhiTexture::CubeMap) ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : colorTexD->target;
-            cmd.args.blitFromRb.target = faceTargetBase + colorAtt.resolveLayer();
+            const bool isLayered = isLayeredTarget(colorTexD->target);
+            cmd.args.blitFromRb.target = isLayered ? colorTexD->target : faceTargetBase + colorAtt.resolveLayer();
             cmd.args.blitFromRb.texture = colorTexD->texture;
             cmd.args.blitFromRb.dstLevel = colorAtt.resolveLevel();
-            cbD->commands.append(cmd);
+            cmd.args.blitFromRb.dstLayer = isLayered ? colorAtt.resolveLayer() : 0;
         }
+        // the multisample contents are not needed anymore once resolved
+        invalidateAttachments(cbD, rtTex,
+                              colorAtt.resolveTexture() || colorStoreOp(colorAtt) == QRhiColorAttachment::StoreOpDontCare,
+                              rtTex->d.attCount > 1
+                              && depthStencilStoreOp(rtTex) == QRhiColorAttachment::StoreOpDontCare);
     }
 
     cbD->currentTarget = nullptr;
@@ -1897,16 +3169,49 @@ void QRhiGles2::endPass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resource
         enqueueResourceUpdates(cb, resourceUpdates);
 }
 
-static void addToRshReleaseQueue(QRhiResourceSharingHostPrivate *rsh, const QRhiGles2::DeferredReleaseEntry &e)
+void QRhiGles2::beginComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
 {
-    QVector<QRhiGles2::DeferredReleaseEntry> *rshRelQueue =
-            static_cast<QVector<QRhiGles2::DeferredReleaseEntry> *>(rsh->d_gles2.releaseQueue);
-    if (!rshRelQueue) {
-        rshRelQueue = new QVector<QRhiGles2::DeferredReleaseEntry>;
-        rsh->d_gles2.releaseQueue = rshRelQueue;
-    }
-    rshRelQueue->append(e);
-}
+    Q_ASSERT(!inPass && !inComputePass);
+
+    if (resourceUpdates)
+        enqueueResourceUpdates(cb, resourceUpdates);
+
+    // glUseProgram is going to be called with a compute program, so the
+    // graphics pipeline and its uniforms need to be set again after the pass.
+    QGles2CommandBuffer *cbD = QRHI_RES(QGles2CommandBuffer, cb);
+    cbD->currentPipeline = nullptr;
+    cbD->currentPipelineGeneration = 0;
+    cbD->currentSrb = nullptr;
+    cbD->currentSrbGeneration = 0;
+
+    inComputePass = true;
+}
+
+void QRhiGles2::endComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
+{
+    Q_ASSERT(inComputePass);
+    inComputePass = false;
+
+    QGles2CommandBuffer *cbD = QRHI_RES(QGles2CommandBuffer, cb);
+    cbD->currentComputePipeline = nullptr;
+    cbD->currentComputePipelineGeneration = 0;
+    cbD->currentSrb = nullptr;
+    cbD->currentSrbGeneration = 0;
+
+    if (resourceUpdates)
+        enqueueResourceUpdates(cb, resourceUpdates);
+}
+
+static void addToRshReleaseQueue(QRhiResourceSharingHostPrivate *rsh, const QRhiGles2::DeferredReleaseEntry &e)
+{
+    QVector<QRhiGles2::DeferredReleaseEntry> *rshRelQueue =
+            static_cast<QVector<QRhiGles2::DeferredReleaseEntry> *>(rsh->d_gles2.releaseQueue);
+    if (!rshRelQueue) {
+        rshRelQueue = new QVector<QRhiGles2::DeferredReleaseEntry>;
+        rsh->d_gles2.releaseQueue = rshRelQueue;
+    }
+    rshRelQueue->append(e);
+}
 
 QGles2Buffer::QGles2Buffer(QRhiImplementation *rhi, Type type, UsageFlags usage, int size)
     : QRhiBuffer(rhi, type, usage, size)
@@ -1920,8 +3225,26 @@ bool QGles2Buffer::isShareable() const
 
 void QGles2Buffer::release()
 {
-    if (!buffer)
+    if (!buffer && ubuf.isEmpty())
+        return;
+
+    if (!m_orphanedWithRsh) {
+        // recorded commands may still be executing on the render thread
+        QRHI_RES_RHI(QRhiGles2);
+        rhiD->waitRenderThread();
+    }
+
+    if (!buffer) {
+        // uniform buffer, there is only the CPU-side copy
+        ubuf.clear();
+        if (!m_orphanedWithRsh) {
+            QRHI_RES_RHI(QRhiGles2);
+            QRHI_PROF;
+            QRHI_PROF_F(releaseBuffer(this));
+            rhiD->removeBufferMemory(this);
+        }
         return;
+    }
 
     QRhiGles2::DeferredReleaseEntry e;
     e.type = QRhiGles2::DeferredReleaseEntry::Buffer;
@@ -1935,6 +3258,7 @@ void QGles2Buffer::release()
         rhiD->releaseQueue.append(e);
         QRHI_PROF;
         QRHI_PROF_F(releaseBuffer(this));
+        rhiD->removeBufferMemory(this);
         rhiD->unregisterResource(this);
     } else {
         // associated rhi is already gone, queue the deferred release to the rsh instead
@@ -1947,22 +3271,38 @@ bool QGles2Buffer::build()
     if (!QRhiImplementation::orphanCheck(this))
         return false;
 
-    if (buffer)
+    if (buffer || !ubuf.isEmpty())
         release();
 
     QRHI_RES_RHI(QRhiGles2);
     QRHI_PROF;
 
-    if (m_usage.testFlag(QRhiBuffer::UniformBuffer)) {
+    if (m_usage.testFlag(QRhiBuffer::UniformBuffer) && !m_usage.testFlag(QRhiBuffer::StorageBuffer)) {
         // special since we do not support uniform blocks in this backend
+        rhiD->waitRenderThread();
         ubuf.resize(m_size);
         QRHI_PROF_F(newBuffer(this, m_size, 0, 1));
+        rhiD->addBufferMemory(this, m_size, 1);
         return true;
     }
 
     if (!rhiD->ensureContext())
         return false;
 
+    if (m_usage.testFlag(QRhiBuffer::StorageBuffer)) {
+        if (!rhiD->caps.compute) {
+            qWarning("Storage buffers are not supported");
+            return false;
+        }
+        target = GL_SHADER_STORAGE_BUFFER;
+    }
+    if (m_usage.testFlag(QRhiBuffer::IndirectBuffer)) {
+        if (!rhiD->caps.drawIndirect) {
+            qWarning("Indirect buffers are not supported");
+            return false;
+        }
+        target = GL_DRAW_INDIRECT_BUFFER;
+    }
     if (m_usage.testFlag(QRhiBuffer::VertexBuffer))
         target = GL_ARRAY_BUFFER;
     if (m_usage.testFlag(QRhiBuffer::IndexBuffer))
@@ -1973,6 +3313,7 @@ bool QGles2Buffer::build()
     rhiD->f->glBufferData(target, m_size, nullptr, m_type == Dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
 
     QRHI_PROF_F(newBuffer(this, m_size, 1, 0));
+    rhiD->addBufferMemory(this, m_size, 1);
     rhiD->registerResource(this);
     return true;
 }
@@ -1993,6 +3334,11 @@ void QGles2RenderBuffer::release()
     if (!renderbuffer)
         return;
 
+    if (!m_orphanedWithRsh) {
+        QRHI_RES_RHI(QRhiGles2);
+        rhiD->waitRenderThread();
+    }
+
     QRhiGles2::DeferredReleaseEntry e;
     e.type = QRhiGles2::DeferredReleaseEntry::RenderBuffer;
 
@@ -2005,6 +3351,7 @@ void QGles2RenderBuffer::release()
         rhiD->releaseQueue.append(e);
         QRHI_PROF;
         QRHI_PROF_F(releaseRenderBuffer(this));
+        rhiD->removeRenderBufferMemory(this);
         rhiD->unregisterResource(this);
     } else {
         // associated rhi is already gone, queue the deferred release to the rsh instead
@@ -2051,6 +3398,7 @@ bool QGles2RenderBuffer::build()
             rhiD->f->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8,
                                            m_pixelSize.width(), m_pixelSize.height());
         QRHI_PROF_F(newRenderBuffer(this, false, false, samples));
+        rhiD->addRenderBufferMemory(this, samples);
         break;
     case QRhiRenderBuffer::Color:
         if (rhiD->caps.msaaRenderBuffer)
@@ -2060,6 +3408,7 @@ bool QGles2RenderBuffer::build()
             rhiD->f->glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8,
                                            m_pixelSize.width(), m_pixelSize.height());
         QRHI_PROF_F(newRenderBuffer(this, false, false, samples));
+        rhiD->addRenderBufferMemory(this, samples);
         break;
     default:
         Q_UNREACHABLE();
@@ -2091,6 +3440,11 @@ void QGles2Texture::release()
     if (!texture)
         return;
 
+    if (!m_orphanedWithRsh) {
+        QRHI_RES_RHI(QRhiGles2);
+        rhiD->waitRenderThread();
+    }
+
     QRhiGles2::DeferredReleaseEntry e;
     e.type = QRhiGles2::DeferredReleaseEntry::Texture;
 
@@ -2106,6 +3460,7 @@ void QGles2Texture::release()
             rhiD->releaseQueue.append(e);
         QRHI_PROF;
         QRHI_PROF_F(releaseTexture(this));
+        rhiD->removeTextureMemory(this);
         rhiD->unregisterResource(this);
     } else {
         // associated rhi is already gone, queue the deferred release to the rsh instead
@@ -2136,10 +3491,36 @@ bool QGles2Texture::prepareBuild(QSize *adjustedSize)
         size = QSize(qNextPowerOfTwo(size.width()), qNextPowerOfTwo(size.height()));
 
     const bool isCube = m_flags.testFlag(CubeMap);
+    const bool is3D = m_flags.testFlag(ThreeDimensional);
+    const bool isArray = m_flags.testFlag(TextureArray);
     const bool hasMipMaps = m_flags.testFlag(MipMapped);
     const bool isCompressed = rhiD->isCompressedFormat(m_format);
 
-    target = isCube ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    if (int(isCube) + int(is3D) + int(isArray) > 1) {
+        qWarning("Texture cannot be more than one of cubemap, 3D, and array");
+        return false;
+    }
+    if (is3D && !rhiD->caps.texture3D) {
+        qWarning("3D textures are not supported");
+        return false;
+    }
+    if (is3D && hasMipMaps) {
+        qWarning("3D texture cannot have mipmaps");
+        return false;
+    }
+    if (isArray && (!rhiD->caps.textureArrays || layerCount() > rhiD->caps.maxTextureArraySize)) {
+        qWarning("Texture array with %d layers is not supported", layerCount());
+        return false;
+    }
+
+    if (isCube)
+        target = GL_TEXTURE_CUBE_MAP;
+    else if (is3D)
+        target = GL_TEXTURE_3D;
+    else if (isArray)
+        target = GL_TEXTURE_2D_ARRAY;
+    else
+        target = GL_TEXTURE_2D;
     mipLevelCount = hasMipMaps ? rhiD->q->mipLevelsForSize(size) : 1;
     gltype = GL_UNSIGNED_BYTE;
 
@@ -2149,34 +3530,83 @@ bool QGles2Texture::prepareBuild(QSize *adjustedSize)
             qWarning("Compressed format %d not mappable to GL compressed format", m_format);
             return false;
         }
+        glsizedintformat = glintformat;
         glformat = GL_RGBA;
     } else {
         switch (m_format) {
         case QRhiTexture::RGBA8:
             glintformat = GL_RGBA;
+            glsizedintformat = GL_RGBA8;
             glformat = GL_RGBA;
             break;
         case QRhiTexture::BGRA8:
             glintformat = rhiD->caps.bgraInternalFormat ? GL_BGRA : GL_RGBA;
+            // GL_BGRA8_EXT with glTexStorage2D would need EXT_texture_storage, skip it
+            glsizedintformat = rhiD->caps.bgraInternalFormat ? 0 : GL_RGBA8;
             glformat = GL_BGRA;
             break;
         case QRhiTexture::R16:
             glintformat = GL_R16;
+            glsizedintformat = GL_R16;
             glformat = GL_RED;
             gltype = GL_UNSIGNED_SHORT;
             break;
         case QRhiTexture::R8:
             glintformat = GL_R8;
+            glsizedintformat = GL_R8;
             glformat = GL_RED;
             break;
         case QRhiTexture::RED_OR_ALPHA8:
             // always alpha because we do not support core profile
             glintformat = GL_ALPHA;
+            glsizedintformat = 0; // no sized alpha format for glTexStorage2D in ES 3.0
             glformat = GL_ALPHA;
             break;
+        case QRhiTexture::RG8:
+            glintformat = GL_RG8;
+            glsizedintformat = GL_RG8;
+            glformat = GL_RG;
+            break;
+        case QRhiTexture::RG16:
+            glintformat = GL_RG16;
+            glsizedintformat = GL_RG16;
+            glformat = GL_RG;
+            gltype = GL_UNSIGNED_SHORT;
+            break;
+        case QRhiTexture::RGBA16F:
+            glintformat = GL_RGBA16F;
+            glsizedintformat = GL_RGBA16F;
+            glformat = GL_RGBA;
+            gltype = GL_HALF_FLOAT;
+            break;
+        case QRhiTexture::RGBA32F:
+            glintformat = GL_RGBA32F;
+            glsizedintformat = GL_RGBA32F;
+            glformat = GL_RGBA;
+            gltype = GL_FLOAT;
+            break;
+        case QRhiTexture::R16F:
+            glintformat = GL_R16F;
+            glsizedintformat = GL_R16F;
+            glformat = GL_RED;
+            gltype = GL_HALF_FLOAT;
+            break;
+        case QRhiTexture::R32F:
+            glintformat = GL_R32F;
+            glsizedintformat = GL_R32F;
+            glformat = GL_RED;
+            gltype = GL_FLOAT;
+            break;
+        case QRhiTexture::B10G11R11_UFLOAT:
+            glintformat = GL_R11F_G11F_B10F;
+            glsizedintformat = GL_R11F_G11F_B10F;
+            glformat = GL_RGB;
+            gltype = GL_UNSIGNED_INT_10F_11F_11F_REV;
+            break;
         default:
             Q_UNREACHABLE();
             glintformat = GL_RGBA;
+            glsizedintformat = GL_RGBA8;
             glformat = GL_RGBA;
             break;
         }
@@ -2198,9 +3628,36 @@ bool QGles2Texture::build()
     rhiD->f->glGenTextures(1, &texture);
 
     const bool isCube = m_flags.testFlag(CubeMap);
+    const bool isLayered = isLayeredTarget(target);
     const bool hasMipMaps = m_flags.testFlag(MipMapped);
     const bool isCompressed = rhiD->isCompressedFormat(m_format);
-    if (!isCompressed) {
+    if (rhiD->caps.texStorage && glsizedintformat) {
+        // Immutable storage: the entire mip chain (and all faces) is
+        // allocated at once, and the texture is always complete. Compressed
+        // textures do not need to wait for the data in this case.
+        rhiD->f->glBindTexture(target, texture);
+        if (isLayered)
+            rhiD->f->glTexStorage3D(target, mipLevelCount, glsizedintformat, size.width(), size.height(), layerCount());
+        else
+            rhiD->f->glTexStorage2D(target, mipLevelCount, glsizedintformat, size.width(), size.height());
+        specified = true;
+    } else if (isLayered) {
+        // Uploads always target a single layer or slice, so there is no
+        // deferred specification for compressed data.
+        if (isCompressed) {
+            qWarning("Compressed 3D and array textures need immutable texture storage");
+            rhiD->f->glDeleteTextures(1, &texture);
+            texture = 0;
+            return false;
+        }
+        rhiD->f->glBindTexture(target, texture);
+        for (int level = 0; level != mipLevelCount; ++level) {
+            const QSize mipSize = rhiD->q->sizeForMipLevel(level, size);
+            rhiD->f->glTexImage3D(target, level, glintformat, mipSize.width(), mipSize.height(), layerCount(), 0,
+                                  glformat, gltype, nullptr);
+        }
+        specified = true;
+    } else if (!isCompressed) {
         rhiD->f->glBindTexture(target, texture);
         if (hasMipMaps || isCube) {
             const GLenum faceTargetBase = isCube ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
@@ -2224,7 +3681,8 @@ bool QGles2Texture::build()
     }
 
     QRHI_PROF;
-    QRHI_PROF_F(newTexture(this, true, mipLevelCount, isCube ? 6 : 1, 1));
+    QRHI_PROF_F(newTexture(this, true, false, mipLevelCount, layerCount(), 1));
+    rhiD->addTextureMemory(this, mipLevelCount, layerCount(), 1);
 
     owns = true;
     nativeHandlesStruct.texture = texture;
@@ -2248,7 +3706,7 @@ bool QGles2Texture::buildFrom(const QRhiNativeHandles *src)
 
     QRHI_RES_RHI(QRhiGles2);
     QRHI_PROF;
-    QRHI_PROF_F(newTexture(this, false, mipLevelCount, m_flags.testFlag(CubeMap) ? 6 : 1, 1));
+    QRHI_PROF_F(newTexture(this, false, false, mipLevelCount, layerCount(), 1));
 
     owns = false;
     nativeHandlesStruct.texture = texture;
@@ -2276,12 +3734,41 @@ bool QGles2Sampler::isShareable() const
 
 void QGles2Sampler::release()
 {
-    // nothing to do here
+    if (!samplerObject)
+        return;
+
+    if (!m_orphanedWithRsh) {
+        QRHI_RES_RHI(QRhiGles2);
+        rhiD->waitRenderThread();
+    }
+
+    QRhiGles2::DeferredReleaseEntry e;
+    e.type = QRhiGles2::DeferredReleaseEntry::Sampler;
+
+    e.sampler.sampler = samplerObject;
+
+    samplerObject = 0;
+
+    if (!m_orphanedWithRsh) {
+        QRHI_RES_RHI(QRhiGles2);
+        rhiD->releaseQueue.append(e);
+        rhiD->unregisterResource(this);
+    } else {
+        // associated rhi is already gone, queue the deferred release to the rsh instead
+        addToRshReleaseQueue(m_orphanedWithRsh, e);
+    }
 }
 
 bool QGles2Sampler::build()
 {
-    // no backing GL object -> no orphanCheck() since it is never registered
+    if (!QRhiImplementation::orphanCheck(this))
+        return false;
+
+    if (samplerObject)
+        release();
+
+    QRHI_RES_RHI(QRhiGles2);
+    rhiD->waitRenderThread();
 
     glminfilter = toGlMinFilter(m_minFilter, m_mipmapMode);
     glmagfilter = toGlMagFilter(m_magFilter);
@@ -2289,6 +3776,22 @@ bool QGles2Sampler::build()
     glwrapt = toGlWrapMode(m_addressV);
     glwrapr = toGlWrapMode(m_addressW);
 
+    // Without sampler objects there is no backing GL object: the parameters
+    // are applied to the texture when binding.
+    if (rhiD->caps.samplerObjects) {
+        if (!rhiD->ensureContext())
+            return false;
+
+        rhiD->f->glGenSamplers(1, &samplerObject);
+        rhiD->f->glSamplerParameteri(samplerObject, GL_TEXTURE_MIN_FILTER, GLint(glminfilter));
+        rhiD->f->glSamplerParameteri(samplerObject, GL_TEXTURE_MAG_FILTER, GLint(glmagfilter));
+        rhiD->f->glSamplerParameteri(samplerObject, GL_TEXTURE_WRAP_S, GLint(glwraps));
+        rhiD->f->glSamplerParameteri(samplerObject, GL_TEXTURE_WRAP_T, GLint(glwrapt));
+        rhiD->f->glSamplerParameteri(samplerObject, GL_TEXTURE_WRAP_R, GLint(glwrapr));
+
+        rhiD->registerResource(this);
+    }
+
     generation += 1;
     return true;
 }
@@ -2343,6 +3846,9 @@ void QGles2TextureRenderTarget::release()
     if (!framebuffer)
         return;
 
+    QRHI_RES_RHI(QRhiGles2);
+    rhiD->waitRenderThread();
+
     QRhiGles2::DeferredReleaseEntry e;
     e.type = QRhiGles2::DeferredReleaseEntry::TextureRenderTarget;
 
@@ -2350,7 +3856,6 @@ void QGles2TextureRenderTarget::release()
 
     framebuffer = 0;
 
-    QRHI_RES_RHI(QRhiGles2);
     rhiD->releaseQueue.append(e);
 
     rhiD->unregisterResource(this);
@@ -2394,8 +3899,12 @@ bool QGles2TextureRenderTarget::build()
     if (texture) {
         QGles2Texture *texD = QRHI_RES(QGles2Texture, texture);
         Q_ASSERT(texD->texture && texD->specified);
-        const GLenum faceTargetBase = texD->flags().testFlag(QRhiTexture::CubeMap) ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : texD->target;
-        rhiD->f->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, faceTargetBase + colorAtt.layer(), texD->texture, colorAtt.level());
+        if (isLayeredTarget(texD->target)) {
+            rhiD->f->glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texD->texture, colorAtt.level(), colorAtt.layer());
+        } else {
+            const GLenum faceTargetBase = texD->flags().testFlag(QRhiTexture::CubeMap) ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : texD->target;
+            rhiD->f->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, faceTargetBase + colorAtt.layer(), texD->texture, colorAtt.level());
+        }
         d.pixelSize = texD->pixelSize();
     } else {
         QGles2RenderBuffer *rbD = QRHI_RES(QGles2RenderBuffer, renderBuffer);
@@ -2443,11 +3952,16 @@ QGles2ShaderResourceBindings::QGles2ShaderResourceBindings(QRhiImplementation *r
 
 void QGles2ShaderResourceBindings::release()
 {
-    // nothing to do here
+    // boundResourceData is read when executing setShaderResources
+    QRHI_RES_RHI(QRhiGles2);
+    rhiD->waitRenderThread();
 }
 
 bool QGles2ShaderResourceBindings::build()
 {
+    QRHI_RES_RHI(QRhiGles2);
+    rhiD->waitRenderThread();
+
     boundResourceData.resize(m_bindings.count());
 
     for (int i = 0, ie = m_bindings.count(); i != ie; ++i) {
@@ -2464,6 +3978,19 @@ bool QGles2ShaderResourceBindings::build()
             bd.stex.samplerId = UINT_MAX;
             bd.stex.samplerGeneration = UINT_MAX;
             break;
+        case QRhiShaderResourceBinding::ImageLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageLoadStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferLoadStore:
+            // nothing, bound unconditionally
+            break;
         default:
             Q_UNREACHABLE();
             break;
@@ -2474,6 +4001,131 @@ bool QGles2ShaderResourceBindings::build()
     return true;
 }
 
+bool QRhiGles2::compileShader(GLuint program, GLenum shaderType, const QBakedShader &bakedShader,
+                              QBakedShaderKey::ShaderVariant shaderVariant)
+{
+    QBakedShaderVersion ver;
+    if (shaderType == GL_COMPUTE_SHADER) {
+        if (ctx->isOpenGLES())
+            ver = { 310, QBakedShaderVersion::GlslEs };
+        else
+            ver = { 430 };
+    } else {
+        if (ctx->isOpenGLES())
+            ver = { 100, QBakedShaderVersion::GlslEs };
+        else
+            ver = { 120 };
+    }
+    const QByteArray source = bakedShader.shader({ QBakedShaderKey::GlslShader, ver, shaderVariant }).shader();
+    if (source.isEmpty()) {
+        qWarning() << "No GLSL" << ver.version() << "shader code found in baked shader" << bakedShader;
+        return false;
+    }
+
+    GLuint shader = f->glCreateShader(shaderType);
+    const char *srcStr = source.constData();
+    const GLint srcLength = source.count();
+    f->glShaderSource(shader, 1, &srcStr, &srcLength);
+    f->glCompileShader(shader);
+    GLint compiled = 0;
+    f->glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        GLint infoLogLength = 0;
+        f->glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
+        QByteArray log;
+        if (infoLogLength > 1) {
+            GLsizei length = 0;
+            log.resize(infoLogLength);
+            f->glGetShaderInfoLog(shader, infoLogLength, &length, log.data());
+        }
+        qWarning("Failed to compile shader: %s\nSource was:\n%s", log.constData(), source.constData());
+        f->glDeleteShader(shader);
+        return false;
+    }
+
+    f->glAttachShader(program, shader);
+    f->glDeleteShader(shader);
+    return true;
+}
+
+bool QRhiGles2::linkProgram(GLuint program)
+{
+    f->glLinkProgram(program);
+    GLint linked = 0;
+    f->glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        GLint infoLogLength = 0;
+        f->glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
+        QByteArray log;
+        if (infoLogLength > 1) {
+            GLsizei length = 0;
+            log.resize(infoLogLength);
+            f->glGetProgramInfoLog(program, infoLogLength, &length, log.data());
+        }
+        qWarning("Failed to link shader program: %s", log.constData());
+        return false;
+    }
+    return true;
+}
+
+void QRhiGles2::gatherUniforms(GLuint program, const QShaderDescription::UniformBlock &ub,
+                               QVector<QGles2UniformDescription> *dst)
+{
+    const QByteArray prefix = ub.structName.toUtf8() + '.';
+    for (const QShaderDescription::BlockVariable &blockMember : ub.members) {
+        // ### no array support for now
+        QGles2UniformDescription uniform;
+        uniform.type = blockMember.type;
+        const QByteArray name = prefix + blockMember.name.toUtf8();
+        uniform.glslLocation = f->glGetUniformLocation(program, name.constData());
+        if (uniform.glslLocation >= 0) {
+            uniform.binding = ub.binding;
+            uniform.offset = blockMember.offset;
+            uniform.data.resize(blockMember.size);
+            dst->append(uniform);
+        }
+    }
+}
+
+void QRhiGles2::gatherSamplers(GLuint program, const QShaderDescription::InOutVariable &v,
+                               QVector<QGles2SamplerDescription> *dst)
+{
+    QGles2SamplerDescription sampler;
+    const QByteArray name = v.name.toUtf8();
+    sampler.glslLocation = f->glGetUniformLocation(program, name.constData());
+    if (sampler.glslLocation >= 0) {
+        sampler.binding = v.binding;
+        // Each sampler gets its own texture unit. The uniform is set once
+        // after linking, instead of whenever binding textures.
+        sampler.texUnit = dst->count();
+        dst->append(sampler);
+    }
+}
+
+void QRhiGles2::gatherPushConstants(GLuint program, const QShaderDescription::PushConstantBlock &pc,
+                                    QVector<QGles2UniformDescription> *dst)
+{
+    // push constant blocks are translated to a plain struct uniform
+    const QByteArray prefix = pc.name.toUtf8() + '.';
+    for (const QShaderDescription::BlockVariable &blockMember : pc.members) {
+        // ### no array support for now
+        QGles2UniformDescription uniform;
+        uniform.type = blockMember.type;
+        const QByteArray name = prefix + blockMember.name.toUtf8();
+        uniform.glslLocation = f->glGetUniformLocation(program, name.constData());
+        // the block is typically declared in more than one stage, gather it only once
+        const bool seen = std::find_if(dst->cbegin(), dst->cend(), [&uniform](const QGles2UniformDescription &u) {
+            return u.glslLocation == uniform.glslLocation;
+        }) != dst->cend();
+        if (uniform.glslLocation >= 0 && !seen) {
+            uniform.binding = -1;
+            uniform.offset = blockMember.offset;
+            uniform.data.fill('\0', blockMember.size);
+            dst->append(uniform);
+        }
+    }
+}
+
 QGles2GraphicsPipeline::QGles2GraphicsPipeline(QRhiImplementation *rhi)
     : QRhiGraphicsPipeline(rhi)
 {
@@ -2484,6 +4136,10 @@ void QGles2GraphicsPipeline::release()
     if (!program)
         return;
 
+    // uniforms and samplers are read when executing the draw calls
+    QRHI_RES_RHI(QRhiGles2);
+    rhiD->waitRenderThread();
+
     QRhiGles2::DeferredReleaseEntry e;
     e.type = QRhiGles2::DeferredReleaseEntry::Pipeline;
 
@@ -2491,9 +4147,10 @@ void QGles2GraphicsPipeline::release()
 
     program = 0;
     uniforms.clear();
+    pushConstants.clear();
+    pushConstantsSize = 0;
     samplers.clear();
 
-    QRHI_RES_RHI(QRhiGles2);
     rhiD->releaseQueue.append(e);
 
     rhiD->unregisterResource(this);
@@ -2519,40 +4176,13 @@ bool QGles2GraphicsPipeline::build()
         if (!isVertex && !isFragment)
             continue;
 
-        GLuint shader = rhiD->f->glCreateShader(isVertex ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER);
-        QBakedShaderVersion ver;
-        if (rhiD->ctx->isOpenGLES())
-            ver = { 100, QBakedShaderVersion::GlslEs };
-        else
-            ver = { 120 };
         const QBakedShader bakedShader = shaderStage.shader();
-        const QByteArray source = bakedShader.shader({ QBakedShaderKey::GlslShader, ver, shaderStage.shaderVariant() }).shader();
-        if (source.isEmpty()) {
-            qWarning() << "No GLSL" << ver.version() << "shader code found in baked shader" << bakedShader;
-            return false;
-        }
-        const char *srcStr = source.constData();
-        const GLint srcLength = source.count();
-        rhiD->f->glShaderSource(shader, 1, &srcStr, &srcLength);
-        rhiD->f->glCompileShader(shader);
-        GLint compiled = 0;
-        rhiD->f->glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
-        if (!compiled) {
-            GLint infoLogLength = 0;
-            rhiD->f->glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
-            QByteArray log;
-            if (infoLogLength > 1) {
-                GLsizei length = 0;
-                log.resize(infoLogLength);
-                rhiD->f->glGetShaderInfoLog(shader, infoLogLength, &length, log.data());
-            }
-            qWarning("Failed to compile shader: %s\nSource was:\n%s", log.constData(), source.constData());
+        if (!rhiD->compileShader(program, isVertex ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER,
+                                 bakedShader, shaderStage.shaderVariant()))
+        {
             return false;
         }
 
-        rhiD->f->glAttachShader(program, shader);
-        rhiD->f->glDeleteShader(shader);
-
         if (isVertex)
             vsDesc = bakedShader.description();
         else
@@ -2564,60 +4194,120 @@ bool QGles2GraphicsPipeline::build()
         rhiD->f->glBindAttribLocation(program, inVar.location, name.constData());
     }
 
-    rhiD->f->glLinkProgram(program);
-    GLint linked = 0;
-    rhiD->f->glGetProgramiv(program, GL_LINK_STATUS, &linked);
-    if (!linked) {
-        GLint infoLogLength = 0;
-        rhiD->f->glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
-        QByteArray log;
-        if (infoLogLength > 1) {
-            GLsizei length = 0;
-            log.resize(infoLogLength);
-            rhiD->f->glGetProgramInfoLog(program, infoLogLength, &length, log.data());
-        }
-        qWarning("Failed to link shader program: %s", log.constData());
+    if (!rhiD->linkProgram(program))
         return false;
-    }
-
-    auto lookupUniforms = [this, rhiD](const QShaderDescription::UniformBlock &ub) {
-        const QByteArray prefix = ub.structName.toUtf8() + '.';
-        for (const QShaderDescription::BlockVariable &blockMember : ub.members) {
-            // ### no array support for now
-            Uniform uniform;
-            uniform.type = blockMember.type;
-            const QByteArray name = prefix + blockMember.name.toUtf8();
-            uniform.glslLocation = rhiD->f->glGetUniformLocation(program, name.constData());
-            if (uniform.glslLocation >= 0) {
-                uniform.binding = ub.binding;
-                uniform.offset = blockMember.offset;
-                uniform.data.resize(blockMember.size);
-                uniforms.append(uniform);
-            }
-        }
-    };
 
     for (const QShaderDescription::UniformBlock &ub : vsDesc.uniformBlocks())
-        lookupUniforms(ub);
+        rhiD->gatherUniforms(program, ub, &uniforms);
 
     for (const QShaderDescription::UniformBlock &ub : fsDesc.uniformBlocks())
-        lookupUniforms(ub);
-
-    auto lookupSamplers = [this, rhiD](const QShaderDescription::InOutVariable &v) {
-        Sampler sampler;
-        const QByteArray name = v.name.toUtf8();
-        sampler.glslLocation = rhiD->f->glGetUniformLocation(program, name.constData());
-        if (sampler.glslLocation >= 0) {
-            sampler.binding = v.binding;
-            samplers.append(sampler);
-        }
-    };
+        rhiD->gatherUniforms(program, ub, &uniforms);
+
+    for (const QShaderDescription::PushConstantBlock &pc : vsDesc.pushConstantBlocks()) {
+        rhiD->gatherPushConstants(program, pc, &pushConstants);
+        pushConstantsSize = qMax(pushConstantsSize, quint32(pc.size));
+    }
+
+    for (const QShaderDescription::PushConstantBlock &pc : fsDesc.pushConstantBlocks()) {
+        rhiD->gatherPushConstants(program, pc, &pushConstants);
+        pushConstantsSize = qMax(pushConstantsSize, quint32(pc.size));
+    }
 
     for (const QShaderDescription::InOutVariable &v : vsDesc.combinedImageSamplers())
-        lookupSamplers(v);
+        rhiD->gatherSamplers(program, v, &samplers);
 
     for (const QShaderDescription::InOutVariable &v : fsDesc.combinedImageSamplers())
-        lookupSamplers(v);
+        rhiD->gatherSamplers(program, v, &samplers);
+
+    if (!samplers.isEmpty()) {
+        rhiD->f->glUseProgram(program);
+        for (const QGles2SamplerDescription &sampler : qAsConst(samplers))
+            rhiD->f->glUniform1i(sampler.glslLocation, sampler.texUnit);
+        rhiD->f->glUseProgram(0);
+    }
+
+    generation += 1;
+    rhiD->registerResource(this);
+    return true;
+}
+
+QGles2ComputePipeline::QGles2ComputePipeline(QRhiImplementation *rhi)
+    : QRhiComputePipeline(rhi)
+{
+}
+
+void QGles2ComputePipeline::release()
+{
+    if (!program)
+        return;
+
+    // uniforms and samplers are read when executing the draw calls
+    QRHI_RES_RHI(QRhiGles2);
+    rhiD->waitRenderThread();
+
+    QRhiGles2::DeferredReleaseEntry e;
+    e.type = QRhiGles2::DeferredReleaseEntry::Pipeline;
+
+    e.pipeline.program = program;
+
+    program = 0;
+    uniforms.clear();
+    pushConstants.clear();
+    pushConstantsSize = 0;
+    samplers.clear();
+
+    rhiD->releaseQueue.append(e);
+
+    rhiD->unregisterResource(this);
+}
+
+bool QGles2ComputePipeline::build()
+{
+    QRHI_RES_RHI(QRhiGles2);
+
+    if (program)
+        release();
+
+    if (!rhiD->ensureContext())
+        return false;
+
+    if (!rhiD->caps.compute) {
+        qWarning("Compute shaders are not supported");
+        return false;
+    }
+
+    if (m_shader.stage() != QBakedShader::ComputeStage) {
+        qWarning("Compute pipeline requires a compute shader, got stage %d", m_shader.stage());
+        return false;
+    }
+
+    program = rhiD->f->glCreateProgram();
+
+    if (!rhiD->compileShader(program, GL_COMPUTE_SHADER, m_shader, m_shaderVariant))
+        return false;
+
+    csDesc = m_shader.description();
+
+    if (!rhiD->linkProgram(program))
+        return false;
+
+    for (const QShaderDescription::UniformBlock &ub : csDesc.uniformBlocks())
+        rhiD->gatherUniforms(program, ub, &uniforms);
+
+    for (const QShaderDescription::PushConstantBlock &pc : csDesc.pushConstantBlocks()) {
+        rhiD->gatherPushConstants(program, pc, &pushConstants);
+        pushConstantsSize = qMax(pushConstantsSize, quint32(pc.size));
+    }
+
+    for (const QShaderDescription::InOutVariable &v : csDesc.combinedImageSamplers())
+        rhiD->gatherSamplers(program, v, &samplers);
+
+    if (!samplers.isEmpty()) {
+        rhiD->f->glUseProgram(program);
+        for (const QGles2SamplerDescription &sampler : qAsConst(samplers))
+            rhiD->f->glUniform1i(sampler.glslLocation, sampler.texUnit);
+        rhiD->f->glUseProgram(0);
+    }
 
     generation += 1;
     rhiD->registerResource(this);
@@ -2644,6 +4334,29 @@ QGles2SwapChain::QGles2SwapChain(QRhiImplementation *rhi)
 
 void QGles2SwapChain::release()
 {
+    // the surface may go away afterwards
+    QRHI_RES_RHI(QRhiGles2);
+    rhiD->waitRenderThread();
+    // timestamp results still waiting for delivery refer to this swapchain
+    if (rhiD->renderThread)
+        rhiD->renderThread->invokeReadbackCallbacks();
+
+    for (TimestampFrame &tf : timestampFrames) {
+        for (GLuint &query : tf.queries) {
+            if (query) {
+                QRhiGles2::DeferredReleaseEntry e;
+                e.type = QRhiGles2::DeferredReleaseEntry::Query;
+                e.query.query = query;
+                rhiD->releaseQueue.append(e);
+                query = 0;
+            }
+        }
+        tf.active = false;
+        tf.pending = false;
+        tf.markerSerial = 0;
+    }
+    currentTimestampFrame = 0;
+
     QRHI_PROF;
     QRHI_PROF_F(releaseSwapChain(this));
 }
@@ -2671,6 +4384,9 @@ QRhiRenderPassDescriptor *QGles2SwapChain::newCompatibleRenderPassDescriptor()
 
 bool QGles2SwapChain::buildOrResize()
 {
+    QRHI_RES_RHI(QRhiGles2);
+    rhiD->waitRenderThread();
+
     surface = m_window;
     m_currentPixelSize = surfacePixelSize();
     pixelSize = m_currentPixelSize;
@@ -2690,4 +4406,116 @@ bool QGles2SwapChain::buildOrResize()
     return true;
 }
 
+QGles2RenderThread::QGles2RenderThread(QRhiGles2 *rhi)
+    : rhiD(rhi),
+      rhiThread(QThread::currentThread())
+{
+}
+
+void QGles2RenderThread::submit(QGles2CommandBuffer *cbD, QSurface *surface, bool present)
+{
+    // only one frame in flight
+    waitIdle();
+    readyReadbacks += frame.completedReadbacks;
+    frame.completedReadbacks.clear();
+
+    // The previous frame's (reset) stream and (empty) pools go back to the
+    // command buffer, so the memory blocks get reused.
+    frame.commands.swap(cbD->commands);
+    frame.dataRetainPool.swap(cbD->dataRetainPool);
+    frame.imageRetainPool.swap(cbD->imageRetainPool);
+    frame.releaseQueue += rhiD->releaseQueue;
+    rhiD->releaseQueue.clear();
+    frame.surface = surface;
+    frame.present = present;
+
+    QOpenGLContext *ctx = rhiD->ctx;
+    if (QOpenGLContext::currentContext() == ctx)
+        ctx->doneCurrent();
+    ctx->moveToThread(this);
+    rhiD->needsMakeCurrent = true;
+
+    QMutexLocker lock(&mutex);
+    hasFrame = true;
+    cond.wakeOne();
+}
+
+void QGles2RenderThread::waitIdle()
+{
+    QMutexLocker lock(&mutex);
+    while (hasFrame)
+        cond.wait(&mutex);
+}
+
+void QGles2RenderThread::invokeReadbackCallbacks()
+{
+    mutex.lock();
+    if (!hasFrame) {
+        readyReadbacks += frame.completedReadbacks;
+        frame.completedReadbacks.clear();
+    }
+    mutex.unlock();
+
+    const QVector<std::function<void()>> readbacks = readyReadbacks;
+    readyReadbacks.clear();
+    for (const std::function<void()> &f : readbacks)
+        f();
+}
+
+void QGles2RenderThread::stop()
+{
+    mutex.lock();
+    quit = true;
+    cond.wakeOne();
+    mutex.unlock();
+    wait();
+}
+
+void QGles2RenderThread::run()
+{
+    QMutexLocker lock(&mutex);
+    for (;;) {
+        while (!hasFrame && !quit)
+            cond.wait(&mutex);
+        if (quit)
+            break;
+
+        lock.unlock();
+        executeFrame();
+        lock.relock();
+
+        hasFrame = false;
+        cond.wakeAll();
+    }
+}
+
+void QGles2RenderThread::executeFrame()
+{
+    QOpenGLContext *ctx = rhiD->ctx;
+    QSurface *surface = frame.surface;
+    if (!surface || (surface->surfaceClass() == QSurface::Window && !surface->surfaceHandle()))
+        surface = rhiD->fallbackSurface;
+
+    if (ctx->makeCurrent(surface)) {
+        rhiD->executeCommands(frame.commands, &frame.completedReadbacks);
+        // the window may have lost its native window since the frame was recorded
+        if (frame.present && surface == frame.surface)
+            ctx->swapBuffers(surface);
+        else
+            rhiD->f->glFlush();
+        rhiD->executeDeferredReleases(&frame.releaseQueue);
+        ctx->doneCurrent();
+    } else {
+        // the release queue is kept and retried with the next frame
+        qWarning("QRhiGles2: Failed to make context current on the render thread. Expect bad things to happen.");
+    }
+
+    // must happen on this thread since the context belongs to it now
+    ctx->moveToThread(rhiThread);
+
+    frame.commands.reset();
+    frame.dataRetainPool.clear();
+    frame.imageRetainPool.clear();
+}
+
 QT_END_NAMESPACE
@@ -49,6 +49,7 @@ struct Q_RHI_EXPORT QRhiGles2InitParams : public QRhiInitParams
 {
     QOffscreenSurface *fallbackSurface = nullptr;
     QWindow *window = nullptr;
+    bool threadedExecution = false;
 
     static QOffscreenSurface *newFallbackSurface();
 };
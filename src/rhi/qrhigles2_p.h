@@ -46,11 +46,15 @@
 #include <qopengl.h>
 #include <QSurface>
 #include <QShaderDescription>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
 
 QT_BEGIN_NAMESPACE
 
 class QOpenGLExtensions;
 class QRhiResourceSharingHostPrivate;
+class QGles2RenderThread;
 
 struct QGles2Buffer : public QRhiBuffer
 {
@@ -95,6 +99,7 @@ struct QGles2Texture : public QRhiTexture
     bool owns = true;
     GLenum target;
     GLenum glintformat;
+    GLenum glsizedintformat; // for glTexStorage2D, 0 if there is no suitable sized format
     GLenum glformat;
     GLenum gltype;
     bool specified = false;
@@ -118,6 +123,7 @@ struct QGles2Sampler : public QRhiSampler
     GLenum glwraps;
     GLenum glwrapt;
     GLenum glwrapr;
+    GLuint samplerObject = 0; // only when caps.samplerObjects
 
     uint generation = 0;
     friend class QRhiGles2;
@@ -193,6 +199,26 @@ struct QGles2ShaderResourceBindings : public QRhiShaderResourceBindings
 
 Q_DECLARE_TYPEINFO(QGles2ShaderResourceBindings::BoundResourceData, Q_MOVABLE_TYPE);
 
+struct QGles2UniformDescription
+{
+    QShaderDescription::VarType type;
+    int glslLocation;
+    int binding;
+    uint offset;
+    QByteArray data;
+};
+
+Q_DECLARE_TYPEINFO(QGles2UniformDescription, Q_MOVABLE_TYPE);
+
+struct QGles2SamplerDescription
+{
+    int glslLocation;
+    int binding;
+    int texUnit; // fixed for the lifetime of the program
+};
+
+Q_DECLARE_TYPEINFO(QGles2SamplerDescription, Q_MOVABLE_TYPE);
+
 struct QGles2GraphicsPipeline : public QRhiGraphicsPipeline
 {
     QGles2GraphicsPipeline(QRhiImplementation *rhi);
@@ -203,36 +229,37 @@ struct QGles2GraphicsPipeline : public QRhiGraphicsPipeline
     GLenum drawMode = GL_TRIANGLES;
     QShaderDescription vsDesc;
     QShaderDescription fsDesc;
+    QVector<QGles2UniformDescription> uniforms;
+    QVector<QGles2UniformDescription> pushConstants; // binding is unused
+    quint32 pushConstantsSize = 0; // largest block declared by the shaders
+    QVector<QGles2SamplerDescription> samplers;
+    uint generation = 0;
+    friend class QRhiGles2;
+};
 
-    struct Uniform {
-        QShaderDescription::VarType type;
-        int glslLocation;
-        int binding;
-        uint offset;
-        QByteArray data;
-    };
-    QVector<Uniform> uniforms;
-
-    struct Sampler {
-        int glslLocation;
-        int binding;
-    };
-    QVector<Sampler> samplers;
+struct QGles2ComputePipeline : public QRhiComputePipeline
+{
+    QGles2ComputePipeline(QRhiImplementation *rhi);
+    void release() override;
+    bool build() override;
 
+    GLuint program = 0;
+    QShaderDescription csDesc;
+    QVector<QGles2UniformDescription> uniforms;
+    QVector<QGles2UniformDescription> pushConstants; // binding is unused
+    quint32 pushConstantsSize = 0; // largest block declared by the shaders
+    QVector<QGles2SamplerDescription> samplers;
     uint generation = 0;
     friend class QRhiGles2;
 };
 
-Q_DECLARE_TYPEINFO(QGles2GraphicsPipeline::Uniform, Q_MOVABLE_TYPE);
-Q_DECLARE_TYPEINFO(QGles2GraphicsPipeline::Sampler, Q_MOVABLE_TYPE);
-
 struct QGles2CommandBuffer : public QRhiCommandBuffer
 {
     QGles2CommandBuffer(QRhiImplementation *rhi);
     void release() override;
 
     struct Command {
-        enum Cmd {
+        enum Cmd : quint32 {
             Viewport,
             Scissor,
             BlendConstants,
@@ -253,15 +280,35 @@ struct QGles2CommandBuffer : public QRhiCommandBuffer
             CompressedImage,
             CompressedSubImage,
             BlitFromRenderbuffer,
-            GenMip
+            GenMip,
+            UniformBufferSubData,
+            BindComputePipeline,
+            Dispatch,
+            DrawIndirect,
+            DrawIndexedIndirect,
+            PushConstants,
+            InvalidateFramebuffer,
+            GetBufferSubData,
+            QueryCounter,
+            ResolveTimestamps
         };
         Cmd cmd;
-
-        static const int MAX_UBUF_BINDINGS = 32; // should be more than enough
+        quint32 size; // size of the entire record in the CommandStream, including trailing data
+
+        struct SubImageRegion {
+            GLenum faceTarget;
+            int level;
+            int dx;
+            int dy;
+            int dz; // slice or array layer, for 3D and array textures only
+            int w;
+            int h;
+            const void *data; // must come from retainImage()
+        };
 
         // QRhi*/QGles2* references should be kept at minimum (so no
         // QRhiTexture/Buffer/etc. pointers).
-        union {
+        union Args {
             struct {
                 float x, y, w, h;
                 float d0, d1;
@@ -291,20 +338,27 @@ struct QGles2CommandBuffer : public QRhiCommandBuffer
                 QRhiGraphicsPipeline *ps;
                 quint32 vertexCount;
                 quint32 firstVertex;
+                quint32 instanceCount;
+                quint32 firstInstance;
             } draw;
             struct {
                 QRhiGraphicsPipeline *ps;
                 quint32 indexCount;
                 quint32 firstIndex;
+                quint32 instanceCount;
+                quint32 firstInstance;
             } drawIndexed;
             struct {
                 QRhiGraphicsPipeline *ps;
             } bindGraphicsPipeline;
             struct {
-                QRhiGraphicsPipeline *ps;
+                QRhiGraphicsPipeline *maybeGraphicsPs;
+                QRhiComputePipeline *maybeComputePs;
                 QRhiShaderResourceBindings *srb;
                 int dynamicOffsetCount;
-                uint dynamicOffsetPairs[MAX_UBUF_BINDINGS * 2]; // binding, offsetInConstants
+                // binding, offsetInConstants; the array continues past the
+                // end of the struct, with dynamicOffsetCount pairs in total
+                uint dynamicOffsetPairs[2];
             } bindShaderResources;
             struct {
                 GLbitfield mask;
@@ -316,6 +370,11 @@ struct QGles2CommandBuffer : public QRhiCommandBuffer
                 GLuint fbo;
                 bool srgb;
             } bindFramebuffer;
+            struct {
+                GLuint fbo;
+                int attCount;
+                GLenum att[3];
+            } invalidateFramebuffer;
             struct {
                 GLenum target;
                 GLuint buffer;
@@ -329,36 +388,49 @@ struct QGles2CommandBuffer : public QRhiCommandBuffer
                 int srcLevel;
                 int srcX;
                 int srcY;
+                int srcZ;
                 GLenum dstTarget;
                 GLuint dstTexture;
                 GLenum dstFaceTarget;
                 int dstLevel;
                 int dstX;
                 int dstY;
+                int dstZ;
                 int w;
                 int h;
             } copyTex;
             struct {
                 QRhiReadbackResult *result;
                 GLuint texture;
+                int x;
+                int y;
                 int w;
                 int h;
                 QRhiTexture::Format format;
                 GLenum readTarget;
                 int level;
+                int slice;
+                GLenum glformat;
+                GLenum gltype;
             } readPixels;
+            struct {
+                QRhiBufferReadbackResult *result;
+                QRhiBuffer *buf;
+                GLenum target;
+                GLuint buffer; // 0 for uniform buffers, read from ubuf then
+                int offset;
+                int size;
+                const void *data; // ubuf snapshot, when not using the render thread
+            } getBufferSubData;
             struct {
                 GLenum target;
                 GLuint texture;
-                GLenum faceTarget;
-                int level;
-                int dx;
-                int dy;
-                int w;
-                int h;
                 GLenum glformat;
                 GLenum gltype;
-                const void *data; // must come from retainImage()
+                // all levels and faces from one upload, the array continues
+                // past the end of the struct, with regionCount entries in total
+                int regionCount;
+                SubImageRegion regions[1];
             } subImage;
             struct {
                 GLenum target;
@@ -378,6 +450,7 @@ struct QGles2CommandBuffer : public QRhiCommandBuffer
                 int level;
                 int dx;
                 int dy;
+                int dz;
                 int w;
                 int h;
                 GLenum glintformat;
@@ -391,20 +464,245 @@ struct QGles2CommandBuffer : public QRhiCommandBuffer
                 GLenum target;
                 GLuint texture;
                 int dstLevel;
+                int dstLayer;
             } blitFromRb;
             struct {
                 GLenum target;
                 GLuint texture;
             } genMip;
+            struct {
+                QRhiBuffer *buf;
+                int offset;
+                int size;
+                const void *data; // must come from retainData()
+            } uniformBufferSubData;
+            struct {
+                QRhiComputePipeline *ps;
+            } bindComputePipeline;
+            struct {
+                GLuint x;
+                GLuint y;
+                GLuint z;
+                GLbitfield barriers;
+            } dispatch;
+            struct {
+                QRhiGraphicsPipeline *ps;
+                GLuint buffer;
+                quint32 offset;
+                quint32 drawCount;
+                quint32 stride;
+            } drawIndirect; // for both DrawIndirect and DrawIndexedIndirect
+            struct {
+                QRhiGraphicsPipeline *maybeGraphicsPs;
+                QRhiComputePipeline *maybeComputePs;
+                quint32 offset;
+                quint32 size;
+                // the array continues past the end of the struct, size bytes in total
+                quint32 data[1];
+            } pushConstants;
+            struct {
+                GLuint *query; // generated upon first use by the executing thread
+            } queryCounter;
+            struct {
+                QRhiSwapChain *swapChain;
+                const GLuint *queries;
+                int queryCount;
+                int frame;
+                quint64 serial;
+            } resolveTimestamps;
         } args;
+
+        static quint32 argsSize(Cmd cmd) {
+            switch (cmd) {
+            case Viewport:
+                return sizeof(Args::viewport);
+            case Scissor:
+                return sizeof(Args::scissor);
+            case BlendConstants:
+                return sizeof(Args::blendConstants);
+            case StencilRef:
+                return sizeof(Args::stencilRef);
+            case BindVertexBuffer:
+                return sizeof(Args::bindVertexBuffer);
+            case BindIndexBuffer:
+                return sizeof(Args::bindIndexBuffer);
+            case Draw:
+                return sizeof(Args::draw);
+            case DrawIndexed:
+                return sizeof(Args::drawIndexed);
+            case BindGraphicsPipeline:
+                return sizeof(Args::bindGraphicsPipeline);
+            case BindShaderResources:
+                return sizeof(Args::bindShaderResources);
+            case BindFramebuffer:
+                return sizeof(Args::bindFramebuffer);
+            case Clear:
+                return sizeof(Args::clear);
+            case BufferSubData:
+                return sizeof(Args::bufferSubData);
+            case CopyTex:
+                return sizeof(Args::copyTex);
+            case ReadPixels:
+                return sizeof(Args::readPixels);
+            case GetBufferSubData:
+                return sizeof(Args::getBufferSubData);
+            case SubImage:
+                return sizeof(Args::subImage);
+            case CompressedImage:
+                return sizeof(Args::compressedImage);
+            case CompressedSubImage:
+                return sizeof(Args::compressedSubImage);
+            case BlitFromRenderbuffer:
+                return sizeof(Args::blitFromRb);
+            case GenMip:
+                return sizeof(Args::genMip);
+            case UniformBufferSubData:
+                return sizeof(Args::uniformBufferSubData);
+            case BindComputePipeline:
+                return sizeof(Args::bindComputePipeline);
+            case Dispatch:
+                return sizeof(Args::dispatch);
+            case DrawIndirect:
+                Q_FALLTHROUGH();
+            case DrawIndexedIndirect:
+                return sizeof(Args::drawIndirect);
+            case PushConstants:
+                return sizeof(Args::pushConstants);
+            case QueryCounter:
+                return sizeof(Args::queryCounter);
+            case ResolveTimestamps:
+                return sizeof(Args::resolveTimestamps);
+            default:
+                return sizeof(Args);
+            }
+        }
     };
 
-    QVector<Command> commands;
+    // Commands are variable-length records (the header and only the args
+    // relevant for the given Cmd, plus trailing data where applicable) packed
+    // into fixed size blocks. The blocks are kept around and are reused in
+    // subsequent frames, so recording does not allocate in the steady state.
+    struct CommandStream {
+        static const int BLOCK_SIZE = 64 * 1024;
+
+        CommandStream() { }
+        ~CommandStream() { release(); }
+
+        struct Block {
+            char *data;
+            int used;
+            int capacity;
+        };
+
+        // The returned Command is only valid until the next reset(). Only
+        // args members matching cmd may be accessed, and extraSize bytes can
+        // be written after the end of the args.
+        Command &get(Command::Cmd cmd, int extraSize = 0) {
+            const int sz = int(offsetof(Command, args) + Command::argsSize(cmd) + extraSize + 7) & ~7;
+            if (currentBlock >= blocks.count() || blocks[currentBlock].used + sz > blocks[currentBlock].capacity)
+                nextBlock(sz);
+            Block &b(blocks[currentBlock]);
+            Command *c = reinterpret_cast<Command *>(b.data + b.used);
+            b.used += sz;
+            c->cmd = cmd;
+            c->size = quint32(sz);
+            return *c;
+        }
+
+        bool isEmpty() const {
+            return blocks.isEmpty() || blocks[0].used == 0;
+        }
+
+        void reset() {
+            for (Block &b : blocks)
+                b.used = 0;
+            currentBlock = 0;
+        }
+
+        void release() {
+            for (Block &b : blocks)
+                free(b.data);
+            blocks.clear();
+            currentBlock = 0;
+        }
+
+        void swap(CommandStream &other) {
+            blocks.swap(other.blocks);
+            qSwap(currentBlock, other.currentBlock);
+        }
+
+        void nextBlock(int minSize) {
+            while (currentBlock < blocks.count()) {
+                Block &b(blocks[currentBlock]);
+                if (b.used + minSize <= b.capacity)
+                    return;
+                if (b.used == 0) { // only when minSize > BLOCK_SIZE
+                    free(b.data);
+                    b.data = static_cast<char *>(malloc(size_t(minSize)));
+                    Q_CHECK_PTR(b.data);
+                    b.capacity = minSize;
+                    return;
+                }
+                ++currentBlock;
+            }
+            Block b;
+            b.capacity = qMax(int(BLOCK_SIZE), minSize);
+            b.data = static_cast<char *>(malloc(size_t(b.capacity)));
+            Q_CHECK_PTR(b.data);
+            b.used = 0;
+            blocks.append(b);
+        }
+
+        struct const_iterator {
+            const Block *b;
+            const Block *bEnd;
+            int pos;
+            const Command &operator*() const {
+                return *reinterpret_cast<const Command *>(b->data + pos);
+            }
+            const_iterator &operator++() {
+                pos += int((**this).size);
+                skipExhaustedBlocks();
+                return *this;
+            }
+            bool operator!=(const const_iterator &other) const {
+                return b != other.b || pos != other.pos;
+            }
+            void skipExhaustedBlocks() {
+                while (b != bEnd && pos >= b->used) {
+                    ++b;
+                    pos = 0;
+                }
+            }
+        };
+
+        const_iterator begin() const {
+            const Block *bEnd = blocks.constData() + qMin(currentBlock + 1, blocks.count());
+            const_iterator it = { blocks.constData(), bEnd, 0 };
+            it.skipExhaustedBlocks();
+            return it;
+        }
+        const_iterator end() const {
+            const Block *bEnd = blocks.constData() + qMin(currentBlock + 1, blocks.count());
+            return { bEnd, bEnd, 0 };
+        }
+
+        QVector<Block> blocks;
+        int currentBlock = 0;
+
+    private:
+        Q_DISABLE_COPY(CommandStream)
+    };
+
+    CommandStream commands;
     QRhiRenderTarget *currentTarget;
     QRhiGraphicsPipeline *currentPipeline;
     uint currentPipelineGeneration;
+    QRhiComputePipeline *currentComputePipeline;
+    uint currentComputePipelineGeneration;
     QRhiShaderResourceBindings *currentSrb;
     uint currentSrbGeneration;
+    quint32 currentIndexOffset;
 
     QVector<QByteArray> dataRetainPool;
     QVector<QImage> imageRetainPool;
@@ -419,7 +717,7 @@ struct QGles2CommandBuffer : public QRhiCommandBuffer
         return imageRetainPool.constLast().constBits();
     }
     void resetCommands() {
-        commands.clear();
+        commands.reset();
         dataRetainPool.clear();
         imageRetainPool.clear();
     }
@@ -428,12 +726,15 @@ struct QGles2CommandBuffer : public QRhiCommandBuffer
         currentTarget = nullptr;
         currentPipeline = nullptr;
         currentPipelineGeneration = 0;
+        currentComputePipeline = nullptr;
+        currentComputePipelineGeneration = 0;
         currentSrb = nullptr;
         currentSrbGeneration = 0;
+        currentIndexOffset = 0;
     }
 };
 
-Q_DECLARE_TYPEINFO(QGles2CommandBuffer::Command, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QGles2CommandBuffer::CommandStream::Block, Q_PRIMITIVE_TYPE);
 
 struct QGles2SwapChain : public QRhiSwapChain
 {
@@ -453,6 +754,32 @@ struct QGles2SwapChain : public QRhiSwapChain
     QGles2ReferenceRenderTarget rt;
     QGles2CommandBuffer cb;
     int frameCount = 0;
+
+    // GPU frame (and debug marker scope) timing, see QRhi::Timestamps. The
+    // results are polled in subsequent frames by the thread executing the
+    // commands, without waiting, and are reported on the QRhi's thread.
+    static const int TIMESTAMP_FRAMES = 4;
+    static const int MAX_TIMESTAMPS = 2 + 128; // frame start and end, then the markers
+    struct TimestampFrame {
+        struct Scope {
+            int scope;
+            int beginQuery;
+            int endQuery;
+        };
+        // only touched by the executing thread, apart from release()
+        GLuint queries[MAX_TIMESTAMPS] = {};
+        bool active = false;
+        bool pending = false;
+        bool markerTiming = false;
+        quint64 serial = 0;
+        int queryCount = 0;
+        int scopeCount = 0;
+        QVector<Scope> stack;
+        QVector<Scope> scopes;
+        quint64 markerSerial = 0;
+    };
+    TimestampFrame timestampFrames[TIMESTAMP_FRAMES];
+    int currentTimestampFrame = 0;
 };
 
 class QRhiGles2 : public QRhiImplementation
@@ -464,6 +791,7 @@ public:
     void destroy() override;
 
     QRhiGraphicsPipeline *createGraphicsPipeline() override;
+    QRhiComputePipeline *createComputePipeline() override;
     QRhiShaderResourceBindings *createShaderResourceBindings() override;
     QRhiBuffer *createBuffer(QRhiBuffer::Type type,
                              QRhiBuffer::UsageFlags usage,
@@ -499,8 +827,13 @@ public:
                    QRhiResourceUpdateBatch *resourceUpdates) override;
     void endPass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) override;
 
+    void beginComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) override;
+    void endComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) override;
+
     void setGraphicsPipeline(QRhiCommandBuffer *cb,
                              QRhiGraphicsPipeline *ps) override;
+    void setComputePipeline(QRhiCommandBuffer *cb,
+                            QRhiComputePipeline *ps) override;
 
     void setShaderResources(QRhiCommandBuffer *cb,
                             QRhiShaderResourceBindings *srb,
@@ -515,6 +848,8 @@ public:
     void setScissor(QRhiCommandBuffer *cb, const QRhiScissor &scissor) override;
     void setBlendConstants(QRhiCommandBuffer *cb, const QVector4D &c) override;
     void setStencilRef(QRhiCommandBuffer *cb, quint32 refValue) override;
+    void setPushConstants(QRhiCommandBuffer *cb, QRhiShaderResourceBinding::StageFlags stages,
+                          quint32 offset, quint32 size, const void *data) override;
 
     void draw(QRhiCommandBuffer *cb, quint32 vertexCount,
               quint32 instanceCount, quint32 firstVertex, quint32 firstInstance) override;
@@ -523,6 +858,13 @@ public:
                      quint32 instanceCount, quint32 firstIndex,
                      qint32 vertexOffset, quint32 firstInstance) override;
 
+    void drawIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                      quint32 indirectBufferOffset, quint32 drawCount, quint32 stride) override;
+    void drawIndexedIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                             quint32 indirectBufferOffset, quint32 drawCount, quint32 stride) override;
+
+    void dispatch(QRhiCommandBuffer *cb, int x, int y, int z) override;
+
     void debugMarkBegin(QRhiCommandBuffer *cb, const QByteArray &name) override;
     void debugMarkEnd(QRhiCommandBuffer *cb) override;
     void debugMarkMsg(QRhiCommandBuffer *cb, const QByteArray &msg) override;
@@ -533,17 +875,41 @@ public:
     bool isYUpInNDC() const override;
     QMatrix4x4 clipSpaceCorrMatrix() const override;
     bool isTextureFormatSupported(QRhiTexture::Format format, QRhiTexture::Flags flags) const override;
+    bool isVertexFormatSupported(QRhiVertexInputAttribute::Format format) const override;
     bool isFeatureSupported(QRhi::Feature feature) const override;
     int resourceSizeLimit(QRhi::ResourceSizeLimit limit) const override;
     const QRhiNativeHandles *nativeHandles() override;
 
     bool ensureContext(QSurface *surface = nullptr) const;
+    void waitRenderThread() const;
     void executeDeferredReleases();
     void enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates);
+    void invalidateAttachments(QGles2CommandBuffer *cbD, QGles2TextureRenderTarget *rtTex,
+                               bool color, bool depthStencil);
+    void beginFrameTimestamps(QGles2SwapChain *swapChainD);
+    void endFrameTimestamps(QGles2SwapChain *swapChainD);
+    void writeMarkerTimestamp(QGles2CommandBuffer *cbD, bool begin);
+    void resolveTimestamps(QGles2SwapChain *swapChainD, int frame, quint64 serial,
+                           bool disjoint, const QVector<quint64> &timestamps);
     void executeCommandBuffer(QRhiCommandBuffer *cb);
+    void executeCommands(const QGles2CommandBuffer::CommandStream &commands,
+                         QVector<std::function<void()>> *deferredReadbackCallbacks = nullptr);
     void executeBindGraphicsPipeline(QRhiGraphicsPipeline *ps);
-    void setChangedUniforms(QRhiGraphicsPipeline *ps, QRhiShaderResourceBindings *srb,
+    void setChangedUniforms(QRhiGraphicsPipeline *maybeGraphicsPs, QRhiComputePipeline *maybeComputePs,
+                            QRhiShaderResourceBindings *srb,
                             const uint *dynOfsPairs, int dynOfsCount);
+    void setUniformValue(const QGles2UniformDescription &uniform);
+    void executeSetPushConstants(QRhiGraphicsPipeline *maybeGraphicsPs, QRhiComputePipeline *maybeComputePs,
+                                 quint32 offset, quint32 size, const void *data);
+    bool compileShader(GLuint program, GLenum shaderType, const QBakedShader &bakedShader,
+                       QBakedShaderKey::ShaderVariant shaderVariant);
+    bool linkProgram(GLuint program);
+    void gatherUniforms(GLuint program, const QShaderDescription::UniformBlock &ub,
+                        QVector<QGles2UniformDescription> *dst);
+    void gatherSamplers(GLuint program, const QShaderDescription::InOutVariable &v,
+                        QVector<QGles2SamplerDescription> *dst);
+    void gatherPushConstants(GLuint program, const QShaderDescription::PushConstantBlock &pc,
+                             QVector<QGles2UniformDescription> *dst);
 
     QOpenGLContext *ctx = nullptr;
     bool importedContext = false;
@@ -562,9 +928,28 @@ public:
               bgraInternalFormat(false),
               r8Format(false),
               r16Format(false),
-              srgbCapableDefaultFramebuffer(false)
+              srgbCapableDefaultFramebuffer(false),
+              samplerObjects(false),
+              instancing(false),
+              baseInstance(false),
+              texStorage(false),
+              compute(false),
+              gles(false),
+              drawIndirect(false),
+              multiDrawIndirect(false),
+              texture3D(false),
+              textureArrays(false),
+              halfAttributes(false),
+              intAttributes(false),
+              packedAttributes(false),
+              floatFormats(false),
+              invalidateFramebuffer(false),
+              mapBufferRead(false),
+              timestamps(false),
+              timestampDisjoint(false)
         { }
         int maxTextureSize;
+        int maxTextureArraySize = 0;
         // Multisample fb and blit are supported (GLES 3.0 or OpenGL 3.x). Not
         // the same as multisample textures!
         uint msaaRenderBuffer : 1;
@@ -576,10 +961,60 @@ public:
         uint r8Format : 1;
         uint r16Format : 1;
         uint srgbCapableDefaultFramebuffer : 1;
+        uint samplerObjects : 1;
+        uint instancing : 1;
+        uint baseInstance : 1;
+        uint texStorage : 1;
+        uint compute : 1;
+        uint gles : 1;
+        uint drawIndirect : 1;
+        uint multiDrawIndirect : 1;
+        uint texture3D : 1;
+        uint textureArrays : 1;
+        uint halfAttributes : 1;
+        uint intAttributes : 1; // glVertexAttribIPointer
+        uint packedAttributes : 1; // 2_10_10_10_REV
+        uint floatFormats : 1;
+        uint invalidateFramebuffer : 1;
+        uint mapBufferRead : 1;
+        uint timestamps : 1;
+        uint timestampDisjoint : 1; // GL_EXT_disjoint_timer_query
     } caps;
+    // core or ARB/EXT/ANGLE suffixed, resolved manually, set when caps.instancing is
+    void (QOPENGLF_APIENTRYP glDrawArraysInstanced)(GLenum mode, GLint first, GLsizei count,
+                                                     GLsizei instancecount) = nullptr;
+    void (QOPENGLF_APIENTRYP glDrawElementsInstanced)(GLenum mode, GLsizei count, GLenum type,
+                                                       const void *indices, GLsizei instancecount) = nullptr;
+    void (QOPENGLF_APIENTRYP glVertexAttribDivisor)(GLuint index, GLuint divisor) = nullptr;
+    // OpenGL 4.2, ARB_base_instance or EXT_base_instance, set when caps.baseInstance is
+    void (QOPENGLF_APIENTRYP glDrawArraysInstancedBaseInstance)(GLenum mode, GLint first, GLsizei count,
+                                                                 GLsizei instancecount, GLuint baseinstance) = nullptr;
+    void (QOPENGLF_APIENTRYP glDrawElementsInstancedBaseInstance)(GLenum mode, GLsizei count, GLenum type,
+                                                                   const void *indices, GLsizei instancecount,
+                                                                   GLuint baseinstance) = nullptr;
+    // not in QOpenGLExtraFunctions, resolved manually when caps.multiDrawIndirect is set
+    void (QOPENGLF_APIENTRYP glMultiDrawArraysIndirect)(GLenum mode, const void *indirect,
+                                                         GLsizei drawcount, GLsizei stride) = nullptr;
+    void (QOPENGLF_APIENTRYP glMultiDrawElementsIndirect)(GLenum mode, GLenum type, const void *indirect,
+                                                           GLsizei drawcount, GLsizei stride) = nullptr;
+    // glInvalidateFramebuffer or glDiscardFramebufferEXT, resolved manually
+    // since the latter is an ES 2.0 extension, set when caps.invalidateFramebuffer is
+    void (QOPENGLF_APIENTRYP glInvalidateFramebuffer)(GLenum target, GLsizei numAttachments,
+                                                       const GLenum *attachments) = nullptr;
+    // ARB_timer_query or EXT_disjoint_timer_query (the latter on ES, where
+    // query objects may not be available otherwise), set when caps.timestamps is
+    void (QOPENGLF_APIENTRYP glGenQueries)(GLsizei n, GLuint *ids) = nullptr;
+    void (QOPENGLF_APIENTRYP glDeleteQueries)(GLsizei n, const GLuint *ids) = nullptr;
+    void (QOPENGLF_APIENTRYP glQueryCounter)(GLuint id, GLenum target) = nullptr;
+    void (QOPENGLF_APIENTRYP glGetQueryObjectuiv)(GLuint id, GLenum pname, GLuint *params) = nullptr;
+    void (QOPENGLF_APIENTRYP glGetQueryObjectui64v)(GLuint id, GLenum pname, quint64 *params) = nullptr;
+    // OpenGL ES 3.1 rejects indirect draws with the default vertex array object
+    GLuint vao = 0;
     bool inFrame = false;
     bool inPass = false;
+    bool inComputePass = false;
     QGles2SwapChain *currentSwapChain = nullptr;
+    quint64 timestampSerial = 0;
     QVector<GLint> supportedCompressedFormats;
     QRhiGles2NativeHandles nativeHandlesStruct;
 
@@ -589,7 +1024,9 @@ public:
             Pipeline,
             Texture,
             RenderBuffer,
-            TextureRenderTarget
+            TextureRenderTarget,
+            Sampler,
+            Query
         };
         Type type;
         union {
@@ -608,10 +1045,17 @@ public:
             struct {
                 GLuint framebuffer;
             } textureRenderTarget;
+            struct {
+                GLuint sampler;
+            } sampler;
+            struct {
+                GLuint query;
+            } query;
         };
     };
     QVector<DeferredReleaseEntry> releaseQueue;
 
+    void executeDeferredReleases(QVector<DeferredReleaseEntry> *queue);
     void executeDeferredReleasesOnRshNow(QVector<QRhiGles2::DeferredReleaseEntry> *rshRelQueue);
 
     struct OffscreenFrame {
@@ -619,10 +1063,53 @@ public:
         bool active = false;
         QGles2CommandBuffer cbWrapper;
     } ofr;
+
+    bool threadedExecution = false;
+    QGles2RenderThread *renderThread = nullptr;
 };
 
 Q_DECLARE_TYPEINFO(QRhiGles2::DeferredReleaseEntry, Q_MOVABLE_TYPE);
 
+// Executes swapchain frames, including the swap, while the thread owning the
+// QRhi records the next frame. The context is moved to the render thread for
+// the duration of a frame and is moved back afterwards, so anything needing
+// the context on the QRhi's thread has to waitIdle() first.
+class QGles2RenderThread : public QThread
+{
+public:
+    QGles2RenderThread(QRhiGles2 *rhi);
+
+    void submit(QGles2CommandBuffer *cbD, QSurface *surface, bool present);
+    void waitIdle();
+    void invokeReadbackCallbacks();
+    void stop();
+
+protected:
+    void run() override;
+
+private:
+    void executeFrame();
+
+    QRhiGles2 *rhiD;
+    QThread *rhiThread;
+    QMutex mutex;
+    QWaitCondition cond;
+    bool hasFrame = false;
+    bool quit = false;
+    QVector<std::function<void()>> readyReadbacks;
+
+    // belongs to the render thread while hasFrame is true
+    struct Frame {
+        QGles2CommandBuffer::CommandStream commands;
+        QVector<QByteArray> dataRetainPool;
+        QVector<QImage> imageRetainPool;
+        QVector<QRhiGles2::DeferredReleaseEntry> releaseQueue;
+        QVector<std::function<void()>> completedReadbacks;
+        QSurface *surface = nullptr;
+        bool present = false;
+    } frame;
+};
+
 QT_END_NAMESPACE
 
 #endif
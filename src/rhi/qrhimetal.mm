@@ -183,12 +183,19 @@ struct QRhiMetalData
     };
     QVector<ActiveReadback> activeReadbacks;
 
+    struct ActiveBufferReadback {
+        int activeFrameSlot = -1;
+        QRhiBufferReadbackResult *result;
+    };
+    QVector<ActiveBufferReadback> activeBufferReadbacks;
+
     API_AVAILABLE(macos(10.13), ios(11.0)) MTLCaptureManager *captureMgr;
     API_AVAILABLE(macos(10.13), ios(11.0)) id<MTLCaptureScope> captureScope = nil;
 };
 
 Q_DECLARE_TYPEINFO(QRhiMetalData::DeferredReleaseEntry, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(QRhiMetalData::ActiveReadback, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QRhiMetalData::ActiveBufferReadback, Q_MOVABLE_TYPE);
 
 struct QMetalBufferData
 {
@@ -490,6 +497,16 @@ bool QRhiMetal::isTextureFormatSupported(QRhiTexture::Format format, QRhiTexture
     return true;
 }
 
+bool QRhiMetal::isVertexFormatSupported(QRhiVertexInputAttribute::Format format) const
+{
+    if (format == QRhiVertexInputAttribute::UNormByte) {
+        if (@available(macOS 10.13, iOS 11.0, *))
+            return true;
+        return false;
+    }
+    return true;
+}
+
 bool QRhiMetal::isFeatureSupported(QRhi::Feature feature) const
 {
     switch (feature) {
@@ -519,6 +536,18 @@ bool QRhiMetal::isFeatureSupported(QRhi::Feature feature) const
         return true;
     case QRhi::RedOrAlpha8IsRed:
         return true;
+    case QRhi::Compute:
+        return false;
+    case QRhi::DrawIndirect:
+        return true;
+    case QRhi::DrawIndirectMulti:
+        return false;
+    case QRhi::PushConstants:
+        return false;
+    case QRhi::ThreeDimensionalTextures:
+        return false;
+    case QRhi::TextureArrays:
+        return false;
     default:
         Q_UNREACHABLE();
         return false;
@@ -532,6 +561,10 @@ int QRhiMetal::resourceSizeLimit(QRhi::ResourceSizeLimit limit) const
         return 1;
     case QRhi::TextureSizeMax:
         return caps.maxTextureSize;
+    case QRhi::PushConstantsSizeMax:
+        return 0;
+    case QRhi::TextureArraySizeMax:
+        return 0;
     default:
         Q_UNREACHABLE();
         return 0;
@@ -573,6 +606,11 @@ QRhiGraphicsPipeline *QRhiMetal::createGraphicsPipeline()
     return new QMetalGraphicsPipeline(this);
 }
 
+QRhiComputePipeline *QRhiMetal::createComputePipeline()
+{
+    return new QMetalComputePipeline(this);
+}
+
 QRhiShaderResourceBindings *QRhiMetal::createShaderResourceBindings()
 {
     return new QMetalShaderResourceBindings(this);
@@ -630,6 +668,19 @@ void QRhiMetal::enqueueShaderResourceBindings(QMetalShaderResourceBindings *srbD
             }
         }
             break;
+        case QRhiShaderResourceBinding::ImageLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageLoadStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferLoadStore:
+            // ### compute is not supported in this backend
+            break;
         default:
             Q_UNREACHABLE();
             break;
@@ -701,6 +752,13 @@ void QRhiMetal::enqueueShaderResourceBindings(QMetalShaderResourceBindings *srbD
     }
 }
 
+void QRhiMetal::setComputePipeline(QRhiCommandBuffer *cb, QRhiComputePipeline *ps)
+{
+    Q_UNUSED(cb);
+    Q_UNUSED(ps);
+    Q_ASSERT(inComputePass);
+}
+
 void QRhiMetal::setGraphicsPipeline(QRhiCommandBuffer *cb, QRhiGraphicsPipeline *ps)
 {
     Q_ASSERT(inPass);
@@ -777,6 +835,19 @@ void QRhiMetal::setShaderResources(QRhiCommandBuffer *cb, QRhiShaderResourceBind
             samplerD->lastActiveFrameSlot = currentFrameSlot;
         }
             break;
+        case QRhiShaderResourceBinding::ImageLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageLoadStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferLoadStore:
+            // ### compute is not supported in this backend
+            break;
         default:
             Q_UNREACHABLE();
             break;
@@ -920,6 +991,18 @@ void QRhiMetal::setStencilRef(QRhiCommandBuffer *cb, quint32 refValue)
     [cbD->d->currentPassEncoder setStencilReferenceValue: refValue];
 }
 
+void QRhiMetal::setPushConstants(QRhiCommandBuffer *cb, QRhiShaderResourceBinding::StageFlags stages,
+                                 quint32 offset, quint32 size, const void *data)
+{
+    Q_UNUSED(cb);
+    Q_UNUSED(stages);
+    Q_UNUSED(offset);
+    Q_UNUSED(size);
+    Q_UNUSED(data);
+    Q_ASSERT(inPass || inComputePass);
+    // ### push constants are not supported in this backend
+}
+
 void QRhiMetal::draw(QRhiCommandBuffer *cb, quint32 vertexCount,
                      quint32 instanceCount, quint32 firstVertex, quint32 firstInstance)
 {
@@ -954,6 +1037,65 @@ void QRhiMetal::drawIndexed(QRhiCommandBuffer *cb, quint32 indexCount,
       baseInstance: firstInstance];
 }
 
+void QRhiMetal::drawIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                             quint32 indirectBufferOffset, quint32 drawCount, quint32 stride)
+{
+    Q_ASSERT(inPass);
+    QMetalCommandBuffer *cbD = QRHI_RES(QMetalCommandBuffer, cb);
+    QMetalBuffer *bufD = QRHI_RES(QMetalBuffer, indirectBuffer);
+    Q_ASSERT(bufD->m_usage.testFlag(QRhiBuffer::IndirectBuffer));
+    drawCount = indirectDrawCountInRange(bufD, indirectBufferOffset, drawCount, stride,
+                                         sizeof(QRhiCommandBuffer::DrawIndirectCommand));
+    executeBufferHostWritesForCurrentFrame(bufD);
+    bufD->lastActiveFrameSlot = currentFrameSlot;
+    id<MTLBuffer> mtlbuf = bufD->d->buf[bufD->m_type == QRhiBuffer::Immutable ? 0 : currentFrameSlot];
+
+    // no multi-draw, each command is a separate draw call
+    for (quint32 i = 0; i < drawCount; ++i) {
+        [cbD->d->currentPassEncoder drawPrimitives: QRHI_RES(QMetalGraphicsPipeline, cbD->currentPipeline)->d->primitiveType
+          indirectBuffer: mtlbuf
+          indirectBufferOffset: NSUInteger(indirectBufferOffset) + NSUInteger(i) * stride];
+    }
+}
+
+void QRhiMetal::drawIndexedIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                                    quint32 indirectBufferOffset, quint32 drawCount, quint32 stride)
+{
+    Q_ASSERT(inPass);
+    QMetalCommandBuffer *cbD = QRHI_RES(QMetalCommandBuffer, cb);
+    if (!cbD->currentIndexBuffer)
+        return;
+
+    QMetalBuffer *bufD = QRHI_RES(QMetalBuffer, indirectBuffer);
+    Q_ASSERT(bufD->m_usage.testFlag(QRhiBuffer::IndirectBuffer));
+    drawCount = indirectDrawCountInRange(bufD, indirectBufferOffset, drawCount, stride,
+                                         sizeof(QRhiCommandBuffer::DrawIndexedIndirectCommand));
+    executeBufferHostWritesForCurrentFrame(bufD);
+    bufD->lastActiveFrameSlot = currentFrameSlot;
+    id<MTLBuffer> mtlbuf = bufD->d->buf[bufD->m_type == QRhiBuffer::Immutable ? 0 : currentFrameSlot];
+
+    QMetalBuffer *ibufD = QRHI_RES(QMetalBuffer, cbD->currentIndexBuffer);
+    id<MTLBuffer> mtlibuf = ibufD->d->buf[ibufD->m_type == QRhiBuffer::Immutable ? 0 : currentFrameSlot];
+
+    for (quint32 i = 0; i < drawCount; ++i) {
+        [cbD->d->currentPassEncoder drawIndexedPrimitives: QRHI_RES(QMetalGraphicsPipeline, cbD->currentPipeline)->d->primitiveType
+          indexType: cbD->currentIndexFormat == QRhiCommandBuffer::IndexUInt16 ? MTLIndexTypeUInt16 : MTLIndexTypeUInt32
+          indexBuffer: mtlibuf
+          indexBufferOffset: cbD->currentIndexOffset
+          indirectBuffer: mtlbuf
+          indirectBufferOffset: NSUInteger(indirectBufferOffset) + NSUInteger(i) * stride];
+    }
+}
+
+void QRhiMetal::dispatch(QRhiCommandBuffer *cb, int x, int y, int z)
+{
+    Q_UNUSED(cb);
+    Q_UNUSED(x);
+    Q_UNUSED(y);
+    Q_UNUSED(z);
+    Q_ASSERT(inComputePass);
+}
+
 void QRhiMetal::debugMarkBegin(QRhiCommandBuffer *cb, const QByteArray &name)
 {
     if (!debugMarkers)
@@ -1168,6 +1310,21 @@ QRhi::FrameOpResult QRhiMetal::finish()
     return QRhi::FrameOpSuccess;
 }
 
+static inline MTLLoadAction toMetalLoadAction(QRhiColorAttachment::LoadOp op)
+{
+    switch (op) {
+    case QRhiColorAttachment::LoadOpClear:
+        return MTLLoadActionClear;
+    case QRhiColorAttachment::LoadOpLoad:
+        return MTLLoadActionLoad;
+    case QRhiColorAttachment::LoadOpDontCare:
+        return MTLLoadActionDontCare;
+    default:
+        Q_UNREACHABLE();
+        return MTLLoadActionClear;
+    }
+}
+
 MTLRenderPassDescriptor *QRhiMetalData::createDefaultRenderPass(bool hasDepthStencil,
                                                                 const QRhiColorClearValue &colorClearValue,
                                                                 const QRhiDepthStencilClearValue &depthStencilClearValue)
@@ -1213,6 +1370,21 @@ void QRhiMetal::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdate
             bufD->d->pendingUpdates[i].append({ u.buf, u.offset, u.data.size(), u.data.constData() });
     }
 
+    for (const QRhiResourceUpdateBatchPrivate::BufferReadback &u : ud->bufferReadbacks) {
+        // All buffers are host visible and only written by the host, so
+        // there is nothing to wait for. Complete in the usual place still,
+        // like the other backends do.
+        QMetalBuffer *bufD = QRHI_RES(QMetalBuffer, u.buf);
+        executeBufferHostWritesForCurrentFrame(bufD);
+        const int idx = bufD->m_type == QRhiBuffer::Immutable ? 0 : currentFrameSlot;
+        const char *p = static_cast<const char *>([bufD->d->buf[idx] contents]);
+        u.result->data = QByteArray(p + u.offset, u.size);
+        QRhiMetalData::ActiveBufferReadback aRb;
+        aRb.activeFrameSlot = currentFrameSlot;
+        aRb.result = u.result;
+        d->activeBufferReadbacks.append(aRb);
+    }
+
     id<MTLBlitCommandEncoder> blitEnc = nil;
     auto ensureBlit = [&blitEnc, cbD, this] {
         if (!blitEnc) {
@@ -1250,6 +1422,7 @@ void QRhiMetal::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdate
                 utexD->d->stagingBuf[currentFrameSlot] = [d->dev newBufferWithLength: stagingSize
                         options: MTLResourceStorageModeShared];
                 QRHI_PROF_F(newTextureStagingArea(utexD, currentFrameSlot, stagingSize));
+                addStagingMemory(utexD, currentFrameSlot, stagingSize);
             }
 
             void *mp = [utexD->d->stagingBuf[currentFrameSlot] contents];
@@ -1355,6 +1528,7 @@ void QRhiMetal::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdate
                 utexD->d->stagingBuf[currentFrameSlot] = nil;
                 d->releaseQueue.append(e);
                 QRHI_PROF_F(releaseTextureStagingArea(utexD, currentFrameSlot));
+                removeStagingMemory(utexD, currentFrameSlot);
             }
         } else if (u.type == QRhiResourceUpdateBatchPrivate::TextureOp::TexCopy) {
             Q_ASSERT(u.copy.src && u.copy.dst);
@@ -1385,29 +1559,31 @@ void QRhiMetal::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdate
             QMetalTexture *texD = QRHI_RES(QMetalTexture, u.read.rb.texture());
             QMetalSwapChain *swapChainD = nullptr;
             id<MTLTexture> src;
-            QSize srcSize;
+            QRect rect;
             if (texD) {
                 if (texD->samples > 1) {
                     qWarning("Multisample texture cannot be read back");
                     continue;
                 }
-                aRb.pixelSize = u.read.rb.level() > 0 ? q->sizeForMipLevel(u.read.rb.level(), texD->m_pixelSize)
-                                                      : texD->m_pixelSize;
+                const QSize levelSize = u.read.rb.level() > 0 ? q->sizeForMipLevel(u.read.rb.level(), texD->m_pixelSize)
+                                                              : texD->m_pixelSize;
+                if (!readbackRect(u.read.rb, levelSize, &rect))
+                    continue;
                 aRb.format = texD->m_format;
                 src = texD->d->tex;
-                srcSize = texD->m_pixelSize;
                 texD->lastActiveFrameSlot = currentFrameSlot;
             } else {
                 Q_ASSERT(currentSwapChain);
                 swapChainD = QRHI_RES(QMetalSwapChain, currentSwapChain);
-                aRb.pixelSize = swapChainD->pixelSize;
+                if (!readbackRect(u.read.rb, swapChainD->pixelSize, &rect))
+                    continue;
                 aRb.format = swapChainD->d->rhiColorFormat;
                 // Multisample swapchains need nothing special since resolving
                 // happens when ending a renderpass.
                 const QMetalRenderTargetData::ColorAtt &colorAtt(swapChainD->rtWrapper.d->fb.colorAtt[0]);
                 src = colorAtt.resolveTex ? colorAtt.resolveTex : colorAtt.tex;
-                srcSize = swapChainD->rtWrapper.d->pixelSize;
             }
+            aRb.pixelSize = rect.size();
 
             quint32 bpl = 0;
             textureFormatInfo(aRb.format, aRb.pixelSize, &bpl, &aRb.bufSize);
@@ -1416,13 +1592,14 @@ void QRhiMetal::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdate
             QRHI_PROF_F(newReadbackBuffer(quint64(quintptr(aRb.buf)),
                                           texD ? static_cast<QRhiResource *>(texD) : static_cast<QRhiResource *>(swapChainD),
                                           aRb.bufSize));
+            addReadbackMemory(quint64(quintptr(aRb.buf)), aRb.bufSize);
 
             ensureBlit();
             [blitEnc copyFromTexture: src
                                       sourceSlice: u.read.rb.layer()
                                       sourceLevel: u.read.rb.level()
-                                      sourceOrigin: MTLOriginMake(0, 0, 0)
-                                      sourceSize: MTLSizeMake(srcSize.width(), srcSize.height(), 1)
+                                      sourceOrigin: MTLOriginMake(rect.x(), rect.y(), 0)
+                                      sourceSize: MTLSizeMake(rect.width(), rect.height(), 1)
                                       toBuffer: aRb.buf
                                       destinationOffset: 0
                                       destinationBytesPerRow: bpl
@@ -1473,7 +1650,7 @@ void QRhiMetal::executeBufferHostWritesForCurrentFrame(QMetalBuffer *bufD)
 
 void QRhiMetal::resourceUpdate(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
 {
-    Q_ASSERT(inFrame && !inPass);
+    Q_ASSERT(inFrame && !inPass && !inComputePass);
 
     enqueueResourceUpdates(cb, resourceUpdates);
 }
@@ -1484,7 +1661,7 @@ void QRhiMetal::beginPass(QRhiCommandBuffer *cb,
                           const QRhiDepthStencilClearValue &depthStencilClearValue,
                           QRhiResourceUpdateBatch *resourceUpdates)
 {
-    Q_ASSERT(!inPass);
+    Q_ASSERT(!inPass && !inComputePass);
 
     if (resourceUpdates)
         enqueueResourceUpdates(cb, resourceUpdates);
@@ -1522,13 +1699,25 @@ void QRhiMetal::beginPass(QRhiCommandBuffer *cb,
         QMetalTextureRenderTarget *rtTex = QRHI_RES(QMetalTextureRenderTarget, rt);
         rtD = rtTex->d;
         cbD->d->currentPassRpDesc = d->createDefaultRenderPass(rtD->dsAttCount, colorClearValue, depthStencilClearValue);
-        if (rtTex->m_flags.testFlag(QRhiTextureRenderTarget::PreserveColorContents)) {
-            for (int i = 0; i < rtD->colorAttCount; ++i)
-                cbD->d->currentPassRpDesc.colorAttachments[i].loadAction = MTLLoadActionLoad;
+        const QVector<QRhiColorAttachment> colorAttachments = rtTex->m_desc.colorAttachments();
+        const QVector4D rgba = colorClearValue.rgba();
+        for (int i = 0; i < rtD->colorAttCount; ++i) {
+            MTLRenderPassColorAttachmentDescriptor *att = cbD->d->currentPassRpDesc.colorAttachments[i];
+            att.loadAction = toMetalLoadAction(colorLoadOp(rtTex, colorAttachments[i]));
+            att.storeAction = colorStoreOp(colorAttachments[i]) == QRhiColorAttachment::StoreOpStore
+                    ? MTLStoreActionStore : MTLStoreActionDontCare;
+            att.clearColor = MTLClearColorMake(rgba.x(), rgba.y(), rgba.z(), rgba.w());
         }
-        if (rtD->dsAttCount && rtTex->m_flags.testFlag(QRhiTextureRenderTarget::PreserveDepthStencilContents)) {
-            cbD->d->currentPassRpDesc.depthAttachment.loadAction = MTLLoadActionLoad;
-            cbD->d->currentPassRpDesc.stencilAttachment.loadAction = MTLLoadActionLoad;
+        if (rtD->dsAttCount) {
+            const MTLLoadAction loadAction = toMetalLoadAction(depthStencilLoadOp(rtTex));
+            // depth/stencil renderbuffers are never written out
+            const MTLStoreAction storeAction = rtTex->m_desc.depthTexture()
+                    && depthStencilStoreOp(rtTex) == QRhiColorAttachment::StoreOpStore
+                    ? MTLStoreActionStore : MTLStoreActionDontCare;
+            cbD->d->currentPassRpDesc.depthAttachment.loadAction = loadAction;
+            cbD->d->currentPassRpDesc.depthAttachment.storeAction = storeAction;
+            cbD->d->currentPassRpDesc.stencilAttachment.loadAction = loadAction;
+            cbD->d->currentPassRpDesc.stencilAttachment.storeAction = storeAction;
         }
     }
         break;
@@ -1577,6 +1766,27 @@ void QRhiMetal::endPass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resource
         enqueueResourceUpdates(cb, resourceUpdates);
 }
 
+void QRhiMetal::beginComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
+{
+    Q_ASSERT(!inPass && !inComputePass);
+
+    // ### compute is not supported in this backend, the pass only serves as a
+    // resource update point
+    if (resourceUpdates)
+        enqueueResourceUpdates(cb, resourceUpdates);
+
+    inComputePass = true;
+}
+
+void QRhiMetal::endComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
+{
+    Q_ASSERT(inComputePass);
+    inComputePass = false;
+
+    if (resourceUpdates)
+        enqueueResourceUpdates(cb, resourceUpdates);
+}
+
 static void qrhimtl_releaseBuffer(const QRhiMetalData::DeferredReleaseEntry &e)
 {
     for (int i = 0; i < QMTL_FRAMES_IN_FLIGHT; ++i)
@@ -1665,12 +1875,11 @@ void QRhiMetal::finishActiveReadbacks(bool forced)
         if (forced || currentFrameSlot == aRb.activeFrameSlot || aRb.activeFrameSlot < 0) {
             aRb.result->format = aRb.format;
             aRb.result->pixelSize = aRb.pixelSize;
-            aRb.result->data.resize(aRb.bufSize);
-            void *p = [aRb.buf contents];
-            memcpy(aRb.result->data.data(), p, aRb.bufSize);
+            storeReadbackData(aRb.result, [aRb.buf contents], aRb.bufSize);
             [aRb.buf release];
 
             QRHI_PROF_F(releaseReadbackBuffer(quint64(quintptr(aRb.buf))));
+            removeReadbackMemory(quint64(quintptr(aRb.buf)));
 
             if (aRb.result->completed)
                 completedCallbacks.append(aRb.result->completed);
@@ -1679,6 +1888,15 @@ void QRhiMetal::finishActiveReadbacks(bool forced)
         }
     }
 
+    for (int i = d->activeBufferReadbacks.count() - 1; i >= 0; --i) {
+        const QRhiMetalData::ActiveBufferReadback &aRb(d->activeBufferReadbacks[i]);
+        if (forced || currentFrameSlot == aRb.activeFrameSlot || aRb.activeFrameSlot < 0) {
+            if (aRb.result->completed)
+                completedCallbacks.append(aRb.result->completed);
+            d->activeBufferReadbacks.removeAt(i);
+        }
+    }
+
     for (auto f : completedCallbacks)
         f();
 }
@@ -1732,6 +1950,7 @@ void QMetalBuffer::release()
         rhiD->d->releaseQueue.append(e);
         QRHI_PROF;
         QRHI_PROF_F(releaseBuffer(this));
+        rhiD->removeBufferMemory(this);
         rhiD->unregisterResource(this);
     } else {
         // associated rhi is already gone, queue the deferred release to the rsh instead
@@ -1779,6 +1998,7 @@ bool QMetalBuffer::build()
 
     QRHI_PROF;
     QRHI_PROF_F(newBuffer(this, roundedSize, m_type == Immutable ? 1 : QMTL_FRAMES_IN_FLIGHT, 0));
+    rhiD->addBufferMemory(this, roundedSize, m_type == Immutable ? 1 : QMTL_FRAMES_IN_FLIGHT);
 
     lastActiveFrameSlot = -1;
     generation += 1;
@@ -1820,6 +2040,7 @@ void QMetalRenderBuffer::release()
         rhiD->d->releaseQueue.append(e);
         QRHI_PROF;
         QRHI_PROF_F(releaseRenderBuffer(this));
+        rhiD->removeRenderBufferMemory(this);
         rhiD->unregisterResource(this);
     } else {
         addToRshReleaseQueue(m_orphanedWithRsh, e);
@@ -1863,7 +2084,16 @@ bool QMetalRenderBuffer::build()
         desc.pixelFormat = d->format;
         break;
     case Color:
+#ifdef Q_OS_MACOS
         desc.storageMode = MTLStorageModePrivate;
+#else
+        if (m_flags.testFlag(Transient)) {
+            desc.storageMode = MTLResourceStorageModeMemoryless;
+            transientBacking = true;
+        } else {
+            desc.storageMode = MTLStorageModePrivate;
+        }
+#endif
         d->format = MTLPixelFormatRGBA8Unorm;
         desc.pixelFormat = d->format;
         break;
@@ -1880,6 +2110,7 @@ bool QMetalRenderBuffer::build()
 
     QRHI_PROF;
     QRHI_PROF_F(newRenderBuffer(this, transientBacking, false, samples));
+    rhiD->addRenderBufferMemory(this, samples);
 
     lastActiveFrameSlot = -1;
     generation += 1;
@@ -1934,6 +2165,9 @@ void QMetalTexture::release()
         rhiD->d->releaseQueue.append(e);
         QRHI_PROF;
         QRHI_PROF_F(releaseTexture(this));
+        rhiD->removeTextureMemory(this);
+        for (int i = 0; i < QMTL_FRAMES_IN_FLIGHT; ++i)
+            rhiD->removeStagingMemory(this, i);
         rhiD->unregisterResource(this);
     } else {
         addToRshReleaseQueue(m_orphanedWithRsh, e);
@@ -1959,6 +2193,21 @@ static inline MTLPixelFormat toMetalTextureFormat(QRhiTexture::Format format, QR
     case QRhiTexture::RED_OR_ALPHA8:
         return MTLPixelFormatR8Unorm;
 
+    case QRhiTexture::RG8:
+        return MTLPixelFormatRG8Unorm;
+    case QRhiTexture::RG16:
+        return MTLPixelFormatRG16Unorm;
+    case QRhiTexture::RGBA16F:
+        return MTLPixelFormatRGBA16Float;
+    case QRhiTexture::RGBA32F:
+        return MTLPixelFormatRGBA32Float;
+    case QRhiTexture::R16F:
+        return MTLPixelFormatR16Float;
+    case QRhiTexture::R32F:
+        return MTLPixelFormatR32Float;
+    case QRhiTexture::B10G11R11_UFLOAT:
+        return MTLPixelFormatRG11B10Float;
+
     case QRhiTexture::D16:
         return MTLPixelFormatDepth16Unorm;
     case QRhiTexture::D32:
@@ -2067,6 +2316,11 @@ bool QMetalTexture::prepareBuild(QSize *adjustedSize)
     if (d->tex)
         release();
 
+    if (m_flags.testFlag(ThreeDimensional) || m_flags.testFlag(TextureArray)) {
+        qWarning("3D and array textures are not supported");
+        return false;
+    }
+
     const QSize size = m_pixelSize.isEmpty() ? QSize(1, 1) : m_pixelSize;
     const bool isCube = m_flags.testFlag(CubeMap);
     const bool hasMipMaps = m_flags.testFlag(MipMapped);
@@ -2117,6 +2371,15 @@ bool QMetalTexture::build()
     if (m_flags.testFlag(RenderTarget))
         desc.usage |= MTLTextureUsageRenderTarget;
 
+    bool transientBacking = false;
+#ifndef Q_OS_MACOS
+    if (m_flags.testFlag(Transient)) {
+        desc.storageMode = MTLStorageModeMemoryless;
+        desc.usage = MTLTextureUsageRenderTarget;
+        transientBacking = true;
+    }
+#endif
+
     QRHI_RES_RHI(QRhiMetal);
     d->tex = [rhiD->d->dev newTextureWithDescriptor: desc];
     [desc release];
@@ -2128,7 +2391,8 @@ bool QMetalTexture::build()
     nativeHandlesStruct.texture = d->tex;
 
     QRHI_PROF;
-    QRHI_PROF_F(newTexture(this, true, mipLevelCount, isCube ? 6 : 1, samples));
+    QRHI_PROF_F(newTexture(this, true, transientBacking, mipLevelCount, isCube ? 6 : 1, samples));
+    rhiD->addTextureMemory(this, mipLevelCount, isCube ? 6 : 1, samples);
 
     lastActiveFrameSlot = -1;
     generation += 1;
@@ -2151,7 +2415,7 @@ bool QMetalTexture::buildFrom(const QRhiNativeHandles *src)
     nativeHandlesStruct.texture = d->tex;
 
     QRHI_PROF;
-    QRHI_PROF_F(newTexture(this, false, mipLevelCount, m_flags.testFlag(CubeMap) ? 6 : 1, samples));
+    QRHI_PROF_F(newTexture(this, false, false, mipLevelCount, m_flags.testFlag(CubeMap) ? 6 : 1, samples));
 
     lastActiveFrameSlot = -1;
     generation += 1;
@@ -2477,6 +2741,19 @@ bool QMetalShaderResourceBindings::build()
             bd.stex.samplerGeneration = samplerD->generation;
         }
             break;
+        case QRhiShaderResourceBinding::ImageLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageLoadStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferLoadStore:
+            // ### compute is not supported in this backend
+            break;
         default:
             Q_UNREACHABLE();
             break;
@@ -2556,6 +2833,38 @@ static inline MTLVertexFormat toMetalAttributeFormat(QRhiVertexInputAttribute::F
             return MTLVertexFormatUCharNormalized;
         else
             Q_UNREACHABLE();
+    case QRhiVertexInputAttribute::Half4:
+        return MTLVertexFormatHalf4;
+    case QRhiVertexInputAttribute::Half2:
+        return MTLVertexFormatHalf2;
+    case QRhiVertexInputAttribute::SNormByte4:
+        return MTLVertexFormatChar4Normalized;
+    case QRhiVertexInputAttribute::SNormByte2:
+        return MTLVertexFormatChar2Normalized;
+    case QRhiVertexInputAttribute::SNormShort4:
+        return MTLVertexFormatShort4Normalized;
+    case QRhiVertexInputAttribute::SNormShort2:
+        return MTLVertexFormatShort2Normalized;
+    case QRhiVertexInputAttribute::UInt4:
+        return MTLVertexFormatUInt4;
+    case QRhiVertexInputAttribute::UInt3:
+        return MTLVertexFormatUInt3;
+    case QRhiVertexInputAttribute::UInt2:
+        return MTLVertexFormatUInt2;
+    case QRhiVertexInputAttribute::UInt:
+        return MTLVertexFormatUInt;
+    case QRhiVertexInputAttribute::SInt4:
+        return MTLVertexFormatInt4;
+    case QRhiVertexInputAttribute::SInt3:
+        return MTLVertexFormatInt3;
+    case QRhiVertexInputAttribute::SInt2:
+        return MTLVertexFormatInt2;
+    case QRhiVertexInputAttribute::SInt:
+        return MTLVertexFormatInt;
+    case QRhiVertexInputAttribute::UNormA2B10G10R10:
+        return MTLVertexFormatUInt1010102Normalized;
+    case QRhiVertexInputAttribute::SNormA2B10G10R10:
+        return MTLVertexFormatInt1010102Normalized;
     default:
         Q_UNREACHABLE();
         return MTLVertexFormatFloat4;
@@ -2935,6 +3244,21 @@ bool QMetalGraphicsPipeline::build()
     return true;
 }
 
+QMetalComputePipeline::QMetalComputePipeline(QRhiImplementation *rhi)
+    : QRhiComputePipeline(rhi)
+{
+}
+
+void QMetalComputePipeline::release()
+{
+}
+
+bool QMetalComputePipeline::build()
+{
+    qWarning("Compute pipelines are not supported by the Metal backend");
+    return false;
+}
+
 QMetalCommandBuffer::QMetalCommandBuffer(QRhiImplementation *rhi)
     : QRhiCommandBuffer(rhi),
       d(new QMetalCommandBufferData)
@@ -223,6 +223,13 @@ struct QMetalGraphicsPipeline : public QRhiGraphicsPipeline
     friend class QRhiMetal;
 };
 
+struct QMetalComputePipeline : public QRhiComputePipeline
+{
+    QMetalComputePipeline(QRhiImplementation *rhi);
+    void release() override;
+    bool build() override;
+};
+
 struct QMetalCommandBufferData;
 struct QMetalSwapChain;
 
@@ -289,6 +296,7 @@ public:
     void destroy() override;
 
     QRhiGraphicsPipeline *createGraphicsPipeline() override;
+    QRhiComputePipeline *createComputePipeline() override;
     QRhiShaderResourceBindings *createShaderResourceBindings() override;
     QRhiBuffer *createBuffer(QRhiBuffer::Type type,
                              QRhiBuffer::UsageFlags usage,
@@ -323,9 +331,13 @@ public:
                    const QRhiDepthStencilClearValue &depthStencilClearValue,
                    QRhiResourceUpdateBatch *resourceUpdates) override;
     void endPass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) override;
+    void beginComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) override;
+    void endComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) override;
 
     void setGraphicsPipeline(QRhiCommandBuffer *cb,
                              QRhiGraphicsPipeline *ps) override;
+    void setComputePipeline(QRhiCommandBuffer *cb,
+                            QRhiComputePipeline *ps) override;
 
     void setShaderResources(QRhiCommandBuffer *cb,
                             QRhiShaderResourceBindings *srb,
@@ -340,6 +352,8 @@ public:
     void setScissor(QRhiCommandBuffer *cb, const QRhiScissor &scissor) override;
     void setBlendConstants(QRhiCommandBuffer *cb, const QVector4D &c) override;
     void setStencilRef(QRhiCommandBuffer *cb, quint32 refValue) override;
+    void setPushConstants(QRhiCommandBuffer *cb, QRhiShaderResourceBinding::StageFlags stages,
+                          quint32 offset, quint32 size, const void *data) override;
 
     void draw(QRhiCommandBuffer *cb, quint32 vertexCount,
               quint32 instanceCount, quint32 firstVertex, quint32 firstInstance) override;
@@ -348,6 +362,13 @@ public:
                      quint32 instanceCount, quint32 firstIndex,
                      qint32 vertexOffset, quint32 firstInstance) override;
 
+    void drawIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                      quint32 indirectBufferOffset, quint32 drawCount, quint32 stride) override;
+    void drawIndexedIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                             quint32 indirectBufferOffset, quint32 drawCount, quint32 stride) override;
+
+    void dispatch(QRhiCommandBuffer *cb, int x, int y, int z) override;
+
     void debugMarkBegin(QRhiCommandBuffer *cb, const QByteArray &name) override;
     void debugMarkEnd(QRhiCommandBuffer *cb) override;
     void debugMarkMsg(QRhiCommandBuffer *cb, const QByteArray &msg) override;
@@ -358,6 +379,7 @@ public:
     bool isYUpInNDC() const override;
     QMatrix4x4 clipSpaceCorrMatrix() const override;
     bool isTextureFormatSupported(QRhiTexture::Format format, QRhiTexture::Flags flags) const override;
+    bool isVertexFormatSupported(QRhiVertexInputAttribute::Format format) const override;
     bool isFeatureSupported(QRhi::Feature feature) const override;
     int resourceSizeLimit(QRhi::ResourceSizeLimit limit) const override;
     const QRhiNativeHandles *nativeHandles() override;
@@ -376,6 +398,7 @@ public:
     bool inFrame = false;
     int currentFrameSlot = 0;
     bool inPass = false;
+    bool inComputePass = false;
     QMetalSwapChain *currentSwapChain = nullptr;
     QSet<QMetalSwapChain *> swapchains;
     QRhiMetalNativeHandles nativeHandlesStruct;
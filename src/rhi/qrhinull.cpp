@@ -36,6 +36,7 @@
 
 #include "qrhinull_p.h"
 #include <qmath.h>
+#include <QVarLengthArray>
 
 QT_BEGIN_NAMESPACE
 
@@ -56,12 +57,72 @@ QT_BEGIN_NAMESPACE
     still be run, albeit potentially at an unthrottled speed, depending on
     their frame rendering strategy. The backend reports resources to
     QRhiProfiler as usual.
+
+    Setting \c enableCostModel to true makes the backend estimate what a frame
+    would cost on a real one: state changes, redundant binds, bytes
+    transferred, attachment bandwidth, and memory footprint are added to
+    QRhiNullStatistics. This makes it possible to compare the effect of scene
+    changes on machines without a GPU, for example in CI. The bookkeeping is
+    not free, so it is disabled by default.
  */
 
 /*!
     \class QRhiNullNativeHandles
     \inmodule QtRhi
-    \brief Empty.
+    \brief Provides access to the statistics collected by the Null backend.
+
+    \c statistics stays valid for the lifetime of the QRhi.
+ */
+
+/*!
+    \class QRhiNullStatistics
+    \inmodule QtRhi
+    \brief Counters collected by the Null backend.
+
+    Since nothing is rendered, these describe the work a real backend would
+    have been asked to do. \c discardedColorStores and \c
+    discardedDepthStencilStores count the attachments that were not written
+    out at the end of a render pass due to QRhiColorAttachment::StoreOpDontCare
+    or QRhiTextureRenderTargetDescription::depthStencilStoreOp(), or due to
+    being QRhiTexture::Transient or QRhiRenderBuffer::Transient, while \c
+    discardedStoreBytes is the approximate amount of memory traffic this
+    saved.
+
+    The rest of the counters are only collected when
+    QRhiNullInitParams::enableCostModel was set:
+
+    \list
+
+    \li \c frameCount, \c drawCount and \c dispatchCount count frames (both
+    swapchain and offscreen), draw calls (indirect ones contributing one for
+    each command) and compute dispatches.
+
+    \li \c pipelineChanges, \c shaderResourceChanges, \c vertexInputChanges
+    and \c dynamicStateChanges count the calls that changed the state of the
+    command buffer. Viewport, scissor, blend constants and stencil reference
+    changes are dynamic state. The \c redundant counterparts count the calls
+    that set what was already set since the beginning of the current pass. A
+    pipeline or shader resource bindings object that got rebuilt in between is
+    not redundant.
+
+    \li \c uploadedBytes is the amount of buffer and texture data uploaded,
+    \c copiedBytes is the amount of texture data copied, including the
+    generated mip levels, while \c readBackBytes is the amount read back.
+
+    \li \c attachmentLoadBytes and \c attachmentStoreBytes are the estimated
+    memory traffic caused by loading attachment contents at the beginning of a
+    render pass and writing them out, including resolving, at the end. These
+    are based on the size, the format and the sample count of the attachment,
+    and the load and store operations.
+
+    \li \c memoryBytes and \c peakMemoryBytes are the estimated current and
+    peak memory footprint of the buffers, textures and renderbuffers, see
+    QRhi::memoryStatistics().
+
+    \endlist
+
+    The counters are never reset. To measure a frame or a scene, take a copy
+    of the structure before and subtract.
  */
 
 /*!
@@ -71,8 +132,10 @@ QT_BEGIN_NAMESPACE
  */
 
 QRhiNull::QRhiNull(QRhiNullInitParams *params)
+    : offscreenCommandBuffer(this)
 {
-    Q_UNUSED(params);
+    costModel = params->enableCostModel;
+    nativeHandlesStruct.statistics = &stats;
 }
 
 bool QRhiNull::create(QRhi::Flags flags)
@@ -127,6 +190,12 @@ bool QRhiNull::isTextureFormatSupported(QRhiTexture::Format format, QRhiTexture:
     return true;
 }
 
+bool QRhiNull::isVertexFormatSupported(QRhiVertexInputAttribute::Format format) const
+{
+    Q_UNUSED(format);
+    return true;
+}
+
 bool QRhiNull::isFeatureSupported(QRhi::Feature feature) const
 {
     Q_UNUSED(feature);
@@ -140,6 +209,10 @@ int QRhiNull::resourceSizeLimit(QRhi::ResourceSizeLimit limit) const
         return 1;
     case QRhi::TextureSizeMax:
         return 16384;
+    case QRhi::PushConstantsSizeMax:
+        return 128;
+    case QRhi::TextureArraySizeMax:
+        return 2048;
     default:
         Q_UNREACHABLE();
         return 0;
@@ -181,6 +254,11 @@ QRhiGraphicsPipeline *QRhiNull::createGraphicsPipeline()
     return new QNullGraphicsPipeline(this);
 }
 
+QRhiComputePipeline *QRhiNull::createComputePipeline()
+{
+    return new QNullComputePipeline(this);
+}
+
 QRhiShaderResourceBindings *QRhiNull::createShaderResourceBindings()
 {
     return new QNullShaderResourceBindings(this);
@@ -188,51 +266,159 @@ QRhiShaderResourceBindings *QRhiNull::createShaderResourceBindings()
 
 void QRhiNull::setGraphicsPipeline(QRhiCommandBuffer *cb, QRhiGraphicsPipeline *ps)
 {
-    Q_UNUSED(cb);
-    Q_UNUSED(ps);
+    if (!costModel)
+        return;
+
+    QNullCommandBuffer *cbD = QRHI_RES(QNullCommandBuffer, cb);
+    QNullGraphicsPipeline *psD = QRHI_RES(QNullGraphicsPipeline, ps);
+    if (cbD->currentGraphicsPipeline == ps && cbD->currentPipelineGeneration == psD->generation) {
+        stats.redundantPipelineBinds += 1;
+        return;
+    }
+
+    stats.pipelineChanges += 1;
+    cbD->currentGraphicsPipeline = ps;
+    cbD->currentComputePipeline = nullptr;
+    cbD->currentPipelineGeneration = psD->generation;
+}
+
+void QRhiNull::setComputePipeline(QRhiCommandBuffer *cb, QRhiComputePipeline *ps)
+{
+    if (!costModel)
+        return;
+
+    QNullCommandBuffer *cbD = QRHI_RES(QNullCommandBuffer, cb);
+    QNullComputePipeline *psD = QRHI_RES(QNullComputePipeline, ps);
+    if (cbD->currentComputePipeline == ps && cbD->currentPipelineGeneration == psD->generation) {
+        stats.redundantPipelineBinds += 1;
+        return;
+    }
+
+    stats.pipelineChanges += 1;
+    cbD->currentGraphicsPipeline = nullptr;
+    cbD->currentComputePipeline = ps;
+    cbD->currentPipelineGeneration = psD->generation;
 }
 
 void QRhiNull::setShaderResources(QRhiCommandBuffer *cb, QRhiShaderResourceBindings *srb,
                                   const QVector<QRhiCommandBuffer::DynamicOffset> &dynamicOffsets)
 {
-    Q_UNUSED(cb);
-    Q_UNUSED(srb);
-    Q_UNUSED(dynamicOffsets);
+    if (!costModel)
+        return;
+
+    QNullCommandBuffer *cbD = QRHI_RES(QNullCommandBuffer, cb);
+    if (!srb) {
+        if (cbD->currentGraphicsPipeline)
+            srb = cbD->currentGraphicsPipeline->shaderResourceBindings();
+        else if (cbD->currentComputePipeline)
+            srb = cbD->currentComputePipeline->shaderResourceBindings();
+        if (!srb)
+            return;
+    }
+
+    QNullShaderResourceBindings *srbD = QRHI_RES(QNullShaderResourceBindings, srb);
+    if (cbD->currentSrb == srb && cbD->currentSrbGeneration == srbD->generation
+            && cbD->currentDynamicOffsets == dynamicOffsets)
+    {
+        stats.redundantShaderResourceBinds += 1;
+        return;
+    }
+
+    stats.shaderResourceChanges += 1;
+    cbD->currentSrb = srb;
+    cbD->currentSrbGeneration = srbD->generation;
+    cbD->currentDynamicOffsets = dynamicOffsets;
 }
 
 void QRhiNull::setVertexInput(QRhiCommandBuffer *cb, int startBinding, const QVector<QRhiCommandBuffer::VertexInput> &bindings,
                                QRhiBuffer *indexBuf, quint32 indexOffset, QRhiCommandBuffer::IndexFormat indexFormat)
 {
-    Q_UNUSED(cb);
-    Q_UNUSED(startBinding);
-    Q_UNUSED(bindings);
-    Q_UNUSED(indexBuf);
-    Q_UNUSED(indexOffset);
-    Q_UNUSED(indexFormat);
+    if (!costModel)
+        return;
+
+    QNullCommandBuffer *cbD = QRHI_RES(QNullCommandBuffer, cb);
+    bool changed = false;
+    if (cbD->currentVertexInputs.count() < startBinding + bindings.count())
+        cbD->currentVertexInputs.resize(startBinding + bindings.count());
+    for (int i = 0, ie = bindings.count(); i != ie; ++i) {
+        if (cbD->currentVertexInputs[startBinding + i] != bindings[i]) {
+            cbD->currentVertexInputs[startBinding + i] = bindings[i];
+            changed = true;
+        }
+    }
+    if (indexBuf && (cbD->currentIndexBuffer != indexBuf
+                     || cbD->currentIndexOffset != indexOffset
+                     || cbD->currentIndexFormat != indexFormat))
+    {
+        cbD->currentIndexBuffer = indexBuf;
+        cbD->currentIndexOffset = indexOffset;
+        cbD->currentIndexFormat = indexFormat;
+        changed = true;
+    }
+
+    if (changed)
+        stats.vertexInputChanges += 1;
+    else
+        stats.redundantVertexInputBinds += 1;
+}
+
+template<typename T>
+static inline void countDynamicState(QRhiNullStatistics *stats, T *current, bool *hasCurrent, const T &value)
+{
+    if (*hasCurrent && *current == value) {
+        stats->redundantDynamicStateChanges += 1;
+        return;
+    }
+
+    stats->dynamicStateChanges += 1;
+    *current = value;
+    *hasCurrent = true;
 }
 
 void QRhiNull::setViewport(QRhiCommandBuffer *cb, const QRhiViewport &viewport)
 {
-    Q_UNUSED(cb);
-    Q_UNUSED(viewport);
+    if (!costModel)
+        return;
+
+    QNullCommandBuffer *cbD = QRHI_RES(QNullCommandBuffer, cb);
+    countDynamicState(&stats, &cbD->currentViewport, &cbD->hasViewport, viewport);
 }
 
 void QRhiNull::setScissor(QRhiCommandBuffer *cb, const QRhiScissor &scissor)
 {
-    Q_UNUSED(cb);
-    Q_UNUSED(scissor);
+    if (!costModel)
+        return;
+
+    QNullCommandBuffer *cbD = QRHI_RES(QNullCommandBuffer, cb);
+    countDynamicState(&stats, &cbD->currentScissor, &cbD->hasScissor, scissor);
 }
 
 void QRhiNull::setBlendConstants(QRhiCommandBuffer *cb, const QVector4D &c)
 {
-    Q_UNUSED(cb);
-    Q_UNUSED(c);
+    if (!costModel)
+        return;
+
+    QNullCommandBuffer *cbD = QRHI_RES(QNullCommandBuffer, cb);
+    countDynamicState(&stats, &cbD->currentBlendConstants, &cbD->hasBlendConstants, c);
 }
 
 void QRhiNull::setStencilRef(QRhiCommandBuffer *cb, quint32 refValue)
+{
+    if (!costModel)
+        return;
+
+    QNullCommandBuffer *cbD = QRHI_RES(QNullCommandBuffer, cb);
+    countDynamicState(&stats, &cbD->currentStencilRef, &cbD->hasStencilRef, refValue);
+}
+
+void QRhiNull::setPushConstants(QRhiCommandBuffer *cb, QRhiShaderResourceBinding::StageFlags stages,
+                                quint32 offset, quint32 size, const void *data)
 {
     Q_UNUSED(cb);
-    Q_UNUSED(refValue);
+    Q_UNUSED(stages);
+    Q_UNUSED(offset);
+    Q_UNUSED(size);
+    Q_UNUSED(data);
 }
 
 void QRhiNull::draw(QRhiCommandBuffer *cb, quint32 vertexCount,
@@ -243,6 +429,8 @@ void QRhiNull::draw(QRhiCommandBuffer *cb, quint32 vertexCount,
     Q_UNUSED(instanceCount);
     Q_UNUSED(firstVertex);
     Q_UNUSED(firstInstance);
+    if (costModel)
+        stats.drawCount += 1;
 }
 
 void QRhiNull::drawIndexed(QRhiCommandBuffer *cb, quint32 indexCount,
@@ -254,6 +442,55 @@ void QRhiNull::drawIndexed(QRhiCommandBuffer *cb, quint32 indexCount,
     Q_UNUSED(firstIndex);
     Q_UNUSED(vertexOffset);
     Q_UNUSED(firstInstance);
+    if (costModel)
+        stats.drawCount += 1;
+}
+
+template<typename T>
+static const T *nullIndirectCommand(QNullBuffer *bufD, quint32 offset, quint32 stride, quint32 i)
+{
+    const quint64 pos = quint64(offset) + quint64(i) * stride;
+    if (pos + sizeof(T) > quint64(bufD->data.size())) {
+        qWarning("Indirect draw command %u is out of range (buffer size %d)", i, bufD->data.size());
+        return nullptr;
+    }
+    return reinterpret_cast<const T *>(bufD->data.constData() + pos);
+}
+
+void QRhiNull::drawIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                            quint32 indirectBufferOffset, quint32 drawCount, quint32 stride)
+{
+    QNullBuffer *bufD = QRHI_RES(QNullBuffer, indirectBuffer);
+    for (quint32 i = 0; i < drawCount; ++i) {
+        const QRhiCommandBuffer::DrawIndirectCommand *c =
+                nullIndirectCommand<QRhiCommandBuffer::DrawIndirectCommand>(bufD, indirectBufferOffset, stride, i);
+        if (!c)
+            break;
+        draw(cb, c->vertexCount, c->instanceCount, c->firstVertex, c->firstInstance);
+    }
+}
+
+void QRhiNull::drawIndexedIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                                   quint32 indirectBufferOffset, quint32 drawCount, quint32 stride)
+{
+    QNullBuffer *bufD = QRHI_RES(QNullBuffer, indirectBuffer);
+    for (quint32 i = 0; i < drawCount; ++i) {
+        const QRhiCommandBuffer::DrawIndexedIndirectCommand *c =
+                nullIndirectCommand<QRhiCommandBuffer::DrawIndexedIndirectCommand>(bufD, indirectBufferOffset, stride, i);
+        if (!c)
+            break;
+        drawIndexed(cb, c->indexCount, c->instanceCount, c->firstIndex, c->vertexOffset, c->firstInstance);
+    }
+}
+
+void QRhiNull::dispatch(QRhiCommandBuffer *cb, int x, int y, int z)
+{
+    Q_UNUSED(cb);
+    Q_UNUSED(x);
+    Q_UNUSED(y);
+    Q_UNUSED(z);
+    if (costModel)
+        stats.dispatchCount += 1;
 }
 
 void QRhiNull::debugMarkBegin(QRhiCommandBuffer *cb, const QByteArray &name)
@@ -276,6 +513,8 @@ void QRhiNull::debugMarkMsg(QRhiCommandBuffer *cb, const QByteArray &msg)
 QRhi::FrameOpResult QRhiNull::beginFrame(QRhiSwapChain *swapChain, QRhi::BeginFrameFlags flags)
 {
     Q_UNUSED(flags);
+    currentSwapChain = QRHI_RES(QNullSwapChain, swapChain);
+    currentSwapChain->cb.resetState();
     QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
     QRHI_PROF_F(beginSwapChainFrame(swapChain));
     return QRhi::FrameOpSuccess;
@@ -289,17 +528,23 @@ QRhi::FrameOpResult QRhiNull::endFrame(QRhiSwapChain *swapChain, QRhi::EndFrameF
     QRHI_PROF_F(endSwapChainFrame(swapChain, swapChainD->frameCount + 1));
     QRHI_PROF_F(swapChainFrameGpuTime(swapChain, 0.000666f));
     swapChainD->frameCount += 1;
+    currentSwapChain = nullptr;
+    if (costModel)
+        stats.frameCount += 1;
     return QRhi::FrameOpSuccess;
 }
 
 QRhi::FrameOpResult QRhiNull::beginOffscreenFrame(QRhiCommandBuffer **cb)
 {
-    Q_UNUSED(cb);
+    offscreenCommandBuffer.resetState();
+    *cb = &offscreenCommandBuffer;
     return QRhi::FrameOpSuccess;
 }
 
 QRhi::FrameOpResult QRhiNull::endOffscreenFrame()
 {
+    if (costModel)
+        stats.frameCount += 1;
     return QRhi::FrameOpSuccess;
 }
 
@@ -311,8 +556,130 @@ QRhi::FrameOpResult QRhiNull::finish()
 void QRhiNull::resourceUpdate(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
 {
     Q_UNUSED(cb);
+    applyResourceUpdates(resourceUpdates);
+}
+
+void QRhiNull::applyResourceUpdates(QRhiResourceUpdateBatch *resourceUpdates)
+{
     QRhiResourceUpdateBatchPrivate *ud = QRhiResourceUpdateBatchPrivate::get(resourceUpdates);
+    if (costModel)
+        countResourceUpdates(ud);
+
+    // Nothing is stored, except for indirect buffers, because the draw
+    // commands in those are decoded in drawIndirect and drawIndexedIndirect.
+    auto write = [](QRhiBuffer *buf, int offset, const QByteArray &data) {
+        QNullBuffer *bufD = QRHI_RES(QNullBuffer, buf);
+        if (bufD->data.isEmpty())
+            return;
+        const int size = qMin(data.size(), bufD->data.size() - offset);
+        if (size > 0)
+            memcpy(bufD->data.data() + offset, data.constData(), size);
+    };
+
+    for (const QRhiResourceUpdateBatchPrivate::DynamicBufferUpdate &u : ud->dynamicBufferUpdates)
+        write(u.buf, u.offset, u.data);
+
+    for (const QRhiResourceUpdateBatchPrivate::StaticBufferUpload &u : ud->staticBufferUploads)
+        write(u.buf, u.offset, u.data);
+
+    // Readbacks complete immediately. The data is all zeroes, apart from
+    // indirect buffers, but has the size the real backends would return.
+    QVarLengthArray<std::function<void()>, 4> completedCallbacks;
+
+    for (const QRhiResourceUpdateBatchPrivate::BufferReadback &u : ud->bufferReadbacks) {
+        QNullBuffer *bufD = QRHI_RES(QNullBuffer, u.buf);
+        if (bufD->data.isEmpty())
+            u.result->data.fill('\0', u.size);
+        else
+            u.result->data = bufD->data.mid(u.offset, u.size);
+        if (costModel)
+            stats.readBackBytes += quint64(u.size);
+        if (u.result->completed)
+            completedCallbacks.append(u.result->completed);
+    }
+
+    for (const QRhiResourceUpdateBatchPrivate::TextureOp &u : ud->textureOps) {
+        if (u.type != QRhiResourceUpdateBatchPrivate::TextureOp::TexRead)
+            continue;
+        QRhiTexture *tex = u.read.rb.texture();
+        QSize levelSize;
+        if (tex)
+            levelSize = u.read.rb.level() > 0 ? q->sizeForMipLevel(u.read.rb.level(), tex->pixelSize()) : tex->pixelSize();
+        else if (currentSwapChain)
+            levelSize = currentSwapChain->rt.d.pixelSize;
+        QRect rect;
+        if (!readbackRect(u.read.rb, levelSize, &rect))
+            continue;
+        u.read.result->format = tex ? tex->format() : QRhiTexture::RGBA8;
+        u.read.result->pixelSize = rect.size();
+        quint32 byteSize = 0;
+        textureFormatInfo(u.read.result->format, rect.size(), nullptr, &byteSize);
+        if (costModel)
+            stats.readBackBytes += byteSize;
+        if (u.read.result->destination) {
+            if (u.read.result->destinationSize >= byteSize)
+                memset(u.read.result->destination, 0, byteSize);
+            else
+                qWarning("Readback destination of %u bytes is too small, need %u bytes",
+                         u.read.result->destinationSize, byteSize);
+        } else {
+            u.read.result->data.fill('\0', int(byteSize));
+        }
+        if (u.read.result->completed)
+            completedCallbacks.append(u.read.result->completed);
+    }
+
     ud->free();
+
+    for (auto f : completedCallbacks)
+        f();
+}
+
+void QRhiNull::countResourceUpdates(QRhiResourceUpdateBatchPrivate *ud)
+{
+    for (const QRhiResourceUpdateBatchPrivate::DynamicBufferUpdate &u : ud->dynamicBufferUpdates)
+        stats.uploadedBytes += quint64(u.data.size());
+
+    for (const QRhiResourceUpdateBatchPrivate::StaticBufferUpload &u : ud->staticBufferUploads)
+        stats.uploadedBytes += quint64(u.data.size());
+
+    for (const QRhiResourceUpdateBatchPrivate::TextureOp &u : ud->textureOps) {
+        switch (u.type) {
+        case QRhiResourceUpdateBatchPrivate::TextureOp::TexUpload:
+            for (const QRhiTextureLayer &layer : u.upload.desc.layers()) {
+                for (const QRhiTextureMipLevel &mipImage : layer.mipImages()) {
+                    const QImage image = mipImage.image();
+                    if (image.isNull()) {
+                        stats.uploadedBytes += quint64(mipImage.compressedData().size());
+                    } else {
+                        const QSize size = mipImage.sourceSize().isEmpty() ? image.size() : mipImage.sourceSize();
+                        stats.uploadedBytes += quint64(size.width()) * quint64(size.height()) * quint64(image.depth() / 8);
+                    }
+                }
+            }
+            break;
+        case QRhiResourceUpdateBatchPrivate::TextureOp::TexCopy:
+        {
+            const QRhiTextureCopyDescription &desc(u.copy.desc);
+            QSize size = desc.pixelSize();
+            if (size.isEmpty())
+                size = q->sizeForMipLevel(desc.sourceLevel(), u.copy.src->pixelSize());
+            stats.copiedBytes += approxByteSizeForTexture(u.copy.src->format(), size, 1, 1);
+        }
+            break;
+        case QRhiResourceUpdateBatchPrivate::TextureOp::TexMipGen:
+        {
+            // everything but the base level gets written
+            QRhiTexture *tex = u.mipgen.tex;
+            const int mipLevelCount = q->mipLevelsForSize(tex->pixelSize());
+            stats.copiedBytes += approxByteSizeForTexture(tex->format(), tex->pixelSize(), mipLevelCount, tex->layerCount())
+                    - approxByteSizeForTexture(tex->format(), tex->pixelSize(), 1, tex->layerCount());
+        }
+            break;
+        default:
+            break;
+        }
+    }
 }
 
 void QRhiNull::beginPass(QRhiCommandBuffer *cb,
@@ -321,25 +688,116 @@ void QRhiNull::beginPass(QRhiCommandBuffer *cb,
                           const QRhiDepthStencilClearValue &depthStencilClearValue,
                           QRhiResourceUpdateBatch *resourceUpdates)
 {
-    Q_UNUSED(cb);
-    Q_UNUSED(rt);
     Q_UNUSED(colorClearValue);
     Q_UNUSED(depthStencilClearValue);
-    if (resourceUpdates) {
-        QRhiResourceUpdateBatchPrivate *ud = QRhiResourceUpdateBatchPrivate::get(resourceUpdates);
-        ud->free();
+    if (resourceUpdates)
+        applyResourceUpdates(resourceUpdates);
+
+    currentTarget = rt;
+    stats.renderPassCount += 1;
+
+    if (costModel) {
+        QRHI_RES(QNullCommandBuffer, cb)->resetState();
+        if (rt->type() == QRhiRenderTarget::RtTexture)
+            countAttachmentLoads(static_cast<QRhiTextureRenderTarget *>(rt));
     }
 }
 
 void QRhiNull::endPass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
 {
     Q_UNUSED(cb);
-    if (resourceUpdates) {
-        QRhiResourceUpdateBatchPrivate *ud = QRhiResourceUpdateBatchPrivate::get(resourceUpdates);
-        ud->free();
+    if (currentTarget)
+        countAttachmentStores(currentTarget);
+
+    currentTarget = nullptr;
+
+    if (resourceUpdates)
+        applyResourceUpdates(resourceUpdates);
+}
+
+static quint32 attachmentByteSize(QRhiImplementation *rhi, QRhiTexture *tex, QRhiRenderBuffer *rb)
+{
+    if (tex)
+        return rhi->approxByteSizeForTexture(tex->format(), tex->pixelSize(), 1, 1) * quint32(tex->sampleCount());
+
+    const QRhiTexture::Format format = rb->type() == QRhiRenderBuffer::Color ? QRhiTexture::RGBA8 : QRhiTexture::D32;
+    return rhi->approxByteSizeForTexture(format, rb->pixelSize(), 1, 1) * quint32(rb->sampleCount());
+}
+
+void QRhiNull::countAttachmentLoads(QRhiTextureRenderTarget *rt)
+{
+    const QRhiTextureRenderTargetDescription desc = rt->description();
+    for (const QRhiColorAttachment &colorAtt : desc.colorAttachments()) {
+        if (colorLoadOp(rt, colorAtt) == QRhiColorAttachment::LoadOpLoad)
+            stats.attachmentLoadBytes += attachmentByteSize(this, colorAtt.texture(), colorAtt.renderBuffer());
+    }
+    if ((desc.depthTexture() || desc.depthStencilBuffer())
+            && depthStencilLoadOp(rt) == QRhiColorAttachment::LoadOpLoad)
+    {
+        stats.attachmentLoadBytes += attachmentByteSize(this, desc.depthTexture(), desc.depthStencilBuffer());
     }
 }
 
+void QRhiNull::countAttachmentStores(QRhiRenderTarget *rt)
+{
+    if (rt->type() == QRhiRenderTarget::RtRef) {
+        // swapchain color buffers are always written out, the depth-stencil never
+        if (costModel && currentSwapChain) {
+            stats.attachmentStoreBytes += approxByteSizeForTexture(QRhiTexture::RGBA8, currentSwapChain->rt.d.pixelSize, 1, 1)
+                    * quint32(qMax(1, currentSwapChain->sampleCount()));
+        }
+        return;
+    }
+
+    QRhiTextureRenderTarget *texRt = static_cast<QRhiTextureRenderTarget *>(rt);
+    const QRhiTextureRenderTargetDescription desc = texRt->description();
+    for (const QRhiColorAttachment &colorAtt : desc.colorAttachments()) {
+        if (colorStoreOp(colorAtt) == QRhiColorAttachment::StoreOpDontCare) {
+            stats.discardedColorStores += 1;
+            stats.discardedStoreBytes += attachmentByteSize(this, colorAtt.texture(), colorAtt.renderBuffer());
+        } else if (costModel) {
+            stats.attachmentStoreBytes += attachmentByteSize(this, colorAtt.texture(), colorAtt.renderBuffer());
+        }
+        if (costModel && colorAtt.resolveTexture())
+            stats.attachmentStoreBytes += attachmentByteSize(this, colorAtt.resolveTexture(), nullptr);
+    }
+    if (desc.depthTexture() || desc.depthStencilBuffer()) {
+        const quint32 byteSize = attachmentByteSize(this, desc.depthTexture(), desc.depthStencilBuffer());
+        if (depthStencilStoreOp(texRt) == QRhiColorAttachment::StoreOpDontCare) {
+            stats.discardedDepthStencilStores += 1;
+            stats.discardedStoreBytes += byteSize;
+        } else if (costModel) {
+            stats.attachmentStoreBytes += byteSize;
+        }
+    }
+}
+
+void QRhiNull::updateMemoryStatistics()
+{
+    if (!costModel)
+        return;
+
+    const QRhiMemoryStatistics ms = memoryStatistics();
+    stats.memoryBytes = quint64(ms.totalBytes());
+    stats.peakMemoryBytes = qMax(stats.peakMemoryBytes, stats.memoryBytes);
+}
+
+void QRhiNull::beginComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
+{
+    if (costModel)
+        QRHI_RES(QNullCommandBuffer, cb)->resetState();
+
+    if (resourceUpdates)
+        applyResourceUpdates(resourceUpdates);
+}
+
+void QRhiNull::endComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
+{
+    Q_UNUSED(cb);
+    if (resourceUpdates)
+        applyResourceUpdates(resourceUpdates);
+}
+
 QNullBuffer::QNullBuffer(QRhiImplementation *rhi, Type type, UsageFlags usage, int size)
     : QRhiBuffer(rhi, type, usage, size)
 {
@@ -347,14 +805,25 @@ QNullBuffer::QNullBuffer(QRhiImplementation *rhi, Type type, UsageFlags usage, i
 
 void QNullBuffer::release()
 {
+    data.clear();
+
     QRHI_PROF;
     QRHI_PROF_F(releaseBuffer(this));
+    m_rhi->removeBufferMemory(this);
+    QRHI_RES_RHI(QRhiNull);
+    rhiD->updateMemoryStatistics();
 }
 
 bool QNullBuffer::build()
 {
+    if (m_usage.testFlag(QRhiBuffer::IndirectBuffer))
+        data.fill('\0', m_size);
+
     QRHI_PROF;
     QRHI_PROF_F(newBuffer(this, m_size, 1, 0));
+    m_rhi->addBufferMemory(this, m_size, 1);
+    QRHI_RES_RHI(QRhiNull);
+    rhiD->updateMemoryStatistics();
     return true;
 }
 
@@ -368,12 +837,18 @@ void QNullRenderBuffer::release()
 {
     QRHI_PROF;
     QRHI_PROF_F(releaseRenderBuffer(this));
+    m_rhi->removeRenderBufferMemory(this);
+    QRHI_RES_RHI(QRhiNull);
+    rhiD->updateMemoryStatistics();
 }
 
 bool QNullRenderBuffer::build()
 {
     QRHI_PROF;
     QRHI_PROF_F(newRenderBuffer(this, false, false, 1));
+    m_rhi->addRenderBufferMemory(this, 1);
+    QRHI_RES_RHI(QRhiNull);
+    rhiD->updateMemoryStatistics();
     return true;
 }
 
@@ -392,28 +867,32 @@ void QNullTexture::release()
 {
     QRHI_PROF;
     QRHI_PROF_F(releaseTexture(this));
+    m_rhi->removeTextureMemory(this);
+    QRHI_RES_RHI(QRhiNull);
+    rhiD->updateMemoryStatistics();
 }
 
 bool QNullTexture::build()
 {
-    const bool isCube = m_flags.testFlag(CubeMap);
     const bool hasMipMaps = m_flags.testFlag(MipMapped);
     QSize size = m_pixelSize.isEmpty() ? QSize(1, 1) : m_pixelSize;
     const int mipLevelCount = hasMipMaps ? qCeil(log2(qMax(size.width(), size.height()))) + 1 : 1;
     QRHI_PROF;
-    QRHI_PROF_F(newTexture(this, true, mipLevelCount, isCube ? 6 : 1, 1));
+    QRHI_PROF_F(newTexture(this, true, false, mipLevelCount, layerCount(), 1));
+    m_rhi->addTextureMemory(this, mipLevelCount, layerCount(), 1);
+    QRHI_RES_RHI(QRhiNull);
+    rhiD->updateMemoryStatistics();
     return true;
 }
 
 bool QNullTexture::buildFrom(const QRhiNativeHandles *src)
 {
     Q_UNUSED(src);
-    const bool isCube = m_flags.testFlag(CubeMap);
     const bool hasMipMaps = m_flags.testFlag(MipMapped);
     QSize size = m_pixelSize.isEmpty() ? QSize(1, 1) : m_pixelSize;
     const int mipLevelCount = hasMipMaps ? qCeil(log2(qMax(size.width(), size.height()))) + 1 : 1;
     QRHI_PROF;
-    QRHI_PROF_F(newTexture(this, false, mipLevelCount, isCube ? 6 : 1, 1));
+    QRHI_PROF_F(newTexture(this, false, false, mipLevelCount, layerCount(), 1));
     return true;
 }
 
@@ -530,6 +1009,7 @@ void QNullShaderResourceBindings::release()
 
 bool QNullShaderResourceBindings::build()
 {
+    generation += 1;
     return true;
 }
 
@@ -540,16 +1020,41 @@ QNullGraphicsPipeline::QNullGraphicsPipeline(QRhiImplementation *rhi)
 
 void QNullGraphicsPipeline::release()
 {
+    QRHI_RES_RHI(QRhiNull);
+    rhiD->unregisterResource(this);
 }
 
 bool QNullGraphicsPipeline::build()
 {
+    QRHI_RES_RHI(QRhiNull);
+    generation += 1;
+    rhiD->registerResource(this);
+    return true;
+}
+
+QNullComputePipeline::QNullComputePipeline(QRhiImplementation *rhi)
+    : QRhiComputePipeline(rhi)
+{
+}
+
+void QNullComputePipeline::release()
+{
+    QRHI_RES_RHI(QRhiNull);
+    rhiD->unregisterResource(this);
+}
+
+bool QNullComputePipeline::build()
+{
+    QRHI_RES_RHI(QRhiNull);
+    generation += 1;
+    rhiD->registerResource(this);
     return true;
 }
 
 QNullCommandBuffer::QNullCommandBuffer(QRhiImplementation *rhi)
     : QRhiCommandBuffer(rhi)
 {
+    resetState();
 }
 
 void QNullCommandBuffer::release()
@@ -43,10 +43,40 @@ QT_BEGIN_NAMESPACE
 
 struct Q_RHI_EXPORT QRhiNullInitParams : public QRhiInitParams
 {
+    bool enableCostModel = false;
+};
+
+struct Q_RHI_EXPORT QRhiNullStatistics
+{
+    quint64 renderPassCount = 0;
+    quint64 discardedColorStores = 0;
+    quint64 discardedDepthStencilStores = 0;
+    quint64 discardedStoreBytes = 0;
+
+    // only with QRhiNullInitParams::enableCostModel
+    quint64 frameCount = 0;
+    quint64 drawCount = 0;
+    quint64 dispatchCount = 0;
+    quint64 pipelineChanges = 0;
+    quint64 redundantPipelineBinds = 0;
+    quint64 shaderResourceChanges = 0;
+    quint64 redundantShaderResourceBinds = 0;
+    quint64 vertexInputChanges = 0;
+    quint64 redundantVertexInputBinds = 0;
+    quint64 dynamicStateChanges = 0;
+    quint64 redundantDynamicStateChanges = 0;
+    quint64 uploadedBytes = 0;
+    quint64 copiedBytes = 0;
+    quint64 readBackBytes = 0;
+    quint64 attachmentLoadBytes = 0;
+    quint64 attachmentStoreBytes = 0;
+    quint64 memoryBytes = 0;
+    quint64 peakMemoryBytes = 0;
 };
 
 struct Q_RHI_EXPORT QRhiNullNativeHandles : public QRhiNativeHandles
 {
+    const QRhiNullStatistics *statistics = nullptr;
 };
 
 struct Q_RHI_EXPORT QRhiNullTextureNativeHandles : public QRhiNativeHandles
@@ -51,6 +51,8 @@ struct QNullBuffer : public QRhiBuffer
     QNullBuffer(QRhiImplementation *rhi, Type type, UsageFlags usage, int size);
     void release() override;
     bool build() override;
+
+    QByteArray data; // only for IndirectBuffer, so that draw commands can be decoded
 };
 
 struct QNullRenderBuffer : public QRhiRenderBuffer
@@ -128,6 +130,8 @@ struct QNullShaderResourceBindings : public QRhiShaderResourceBindings
     QNullShaderResourceBindings(QRhiImplementation *rhi);
     void release() override;
     bool build() override;
+
+    uint generation = 0;
 };
 
 struct QNullGraphicsPipeline : public QRhiGraphicsPipeline
@@ -135,12 +139,62 @@ struct QNullGraphicsPipeline : public QRhiGraphicsPipeline
     QNullGraphicsPipeline(QRhiImplementation *rhi);
     void release() override;
     bool build() override;
+
+    uint generation = 0;
+};
+
+struct QNullComputePipeline : public QRhiComputePipeline
+{
+    QNullComputePipeline(QRhiImplementation *rhi);
+    void release() override;
+    bool build() override;
+
+    uint generation = 0;
 };
 
 struct QNullCommandBuffer : public QRhiCommandBuffer
 {
     QNullCommandBuffer(QRhiImplementation *rhi);
     void release() override;
+
+    // The current state is only tracked for the cost model, to tell real
+    // state changes apart from redundant ones.
+    QRhiGraphicsPipeline *currentGraphicsPipeline;
+    QRhiComputePipeline *currentComputePipeline;
+    uint currentPipelineGeneration;
+    QRhiShaderResourceBindings *currentSrb;
+    uint currentSrbGeneration;
+    QVector<QRhiCommandBuffer::DynamicOffset> currentDynamicOffsets;
+    QVector<QRhiCommandBuffer::VertexInput> currentVertexInputs;
+    QRhiBuffer *currentIndexBuffer;
+    quint32 currentIndexOffset;
+    QRhiCommandBuffer::IndexFormat currentIndexFormat;
+    QRhiViewport currentViewport;
+    bool hasViewport;
+    QRhiScissor currentScissor;
+    bool hasScissor;
+    QVector4D currentBlendConstants;
+    bool hasBlendConstants;
+    quint32 currentStencilRef;
+    bool hasStencilRef;
+
+    void resetState() {
+        currentGraphicsPipeline = nullptr;
+        currentComputePipeline = nullptr;
+        currentPipelineGeneration = 0;
+        currentSrb = nullptr;
+        currentSrbGeneration = 0;
+        currentDynamicOffsets.clear();
+        currentVertexInputs.clear();
+        currentIndexBuffer = nullptr;
+        currentIndexOffset = 0;
+        currentIndexFormat = QRhiCommandBuffer::IndexUInt16;
+        hasViewport = false;
+        hasScissor = false;
+        hasBlendConstants = false;
+        currentStencilRef = 0;
+        hasStencilRef = false;
+    }
 };
 
 struct QNullSwapChain : public QRhiSwapChain
@@ -170,6 +224,7 @@ public:
     void destroy() override;
 
     QRhiGraphicsPipeline *createGraphicsPipeline() override;
+    QRhiComputePipeline *createComputePipeline() override;
     QRhiShaderResourceBindings *createShaderResourceBindings() override;
     QRhiBuffer *createBuffer(QRhiBuffer::Type type,
                              QRhiBuffer::UsageFlags usage,
@@ -205,8 +260,13 @@ public:
                    QRhiResourceUpdateBatch *resourceUpdates) override;
     void endPass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) override;
 
+    void beginComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) override;
+    void endComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) override;
+
     void setGraphicsPipeline(QRhiCommandBuffer *cb,
                              QRhiGraphicsPipeline *ps) override;
+    void setComputePipeline(QRhiCommandBuffer *cb,
+                            QRhiComputePipeline *ps) override;
 
     void setShaderResources(QRhiCommandBuffer *cb,
                             QRhiShaderResourceBindings *srb,
@@ -221,6 +281,8 @@ public:
     void setScissor(QRhiCommandBuffer *cb, const QRhiScissor &scissor) override;
     void setBlendConstants(QRhiCommandBuffer *cb, const QVector4D &c) override;
     void setStencilRef(QRhiCommandBuffer *cb, quint32 refValue) override;
+    void setPushConstants(QRhiCommandBuffer *cb, QRhiShaderResourceBinding::StageFlags stages,
+                          quint32 offset, quint32 size, const void *data) override;
 
     void draw(QRhiCommandBuffer *cb, quint32 vertexCount,
               quint32 instanceCount, quint32 firstVertex, quint32 firstInstance) override;
@@ -229,6 +291,13 @@ public:
                      quint32 instanceCount, quint32 firstIndex,
                      qint32 vertexOffset, quint32 firstInstance) override;
 
+    void drawIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                      quint32 indirectBufferOffset, quint32 drawCount, quint32 stride) override;
+    void drawIndexedIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                             quint32 indirectBufferOffset, quint32 drawCount, quint32 stride) override;
+
+    void dispatch(QRhiCommandBuffer *cb, int x, int y, int z) override;
+
     void debugMarkBegin(QRhiCommandBuffer *cb, const QByteArray &name) override;
     void debugMarkEnd(QRhiCommandBuffer *cb) override;
     void debugMarkMsg(QRhiCommandBuffer *cb, const QByteArray &msg) override;
@@ -239,11 +308,23 @@ public:
     bool isYUpInNDC() const override;
     QMatrix4x4 clipSpaceCorrMatrix() const override;
     bool isTextureFormatSupported(QRhiTexture::Format format, QRhiTexture::Flags flags) const override;
+    bool isVertexFormatSupported(QRhiVertexInputAttribute::Format format) const override;
     bool isFeatureSupported(QRhi::Feature feature) const override;
     int resourceSizeLimit(QRhi::ResourceSizeLimit limit) const override;
     const QRhiNativeHandles *nativeHandles() override;
 
+    void applyResourceUpdates(QRhiResourceUpdateBatch *resourceUpdates);
+    void countResourceUpdates(QRhiResourceUpdateBatchPrivate *ud);
+    void countAttachmentLoads(QRhiTextureRenderTarget *rt);
+    void countAttachmentStores(QRhiRenderTarget *rt);
+    void updateMemoryStatistics();
+
     QRhiNullNativeHandles nativeHandlesStruct;
+    QRhiNullStatistics stats;
+    bool costModel = false;
+    QNullCommandBuffer offscreenCommandBuffer;
+    QRhiRenderTarget *currentTarget = nullptr;
+    QNullSwapChain *currentSwapChain = nullptr;
 };
 
 QT_END_NAMESPACE
@@ -36,6 +36,7 @@
 
 #include "qrhiprofiler_p.h"
 #include "qrhi_p.h"
+#include <qmath.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -57,10 +58,22 @@ QT_BEGIN_NAMESPACE
     profiler gives an estimate of the complete amount of memory the resource
     needs.
 
+    Recording an entry is cheap: it is stored into a fixed size, lock-free ring
+    buffer on the thread using the QRhi. Formatting and writing to the output
+    device happens on a separate, low priority writer thread. If the writer
+    thread cannot keep up, entries are dropped rather than stalling rendering,
+    and a warning is printed.
+
+    \note The output device is written from the writer thread. The
+    application must not access the device while it is set. Call
+    setDevice() with null to stop writing. All pending entries are written
+    before setDevice() returns.
+
     \section2 Output Format
 
-    The output is comma-separated text. Each line has a number of
-    comma-separated entries and each line ends with a comma.
+    With the default QRhiProfiler::TextFormat the output is comma-separated
+    text. Each line has a number of comma-separated entries and each line
+    ends with a comma.
 
     For example:
 
@@ -72,20 +85,20 @@ QT_BEGIN_NAMESPACE
         1,1,140446057947440,,type,2,usage,4,logical_size,68,effective_size,256,backing_gpu_buf_count,2,backing_cpu_buf_count,0,
         1,1,140446057984784,Cube vbuf (textured),type,0,usage,1,logical_size,720,effective_size,720,backing_gpu_buf_count,1,backing_cpu_buf_count,0,
         1,1,140446057982528,Cube ubuf (textured),type,2,usage,4,logical_size,68,effective_size,256,backing_gpu_buf_count,2,backing_cpu_buf_count,0,
-        7,8,140446058913648,Qt texture,width,256,height,256,format,1,owns_native_resource,1,mip_count,9,layer_count,1,effective_sample_count,1,approx_byte_size,349524,
+        7,8,140446058913648,Qt texture,width,256,height,256,format,1,owns_native_resource,1,transient_backing,0,mip_count,9,layer_count,1,effective_sample_count,1,approx_byte_size,349524,
         1,8,140446058795856,Cube vbuf (textured with offscreen),type,0,usage,1,logical_size,720,effective_size,720,backing_gpu_buf_count,1,backing_cpu_buf_count,0,
         1,8,140446058947920,Cube ubuf (textured with offscreen),type,2,usage,4,logical_size,68,effective_size,256,backing_gpu_buf_count,2,backing_cpu_buf_count,0,
-        7,8,140446058794928,Texture for offscreen content,width,512,height,512,format,1,owns_native_resource,1,mip_count,1,layer_count,1,effective_sample_count,1,approx_byte_size,1048576,
+        7,8,140446058794928,Texture for offscreen content,width,512,height,512,format,1,owns_native_resource,1,transient_backing,0,mip_count,1,layer_count,1,effective_sample_count,1,approx_byte_size,1048576,
         1,8,140446058963904,Triangle vbuf,type,0,usage,1,logical_size,84,effective_size,84,backing_gpu_buf_count,1,backing_cpu_buf_count,0,
         1,8,140446058964560,Triangle ubuf,type,2,usage,4,logical_size,68,effective_size,256,backing_gpu_buf_count,2,backing_cpu_buf_count,0,
         5,9,140446057945392,,type,0,width,1280,height,720,effective_sample_count,1,transient_backing,0,winsys_backing,0,approx_byte_size,3686400,
         11,9,140446057944592,,width,1280,height,720,buffer_count,2,msaa_buffer_count,0,effective_sample_count,1,approx_total_byte_size,7372800,
         9,9,140446058913648,Qt texture,slot,0,size,262144,
         10,9,140446058913648,Qt texture,slot,0,
-        17,2019,140446057944592,,frames_since_resize,121,min_ms_frame_delta,9,max_ms_frame_delta,33,Favg_ms_frame_delta,16.1167,
-        18,2019,140446057944592,,frames_since_resize,121,min_ms_frame_build,0,max_ms_frame_build,1,Favg_ms_frame_build,0.00833333,
-        17,4019,140446057944592,,frames_since_resize,241,min_ms_frame_delta,15,max_ms_frame_delta,17,Favg_ms_frame_delta,16.0583,
-        18,4019,140446057944592,,frames_since_resize,241,min_ms_frame_build,0,max_ms_frame_build,0,Favg_ms_frame_build,0,
+        17,2019,140446057944592,,frames_since_resize,121,Fmin_ms_frame_delta,9.3241,Fmax_ms_frame_delta,33.0187,Favg_ms_frame_delta,16.1167,
+        18,2019,140446057944592,,frames_since_resize,121,Fmin_ms_frame_build,0.0512,Fmax_ms_frame_build,1.0044,Favg_ms_frame_build,0.0833,
+        17,4019,140446057944592,,frames_since_resize,241,Fmin_ms_frame_delta,15.2201,Fmax_ms_frame_delta,17.0036,Favg_ms_frame_delta,16.0583,
+        18,4019,140446057944592,,frames_since_resize,241,Fmin_ms_frame_build,0.0487,Fmax_ms_frame_build,0.0931,Favg_ms_frame_build,0.0602,
         12,5070,140446057944592,,
         2,5079,140446057947376,Triangle ubuf,
         2,5079,140446057946208,Triangle vbuf,
@@ -105,7 +118,7 @@ QT_BEGIN_NAMESPACE
 
     Each line starts with \c op, \c timestamp, \c res, \c name where op is a
     value from StreamOp, timestamp is a recording timestamp in milliseconds
-    (qint64), res is a number (quint64) refering to the QRhiResource the entry
+    (qint64) in the text format, res is a number (quint64) refering to the QRhiResource the entry
     refers to, or 0 if not applicable. \c name is the value of
     QRhiResource::name() and may be empty as well. The \c name will never
     contain a comma.
@@ -114,6 +127,52 @@ QT_BEGIN_NAMESPACE
     unspecified string and \c value is a number. If \c key starts with \c F, it
     indicates the value is a float. Otherwise assume that the value is a
     qint64.
+
+    \c name is truncated to 47 bytes.
+
+    With QRhiProfiler::BinaryFormat the output starts with the 8 bytes
+    \c QRHIPROF and a quint32 version number, currently 1, followed by the
+    entries. All numbers are in the byte order of the host. Each entry
+    consists of:
+
+    \list
+    \li quint16 \c op
+    \li quint16 \c{pair count}
+    \li qint64 \c timestamp in nanoseconds
+    \li quint64 \c res
+    \li quint8 length of \c name, followed by the bytes of \c name
+    \li for each pair: quint8 length of \c key, followed by the bytes of
+    \c key, and then 8 bytes for \c value, which is a qint64, or a double
+    when \c key starts with \c F.
+    \endlist
+
+    Text and binary captures can be summarized and compared with the \c
+    qrhiprof tool: peak memory per resource type, resources that are never
+    released, staging buffer churn, and frame time distributions.
+
+    With QRhiProfiler::ChromeTraceFormat the output is a JSON array of trace
+    events. Timestamps are in microseconds. The \c QRhi process has a track
+    per swapchain with a \c frame slice spanning from beginFrame() to
+    endFrame() and a \c present slice covering the submission and present
+    in endFrame(). Each command buffer gets a track with the
+    QRhiCommandBuffer::debugMarkBegin() - QRhiCommandBuffer::debugMarkEnd()
+    groups as nested slices. These are recorded also when
+    QRhi::EnableDebugMarkers is not set. Resource related entries are
+    instant events on the \c resources track with the key-value pairs as
+    arguments, while the aggregated frame timings and allocator statistics
+    are counters. The \c{QRhi GPU} process has a track per swapchain with
+    the GPU time of each frame. As the GPU time becomes known only later,
+    these slices are placed so that they end when the time was reported,
+    meaning only their length is accurate. With marker timing enabled the
+    GPU times of the debug marker scopes are shown as nested slices in the
+    \c{QRhi GPU markers} process, positioned relative to each other but,
+    like the frames, not to the CPU timeline.
+
+    For renderbuffers and textures \c transient_backing is 1 when the native
+    resource is backed by lazily allocated or memoryless storage. The \c
+    approx_byte_size of such resources is what they would need with ordinary
+    memory; on tiled GPUs it is likely that little or none of it is actually
+    committed.
  */
 
 /*!
@@ -138,6 +197,28 @@ QT_BEGIN_NAMESPACE
     \value GpuFrameTime GPU frame times
     \value FrameToFrameTime CPU frame-to-frame times
     \value FrameBuildTime CPU beginFrame-endFrame times
+    \value BeginFrame QRhi::beginFrame() returned successfully for a swapchain
+    \value EndFrame QRhi::endFrame() is called for a swapchain
+    \value FramePresented QRhi::endFrame() returned, the frame is submitted and queued for presentation
+    \value GpuFrameTimeSample GPU time for a single frame, in milliseconds
+    \value DebugMarkBegin QRhiCommandBuffer::debugMarkBegin() was called, \c name is the name of the debug group
+    \value DebugMarkEnd QRhiCommandBuffer::debugMarkEnd() was called
+    \value DebugMarkTime CPU and GPU time of a debug marker scope in a completed frame, see setMarkerTimingEnabled()
+    \value FrameCounters Command and resource update counters of a completed frame, see frameStatistics()
+ */
+
+/*!
+    \enum QRhiProfiler::OutputFormat
+    Specifies the format of the data written to the output device.
+
+    \value TextFormat Comma-separated text, with timestamps in milliseconds.
+    This is the default.
+
+    \value BinaryFormat Compact binary entries, with timestamps in
+    nanoseconds.
+
+    \value ChromeTraceFormat JSON in the Chrome Trace Event format, to be
+    viewed in \c{chrome://tracing} or the Perfetto UI.
  */
 
 /*!
@@ -146,13 +227,94 @@ QT_BEGIN_NAMESPACE
     \brief Contains CPU-side frame timings.
 
     Once sufficient number of frames have been rendered, the minimum, maximum,
-    and average values (in milliseconds) from various measurements are made
-    available in this struct queriable from QRhiProfiler::frameToFrameTimes()
-    and QRhiProfiler::frameBuildTimes().
+    and average values (in milliseconds, with sub-millisecond precision) from
+    various measurements are made available in this struct queriable from
+    QRhiProfiler::frameToFrameTimes() and QRhiProfiler::frameBuildTimes().
 
     \sa QRhiProfiler::setFrameTimingWriteInterval()
  */
 
+/*!
+    \class QRhiProfiler::MarkerTime
+    \inmodule QtRhi
+    \brief Contains the timings of a debug marker scope.
+
+    \c name is the name passed to QRhiCommandBuffer::debugMarkBegin(). \c
+    depth is the nesting level, 0 for top-level scopes, while \c parentIndex
+    is the index of the enclosing scope in the list returned from
+    QRhiProfiler::markerTimes(), or -1.
+
+    \c cpuTime is the time in milliseconds that elapsed between the
+    QRhiCommandBuffer::debugMarkBegin() and QRhiCommandBuffer::debugMarkEnd()
+    calls, meaning the time spent on recording the commands in the scope.
+    \c gpuTime is the time in milliseconds the GPU spent on executing the
+    commands in the scope, or -1 when this is not available.
+
+    \sa QRhiProfiler::setMarkerTimingEnabled()
+ */
+
+/*!
+    \class QRhiProfiler::FrameStatistics
+    \inmodule QtRhi
+    \brief Contains the number of commands and resource updates in a frame.
+
+    The counters cover the commands recorded on the command buffer of a frame
+    and the resource updates submitted in it:
+
+    \list
+    \li \c drawCalls - the number of draws: one for each draw() and
+    drawIndexed() call, and \c drawCount for each drawIndirect() and
+    drawIndexedIndirect() call
+    \li \c dispatchCalls - the number of dispatch() calls
+    \li \c passes - the number of render and compute passes
+    \li \c pipelineBinds - the number of setGraphicsPipeline() and
+    setComputePipeline() calls
+    \li \c shaderResourceBinds - the number of setShaderResources() calls
+    \li \c vertexInputBinds - the number of setVertexInput() calls
+    \li \c descriptorSetUpdates - the number of times the backend had to
+    rewrite a native descriptor set (Vulkan only)
+    \li \c barriers - the number of pipeline or memory barriers issued by the
+    backend (Vulkan and OpenGL only)
+    \li \c uploadBytes - the number of bytes passed in dynamic buffer
+    updates, static buffer uploads, and texture uploads
+    \li \c readbacks - the number of texture and buffer readbacks
+    \endlist
+
+    The \c set and \c draw counters are based on the calls made by the
+    application. Calls the backend optimizes out, for example because the
+    same pipeline is already bound, are counted as well. Indirect draws count
+    each of the \c drawCount commands, which matches the \c drawCount
+    statistic of the QRhi::Null cost model as long as all commands are within
+    the indirect buffer.
+
+    \sa QRhiProfiler::frameStatistics()
+ */
+
+/*!
+    \class QRhiProfiler::FrameTimePercentiles
+    \inmodule QtRhi
+    \brief Contains frame time percentiles.
+
+    Unlike CpuTime and GpuTime, which describe the last
+    frameTimingWriteInterval() frames, the percentiles are calculated from a
+    histogram of all frames since the start, or since the last call to
+    QRhiProfiler::resetFrameTimeHistograms(). \c p50, \c p90, \c p99, and \c
+    p999 are the 50th, 90th, 99th, and 99.9th percentiles in milliseconds.
+    \c frameCount is the number of recorded frames, \c overBudgetCount is
+    the number of those that took longer than
+    QRhiProfiler::frameTimeBudget().
+
+    The histogram uses a fixed amount of memory per swapchain and measurement.
+    Times are recorded in whole microseconds. Up to 0.128 ms every microsecond
+    has its own bucket, so the percentiles are exact at that resolution. Above
+    that, each power of two range is split into 64 buckets, and the reported
+    value, the middle of the bucket, is within 1/128 (less than 0.8%) of the
+    recorded times in it. Times above about 134 seconds are clamped.
+
+    \sa QRhiProfiler::frameToFramePercentiles(),
+    QRhiProfiler::frameBuildPercentiles(), QRhiProfiler::gpuFramePercentiles()
+ */
+
 /*!
     \class QRhiProfiler::GpuTime
     \inmodule QtRhi
@@ -184,13 +346,36 @@ QRhiProfiler::~QRhiProfiler()
 }
 
 /*!
-    Sets the output \a device.
+    Sets the output \a device. Writing starts in the background immediately.
+    Any previously set device gets all pending entries written before this
+    function returns.
 
     \note No output will be generated when QRhi::EnableProfiling was not set.
  */
 void QRhiProfiler::setDevice(QIODevice *device)
 {
+    d->stopWriter();
     d->outputDevice = device;
+    if (device)
+        d->startWriter();
+}
+
+/*!
+    \return the current output format.
+ */
+QRhiProfiler::OutputFormat QRhiProfiler::outputFormat() const
+{
+    return d->outputFormat;
+}
+
+/*!
+    Sets the output \a format. The default is TextFormat.
+
+    \note This must be called before setDevice().
+ */
+void QRhiProfiler::setOutputFormat(OutputFormat format)
+{
+    d->outputFormat = format;
 }
 
 /*!
@@ -273,6 +458,9 @@ QRhiProfiler::CpuTime QRhiProfiler::frameBuildTimes(QRhiSwapChain *sc) const
    \note Some backends have no support for this, and even for those that have,
    it is not guaranteed that the driver will support it at run time. Support
    can be checked via QRhi::Timestamps.
+
+   \note With OpenGL the timer queries are never waited for. When the GPU
+   falls more than a few frames behind, some frames are not timed.
  */
 QRhiProfiler::GpuTime QRhiProfiler::gpuFrameTimes(QRhiSwapChain *sc) const
 {
@@ -283,42 +471,662 @@ QRhiProfiler::GpuTime QRhiProfiler::gpuFrameTimes(QRhiSwapChain *sc) const
     return QRhiProfiler::GpuTime();
 }
 
+/*!
+    \return true if timing of debug marker scopes is enabled.
+ */
+bool QRhiProfiler::isMarkerTimingEnabled() const
+{
+    return d->markerTiming;
+}
+
+/*!
+    Enables or disables timing the debug marker scopes, based on \a enable.
+    The default is false.
+
+    When enabled, each QRhiCommandBuffer::debugMarkBegin() -
+    QRhiCommandBuffer::debugMarkEnd() scope in the command buffer of a
+    swapchain frame gets its CPU recording time measured and, with backends
+    and devices supporting QRhi::Timestamps, a pair of GPU timestamps written.
+    The GPU results are collected asynchronously, when the frame slot is
+    reused, which means the results for a frame become available a few frames
+    later. This works also when QRhi::EnableDebugMarkers is not set.
+
+    \note GPU timestamps for marker scopes are not supported by all backends.
+    The \c gpuTime of the scopes are -1 then.
+
+    \note Writing a large number of timestamps may affect the performance of
+    the GPU. The number of scopes timed on the GPU per frame is limited.
+
+    \sa markerTimes()
+ */
+void QRhiProfiler::setMarkerTimingEnabled(bool enable)
+{
+    d->markerTiming = enable;
+}
+
+/*!
+    \return the debug marker scopes of the most recently completed frame on
+    \a sc, in the order of the QRhiCommandBuffer::debugMarkBegin() calls. The
+    tree structure is described by the \c depth and \c parentIndex members.
+
+    The list is empty when marker timing is not enabled or no frame has
+    completed yet. A DebugMarkTime entry is written to the output stream for
+    each scope as well.
+
+    \sa setMarkerTimingEnabled()
+ */
+QVector<QRhiProfiler::MarkerTime> QRhiProfiler::markerTimes(QRhiSwapChain *sc) const
+{
+    auto it = d->swapchains.constFind(sc);
+    if (it != d->swapchains.constEnd())
+        return it->markerTimes;
+
+    return QVector<QRhiProfiler::MarkerTime>();
+}
+
+/*!
+    \return the counters for the most recently completed frame on \a sc, or
+    for the most recent offscreen frame when \a sc is null.
+
+    The values are updated in every QRhi::endFrame() and
+    QRhi::endOffscreenFrame(). A FrameCounters entry is written to the output
+    stream for each frame as well.
+
+    Counting is cheap and happens always when QRhi::EnableProfiling is set,
+    regardless of the output device. The counts are deterministic with all
+    backends, including QRhi::Null, which makes them suitable for detecting
+    regressions in automated tests.
+ */
+QRhiProfiler::FrameStatistics QRhiProfiler::frameStatistics(QRhiSwapChain *sc) const
+{
+    auto it = d->swapchains.constFind(sc);
+    if (it != d->swapchains.constEnd())
+        return it->frameStatistics;
+
+    return QRhiProfiler::FrameStatistics();
+}
+
+/*!
+    \return the frame time budget in milliseconds. The default is 1000 / 60.
+ */
+float QRhiProfiler::frameTimeBudget() const
+{
+    return d->frameTimeBudget;
+}
+
+/*!
+    Sets the frame time budget to \a ms milliseconds. Frames taking longer
+    are counted in the \c overBudgetCount of FrameTimePercentiles. 0 disables
+    counting.
+
+    \note This affects only the frames recorded afterwards.
+ */
+void QRhiProfiler::setFrameTimeBudget(float ms)
+{
+    d->frameTimeBudget = qMax(0.0f, ms);
+}
+
+/*!
+    Clears the frame time histograms of all swapchains and of the offscreen
+    frames. This is useful for excluding startup or a previous test section
+    from the percentiles.
+ */
+void QRhiProfiler::resetFrameTimeHistograms()
+{
+    for (QRhiProfilerPrivate::Sc &scd : d->swapchains) {
+        scd.frameToFrameHistogram.reset();
+        scd.beginToEndHistogram.reset();
+        scd.gpuFrameHistogram.reset();
+    }
+}
+
+static QRhiProfiler::FrameTimePercentiles percentilesFromHistogram(const QRhiProfilerHistogram &h)
+{
+    QRhiProfiler::FrameTimePercentiles r;
+    r.p50 = h.percentile(50);
+    r.p90 = h.percentile(90);
+    r.p99 = h.percentile(99);
+    r.p999 = h.percentile(99.9);
+    r.frameCount = h.count;
+    r.overBudgetCount = h.overBudgetCount;
+    return r;
+}
+
+/*!
+    \return the percentiles of the time that elapsed between two
+    QRhi::endFrame() calls on \a sc. When \a sc is null, the values are for
+    QRhi::endOffscreenFrame().
+ */
+QRhiProfiler::FrameTimePercentiles QRhiProfiler::frameToFramePercentiles(QRhiSwapChain *sc) const
+{
+    auto it = d->swapchains.constFind(sc);
+    if (it != d->swapchains.constEnd())
+        return percentilesFromHistogram(it->frameToFrameHistogram);
+
+    return QRhiProfiler::FrameTimePercentiles();
+}
+
+/*!
+    \return the percentiles of the time that elapsed between a
+    QRhi::beginFrame() and QRhi::endFrame() on \a sc. When \a sc is null,
+    the values are for QRhi::beginOffscreenFrame() and
+    QRhi::endOffscreenFrame(), which includes waiting for the GPU.
+ */
+QRhiProfiler::FrameTimePercentiles QRhiProfiler::frameBuildPercentiles(QRhiSwapChain *sc) const
+{
+    auto it = d->swapchains.constFind(sc);
+    if (it != d->swapchains.constEnd())
+        return percentilesFromHistogram(it->beginToEndHistogram);
+
+    return QRhiProfiler::FrameTimePercentiles();
+}
+
+/*!
+    \return the percentiles of the GPU time spent on the frames of \a sc.
+
+    \note The same limitations apply as for gpuFrameTimes(). There are no GPU
+    times for offscreen frames.
+ */
+QRhiProfiler::FrameTimePercentiles QRhiProfiler::gpuFramePercentiles(QRhiSwapChain *sc) const
+{
+    auto it = d->swapchains.constFind(sc);
+    if (it != d->swapchains.constEnd())
+        return percentilesFromHistogram(it->gpuFrameHistogram);
+
+    return QRhiProfiler::FrameTimePercentiles();
+}
+
+int QRhiProfilerHistogram::bucketIndex(quint64 us)
+{
+    if (us < quint64(LINEAR_BUCKETS))
+        return int(us);
+
+    us = qMin(us, (quint64(1) << (MAX_EXPONENT + 1)) - 1);
+    const int e = 63 - int(qCountLeadingZeroBits(us));
+    const int m = int(us >> (e - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return LINEAR_BUCKETS + (e - SUB_BUCKET_BITS - 1) * SUB_BUCKETS + m;
+}
+
+float QRhiProfilerHistogram::bucketValue(int idx)
+{
+    if (idx < LINEAR_BUCKETS)
+        return idx / 1000.0f;
+
+    // the middle of the bucket
+    const int e = SUB_BUCKET_BITS + 1 + (idx - LINEAR_BUCKETS) / SUB_BUCKETS;
+    const int m = (idx - LINEAR_BUCKETS) % SUB_BUCKETS;
+    const quint64 lower = quint64(SUB_BUCKETS + m) << (e - SUB_BUCKET_BITS);
+    const quint64 width = quint64(1) << (e - SUB_BUCKET_BITS);
+    return (lower + width / 2) / 1000.0f;
+}
+
+void QRhiProfilerHistogram::record(float ms, float budgetMs)
+{
+    if (buckets.isEmpty())
+        buckets.resize(BUCKET_COUNT);
+
+    const quint64 us = ms > 0 ? quint64(ms * 1000.0f) : 0;
+    ++buckets[bucketIndex(us)];
+    ++count;
+    if (budgetMs > 0 && ms > budgetMs)
+        ++overBudgetCount;
+}
+
+float QRhiProfilerHistogram::percentile(double p) const
+{
+    if (!count)
+        return 0;
+
+    const qint64 target = qMax<qint64>(1, qint64(qCeil(p / 100.0 * count)));
+    qint64 n = 0;
+    for (int i = 0; i < buckets.count(); ++i) {
+        n += buckets[i];
+        if (n >= target)
+            return bucketValue(i);
+    }
+    return bucketValue(buckets.count() - 1);
+}
+
+void QRhiProfilerHistogram::reset()
+{
+    buckets.clear();
+    count = 0;
+    overBudgetCount = 0;
+}
+
+QRhiProfilerPrivate::~QRhiProfilerPrivate()
+{
+    stopWriter();
+}
+
+void QRhiProfilerPrivate::startWriter()
+{
+    Q_ASSERT(!writer && outputDevice);
+    if (ring.isEmpty())
+        ring.resize(RING_SIZE);
+    ringHead.store(0);
+    ringTail.store(0);
+    droppedEventCount.store(0);
+    chromeTraceFirstEvent = true;
+    chromeTraceTracks.clear();
+    writer = new QRhiProfilerWriter(this);
+    writer->start(QThread::LowPriority);
+}
+
+void QRhiProfilerPrivate::stopWriter()
+{
+    if (!writer)
+        return;
+
+    writer->stopRequested.storeRelease(1);
+    writer->wait();
+    delete writer;
+    writer = nullptr;
+}
+
+void QRhiProfilerWriter::run()
+{
+    if (d->outputFormat == QRhiProfiler::BinaryFormat) {
+        const quint32 version = 1;
+        d->outputDevice->write("QRHIPROF", 8);
+        d->outputDevice->write(reinterpret_cast<const char *>(&version), sizeof(version));
+    } else if (d->outputFormat == QRhiProfiler::ChromeTraceFormat) {
+        QByteArray out("[");
+        d->beginChromeTraceEvent(&out, "process_name", 'M', 1, 0, 0);
+        out.append(",\"args\":{\"name\":\"QRhi\"}}");
+        d->beginChromeTraceEvent(&out, "process_name", 'M', 2, 0, 0);
+        out.append(",\"args\":{\"name\":\"QRhi GPU\"}}");
+        d->beginChromeTraceEvent(&out, "process_name", 'M', 3, 0, 0);
+        out.append(",\"args\":{\"name\":\"QRhi GPU markers\"}}");
+        d->beginChromeTraceEvent(&out, "thread_name", 'M', 1, 0, 0);
+        out.append(",\"args\":{\"name\":\"resources\"}}");
+        d->outputDevice->write(out);
+    }
+
+    while (!stopRequested.loadAcquire()) {
+        d->drain();
+        msleep(WRITE_INTERVAL_MS);
+    }
+
+    d->drain();
+
+    if (d->outputFormat == QRhiProfiler::ChromeTraceFormat)
+        d->outputDevice->write("\n]\n");
+}
+
+void QRhiProfilerPrivate::drain()
+{
+    QByteArray out;
+    quint32 tail = ringTail.load();
+    const quint32 head = ringHead.loadAcquire();
+    while (tail != head) {
+        const Event &e(ring.at(int(tail & (RING_SIZE - 1))));
+        switch (outputFormat) {
+        case QRhiProfiler::BinaryFormat:
+            appendBinaryEvent(e, &out);
+            break;
+        case QRhiProfiler::ChromeTraceFormat:
+            appendChromeTraceEvent(e, &out);
+            break;
+        default:
+            appendTextEvent(e, &out);
+            break;
+        }
+        ++tail;
+    }
+    ringTail.storeRelease(tail);
+
+    const quint32 dropped = droppedEventCount.fetchAndStoreRelaxed(0);
+    if (dropped)
+        qWarning("QRhiProfiler: %u entries dropped because the writer could not keep up", dropped);
+
+    if (!out.isEmpty())
+        outputDevice->write(out);
+}
+
+void QRhiProfilerPrivate::appendTextEvent(const Event &e, QByteArray *dst)
+{
+    dst->append(QByteArray::number(e.op));
+    dst->append(',');
+    dst->append(QByteArray::number(e.timestamp / 1000000));
+    dst->append(',');
+    dst->append(QByteArray::number(e.res));
+    dst->append(',');
+    dst->append(e.name);
+    dst->append(',');
+    for (int i = 0; i < e.pairCount; ++i) {
+        const Event::Pair &pair(e.pairs[i]);
+        dst->append(pair.key);
+        dst->append(',');
+        if (pair.key[0] == 'F')
+            dst->append(QByteArray::number(pair.f));
+        else
+            dst->append(QByteArray::number(pair.i));
+        dst->append(',');
+    }
+    dst->append('\n');
+}
+
+template<typename T>
+static inline void appendRaw(QByteArray *dst, T v)
+{
+    dst->append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+static inline void appendShortString(QByteArray *dst, const char *str)
+{
+    const quint8 len = quint8(qMin<size_t>(qstrlen(str), 255));
+    appendRaw(dst, len);
+    dst->append(str, len);
+}
+
+void QRhiProfilerPrivate::appendBinaryEvent(const Event &e, QByteArray *dst)
+{
+    appendRaw(dst, quint16(e.op));
+    appendRaw(dst, quint16(e.pairCount));
+    appendRaw(dst, e.timestamp);
+    appendRaw(dst, e.res);
+    appendShortString(dst, e.name);
+    for (int i = 0; i < e.pairCount; ++i) {
+        const Event::Pair &pair(e.pairs[i]);
+        appendShortString(dst, pair.key);
+        if (pair.key[0] == 'F')
+            appendRaw(dst, double(pair.f));
+        else
+            appendRaw(dst, pair.i);
+    }
+}
+
+static const char *streamOpName(QRhiProfiler::StreamOp op)
+{
+    switch (op) {
+    case QRhiProfiler::NewBuffer:
+        return "NewBuffer";
+    case QRhiProfiler::ReleaseBuffer:
+        return "ReleaseBuffer";
+    case QRhiProfiler::NewBufferStagingArea:
+        return "NewBufferStagingArea";
+    case QRhiProfiler::ReleaseBufferStagingArea:
+        return "ReleaseBufferStagingArea";
+    case QRhiProfiler::NewRenderBuffer:
+        return "NewRenderBuffer";
+    case QRhiProfiler::ReleaseRenderBuffer:
+        return "ReleaseRenderBuffer";
+    case QRhiProfiler::NewTexture:
+        return "NewTexture";
+    case QRhiProfiler::ReleaseTexture:
+        return "ReleaseTexture";
+    case QRhiProfiler::NewTextureStagingArea:
+        return "NewTextureStagingArea";
+    case QRhiProfiler::ReleaseTextureStagingArea:
+        return "ReleaseTextureStagingArea";
+    case QRhiProfiler::ResizeSwapChain:
+        return "ResizeSwapChain";
+    case QRhiProfiler::ReleaseSwapChain:
+        return "ReleaseSwapChain";
+    case QRhiProfiler::NewReadbackBuffer:
+        return "NewReadbackBuffer";
+    case QRhiProfiler::ReleaseReadbackBuffer:
+        return "ReleaseReadbackBuffer";
+    case QRhiProfiler::VMemAllocStats:
+        return "VMemAllocStats";
+    case QRhiProfiler::GpuFrameTime:
+        return "GpuFrameTime";
+    case QRhiProfiler::FrameToFrameTime:
+        return "FrameToFrameTime";
+    case QRhiProfiler::FrameBuildTime:
+        return "FrameBuildTime";
+    case QRhiProfiler::BeginFrame:
+        return "BeginFrame";
+    case QRhiProfiler::EndFrame:
+        return "EndFrame";
+    case QRhiProfiler::FramePresented:
+        return "FramePresented";
+    case QRhiProfiler::GpuFrameTimeSample:
+        return "GpuFrameTimeSample";
+    case QRhiProfiler::DebugMarkBegin:
+        return "DebugMarkBegin";
+    case QRhiProfiler::DebugMarkEnd:
+        return "DebugMarkEnd";
+    case QRhiProfiler::DebugMarkTime:
+        return "DebugMarkTime";
+    case QRhiProfiler::FrameCounters:
+        return "FrameCounters";
+    }
+    return "";
+}
+
+static void appendJsonString(QByteArray *dst, const char *str)
+{
+    dst->append('"');
+    for (const char *p = str; *p; ++p) {
+        const uchar c = uchar(*p);
+        if (c == '"' || c == '\\') {
+            dst->append('\\');
+            dst->append(char(c));
+        } else if (c < 0x20) {
+            char esc[8];
+            qsnprintf(esc, sizeof(esc), "\\u%04x", c);
+            dst->append(esc);
+        } else {
+            dst->append(char(c));
+        }
+    }
+    dst->append('"');
+}
+
+static void appendChromeTraceArgs(QByteArray *dst, const QRhiProfilerPrivate::Event &e, bool withResource)
+{
+    dst->append(",\"args\":{");
+    bool first = true;
+    if (withResource && e.res) {
+        dst->append("\"res\":\"0x");
+        dst->append(QByteArray::number(e.res, 16));
+        dst->append("\",\"res_name\":");
+        appendJsonString(dst, e.name);
+        first = false;
+    }
+    for (int i = 0; i < e.pairCount; ++i) {
+        const QRhiProfilerPrivate::Event::Pair &pair(e.pairs[i]);
+        if (!first)
+            dst->append(',');
+        first = false;
+        appendJsonString(dst, pair.key);
+        dst->append(':');
+        if (pair.key[0] == 'F')
+            dst->append(QByteArray::number(pair.f));
+        else
+            dst->append(QByteArray::number(pair.i));
+    }
+    dst->append('}');
+}
+
+void QRhiProfilerPrivate::beginChromeTraceEvent(QByteArray *dst, const char *name, char phase, int pid, int tid, double tsUs)
+{
+    dst->append(chromeTraceFirstEvent ? "\n" : ",\n");
+    chromeTraceFirstEvent = false;
+    dst->append("{\"name\":");
+    appendJsonString(dst, name);
+    dst->append(",\"ph\":\"");
+    dst->append(phase);
+    dst->append("\",\"pid\":");
+    dst->append(QByteArray::number(pid));
+    dst->append(",\"tid\":");
+    dst->append(QByteArray::number(tid));
+    dst->append(",\"ts\":");
+    dst->append(QByteArray::number(tsUs, 'f', 3));
+}
+
+int QRhiProfilerPrivate::chromeTraceTrack(int pid, quint64 res, const char *kind, const char *name, QByteArray *dst)
+{
+    // Track ids are small integers assigned on first use, with a thread_name
+    // metadata event so that viewers show something meaningful. 0 is the
+    // resources track.
+    const QPair<int, quint64> key(pid, res);
+    auto it = chromeTraceTracks.constFind(key);
+    if (it != chromeTraceTracks.constEnd())
+        return it.value();
+
+    const int tid = chromeTraceTracks.count() + 1;
+    chromeTraceTracks.insert(key, tid);
+
+    QByteArray label(kind);
+    label.append(' ');
+    if (name[0])
+        label.append(name);
+    else
+        label.append("0x" + QByteArray::number(res, 16));
+
+    beginChromeTraceEvent(dst, "thread_name", 'M', pid, tid, 0);
+    dst->append(",\"args\":{\"name\":");
+    appendJsonString(dst, label.constData());
+    dst->append("}}");
+
+    return tid;
+}
+
+void QRhiProfilerPrivate::appendChromeTraceEvent(const Event &e, QByteArray *dst)
+{
+    // Process 1 has a track for each swapchain and command buffer, plus the
+    // resources track. Process 2 has the GPU frame times, one track per
+    // swapchain, and process 3 the GPU times of the debug marker scopes.
+    const double tsUs = e.timestamp / 1000.0;
+    switch (e.op) {
+    case QRhiProfiler::BeginFrame:
+    {
+        const int tid = chromeTraceTrack(1, e.res, "swapchain", e.name, dst);
+        beginChromeTraceEvent(dst, "frame", 'B', 1, tid, tsUs);
+        dst->append('}');
+    }
+        break;
+    case QRhiProfiler::EndFrame:
+    {
+        const int tid = chromeTraceTrack(1, e.res, "swapchain", e.name, dst);
+        beginChromeTraceEvent(dst, "frame", 'E', 1, tid, tsUs);
+        dst->append('}');
+        beginChromeTraceEvent(dst, "present", 'B', 1, tid, tsUs);
+        dst->append('}');
+    }
+        break;
+    case QRhiProfiler::FramePresented:
+    {
+        const int tid = chromeTraceTrack(1, e.res, "swapchain", e.name, dst);
+        beginChromeTraceEvent(dst, "present", 'E', 1, tid, tsUs);
+        dst->append('}');
+    }
+        break;
+    case QRhiProfiler::GpuFrameTimeSample:
+    {
+        const int tid = chromeTraceTrack(2, e.res, "swapchain", e.name, dst);
+        const double durUs = e.pairCount ? e.pairs[0].f * 1000.0 : 0.0;
+        beginChromeTraceEvent(dst, "gpu frame", 'X', 2, tid, tsUs - durUs);
+        dst->append(",\"dur\":");
+        dst->append(QByteArray::number(durUs, 'f', 3));
+        dst->append('}');
+    }
+        break;
+    case QRhiProfiler::DebugMarkBegin:
+    {
+        const int tid = chromeTraceTrack(1, e.res, "command buffer", "", dst);
+        beginChromeTraceEvent(dst, e.name, 'B', 1, tid, tsUs);
+        dst->append('}');
+    }
+        break;
+    case QRhiProfiler::DebugMarkEnd:
+    {
+        const int tid = chromeTraceTrack(1, e.res, "command buffer", "", dst);
+        beginChromeTraceEvent(dst, "", 'E', 1, tid, tsUs);
+        dst->append('}');
+    }
+        break;
+    case QRhiProfiler::DebugMarkTime:
+    {
+        // pairs are depth, parent, Fcpu_ms, Fgpu_ms, Fgpu_start_ms
+        if (e.pairCount < 5 || e.pairs[3].f < 0)
+            break;
+        const int tid = chromeTraceTrack(3, e.res, "swapchain", "", dst);
+        beginChromeTraceEvent(dst, e.name, 'X', 3, tid, tsUs + e.pairs[4].f * 1000.0);
+        dst->append(",\"dur\":");
+        dst->append(QByteArray::number(e.pairs[3].f * 1000.0, 'f', 3));
+        appendChromeTraceArgs(dst, e, false);
+        dst->append('}');
+    }
+        break;
+    case QRhiProfiler::GpuFrameTime:
+    case QRhiProfiler::FrameToFrameTime:
+    case QRhiProfiler::FrameBuildTime:
+    case QRhiProfiler::VMemAllocStats:
+    case QRhiProfiler::FrameCounters:
+        beginChromeTraceEvent(dst, streamOpName(e.op), 'C', 1, 0, tsUs);
+        if (e.res) {
+            dst->append(",\"id\":\"0x");
+            dst->append(QByteArray::number(e.res, 16));
+            dst->append('"');
+        }
+        appendChromeTraceArgs(dst, e, false);
+        dst->append('}');
+        break;
+    default:
+        beginChromeTraceEvent(dst, streamOpName(e.op), 'i', 1, 0, tsUs);
+        dst->append(",\"s\":\"t\"");
+        appendChromeTraceArgs(dst, e, true);
+        dst->append('}');
+        break;
+    }
+}
+
 void QRhiProfilerPrivate::startEntry(QRhiProfiler::StreamOp op, qint64 timestamp, QRhiResource *res)
 {
-    buf.clear();
-    buf.append(QByteArray::number(op));
-    buf.append(',');
-    buf.append(QByteArray::number(timestamp));
-    buf.append(',');
-    buf.append(QByteArray::number(quint64(quintptr(res))));
-    buf.append(',');
+    cur.op = op;
+    cur.pairCount = 0;
+    cur.timestamp = timestamp;
+    cur.res = quint64(quintptr(res));
     if (res)
-        buf.append(res->name());
-    buf.append(',');
+        qstrncpy(cur.name, res->name().constData(), sizeof(cur.name));
+    else
+        cur.name[0] = '\0';
 }
 
 void QRhiProfilerPrivate::writeInt(const char *key, qint64 v)
 {
     Q_ASSERT(key[0] != 'F');
-    buf.append(key);
-    buf.append(',');
-    buf.append(QByteArray::number(v));
-    buf.append(',');
+    Q_ASSERT(cur.pairCount < Event::MAX_PAIRS);
+    if (cur.pairCount >= Event::MAX_PAIRS)
+        return;
+    Event::Pair &pair(cur.pairs[cur.pairCount++]);
+    pair.key = key;
+    pair.i = v;
 }
 
 void QRhiProfilerPrivate::writeFloat(const char *key, float f)
 {
     Q_ASSERT(key[0] == 'F');
-    buf.append(key);
-    buf.append(',');
-    buf.append(QByteArray::number(f));
-    buf.append(',');
+    Q_ASSERT(cur.pairCount < Event::MAX_PAIRS);
+    if (cur.pairCount >= Event::MAX_PAIRS)
+        return;
+    Event::Pair &pair(cur.pairs[cur.pairCount++]);
+    pair.key = key;
+    pair.f = f;
+}
+
+void QRhiProfilerPrivate::writeHistogram(const QRhiProfilerHistogram &h)
+{
+    writeFloat("Fp50_ms", h.percentile(50));
+    writeFloat("Fp90_ms", h.percentile(90));
+    writeFloat("Fp99_ms", h.percentile(99));
+    writeFloat("Fp999_ms", h.percentile(99.9));
+    writeInt("over_budget", h.overBudgetCount);
 }
 
 void QRhiProfilerPrivate::endEntry()
 {
-    buf.append('\n');
-    outputDevice->write(buf);
+    const quint32 head = ringHead.load();
+    if (head - ringTail.loadAcquire() == quint32(RING_SIZE)) {
+        droppedEventCount.fetchAndAddRelaxed(1);
+        return;
+    }
+    ring[int(head & (RING_SIZE - 1))] = cur;
+    ringHead.storeRelease(head + 1);
 }
 
 void QRhiProfilerPrivate::newBuffer(QRhiBuffer *buf, quint32 realSize, int backingGpuBufCount, int backingCpuBufCount)
@@ -326,7 +1134,7 @@ void QRhiProfilerPrivate::newBuffer(QRhiBuffer *buf, quint32 realSize, int backi
     if (!outputDevice)
         return;
 
-    startEntry(QRhiProfiler::NewBuffer, ts.elapsed(), buf);
+    startEntry(QRhiProfiler::NewBuffer, ts.nsecsElapsed(), buf);
     writeInt("type", buf->type());
     writeInt("usage", buf->usage());
     writeInt("logical_size", buf->size());
@@ -341,7 +1149,7 @@ void QRhiProfilerPrivate::releaseBuffer(QRhiBuffer *buf)
     if (!outputDevice)
         return;
 
-    startEntry(QRhiProfiler::ReleaseBuffer, ts.elapsed(), buf);
+    startEntry(QRhiProfiler::ReleaseBuffer, ts.nsecsElapsed(), buf);
     endEntry();
 }
 
@@ -350,7 +1158,7 @@ void QRhiProfilerPrivate::newBufferStagingArea(QRhiBuffer *buf, int slot, quint3
     if (!outputDevice)
         return;
 
-    startEntry(QRhiProfiler::NewBufferStagingArea, ts.elapsed(), buf);
+    startEntry(QRhiProfiler::NewBufferStagingArea, ts.nsecsElapsed(), buf);
     writeInt("slot", slot);
     writeInt("size", size);
     endEntry();
@@ -361,7 +1169,7 @@ void QRhiProfilerPrivate::releaseBufferStagingArea(QRhiBuffer *buf, int slot)
     if (!outputDevice)
         return;
 
-    startEntry(QRhiProfiler::ReleaseBufferStagingArea, ts.elapsed(), buf);
+    startEntry(QRhiProfiler::ReleaseBufferStagingArea, ts.nsecsElapsed(), buf);
     writeInt("slot", slot);
     endEntry();
 }
@@ -373,13 +1181,9 @@ void QRhiProfilerPrivate::newRenderBuffer(QRhiRenderBuffer *rb, bool transientBa
 
     const QRhiRenderBuffer::Type type = rb->type();
     const QSize sz = rb->pixelSize();
-    // just make up something, ds is likely D24S8 while color is RGBA8 or similar
-    const QRhiTexture::Format assumedFormat = type == QRhiRenderBuffer::DepthStencil ? QRhiTexture::D32 : QRhiTexture::RGBA8;
-    quint32 byteSize = rhiDWhenEnabled->approxByteSizeForTexture(assumedFormat, sz, 1, 1);
-    if (sampleCount > 1)
-        byteSize *= sampleCount;
+    const quint32 byteSize = rhiDWhenEnabled->approxByteSizeForRenderBuffer(type, sz, sampleCount);
 
-    startEntry(QRhiProfiler::NewRenderBuffer, ts.elapsed(), rb);
+    startEntry(QRhiProfiler::NewRenderBuffer, ts.nsecsElapsed(), rb);
     writeInt("type", type);
     writeInt("width", sz.width());
     writeInt("height", sz.height());
@@ -395,11 +1199,11 @@ void QRhiProfilerPrivate::releaseRenderBuffer(QRhiRenderBuffer *rb)
     if (!outputDevice)
         return;
 
-    startEntry(QRhiProfiler::ReleaseRenderBuffer, ts.elapsed(), rb);
+    startEntry(QRhiProfiler::ReleaseRenderBuffer, ts.nsecsElapsed(), rb);
     endEntry();
 }
 
-void QRhiProfilerPrivate::newTexture(QRhiTexture *tex, bool owns, int mipCount, int layerCount, int sampleCount)
+void QRhiProfilerPrivate::newTexture(QRhiTexture *tex, bool owns, bool transientBacking, int mipCount, int layerCount, int sampleCount)
 {
     if (!outputDevice)
         return;
@@ -410,11 +1214,12 @@ void QRhiProfilerPrivate::newTexture(QRhiTexture *tex, bool owns, int mipCount,
     if (sampleCount > 1)
         byteSize *= sampleCount;
 
-    startEntry(QRhiProfiler::NewTexture, ts.elapsed(), tex);
+    startEntry(QRhiProfiler::NewTexture, ts.nsecsElapsed(), tex);
     writeInt("width", sz.width());
     writeInt("height", sz.height());
     writeInt("format", format);
     writeInt("owns_native_resource", owns);
+    writeInt("transient_backing", transientBacking);
     writeInt("mip_count", mipCount);
     writeInt("layer_count", layerCount);
     writeInt("effective_sample_count", sampleCount);
@@ -427,7 +1232,7 @@ void QRhiProfilerPrivate::releaseTexture(QRhiTexture *tex)
     if (!outputDevice)
         return;
 
-    startEntry(QRhiProfiler::ReleaseTexture, ts.elapsed(), tex);
+    startEntry(QRhiProfiler::ReleaseTexture, ts.nsecsElapsed(), tex);
     endEntry();
 }
 
@@ -436,7 +1241,7 @@ void QRhiProfilerPrivate::newTextureStagingArea(QRhiTexture *tex, int slot, quin
     if (!outputDevice)
         return;
 
-    startEntry(QRhiProfiler::NewTextureStagingArea, ts.elapsed(), tex);
+    startEntry(QRhiProfiler::NewTextureStagingArea, ts.nsecsElapsed(), tex);
     writeInt("slot", slot);
     writeInt("size", size);
     endEntry();
@@ -447,7 +1252,7 @@ void QRhiProfilerPrivate::releaseTextureStagingArea(QRhiTexture *tex, int slot)
     if (!outputDevice)
         return;
 
-    startEntry(QRhiProfiler::ReleaseTextureStagingArea, ts.elapsed(), tex);
+    startEntry(QRhiProfiler::ReleaseTextureStagingArea, ts.nsecsElapsed(), tex);
     writeInt("slot", slot);
     endEntry();
 }
@@ -461,7 +1266,7 @@ void QRhiProfilerPrivate::resizeSwapChain(QRhiSwapChain *sc, int bufferCount, in
     quint32 byteSize = rhiDWhenEnabled->approxByteSizeForTexture(QRhiTexture::BGRA8, sz, 1, 1);
     byteSize = byteSize * bufferCount + byteSize * msaaBufferCount * sampleCount;
 
-    startEntry(QRhiProfiler::ResizeSwapChain, ts.elapsed(), sc);
+    startEntry(QRhiProfiler::ResizeSwapChain, ts.nsecsElapsed(), sc);
     writeInt("width", sz.width());
     writeInt("height", sz.height());
     writeInt("buffer_count", bufferCount);
@@ -473,10 +1278,14 @@ void QRhiProfilerPrivate::resizeSwapChain(QRhiSwapChain *sc, int bufferCount, in
 
 void QRhiProfilerPrivate::releaseSwapChain(QRhiSwapChain *sc)
 {
+    auto it = swapchains.find(sc);
+    if (it != swapchains.end())
+        it->pendingMarkerFrames.clear();
+
     if (!outputDevice)
         return;
 
-    startEntry(QRhiProfiler::ReleaseSwapChain, ts.elapsed(), sc);
+    startEntry(QRhiProfiler::ReleaseSwapChain, ts.nsecsElapsed(), sc);
     endEntry();
 }
 
@@ -510,35 +1319,42 @@ void QRhiProfilerPrivate::endSwapChainFrame(QRhiSwapChain *sc, int frameCount)
 {
     Sc &scd(swapchains[sc]);
     if (!scd.frameToFrameRunning) {
+        // the first frame has a build time, but no delta to the previous one
         scd.frameToFrameTimer.start();
         scd.frameToFrameRunning = true;
-        return;
-    }
-
-    scd.frameToFrameSamples.append(scd.frameToFrameTimer.restart());
-    if (scd.frameToFrameSamples.count() >= frameTimingWriteInterval) {
-        calcTiming(&scd.frameToFrameSamples,
-                   &scd.frameToFrameTime.minTime, &scd.frameToFrameTime.maxTime, &scd.frameToFrameTime.avgTime);
-        if (outputDevice) {
-            startEntry(QRhiProfiler::FrameToFrameTime, ts.elapsed(), sc);
-            writeInt("frames_since_resize", frameCount);
-            writeInt("min_ms_frame_delta", scd.frameToFrameTime.minTime);
-            writeInt("max_ms_frame_delta", scd.frameToFrameTime.maxTime);
-            writeFloat("Favg_ms_frame_delta", scd.frameToFrameTime.avgTime);
-            endEntry();
+    } else {
+        const float frameToFrameMs = scd.frameToFrameTimer.nsecsElapsed() / 1000000.0f;
+        scd.frameToFrameSamples.append(frameToFrameMs);
+        scd.frameToFrameHistogram.record(frameToFrameMs, frameTimeBudget);
+        scd.frameToFrameTimer.restart();
+        if (scd.frameToFrameSamples.count() >= frameTimingWriteInterval) {
+            calcTiming(&scd.frameToFrameSamples,
+                       &scd.frameToFrameTime.minTime, &scd.frameToFrameTime.maxTime, &scd.frameToFrameTime.avgTime);
+            if (outputDevice) {
+                startEntry(QRhiProfiler::FrameToFrameTime, ts.nsecsElapsed(), sc);
+                writeInt("frames_since_resize", frameCount);
+                writeFloat("Fmin_ms_frame_delta", scd.frameToFrameTime.minTime);
+                writeFloat("Fmax_ms_frame_delta", scd.frameToFrameTime.maxTime);
+                writeFloat("Favg_ms_frame_delta", scd.frameToFrameTime.avgTime);
+                writeHistogram(scd.frameToFrameHistogram);
+                endEntry();
+            }
         }
     }
 
-    scd.beginToEndSamples.append(scd.beginToEndTimer.elapsed());
+    const float beginToEndMs = scd.beginToEndTimer.nsecsElapsed() / 1000000.0f;
+    scd.beginToEndSamples.append(beginToEndMs);
+    scd.beginToEndHistogram.record(beginToEndMs, frameTimeBudget);
     if (scd.beginToEndSamples.count() >= frameTimingWriteInterval) {
         calcTiming(&scd.beginToEndSamples,
                    &scd.beginToEndFrameTime.minTime, &scd.beginToEndFrameTime.maxTime, &scd.beginToEndFrameTime.avgTime);
         if (outputDevice) {
-            startEntry(QRhiProfiler::FrameBuildTime, ts.elapsed(), sc);
+            startEntry(QRhiProfiler::FrameBuildTime, ts.nsecsElapsed(), sc);
             writeInt("frames_since_resize", frameCount);
-            writeInt("min_ms_frame_build", scd.beginToEndFrameTime.minTime);
-            writeInt("max_ms_frame_build", scd.beginToEndFrameTime.maxTime);
+            writeFloat("Fmin_ms_frame_build", scd.beginToEndFrameTime.minTime);
+            writeFloat("Fmax_ms_frame_build", scd.beginToEndFrameTime.maxTime);
             writeFloat("Favg_ms_frame_build", scd.beginToEndFrameTime.avgTime);
+            writeHistogram(scd.beginToEndHistogram);
             endEntry();
         }
     }
@@ -546,27 +1362,257 @@ void QRhiProfilerPrivate::endSwapChainFrame(QRhiSwapChain *sc, int frameCount)
 
 void QRhiProfilerPrivate::swapChainFrameGpuTime(QRhiSwapChain *sc, float gpuTime)
 {
+    if (outputDevice) {
+        startEntry(QRhiProfiler::GpuFrameTimeSample, ts.nsecsElapsed(), sc);
+        writeFloat("Fgpu_ms", gpuTime);
+        endEntry();
+    }
+
     Sc &scd(swapchains[sc]);
     scd.gpuFrameSamples.append(gpuTime);
+    scd.gpuFrameHistogram.record(gpuTime, frameTimeBudget);
     if (scd.gpuFrameSamples.count() >= frameTimingWriteInterval) {
         calcTiming(&scd.gpuFrameSamples,
                    &scd.gpuFrameTime.minTime, &scd.gpuFrameTime.maxTime, &scd.gpuFrameTime.avgTime);
         if (outputDevice) {
-            startEntry(QRhiProfiler::GpuFrameTime, ts.elapsed(), sc);
+            startEntry(QRhiProfiler::GpuFrameTime, ts.nsecsElapsed(), sc);
             writeFloat("Fmin_ms_gpu_frame_time", scd.gpuFrameTime.minTime);
             writeFloat("Fmax_ms_gpu_frame_time", scd.gpuFrameTime.maxTime);
             writeFloat("Favg_ms_gpu_frame_time", scd.gpuFrameTime.avgTime);
+            writeHistogram(scd.gpuFrameHistogram);
             endEntry();
         }
     }
 }
 
+void QRhiProfilerPrivate::beginFrame(QRhiSwapChain *sc)
+{
+    currentFrameSwapChain = sc;
+    frameStats = QRhiProfiler::FrameStatistics();
+    if (markerTiming) {
+        Sc::MarkerFrame &frame(swapchains[sc].currentMarkerFrame);
+        frame.serial = ++markerFrameSerial;
+        frame.awaitingGpu = false;
+        frame.markers.clear();
+        frame.cpuBegin.clear();
+        frame.gpuStart.clear();
+        frame.stack.clear();
+    }
+
+    if (!outputDevice)
+        return;
+
+    startEntry(QRhiProfiler::BeginFrame, ts.nsecsElapsed(), sc);
+    endEntry();
+}
+
+void QRhiProfilerPrivate::endFrame(QRhiSwapChain *sc)
+{
+    const qint64 t = ts.nsecsElapsed();
+    if (markerTiming) {
+        // close what the application left open
+        Sc::MarkerFrame &frame(swapchains[sc].currentMarkerFrame);
+        for (int idx : qAsConst(frame.stack))
+            frame.markers[idx].cpuTime = (t - frame.cpuBegin[idx]) / 1000000.0f;
+        frame.stack.clear();
+    }
+
+    if (!outputDevice)
+        return;
+
+    startEntry(QRhiProfiler::EndFrame, t, sc);
+    endEntry();
+}
+
+void QRhiProfilerPrivate::framePresented(QRhiSwapChain *sc)
+{
+    currentFrameSwapChain = nullptr;
+    finishFrameStatistics(sc);
+    if (markerTiming) {
+        Sc &scd(swapchains[sc]);
+        if (scd.currentMarkerFrame.awaitingGpu && !scd.currentMarkerFrame.markers.isEmpty()) {
+            if (scd.pendingMarkerFrames.count() >= Sc::MAX_PENDING_MARKER_FRAMES) {
+                // the backend did not deliver, do not wait forever
+                finishMarkerFrame(sc, &scd, scd.pendingMarkerFrames.first());
+                scd.pendingMarkerFrames.removeFirst();
+            }
+            scd.pendingMarkerFrames.append(scd.currentMarkerFrame);
+        } else {
+            finishMarkerFrame(sc, &scd, scd.currentMarkerFrame);
+        }
+    }
+
+    if (!outputDevice)
+        return;
+
+    startEntry(QRhiProfiler::FramePresented, ts.nsecsElapsed(), sc);
+    endEntry();
+}
+
+void QRhiProfilerPrivate::beginOffscreenFrame()
+{
+    frameStats = QRhiProfiler::FrameStatistics();
+    // offscreen frames are timed like the frames of a null swapchain
+    beginSwapChainFrame(nullptr);
+}
+
+void QRhiProfilerPrivate::endOffscreenFrame()
+{
+    endSwapChainFrame(nullptr, ++offscreenFrameCount);
+    finishFrameStatistics(nullptr);
+}
+
+void QRhiProfilerPrivate::countResourceUpdates(QRhiResourceUpdateBatch *resourceUpdates)
+{
+    if (!resourceUpdates)
+        return;
+
+    QRhiResourceUpdateBatchPrivate *ud = QRhiResourceUpdateBatchPrivate::get(resourceUpdates);
+    for (const QRhiResourceUpdateBatchPrivate::DynamicBufferUpdate &u : qAsConst(ud->dynamicBufferUpdates))
+        frameStats.uploadBytes += u.data.size();
+    for (const QRhiResourceUpdateBatchPrivate::StaticBufferUpload &u : qAsConst(ud->staticBufferUploads))
+        frameStats.uploadBytes += u.data.size();
+    for (const QRhiResourceUpdateBatchPrivate::TextureOp &op : qAsConst(ud->textureOps)) {
+        if (op.type == QRhiResourceUpdateBatchPrivate::TextureOp::TexUpload) {
+            const QVector<QRhiTextureLayer> layers = op.upload.desc.layers();
+            for (const QRhiTextureLayer &layer : layers) {
+                const QVector<QRhiTextureMipLevel> mipImages = layer.mipImages();
+                for (const QRhiTextureMipLevel &mipDesc : mipImages) {
+                    frameStats.uploadBytes += mipDesc.compressedData().isEmpty()
+                            ? mipDesc.image().sizeInBytes() : mipDesc.compressedData().size();
+                }
+            }
+        } else if (op.type == QRhiResourceUpdateBatchPrivate::TextureOp::TexRead) {
+            frameStats.readbacks += 1;
+        }
+    }
+    frameStats.readbacks += ud->bufferReadbacks.count();
+}
+
+void QRhiProfilerPrivate::finishFrameStatistics(QRhiSwapChain *sc)
+{
+    swapchains[sc].frameStatistics = frameStats;
+
+    if (!outputDevice)
+        return;
+
+    // the event with the most pairs, keep it within what an Event can hold
+    const struct {
+        const char *key;
+        qint64 value;
+    } counters[] = {
+        { "draw_calls", frameStats.drawCalls },
+        { "dispatch_calls", frameStats.dispatchCalls },
+        { "passes", frameStats.passes },
+        { "pipeline_binds", frameStats.pipelineBinds },
+        { "srb_binds", frameStats.shaderResourceBinds },
+        { "vertex_input_binds", frameStats.vertexInputBinds },
+        { "descriptor_set_updates", frameStats.descriptorSetUpdates },
+        { "barriers", frameStats.barriers },
+        { "upload_bytes", frameStats.uploadBytes },
+        { "readbacks", frameStats.readbacks }
+    };
+    Q_STATIC_ASSERT(sizeof(counters) / sizeof(counters[0]) <= Event::MAX_PAIRS);
+
+    startEntry(QRhiProfiler::FrameCounters, ts.nsecsElapsed(), sc);
+    for (const auto &c : counters)
+        writeInt(c.key, c.value);
+    endEntry();
+}
+
+void QRhiProfilerPrivate::debugMarkBegin(QRhiCommandBuffer *cb, const QByteArray &name)
+{
+    const qint64 t = ts.nsecsElapsed();
+    if (markerTiming && currentFrameSwapChain) {
+        Sc::MarkerFrame &frame(swapchains[currentFrameSwapChain].currentMarkerFrame);
+        QRhiProfiler::MarkerTime m;
+        m.name = name;
+        m.depth = frame.stack.count();
+        m.parentIndex = frame.stack.isEmpty() ? -1 : frame.stack.last();
+        frame.stack.append(frame.markers.count());
+        frame.markers.append(m);
+        frame.cpuBegin.append(t);
+        frame.gpuStart.append(-1);
+    }
+
+    if (!outputDevice)
+        return;
+
+    startEntry(QRhiProfiler::DebugMarkBegin, t, cb);
+    qstrncpy(cur.name, name.constData(), sizeof(cur.name));
+    endEntry();
+}
+
+void QRhiProfilerPrivate::debugMarkEnd(QRhiCommandBuffer *cb)
+{
+    const qint64 t = ts.nsecsElapsed();
+    if (markerTiming && currentFrameSwapChain) {
+        Sc::MarkerFrame &frame(swapchains[currentFrameSwapChain].currentMarkerFrame);
+        if (!frame.stack.isEmpty()) {
+            const int idx = frame.stack.takeLast();
+            frame.markers[idx].cpuTime = (t - frame.cpuBegin[idx]) / 1000000.0f;
+        }
+    }
+
+    if (!outputDevice)
+        return;
+
+    startEntry(QRhiProfiler::DebugMarkEnd, t, cb);
+    endEntry();
+}
+
+quint64 QRhiProfilerPrivate::requestMarkerGpuTimes(QRhiSwapChain *sc)
+{
+    Sc::MarkerFrame &frame(swapchains[sc].currentMarkerFrame);
+    frame.awaitingGpu = true;
+    return frame.serial;
+}
+
+void QRhiProfilerPrivate::resolveMarkerGpuTimes(QRhiSwapChain *sc, quint64 serial, const QVector<MarkerGpuTime> &times)
+{
+    Sc &scd(swapchains[sc]);
+    for (int i = 0; i < scd.pendingMarkerFrames.count(); ++i) {
+        Sc::MarkerFrame &frame(scd.pendingMarkerFrames[i]);
+        if (frame.serial != serial)
+            continue;
+        const int count = qMin(times.count(), frame.markers.count());
+        for (int idx = 0; idx < count; ++idx) {
+            frame.markers[idx].gpuTime = times[idx].duration;
+            frame.gpuStart[idx] = times[idx].start;
+        }
+        finishMarkerFrame(sc, &scd, frame);
+        scd.pendingMarkerFrames.remove(i);
+        return;
+    }
+}
+
+void QRhiProfilerPrivate::finishMarkerFrame(QRhiSwapChain *sc, Sc *scd, const Sc::MarkerFrame &frame)
+{
+    scd->markerTimes = frame.markers;
+
+    if (!outputDevice)
+        return;
+
+    const qint64 t = ts.nsecsElapsed();
+    for (int idx = 0; idx < frame.markers.count(); ++idx) {
+        const QRhiProfiler::MarkerTime &m(frame.markers[idx]);
+        startEntry(QRhiProfiler::DebugMarkTime, t, sc);
+        qstrncpy(cur.name, m.name.constData(), sizeof(cur.name));
+        writeInt("depth", m.depth);
+        writeInt("parent", m.parentIndex);
+        writeFloat("Fcpu_ms", m.cpuTime);
+        writeFloat("Fgpu_ms", m.gpuTime);
+        writeFloat("Fgpu_start_ms", frame.gpuStart[idx]);
+        endEntry();
+    }
+}
+
 void QRhiProfilerPrivate::newReadbackBuffer(quint64 id, QRhiResource *src, quint32 size)
 {
     if (!outputDevice)
         return;
 
-    startEntry(QRhiProfiler::NewReadbackBuffer, ts.elapsed(), src);
+    startEntry(QRhiProfiler::NewReadbackBuffer, ts.nsecsElapsed(), src);
     writeInt("id", id);
     writeInt("size", size);
     endEntry();
@@ -577,7 +1623,7 @@ void QRhiProfilerPrivate::releaseReadbackBuffer(quint64 id)
     if (!outputDevice)
         return;
 
-    startEntry(QRhiProfiler::ReleaseReadbackBuffer, ts.elapsed(), nullptr);
+    startEntry(QRhiProfiler::ReleaseReadbackBuffer, ts.nsecsElapsed(), nullptr);
     writeInt("id", id);
     endEntry();
 }
@@ -587,7 +1633,7 @@ void QRhiProfilerPrivate::vmemStat(int realAllocCount, int subAllocCount, quint3
     if (!outputDevice)
         return;
 
-    startEntry(QRhiProfiler::VMemAllocStats, ts.elapsed(), nullptr);
+    startEntry(QRhiProfiler::VMemAllocStats, ts.nsecsElapsed(), nullptr);
     writeInt("realAllocCount", realAllocCount);
     writeInt("subAllocCount", subAllocCount);
     writeInt("totalSize", totalSize);
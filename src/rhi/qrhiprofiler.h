@@ -65,21 +65,38 @@ public:
         VMemAllocStats,
         GpuFrameTime,
         FrameToFrameTime,
-        FrameBuildTime
+        FrameBuildTime,
+        BeginFrame,
+        EndFrame,
+        FramePresented,
+        GpuFrameTimeSample,
+        DebugMarkBegin,
+        DebugMarkEnd,
+        DebugMarkTime,
+        FrameCounters
+    };
+
+    enum OutputFormat {
+        TextFormat,
+        BinaryFormat,
+        ChromeTraceFormat
     };
 
     ~QRhiProfiler();
 
     void setDevice(QIODevice *device);
 
+    OutputFormat outputFormat() const;
+    void setOutputFormat(OutputFormat format);
+
     void addVMemAllocatorStats();
 
     int frameTimingWriteInterval() const;
     void setFrameTimingWriteInterval(int frameCount);
 
     struct CpuTime {
-        qint64 minTime = 0;
-        qint64 maxTime = 0;
+        float minTime = 0;
+        float maxTime = 0;
         float avgTime = 0;
     };
 
@@ -93,6 +110,51 @@ public:
     CpuTime frameBuildTimes(QRhiSwapChain *sc) const; // beginFrame - endFrame
     GpuTime gpuFrameTimes(QRhiSwapChain *sc) const;
 
+    bool isMarkerTimingEnabled() const;
+    void setMarkerTimingEnabled(bool enable);
+
+    struct MarkerTime {
+        QByteArray name;
+        int depth = 0;
+        int parentIndex = -1;
+        float cpuTime = 0; // ms, debugMarkBegin - debugMarkEnd
+        float gpuTime = -1; // ms, -1 when not available
+    };
+
+    QVector<MarkerTime> markerTimes(QRhiSwapChain *sc) const;
+
+    struct FrameStatistics {
+        int drawCalls = 0;
+        int dispatchCalls = 0;
+        int passes = 0;
+        int pipelineBinds = 0;
+        int shaderResourceBinds = 0;
+        int vertexInputBinds = 0;
+        int descriptorSetUpdates = 0;
+        int barriers = 0;
+        qint64 uploadBytes = 0;
+        int readbacks = 0;
+    };
+
+    FrameStatistics frameStatistics(QRhiSwapChain *sc) const;
+
+    float frameTimeBudget() const;
+    void setFrameTimeBudget(float ms);
+    void resetFrameTimeHistograms();
+
+    struct FrameTimePercentiles {
+        float p50 = 0;
+        float p90 = 0;
+        float p99 = 0;
+        float p999 = 0;
+        qint64 frameCount = 0;
+        qint64 overBudgetCount = 0;
+    };
+
+    FrameTimePercentiles frameToFramePercentiles(QRhiSwapChain *sc) const;
+    FrameTimePercentiles frameBuildPercentiles(QRhiSwapChain *sc) const;
+    FrameTimePercentiles gpuFramePercentiles(QRhiSwapChain *sc) const;
+
 private:
     Q_DISABLE_COPY(QRhiProfiler)
     QRhiProfiler();
@@ -103,6 +165,9 @@ private:
 
 Q_DECLARE_TYPEINFO(QRhiProfiler::CpuTime, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(QRhiProfiler::GpuTime, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QRhiProfiler::MarkerTime, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QRhiProfiler::FrameStatistics, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QRhiProfiler::FrameTimePercentiles, Q_MOVABLE_TYPE);
 
 QT_END_NAMESPACE
 
@@ -45,12 +45,57 @@
 #include "qrhiprofiler.h"
 #include <QElapsedTimer>
 #include <QHash>
+#include <QPair>
+#include <QThread>
+#include <QAtomicInteger>
 
 QT_BEGIN_NAMESPACE
 
+class QRhiProfilerPrivate;
+
+// Streaming histogram with fixed memory use and bounded relative error, in
+// the spirit of HdrHistogram. Values are recorded in microseconds. Values
+// below 128 get a bucket each, above that each power of two range is split
+// into 64 buckets. See QRhiProfiler::FrameTimePercentiles for the resulting
+// accuracy.
+class Q_RHI_PRIVATE_EXPORT QRhiProfilerHistogram
+{
+public:
+    void record(float ms, float budgetMs);
+    float percentile(double p) const; // ms
+    void reset();
+
+    qint64 count = 0;
+    qint64 overBudgetCount = 0;
+
+private:
+    static const int LINEAR_BUCKETS = 128;
+    static const int SUB_BUCKET_BITS = 6;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAX_EXPONENT = 26;
+    static const int BUCKET_COUNT = LINEAR_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS) * SUB_BUCKETS;
+    static int bucketIndex(quint64 us);
+    static float bucketValue(int idx);
+    QVector<quint32> buckets; // allocated on first use
+};
+
+Q_DECLARE_TYPEINFO(QRhiProfilerHistogram, Q_MOVABLE_TYPE);
+
+class QRhiProfilerWriter : public QThread
+{
+public:
+    QRhiProfilerWriter(QRhiProfilerPrivate *d) : d(d) { }
+    void run() override;
+
+    static const int WRITE_INTERVAL_MS = 10;
+    QRhiProfilerPrivate *d;
+    QAtomicInt stopRequested;
+};
+
 class QRhiProfilerPrivate
 {
 public:
+    ~QRhiProfilerPrivate();
     static QRhiProfilerPrivate *get(QRhiProfiler *p) { return p->d; }
 
     void newBuffer(QRhiBuffer *buf, quint32 realSize, int backingGpuBufCount, int backingCpuBufCount);
@@ -61,7 +106,7 @@ public:
     void newRenderBuffer(QRhiRenderBuffer *rb, bool transientBacking, bool winSysBacking, int sampleCount);
     void releaseRenderBuffer(QRhiRenderBuffer *rb);
 
-    void newTexture(QRhiTexture *tex, bool owns, int mipCount, int layerCount, int sampleCount);
+    void newTexture(QRhiTexture *tex, bool owns, bool transientBacking, int mipCount, int layerCount, int sampleCount);
     void releaseTexture(QRhiTexture *tex);
     void newTextureStagingArea(QRhiTexture *tex, int slot, quint32 size);
     void releaseTextureStagingArea(QRhiTexture *tex, int slot);
@@ -73,6 +118,30 @@ public:
     void endSwapChainFrame(QRhiSwapChain *sc, int frameCount);
     void swapChainFrameGpuTime(QRhiSwapChain *sc, float gpuTimeMs);
 
+    void beginFrame(QRhiSwapChain *sc);
+    void endFrame(QRhiSwapChain *sc);
+    void framePresented(QRhiSwapChain *sc);
+
+    void beginOffscreenFrame();
+    void endOffscreenFrame();
+    void countResourceUpdates(QRhiResourceUpdateBatch *resourceUpdates);
+    void finishFrameStatistics(QRhiSwapChain *sc);
+
+    void debugMarkBegin(QRhiCommandBuffer *cb, const QByteArray &name);
+    void debugMarkEnd(QRhiCommandBuffer *cb);
+
+    // GPU timing for the debug marker scopes of a swapchain frame is provided
+    // by the backends: during endFrame() they call requestMarkerGpuTimes() and
+    // once the results are available (typically when the frame slot is
+    // reused), resolveMarkerGpuTimes() with the timings for each scope, in
+    // debugMarkBegin order.
+    struct MarkerGpuTime {
+        float start = -1; // ms, relative to the first timestamp in the frame
+        float duration = -1; // ms
+    };
+    quint64 requestMarkerGpuTimes(QRhiSwapChain *sc);
+    void resolveMarkerGpuTimes(QRhiSwapChain *sc, quint64 serial, const QVector<MarkerGpuTime> &times);
+
     void newReadbackBuffer(quint64 id, QRhiResource *src, quint32 size);
     void releaseReadbackBuffer(quint64 id);
 
@@ -81,14 +150,63 @@ public:
     void startEntry(QRhiProfiler::StreamOp op, qint64 timestamp, QRhiResource *res);
     void writeInt(const char *key, qint64 v);
     void writeFloat(const char *key, float f);
+    void writeHistogram(const QRhiProfilerHistogram &h);
     void endEntry();
 
+    // Events are recorded into a fixed size ring buffer by the thread using
+    // the QRhi, without locking or allocating, and are formatted and written
+    // to the device on the writer thread. There is exactly one producer and
+    // one consumer, so head and tail are enough for synchronization.
+    struct Event {
+        static const int MAX_PAIRS = 16;
+        static const int MAX_NAME_LENGTH = 47;
+        QRhiProfiler::StreamOp op;
+        int pairCount;
+        qint64 timestamp; // nanoseconds
+        quint64 res;
+        char name[MAX_NAME_LENGTH + 1];
+        struct Pair {
+            const char *key; // always a string literal, floats when starting with F
+            union {
+                qint64 i;
+                float f;
+            };
+        } pairs[MAX_PAIRS];
+    };
+
+    void startWriter();
+    void stopWriter();
+    void drain();
+    void appendTextEvent(const Event &e, QByteArray *dst);
+    void appendBinaryEvent(const Event &e, QByteArray *dst);
+    void appendChromeTraceEvent(const Event &e, QByteArray *dst);
+    void beginChromeTraceEvent(QByteArray *dst, const char *name, char phase, int pid, int tid, double tsUs);
+    int chromeTraceTrack(int pid, quint64 res, const char *kind, const char *name, QByteArray *dst);
+
     QRhiImplementation *rhiDWhenEnabled = nullptr;
     QIODevice *outputDevice = nullptr;
+    QRhiProfiler::OutputFormat outputFormat = QRhiProfiler::TextFormat;
     QElapsedTimer ts;
-    QByteArray buf;
+    Event cur;
+    static const int RING_SIZE = 4096; // must be a power of two
+    QVector<Event> ring;
+    QAtomicInteger<quint32> ringHead; // written by the producer only
+    QAtomicInteger<quint32> ringTail; // written by the writer thread only
+    QAtomicInteger<quint32> droppedEventCount;
+    QRhiProfilerWriter *writer = nullptr;
+    bool markerTiming = false;
+    quint64 markerFrameSerial = 0;
+    QRhiSwapChain *currentFrameSwapChain = nullptr;
+    // counters for the frame being recorded, incremented directly by the
+    // front end and the backends
+    QRhiProfiler::FrameStatistics frameStats;
+    // Chrome trace state, touched by the writer thread only
+    bool chromeTraceFirstEvent = true;
+    QHash<QPair<int, quint64>, int> chromeTraceTracks;
     static const int DEFAULT_FRAME_TIMING_WRITE_INTERVAL = 120; // frames
     int frameTimingWriteInterval = DEFAULT_FRAME_TIMING_WRITE_INTERVAL;
+    float frameTimeBudget = 1000.0f / 60.0f; // ms
+    int offscreenFrameCount = 0;
     struct Sc {
         Sc() {
             frameToFrameSamples.reserve(DEFAULT_FRAME_TIMING_WRITE_INTERVAL);
@@ -98,17 +216,38 @@ public:
         QElapsedTimer frameToFrameTimer;
         bool frameToFrameRunning = false;
         QElapsedTimer beginToEndTimer;
-        QVector<qint64> frameToFrameSamples;
-        QVector<qint64> beginToEndSamples;
+        // milliseconds, with sub-millisecond precision
+        QVector<float> frameToFrameSamples;
+        QVector<float> beginToEndSamples;
         QVector<float> gpuFrameSamples;
         QRhiProfiler::CpuTime frameToFrameTime;
         QRhiProfiler::CpuTime beginToEndFrameTime;
         QRhiProfiler::GpuTime gpuFrameTime;
+        QRhiProfilerHistogram frameToFrameHistogram;
+        QRhiProfilerHistogram beginToEndHistogram;
+        QRhiProfilerHistogram gpuFrameHistogram;
+        struct MarkerFrame {
+            quint64 serial = 0;
+            bool awaitingGpu = false;
+            QVector<QRhiProfiler::MarkerTime> markers;
+            QVector<qint64> cpuBegin; // ns
+            QVector<float> gpuStart; // ms
+            QVector<int> stack;
+        };
+        static const int MAX_PENDING_MARKER_FRAMES = 8;
+        MarkerFrame currentMarkerFrame;
+        QVector<MarkerFrame> pendingMarkerFrames;
+        QVector<QRhiProfiler::MarkerTime> markerTimes;
+        QRhiProfiler::FrameStatistics frameStatistics;
     };
+    void finishMarkerFrame(QRhiSwapChain *sc, Sc *scd, const Sc::MarkerFrame &frame);
     QHash<QRhiSwapChain *, Sc> swapchains;
 };
 
+Q_DECLARE_TYPEINFO(QRhiProfilerPrivate::Event, Q_PRIMITIVE_TYPE);
 Q_DECLARE_TYPEINFO(QRhiProfilerPrivate::Sc, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QRhiProfilerPrivate::Sc::MarkerFrame, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QRhiProfilerPrivate::MarkerGpuTime, Q_PRIMITIVE_TYPE);
 
 QT_END_NAMESPACE
 
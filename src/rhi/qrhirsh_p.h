@@ -68,6 +68,8 @@ public:
 
     QMutex mtx;
     int rhiCount = 0;
+    // the sum of the attached QRhis' accounting, not protected by mtx
+    QAtomicInteger<qint64> memoryBytes[QRhiImplementation::MemoryCategoryCount];
 
 #ifndef QT_NO_OPENGL
     struct {
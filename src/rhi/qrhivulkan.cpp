@@ -395,10 +395,15 @@ bool QRhiVulkan::create(QRhi::Flags flags)
 
         debugMarkersAvailable = false;
         vertexAttribDivisorAvailable = false;
+        maintenance1Available = false;
         for (const VkExtensionProperties &ext : devExts) {
             if (!strcmp(ext.extensionName, VK_EXT_DEBUG_MARKER_EXTENSION_NAME)) {
                 requestedDevExts.append(VK_EXT_DEBUG_MARKER_EXTENSION_NAME);
                 debugMarkersAvailable = true;
+            } else if (!strcmp(ext.extensionName, VK_KHR_MAINTENANCE1_EXTENSION_NAME)) {
+                // for rendering into a slice of a 3D texture
+                requestedDevExts.append(VK_KHR_MAINTENANCE1_EXTENSION_NAME);
+                maintenance1Available = true;
             } else if (!strcmp(ext.extensionName, VK_EXT_VERTEX_ATTRIBUTE_DIVISOR_EXTENSION_NAME)) {
                 if (inst->extensions().contains(QByteArrayLiteral("VK_KHR_get_physical_device_properties2"))) {
                     requestedDevExts.append(VK_EXT_VERTEX_ATTRIBUTE_DIVISOR_EXTENSION_NAME);
@@ -407,6 +412,17 @@ bool QRhiVulkan::create(QRhi::Flags flags)
             }
         }
 
+        // Only enable the optional features that are actually used.
+        VkPhysicalDeviceFeatures supportedFeatures;
+        f->vkGetPhysicalDeviceFeatures(physDev, &supportedFeatures);
+        VkPhysicalDeviceFeatures features;
+        memset(&features, 0, sizeof(features));
+        if (supportedFeatures.multiDrawIndirect) {
+            features.multiDrawIndirect = VK_TRUE;
+            multiDrawIndirectAvailable = true;
+        }
+        features.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
         VkDeviceCreateInfo devInfo;
         memset(&devInfo, 0, sizeof(devInfo));
         devInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -416,6 +432,7 @@ bool QRhiVulkan::create(QRhi::Flags flags)
         devInfo.ppEnabledLayerNames = devLayers.constData();
         devInfo.enabledExtensionCount = requestedDevExts.count();
         devInfo.ppEnabledExtensionNames = requestedDevExts.constData();
+        devInfo.pEnabledFeatures = &features;
 
         err = f->vkCreateDevice(physDev, &devInfo, nullptr, &dev);
         if (err != VK_SUCCESS) {
@@ -556,6 +573,11 @@ void QRhiVulkan::destroy()
     executeDeferredReleases(true);
     finishActiveReadbacks(true);
 
+    for (const ReadbackBuffer &rbuf : qAsConst(readbackBufferPool))
+        destroyReadbackBuffer(rbuf);
+    readbackBufferPool.clear();
+    readbackBufferPoolBytes = 0;
+
     QMutexLocker lock(rsh ? &rsh->mtx : nullptr);
 
     if (ofr.cmdFence) {
@@ -632,7 +654,10 @@ VkResult QRhiVulkan::createDescriptorPool(VkDescriptorPool *pool)
     VkDescriptorPoolSize descPoolSizes[] = {
         { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, QVK_UNIFORM_BUFFERS_PER_POOL },
         { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, QVK_UNIFORM_BUFFERS_PER_POOL },
-        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, QVK_COMBINED_IMAGE_SAMPLERS_PER_POOL }
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, QVK_COMBINED_IMAGE_SAMPLERS_PER_POOL },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, QVK_STORAGE_BUFFERS_PER_POOL },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, QVK_STORAGE_BUFFERS_PER_POOL },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, QVK_STORAGE_IMAGES_PER_POOL }
     };
     VkDescriptorPoolCreateInfo descPoolInfo;
     memset(&descPoolInfo, 0, sizeof(descPoolInfo));
@@ -692,6 +717,61 @@ bool QRhiVulkan::allocateDescriptorSet(VkDescriptorSetAllocateInfo *allocInfo, V
     }
 }
 
+static inline VkFormat toVkAttributeFormat(QRhiVertexInputAttribute::Format format)
+{
+    switch (format) {
+    case QRhiVertexInputAttribute::Float4:
+        return VK_FORMAT_R32G32B32A32_SFLOAT;
+    case QRhiVertexInputAttribute::Float3:
+        return VK_FORMAT_R32G32B32_SFLOAT;
+    case QRhiVertexInputAttribute::Float2:
+        return VK_FORMAT_R32G32_SFLOAT;
+    case QRhiVertexInputAttribute::Float:
+        return VK_FORMAT_R32_SFLOAT;
+    case QRhiVertexInputAttribute::UNormByte4:
+        return VK_FORMAT_R8G8B8A8_UNORM;
+    case QRhiVertexInputAttribute::UNormByte2:
+        return VK_FORMAT_R8G8_UNORM;
+    case QRhiVertexInputAttribute::UNormByte:
+        return VK_FORMAT_R8_UNORM;
+    case QRhiVertexInputAttribute::Half4:
+        return VK_FORMAT_R16G16B16A16_SFLOAT;
+    case QRhiVertexInputAttribute::Half2:
+        return VK_FORMAT_R16G16_SFLOAT;
+    case QRhiVertexInputAttribute::SNormByte4:
+        return VK_FORMAT_R8G8B8A8_SNORM;
+    case QRhiVertexInputAttribute::SNormByte2:
+        return VK_FORMAT_R8G8_SNORM;
+    case QRhiVertexInputAttribute::SNormShort4:
+        return VK_FORMAT_R16G16B16A16_SNORM;
+    case QRhiVertexInputAttribute::SNormShort2:
+        return VK_FORMAT_R16G16_SNORM;
+    case QRhiVertexInputAttribute::UInt4:
+        return VK_FORMAT_R32G32B32A32_UINT;
+    case QRhiVertexInputAttribute::UInt3:
+        return VK_FORMAT_R32G32B32_UINT;
+    case QRhiVertexInputAttribute::UInt2:
+        return VK_FORMAT_R32G32_UINT;
+    case QRhiVertexInputAttribute::UInt:
+        return VK_FORMAT_R32_UINT;
+    case QRhiVertexInputAttribute::SInt4:
+        return VK_FORMAT_R32G32B32A32_SINT;
+    case QRhiVertexInputAttribute::SInt3:
+        return VK_FORMAT_R32G32B32_SINT;
+    case QRhiVertexInputAttribute::SInt2:
+        return VK_FORMAT_R32G32_SINT;
+    case QRhiVertexInputAttribute::SInt:
+        return VK_FORMAT_R32_SINT;
+    case QRhiVertexInputAttribute::UNormA2B10G10R10:
+        return VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+    case QRhiVertexInputAttribute::SNormA2B10G10R10:
+        return VK_FORMAT_A2B10G10R10_SNORM_PACK32;
+    default:
+        Q_UNREACHABLE();
+        return VK_FORMAT_R32G32B32A32_SFLOAT;
+    }
+}
+
 static inline VkFormat toVkTextureFormat(QRhiTexture::Format format, QRhiTexture::Flags flags)
 {
     const bool srgb = flags.testFlag(QRhiTexture::sRGB);
@@ -707,6 +787,21 @@ static inline VkFormat toVkTextureFormat(QRhiTexture::Format format, QRhiTexture
     case QRhiTexture::RED_OR_ALPHA8:
         return VK_FORMAT_R8_UNORM;
 
+    case QRhiTexture::RG8:
+        return VK_FORMAT_R8G8_UNORM;
+    case QRhiTexture::RG16:
+        return VK_FORMAT_R16G16_UNORM;
+    case QRhiTexture::RGBA16F:
+        return VK_FORMAT_R16G16B16A16_SFLOAT;
+    case QRhiTexture::RGBA32F:
+        return VK_FORMAT_R32G32B32A32_SFLOAT;
+    case QRhiTexture::R16F:
+        return VK_FORMAT_R16_SFLOAT;
+    case QRhiTexture::R32F:
+        return VK_FORMAT_R32_SFLOAT;
+    case QRhiTexture::B10G11R11_UFLOAT:
+        return VK_FORMAT_B10G11R11_UFLOAT_PACK32;
+
     case QRhiTexture::D16:
         return VK_FORMAT_D16_UNORM;
     case QRhiTexture::D32:
@@ -792,6 +887,20 @@ static inline QRhiTexture::Format colorTextureFormatFromVkFormat(VkFormat format
         return QRhiTexture::R8;
     case VK_FORMAT_R16_UNORM:
         return QRhiTexture::R16;
+    case VK_FORMAT_R8G8_UNORM:
+        return QRhiTexture::RG8;
+    case VK_FORMAT_R16G16_UNORM:
+        return QRhiTexture::RG16;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return QRhiTexture::RGBA16F;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return QRhiTexture::RGBA32F;
+    case VK_FORMAT_R16_SFLOAT:
+        return QRhiTexture::R16F;
+    case VK_FORMAT_R32_SFLOAT:
+        return QRhiTexture::R32F;
+    case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+        return QRhiTexture::B10G11R11_UFLOAT;
     default: // this cannot assert, must warn and return unknown
         qWarning("VkFormat %d is not a recognized uncompressed color format", format);
         break;
@@ -1041,13 +1150,35 @@ bool QRhiVulkan::createDefaultRenderPass(VkRenderPass *rp, bool hasDepthStencil,
     return true;
 }
 
-bool QRhiVulkan::createOffscreenRenderPass(VkRenderPass *rp,
-                                           const QVector<QRhiColorAttachment> &colorAttachments,
-                                           bool preserveColor,
-                                           bool preserveDs,
-                                           QRhiRenderBuffer *depthStencilBuffer,
-                                           QRhiTexture *depthTexture)
+static inline bool isTransientAttachment(QVkTexture *texD, QVkRenderBuffer *rbD)
+{
+    if (texD)
+        return texD->flags().testFlag(QRhiTexture::Transient);
+    return rbD->flags().testFlag(QRhiRenderBuffer::Transient);
+}
+
+static inline VkAttachmentLoadOp toVkLoadOp(QRhiColorAttachment::LoadOp op)
 {
+    switch (op) {
+    case QRhiColorAttachment::LoadOpClear:
+        return VK_ATTACHMENT_LOAD_OP_CLEAR;
+    case QRhiColorAttachment::LoadOpLoad:
+        return VK_ATTACHMENT_LOAD_OP_LOAD;
+    case QRhiColorAttachment::LoadOpDontCare:
+        return VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    default:
+        Q_UNREACHABLE();
+        return VK_ATTACHMENT_LOAD_OP_CLEAR;
+    }
+}
+
+bool QRhiVulkan::createOffscreenRenderPass(VkRenderPass *rp, const QRhiTextureRenderTarget *rt)
+{
+    const QRhiTextureRenderTargetDescription desc = rt->description();
+    const QVector<QRhiColorAttachment> colorAttachments = desc.colorAttachments();
+    QRhiRenderBuffer *depthStencilBuffer = desc.depthStencilBuffer();
+    QRhiTexture *depthTexture = desc.depthTexture();
+
     QVarLengthArray<VkAttachmentDescription, 8> attDescs;
     QVarLengthArray<VkAttachmentReference, 8> colorRefs;
     QVarLengthArray<VkAttachmentReference, 8> resolveRefs;
@@ -1066,12 +1197,17 @@ bool QRhiVulkan::createOffscreenRenderPass(VkRenderPass *rp,
         memset(&attDesc, 0, sizeof(attDesc));
         attDesc.format = vkformat;
         attDesc.samples = samples;
-        attDesc.loadOp = preserveColor ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
-        attDesc.storeOp = colorAttachments[i].resolveTexture() ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+        const QRhiColorAttachment::LoadOp loadOp = colorLoadOp(rt, colorAttachments[i]);
+        const bool store = colorStoreOp(colorAttachments[i]) == QRhiColorAttachment::StoreOpStore
+                && !colorAttachments[i].resolveTexture();
+        attDesc.loadOp = toVkLoadOp(loadOp);
+        attDesc.storeOp = store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
         attDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         attDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        attDesc.initialLayout = preserveColor ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
-        attDesc.finalLayout = colorAttachments[i].resolveTexture() ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        attDesc.initialLayout = loadOp == QRhiColorAttachment::LoadOpLoad ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                                                                         : VK_IMAGE_LAYOUT_UNDEFINED;
+        attDesc.finalLayout = colorAttachments[i].resolveTexture() || isTransientAttachment(texD, rbD)
+                ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         attDescs.append(attDesc);
 
         const VkAttachmentReference ref = { uint32_t(attDescs.count() - 1), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
@@ -1084,8 +1220,10 @@ bool QRhiVulkan::createOffscreenRenderPass(VkRenderPass *rp,
                                                : QRHI_RES(QVkRenderBuffer, depthStencilBuffer)->vkformat;
         const VkSampleCountFlagBits samples = depthTexture ? QRHI_RES(QVkTexture, depthTexture)->samples
                                                            : QRHI_RES(QVkRenderBuffer, depthStencilBuffer)->samples;
-        const VkAttachmentLoadOp loadOp = preserveDs ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
-        const VkAttachmentStoreOp storeOp = depthTexture ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        const VkAttachmentLoadOp loadOp = toVkLoadOp(depthStencilLoadOp(rt));
+        // depth/stencil renderbuffers are never written out
+        const bool store = depthTexture && depthStencilStoreOp(rt) == QRhiColorAttachment::StoreOpStore;
+        const VkAttachmentStoreOp storeOp = store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
         VkAttachmentDescription attDesc;
         memset(&attDesc, 0, sizeof(attDesc));
         attDesc.format = dsFormat;
@@ -1095,7 +1233,8 @@ bool QRhiVulkan::createOffscreenRenderPass(VkRenderPass *rp,
         attDesc.stencilLoadOp = loadOp;
         attDesc.stencilStoreOp = storeOp;
         attDesc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        attDesc.finalLayout = depthTexture ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        attDesc.finalLayout = depthTexture && !depthTexture->flags().testFlag(QRhiTexture::Transient)
+                ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
         attDescs.append(attDesc);
     }
     VkAttachmentReference dsRef = { uint32_t(attDescs.count() - 1), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
@@ -1372,6 +1511,12 @@ void QRhiVulkan::releaseSwapChainResources(QRhiSwapChain *swapChain)
             df->vkDestroySemaphore(dev, frame.drawSem, nullptr);
             frame.drawSem = VK_NULL_HANDLE;
         }
+        if (frame.markerQueryPool) {
+            df->vkDestroyQueryPool(dev, frame.markerQueryPool, nullptr);
+            frame.markerQueryPool = VK_NULL_HANDLE;
+        }
+        frame.markerTimingActive = false;
+        frame.markerFrameSerial = 0;
     }
 
     for (int i = 0; i < swapChainD->bufferCount; ++i) {
@@ -1644,12 +1789,39 @@ QRhi::FrameOpResult QRhiVulkan::beginNonWrapperFrame(QRhiSwapChain *swapChain)
         }
     }
 
+    // and the timestamps for the debug marker scopes
+    if (frame.markerFrameSerial)
+        resolveMarkerTimestamps(swapChainD, &frame);
+
     // build new draw command buffer
     QVkSwapChain::ImageResources &image(swapChainD->imageRes[swapChainD->currentImageIndex]);
     QRhi::FrameOpResult cbres = startCommandBuffer(&image.cmdBuf);
     if (cbres != QRhi::FrameOpSuccess)
         return cbres;
 
+    frame.markerTimingActive = false;
+    frame.markerQueryCount = 0;
+    frame.markerScopeCount = 0;
+    frame.markerStack.clear();
+    frame.markerScopes.clear();
+    if (rhiP && rhiP->markerTiming && timestampValidBits) {
+        if (!frame.markerQueryPool) {
+            VkQueryPoolCreateInfo queryPoolInfo;
+            memset(&queryPoolInfo, 0, sizeof(queryPoolInfo));
+            queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            queryPoolInfo.queryCount = QVK_MAX_MARKER_TIMESTAMPS;
+            VkResult err = df->vkCreateQueryPool(dev, &queryPoolInfo, nullptr, &frame.markerQueryPool);
+            if (err != VK_SUCCESS)
+                qWarning("Failed to create marker timestamp query pool: %d", err);
+        }
+        if (frame.markerQueryPool) {
+            // cannot be done inside a render pass, so reset everything upfront
+            df->vkCmdResetQueryPool(image.cmdBuf, frame.markerQueryPool, 0, QVK_MAX_MARKER_TIMESTAMPS);
+            frame.markerTimingActive = true;
+        }
+    }
+
     // when profiling is enabled, pick a free query (pair) from the pool
     int timestampQueryIdx = -1;
     if (profilerPrivateOrNull()) {
@@ -1698,6 +1870,7 @@ QRhi::FrameOpResult QRhiVulkan::endNonWrapperFrame(QRhiSwapChain *swapChain, QRh
 
     QVkSwapChain::FrameResources &frame(swapChainD->frameRes[swapChainD->currentFrameSlot]);
     QVkSwapChain::ImageResources &image(swapChainD->imageRes[swapChainD->currentImageIndex]);
+    QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
 
     if (!image.presentableLayout) {
         // was used in a readback as transfer source, go back to presentable layout
@@ -1711,6 +1884,7 @@ QRhi::FrameOpResult QRhiVulkan::endNonWrapperFrame(QRhiSwapChain *swapChain, QRh
         presTrans.image = image.image;
         presTrans.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         presTrans.subresourceRange.levelCount = presTrans.subresourceRange.layerCount = 1;
+        QRHI_PROF_F(frameStats.barriers++);
         df->vkCmdPipelineBarrier(image.cmdBuf,
                                  VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
                                  0, 0, nullptr, 0, nullptr,
@@ -1737,7 +1911,8 @@ QRhi::FrameOpResult QRhiVulkan::endNonWrapperFrame(QRhiSwapChain *swapChain, QRh
     frame.imageSemWaitable = false;
     image.cmdFenceWaitable = true;
 
-    QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
+    if (rhiP && frame.markerTimingActive && !frame.markerScopes.isEmpty())
+        frame.markerFrameSerial = rhiP->requestMarkerGpuTimes(swapChain);
     // this must be done before the Present
     QRHI_PROF_F(endSwapChainFrame(swapChain, swapChainD->frameCount + 1));
 
@@ -1923,13 +2098,18 @@ void QRhiVulkan::deactivateTextureRenderTarget(QRhiCommandBuffer *, QRhiTextureR
     for (const QRhiColorAttachment &colorAttachment : colorAttachments) {
         QVkTexture *texD = QRHI_RES(QVkTexture, colorAttachment.texture());
         QVkRenderBuffer *rbD = QRHI_RES(QVkRenderBuffer, colorAttachment.renderBuffer());
-        if (texD)
-            texD->layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        else if (rbD)
-            rbD->backingTexture->layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        if (rbD)
+            texD = rbD->backingTexture;
+        if (texD) {
+            texD->layout = texD->flags().testFlag(QRhiTexture::Transient) ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+                                                                          : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        }
+    }
+    if (rtD->m_desc.depthTexture()) {
+        QVkTexture *depthTexD = QRHI_RES(QVkTexture, rtD->m_desc.depthTexture());
+        depthTexD->layout = depthTexD->flags().testFlag(QRhiTexture::Transient) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+                                                                                : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     }
-    if (rtD->m_desc.depthTexture())
-        QRHI_RES(QVkTexture, rtD->m_desc.depthTexture())->layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 }
 
 void QRhiVulkan::prepareNewFrame(QRhiCommandBuffer *cb)
@@ -1958,7 +2138,7 @@ void QRhiVulkan::prepareNewFrame(QRhiCommandBuffer *cb)
 
 void QRhiVulkan::resourceUpdate(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
 {
-    Q_ASSERT(inFrame && !inPass);
+    Q_ASSERT(inFrame && !inPass && !inComputePass);
 
     enqueueResourceUpdates(cb, resourceUpdates);
 }
@@ -1969,7 +2149,7 @@ void QRhiVulkan::beginPass(QRhiCommandBuffer *cb,
                            const QRhiDepthStencilClearValue &depthStencilClearValue,
                            QRhiResourceUpdateBatch *resourceUpdates)
 {
-    Q_ASSERT(!inPass);
+    Q_ASSERT(!inPass && !inComputePass);
 
     if (resourceUpdates)
         enqueueResourceUpdates(cb, resourceUpdates);
@@ -2046,6 +2226,75 @@ void QRhiVulkan::endPass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourc
         enqueueResourceUpdates(cb, resourceUpdates);
 }
 
+void QRhiVulkan::beginComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
+{
+    Q_ASSERT(!inPass && !inComputePass);
+
+    if (resourceUpdates)
+        enqueueResourceUpdates(cb, resourceUpdates);
+
+    QVkCommandBuffer *cbD = QRHI_RES(QVkCommandBuffer, cb);
+
+    // Make all earlier writes (transfers, attachments, shader stores) visible
+    // to the compute shaders. This is coarse but keeps the rules simple: no
+    // per-resource tracking is needed on the application side.
+    memoryBarrier(cb,
+                  VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                  | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_UNIFORM_READ_BIT,
+                  VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    // the descriptor set bound for graphics is not relevant for compute and vice versa
+    cbD->currentSrb = nullptr;
+    cbD->currentSrbGeneration = 0;
+    cbD->currentDescSetSlot = -1;
+    cbD->dispatchCount = 0;
+
+    inComputePass = true;
+}
+
+void QRhiVulkan::endComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates)
+{
+    Q_ASSERT(inComputePass);
+    QVkCommandBuffer *cbD = QRHI_RES(QVkCommandBuffer, cb);
+
+    // Make the results visible to anything that may consume them afterwards:
+    // vertex/index/indirect input, shaders (uniform, sampled, storage), and transfers.
+    memoryBarrier(cb,
+                  VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+                  | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT
+                  | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                  VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
+                  | VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                  | VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    // Storage images are in GENERAL layout now, while the rest of the backend
+    // assumes textures are left in SHADER_READ_ONLY_OPTIMAL.
+    for (QVkTexture *texD : qAsConst(computePassGeneralImages)) {
+        if (texD->image && texD->layout == VK_IMAGE_LAYOUT_GENERAL) {
+            imageBarrier(cb, texD, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                         VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        }
+    }
+    computePassGeneralImages.clear();
+
+    cbD->currentComputePipeline = nullptr;
+    cbD->currentComputePipelineGeneration = 0;
+    cbD->currentSrb = nullptr;
+    cbD->currentSrbGeneration = 0;
+    cbD->currentDescSetSlot = -1;
+
+    inComputePass = false;
+
+    if (resourceUpdates)
+        enqueueResourceUpdates(cb, resourceUpdates);
+}
+
 VkShaderModule QRhiVulkan::createShader(const QByteArray &spirv)
 {
     VkShaderModuleCreateInfo shaderInfo;
@@ -2137,6 +2386,45 @@ void QRhiVulkan::updateShaderResourceBindings(QRhiShaderResourceBindings *srb, i
                 writeInfo.pImageInfo = &imageInfos.last();
             }
                 break;
+            case QRhiShaderResourceBinding::ImageLoad:
+                Q_FALLTHROUGH();
+            case QRhiShaderResourceBinding::ImageStore:
+                Q_FALLTHROUGH();
+            case QRhiShaderResourceBinding::ImageLoadStore:
+            {
+                QVkTexture *texD = QRHI_RES(QVkTexture, b->u.simage.tex);
+                VkImageView view = texD->imageViewForLevel(b->u.simage.level);
+                if (view) {
+                    writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+                    bd.simage.id = texD->m_id;
+                    bd.simage.generation = texD->generation;
+                    VkDescriptorImageInfo imageInfo;
+                    imageInfo.sampler = VK_NULL_HANDLE;
+                    imageInfo.imageView = view;
+                    imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+                    imageInfos.append(imageInfo);
+                    writeInfo.pImageInfo = &imageInfos.last();
+                }
+            }
+                break;
+            case QRhiShaderResourceBinding::BufferLoad:
+                Q_FALLTHROUGH();
+            case QRhiShaderResourceBinding::BufferStore:
+                Q_FALLTHROUGH();
+            case QRhiShaderResourceBinding::BufferLoadStore:
+            {
+                QVkBuffer *bufD = QRHI_RES(QVkBuffer, b->u.sbuf.buf);
+                writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                bd.sbuf.id = bufD->m_id;
+                bd.sbuf.generation = bufD->generation;
+                VkDescriptorBufferInfo bufInfo;
+                bufInfo.buffer = bufD->m_type == QRhiBuffer::Dynamic ? bufD->buffers[frameSlot] : bufD->buffers[0];
+                bufInfo.offset = b->u.sbuf.offset;
+                bufInfo.range = b->u.sbuf.maybeSize ? b->u.sbuf.maybeSize : bufD->m_size;
+                bufferInfos.append(bufInfo);
+                writeInfo.pBufferInfo = &bufferInfos.last();
+            }
+                break;
             default:
                 continue;
             }
@@ -2159,7 +2447,7 @@ void QRhiVulkan::bufferBarrier(QRhiCommandBuffer *cb, QRhiBuffer *buf)
 
     QVkBuffer *bufD = QRHI_RES(QVkBuffer, buf);
     int dstAccess = 0;
-    VkPipelineStageFlagBits dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+    int dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
 
     if (bufD->m_usage.testFlag(QRhiBuffer::VertexBuffer))
         dstAccess |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
@@ -2169,13 +2457,19 @@ void QRhiVulkan::bufferBarrier(QRhiCommandBuffer *cb, QRhiBuffer *buf)
         dstAccess |= VK_ACCESS_UNIFORM_READ_BIT;
         dstStage = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT; // don't know where it's used, assume vertex to be safe
     }
+    if (bufD->m_usage.testFlag(QRhiBuffer::IndirectBuffer)) {
+        dstAccess |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        dstStage |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+    }
 
     bufMemBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
     bufMemBarrier.dstAccessMask = dstAccess;
     bufMemBarrier.buffer = QRHI_RES(QVkBuffer, buf)->buffers[0];
     bufMemBarrier.size = bufD->m_size;
 
-    df->vkCmdPipelineBarrier(QRHI_RES(QVkCommandBuffer, cb)->cb, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage,
+    QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
+    QRHI_PROF_F(frameStats.barriers++);
+    df->vkCmdPipelineBarrier(QRHI_RES(QVkCommandBuffer, cb)->cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VkPipelineStageFlags(dstStage),
                              0, 0, nullptr, 1, &bufMemBarrier, 0, nullptr);
 }
 
@@ -2202,6 +2496,8 @@ void QRhiVulkan::imageSubResBarrier(QRhiCommandBuffer *cb, QRhiTexture *tex,
     barrier.dstAccessMask = dstAccess;
     barrier.image = texD->image;
 
+    QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
+    QRHI_PROF_F(frameStats.barriers++);
     df->vkCmdPipelineBarrier(QRHI_RES(QVkCommandBuffer, cb)->cb,
                              srcStage,
                              dstStage,
@@ -2221,7 +2517,7 @@ void QRhiVulkan::imageBarrier(QRhiCommandBuffer *cb, QRhiTexture *tex,
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     barrier.subresourceRange.levelCount = texD->mipLevelCount;
-    barrier.subresourceRange.layerCount = texD->m_flags.testFlag(QRhiTexture::CubeMap) ? 6 : 1;
+    barrier.subresourceRange.layerCount = texD->arrayLayerCount();
 
     barrier.oldLayout = texD->layout;
     barrier.newLayout = newLayout;
@@ -2229,6 +2525,8 @@ void QRhiVulkan::imageBarrier(QRhiCommandBuffer *cb, QRhiTexture *tex,
     barrier.dstAccessMask = dstAccess;
     barrier.image = texD->image;
 
+    QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
+    QRHI_PROF_F(frameStats.barriers++);
     df->vkCmdPipelineBarrier(QRHI_RES(QVkCommandBuffer, cb)->cb,
                              srcStage,
                              dstStage,
@@ -2238,6 +2536,25 @@ void QRhiVulkan::imageBarrier(QRhiCommandBuffer *cb, QRhiTexture *tex,
     texD->layout = newLayout;
 }
 
+void QRhiVulkan::memoryBarrier(QRhiCommandBuffer *cb,
+                               VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+                               VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+{
+    VkMemoryBarrier barrier;
+    memset(&barrier, 0, sizeof(barrier));
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+
+    QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
+    QRHI_PROF_F(frameStats.barriers++);
+    df->vkCmdPipelineBarrier(QRHI_RES(QVkCommandBuffer, cb)->cb,
+                             srcStage,
+                             dstStage,
+                             0, 1, &barrier, 0, nullptr,
+                             0, nullptr);
+}
+
 void QRhiVulkan::prepareForTransferDest(QRhiCommandBuffer *cb, QVkTexture *texD)
 {
     if (texD->layout != VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
@@ -2321,6 +2638,7 @@ void QRhiVulkan::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdat
             if (err == VK_SUCCESS) {
                 bufD->stagingAllocations[currentFrameSlot] = allocation;
                 QRHI_PROF_F(newBufferStagingArea(bufD, currentFrameSlot, bufD->m_size));
+                addStagingMemory(bufD, currentFrameSlot, bufD->m_size);
             } else {
                 qWarning("Failed to create staging buffer of size %d: %d", bufD->m_size, err);
                 continue;
@@ -2358,9 +2676,68 @@ void QRhiVulkan::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdat
             bufD->stagingAllocations[currentFrameSlot] = nullptr;
             releaseQueue.append(e);
             QRHI_PROF_F(releaseBufferStagingArea(bufD, currentFrameSlot));
+            removeStagingMemory(bufD, currentFrameSlot);
         }
     }
 
+    for (const QRhiResourceUpdateBatchPrivate::BufferReadback &u : ud->bufferReadbacks) {
+        QVkBuffer *bufD = QRHI_RES(QVkBuffer, u.buf);
+        ActiveBufferReadback aRb;
+        aRb.activeFrameSlot = currentFrameSlot;
+        aRb.result = u.result;
+        aRb.size = u.size;
+
+        if (bufD->m_type == QRhiBuffer::Dynamic) {
+            // Host visible, the GPU never writes it. Read the current slot
+            // and apply the writes that are still pending for it.
+            void *p = nullptr;
+            VmaAllocation a = toVmaAllocation(bufD->allocations[currentFrameSlot]);
+            VkResult err = vmaMapMemory(toVmaAllocator(allocator), a, &p);
+            if (err != VK_SUCCESS) {
+                qWarning("Failed to map buffer: %d", err);
+                continue;
+            }
+            u.result->data.resize(u.size);
+            memcpy(u.result->data.data(), static_cast<const char *>(p) + u.offset, u.size);
+            vmaUnmapMemory(toVmaAllocator(allocator), a);
+            for (const QRhiResourceUpdateBatchPrivate::DynamicBufferUpdate &w : bufD->pendingDynamicUpdates[currentFrameSlot]) {
+                const int begin = qMax(w.offset, u.offset);
+                const int end = qMin(w.offset + w.data.size(), u.offset + u.size);
+                if (begin < end)
+                    memcpy(u.result->data.data() + begin - u.offset, w.data.constData() + begin - w.offset, end - begin);
+            }
+        } else {
+            if (!acquireReadbackBuffer(u.size, bufD, &aRb.buf))
+                continue;
+
+            // make earlier transfer writes (uploads) visible to the copy
+            VkBufferMemoryBarrier bufMemBarrier;
+            memset(&bufMemBarrier, 0, sizeof(bufMemBarrier));
+            bufMemBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            bufMemBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufMemBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufMemBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            bufMemBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            bufMemBarrier.buffer = bufD->buffers[0];
+            bufMemBarrier.offset = u.offset;
+            bufMemBarrier.size = u.size;
+            QRHI_PROF_F(frameStats.barriers++);
+            df->vkCmdPipelineBarrier(cbD->cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                     0, 0, nullptr, 1, &bufMemBarrier, 0, nullptr);
+
+            VkBufferCopy copyInfo;
+            memset(&copyInfo, 0, sizeof(copyInfo));
+            copyInfo.srcOffset = u.offset;
+            copyInfo.dstOffset = 0;
+            copyInfo.size = u.size;
+            df->vkCmdCopyBuffer(cbD->cb, bufD->buffers[0], aRb.buf.buf, 1, &copyInfo);
+
+            bufD->lastActiveFrameSlot = currentFrameSlot;
+        }
+
+        activeBufferReadbacks.append(aRb);
+    }
+
     for (const QRhiResourceUpdateBatchPrivate::TextureOp &u : ud->textureOps) {
         if (u.type == QRhiResourceUpdateBatchPrivate::TextureOp::TexUpload) {
             const QVector<QRhiTextureLayer> layers = u.upload.desc.layers();
@@ -2403,6 +2780,7 @@ void QRhiVulkan::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdat
                 }
                 utexD->stagingAllocations[currentFrameSlot] = allocation;
                 QRHI_PROF_F(newTextureStagingArea(utexD, currentFrameSlot, stagingSize));
+                addStagingMemory(utexD, currentFrameSlot, stagingSize);
             }
 
             QVarLengthArray<VkBufferImageCopy, 4> copyInfos;
@@ -2415,6 +2793,8 @@ void QRhiVulkan::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdat
                 continue;
             }
             QVector<QImage> tempImages; // yes, we rely heavily on implicit sharing in QImage
+            // layers are slices for 3D textures
+            const bool is3D = utexD->m_flags.testFlag(QRhiTexture::ThreeDimensional);
             for (int layer = 0, layerCount = layers.count(); layer != layerCount; ++layer) {
                 const QRhiTextureLayer &layerDesc(layers[layer]);
                 const QVector<QRhiTextureMipLevel> mipImages = layerDesc.mipImages();
@@ -2428,8 +2808,9 @@ void QRhiVulkan::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdat
                     copyInfo.bufferOffset = curOfs;
                     copyInfo.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
                     copyInfo.imageSubresource.mipLevel = level;
-                    copyInfo.imageSubresource.baseArrayLayer = layer;
+                    copyInfo.imageSubresource.baseArrayLayer = is3D ? 0 : layer;
                     copyInfo.imageSubresource.layerCount = 1;
+                    copyInfo.imageOffset.z = is3D ? layer : 0;
                     copyInfo.imageExtent.depth = 1;
 
                     const QPoint dp = mipDesc.destinationTopLeft();
@@ -2519,6 +2900,7 @@ void QRhiVulkan::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdat
                 utexD->stagingAllocations[currentFrameSlot] = nullptr;
                 releaseQueue.append(e);
                 QRHI_PROF_F(releaseTextureStagingArea(utexD, currentFrameSlot));
+                removeStagingMemory(utexD, currentFrameSlot);
             }
 
             finishTransferDest(cb, utexD);
@@ -2532,19 +2914,23 @@ void QRhiVulkan::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdat
 
             region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
             region.srcSubresource.mipLevel = u.copy.desc.sourceLevel();
-            region.srcSubresource.baseArrayLayer = u.copy.desc.sourceLayer();
+            const bool srcIs3D = srcD->m_flags.testFlag(QRhiTexture::ThreeDimensional);
+            region.srcSubresource.baseArrayLayer = srcIs3D ? 0 : u.copy.desc.sourceLayer();
             region.srcSubresource.layerCount = 1;
 
             region.srcOffset.x = u.copy.desc.sourceTopLeft().x();
             region.srcOffset.y = u.copy.desc.sourceTopLeft().y();
+            region.srcOffset.z = srcIs3D ? u.copy.desc.sourceLayer() : 0;
 
             region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
             region.dstSubresource.mipLevel = u.copy.desc.destinationLevel();
-            region.dstSubresource.baseArrayLayer = u.copy.desc.destinationLayer();
+            const bool dstIs3D = dstD->m_flags.testFlag(QRhiTexture::ThreeDimensional);
+            region.dstSubresource.baseArrayLayer = dstIs3D ? 0 : u.copy.desc.destinationLayer();
             region.dstSubresource.layerCount = 1;
 
             region.dstOffset.x = u.copy.desc.destinationTopLeft().x();
             region.dstOffset.y = u.copy.desc.destinationTopLeft().y();
+            region.dstOffset.z = dstIs3D ? u.copy.desc.destinationLayer() : 0;
 
             const QSize size = u.copy.desc.pixelSize().isEmpty() ? srcD->m_pixelSize : u.copy.desc.pixelSize();
             region.extent.width = size.width();
@@ -2571,13 +2957,17 @@ void QRhiVulkan::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdat
 
             QVkTexture *texD = QRHI_RES(QVkTexture, u.read.rb.texture());
             QVkSwapChain *swapChainD = nullptr;
+            QRect rect;
             if (texD) {
                 if (texD->samples > VK_SAMPLE_COUNT_1_BIT) {
                     qWarning("Multisample texture cannot be read back");
                     continue;
                 }
-                aRb.pixelSize = u.read.rb.level() > 0 ? q->sizeForMipLevel(u.read.rb.level(), texD->m_pixelSize)
-                                                 : texD->m_pixelSize;
+                const QSize levelSize = u.read.rb.level() > 0 ? q->sizeForMipLevel(u.read.rb.level(), texD->m_pixelSize)
+                                                              : texD->m_pixelSize;
+                if (!readbackRect(u.read.rb, levelSize, &rect))
+                    continue;
+                aRb.pixelSize = rect.size();
                 aRb.format = texD->m_format;
                 texD->lastActiveFrameSlot = currentFrameSlot;
             } else {
@@ -2587,7 +2977,9 @@ void QRhiVulkan::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdat
                     qWarning("Swapchain does not support readback");
                     continue;
                 }
-                aRb.pixelSize = swapChainD->pixelSize;
+                if (!readbackRect(u.read.rb, swapChainD->pixelSize, &rect))
+                    continue;
+                aRb.pixelSize = rect.size();
                 aRb.format = colorTextureFormatFromVkFormat(swapChainD->colorFormat, nullptr);
                 if (aRb.format == QRhiTexture::UnknownFormat)
                     continue;
@@ -2597,26 +2989,11 @@ void QRhiVulkan::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdat
             }
             textureFormatInfo(aRb.format, aRb.pixelSize, nullptr, &aRb.bufSize);
 
-            // Create a host visible buffer.
-            VkBufferCreateInfo bufferInfo;
-            memset(&bufferInfo, 0, sizeof(bufferInfo));
-            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-            bufferInfo.size = aRb.bufSize;
-            bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-
-            VmaAllocationCreateInfo allocInfo;
-            memset(&allocInfo, 0, sizeof(allocInfo));
-            allocInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
-
-            VmaAllocation allocation;
-            VkResult err = vmaCreateBuffer(toVmaAllocator(allocator), &bufferInfo, &allocInfo, &aRb.buf, &allocation, nullptr);
-            if (err == VK_SUCCESS) {
-                aRb.bufAlloc = allocation;
-                QRHI_PROF_F(newReadbackBuffer(reinterpret_cast<quint64>(aRb.buf),
-                                              texD ? static_cast<QRhiResource *>(texD) : static_cast<QRhiResource *>(swapChainD),
-                                              aRb.bufSize));
-            } else {
-                qWarning("Failed to create readback buffer of size %u: %d", aRb.bufSize, err);
+            // Get a host visible buffer.
+            if (!acquireReadbackBuffer(aRb.bufSize,
+                                       texD ? static_cast<QRhiResource *>(texD) : static_cast<QRhiResource *>(swapChainD),
+                                       &aRb.buf))
+            {
                 continue;
             }
 
@@ -2626,15 +3003,20 @@ void QRhiVulkan::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdat
             copyDesc.bufferOffset = 0;
             copyDesc.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
             copyDesc.imageSubresource.mipLevel = u.read.rb.level();
-            copyDesc.imageSubresource.baseArrayLayer = u.read.rb.layer();
+            if (texD && texD->m_flags.testFlag(QRhiTexture::ThreeDimensional))
+                copyDesc.imageOffset.z = u.read.rb.layer();
+            else
+                copyDesc.imageSubresource.baseArrayLayer = u.read.rb.layer();
             copyDesc.imageSubresource.layerCount = 1;
+            copyDesc.imageOffset.x = rect.x();
+            copyDesc.imageOffset.y = rect.y();
             copyDesc.imageExtent.width = aRb.pixelSize.width();
             copyDesc.imageExtent.height = aRb.pixelSize.height();
             copyDesc.imageExtent.depth = 1;
 
             if (texD) {
                 prepareForTransferSrc(cb, texD);
-                df->vkCmdCopyImageToBuffer(cbD->cb, texD->image, texD->layout, aRb.buf, 1, &copyDesc);
+                df->vkCmdCopyImageToBuffer(cbD->cb, texD->image, texD->layout, aRb.buf.buf, 1, &copyDesc);
                 finishTransferSrc(cb, texD);
             } else {
                 // use the swapchain image
@@ -2649,13 +3031,14 @@ void QRhiVulkan::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdat
                 barrier.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
                 barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
                 barrier.image = image;
+                QRHI_PROF_F(frameStats.barriers++);
                 df->vkCmdPipelineBarrier(cbD->cb,
                                          VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
                                          0, 0, nullptr, 0, nullptr,
                                          1, &barrier);
                 swapChainD->imageRes[swapChainD->currentImageIndex].presentableLayout = false;
 
-                df->vkCmdCopyImageToBuffer(cbD->cb, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, aRb.buf, 1, &copyDesc);
+                df->vkCmdCopyImageToBuffer(cbD->cb, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, aRb.buf.buf, 1, &copyDesc);
             }
 
             activeReadbacks.append(aRb);
@@ -2667,7 +3050,7 @@ void QRhiVulkan::enqueueResourceUpdates(QRhiCommandBuffer *cb, QRhiResourceUpdat
 
             prepareForTransferSrc(cb, utexD);
 
-            const uint layerCount = utexD->m_flags.testFlag(QRhiTexture::CubeMap) ? 6 : 1;
+            const uint layerCount = utexD->arrayLayerCount();
             for (uint level = 1; level < utexD->mipLevelCount; ++level) {
                 if (level > 1) {
                     imageSubResBarrier(cb, utexD,
@@ -2782,6 +3165,8 @@ static void qrhivk_releaseRenderBuffer(const QRhiVulkan::DeferredReleaseEntry &e
 static void qrhivk_releaseTexture(const QRhiVulkan::DeferredReleaseEntry &e, VkDevice dev, QVulkanDeviceFunctions *df, void *allocator)
 {
     df->vkDestroyImageView(dev, e.texture.imageView, nullptr);
+    for (int i = 0; i < QVK_MAX_MIP_LEVELS; ++i)
+        df->vkDestroyImageView(dev, e.texture.perLevelImageViews[i], nullptr);
     vmaDestroyImage(toVmaAllocator(allocator), e.texture.image, toVmaAllocation(e.texture.allocation));
     for (int i = 0; i < QVK_FRAMES_IN_FLIGHT; ++i)
         vmaDestroyBuffer(toVmaAllocator(allocator), e.texture.stagingBuffers[i], toVmaAllocation(e.texture.stagingAllocations[i]));
@@ -2873,26 +3258,15 @@ void QRhiVulkan::executeDeferredReleases(bool forced)
 void QRhiVulkan::finishActiveReadbacks(bool forced)
 {
     QVarLengthArray<std::function<void()>, 4> completedCallbacks;
-    QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
 
     for (int i = activeReadbacks.count() - 1; i >= 0; --i) {
         const QRhiVulkan::ActiveReadback &aRb(activeReadbacks[i]);
         if (forced || currentFrameSlot == aRb.activeFrameSlot || aRb.activeFrameSlot < 0) {
             aRb.result->format = aRb.format;
             aRb.result->pixelSize = aRb.pixelSize;
-            aRb.result->data.resize(aRb.bufSize);
-            void *p = nullptr;
-            VmaAllocation a = toVmaAllocation(aRb.bufAlloc);
-            VkResult err = vmaMapMemory(toVmaAllocator(allocator), a, &p);
-            if (err != VK_SUCCESS) {
-                qWarning("Failed to map readback buffer: %d", err);
-                continue;
-            }
-            memcpy(aRb.result->data.data(), p, aRb.bufSize);
-            vmaUnmapMemory(toVmaAllocator(allocator), a);
-
-            vmaDestroyBuffer(toVmaAllocator(allocator), aRb.buf, a);
-            QRHI_PROF_F(releaseReadbackBuffer(reinterpret_cast<quint64>(aRb.buf)));
+            vmaInvalidateAllocation(toVmaAllocator(allocator), toVmaAllocation(aRb.buf.alloc), 0, aRb.bufSize);
+            storeReadbackData(aRb.result, aRb.buf.p, aRb.bufSize);
+            recycleReadbackBuffer(aRb.buf);
 
             if (aRb.result->completed)
                 completedCallbacks.append(aRb.result->completed);
@@ -2901,10 +3275,114 @@ void QRhiVulkan::finishActiveReadbacks(bool forced)
         }
     }
 
+    for (int i = activeBufferReadbacks.count() - 1; i >= 0; --i) {
+        const QRhiVulkan::ActiveBufferReadback &aRb(activeBufferReadbacks[i]);
+        if (forced || currentFrameSlot == aRb.activeFrameSlot || aRb.activeFrameSlot < 0) {
+            if (aRb.buf.buf) {
+                vmaInvalidateAllocation(toVmaAllocator(allocator), toVmaAllocation(aRb.buf.alloc), 0, aRb.size);
+                aRb.result->data.resize(aRb.size);
+                memcpy(aRb.result->data.data(), aRb.buf.p, aRb.size);
+                recycleReadbackBuffer(aRb.buf);
+            } // else the data was copied already from a Dynamic buffer
+
+            if (aRb.result->completed)
+                completedCallbacks.append(aRb.result->completed);
+
+            activeBufferReadbacks.removeAt(i);
+        }
+    }
+
     for (auto f : completedCallbacks)
         f();
 }
 
+static inline quint32 readbackBufferSizeClass(quint32 size)
+{
+    // Quarter steps between powers of two, starting from 64 KB, so that
+    // readbacks of a slightly different size (for example, after resizing a
+    // window) can still reuse buffers, while wasting at most 25%.
+    const quint64 minSize = 65536;
+    if (size <= minSize)
+        return quint32(minSize);
+    quint64 octave = minSize;
+    while (octave * 2 < size)
+        octave *= 2;
+    const quint64 step = octave / 4;
+    const quint64 sizeClass = octave + (size - octave + step - 1) / step * step;
+    return sizeClass <= 0xFFFFFFFFu ? quint32(sizeClass) : size;
+}
+
+bool QRhiVulkan::acquireReadbackBuffer(quint32 size, QRhiResource *src, ReadbackBuffer *rbuf)
+{
+    const quint32 sizeClass = readbackBufferSizeClass(size);
+
+    // best fit, but do not tie up a buffer more than twice the size needed
+    int bestIndex = -1;
+    for (int i = readbackBufferPool.count() - 1; i >= 0; --i) {
+        const quint32 candidate = readbackBufferPool[i].sizeClass;
+        if (candidate >= sizeClass && quint64(candidate) <= quint64(sizeClass) * 2
+                && (bestIndex < 0 || candidate < readbackBufferPool[bestIndex].sizeClass))
+        {
+            bestIndex = i;
+            if (candidate == sizeClass)
+                break;
+        }
+    }
+    if (bestIndex >= 0) {
+        *rbuf = readbackBufferPool.takeAt(bestIndex);
+        readbackBufferPoolBytes -= rbuf->sizeClass;
+        return true;
+    }
+
+    VkBufferCreateInfo bufferInfo;
+    memset(&bufferInfo, 0, sizeof(bufferInfo));
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = sizeClass;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    VmaAllocationCreateInfo allocInfo;
+    memset(&allocInfo, 0, sizeof(allocInfo));
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+    allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    VmaAllocation allocation;
+    VmaAllocationInfo allocationInfo;
+    VkResult err = vmaCreateBuffer(toVmaAllocator(allocator), &bufferInfo, &allocInfo,
+                                   &rbuf->buf, &allocation, &allocationInfo);
+    if (err != VK_SUCCESS) {
+        qWarning("Failed to create readback buffer of size %u: %d", sizeClass, err);
+        return false;
+    }
+    rbuf->alloc = allocation;
+    rbuf->p = allocationInfo.pMappedData;
+    rbuf->sizeClass = sizeClass;
+
+    QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
+    QRHI_PROF_F(newReadbackBuffer(reinterpret_cast<quint64>(rbuf->buf), src, sizeClass));
+    addReadbackMemory(reinterpret_cast<quint64>(rbuf->buf), sizeClass);
+    return true;
+}
+
+void QRhiVulkan::recycleReadbackBuffer(const ReadbackBuffer &rbuf)
+{
+    readbackBufferPool.append(rbuf);
+    readbackBufferPoolBytes += rbuf.sizeClass;
+    // bounded by the total size, the least recently used buffers go first
+    while (readbackBufferPoolBytes > QVK_MAX_POOLED_READBACK_BYTES) {
+        const ReadbackBuffer oldest = readbackBufferPool.takeFirst();
+        readbackBufferPoolBytes -= oldest.sizeClass;
+        destroyReadbackBuffer(oldest);
+    }
+}
+
+void QRhiVulkan::destroyReadbackBuffer(const ReadbackBuffer &rbuf)
+{
+    vmaDestroyBuffer(toVmaAllocator(allocator), rbuf.buf, toVmaAllocation(rbuf.alloc));
+    QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
+    QRHI_PROF_F(releaseReadbackBuffer(reinterpret_cast<quint64>(rbuf.buf)));
+    removeReadbackMemory(reinterpret_cast<quint64>(rbuf.buf));
+}
+
 static struct {
     VkSampleCountFlagBits mask;
     int count;
@@ -3027,6 +3505,13 @@ bool QRhiVulkan::isTextureFormatSupported(QRhiTexture::Format format, QRhiTextur
     return (props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
 }
 
+bool QRhiVulkan::isVertexFormatSupported(QRhiVertexInputAttribute::Format format) const
+{
+    VkFormatProperties props;
+    f->vkGetPhysicalDeviceFormatProperties(physDev, toVkAttributeFormat(format), &props);
+    return (props.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT);
+}
+
 bool QRhiVulkan::isFeatureSupported(QRhi::Feature feature) const
 {
     switch (feature) {
@@ -3056,6 +3541,18 @@ bool QRhiVulkan::isFeatureSupported(QRhi::Feature feature) const
         return true;
     case QRhi::RedOrAlpha8IsRed:
         return true;
+    case QRhi::Compute:
+        return true;
+    case QRhi::DrawIndirect:
+        return true;
+    case QRhi::DrawIndirectMulti:
+        return multiDrawIndirectAvailable;
+    case QRhi::PushConstants:
+        return true;
+    case QRhi::ThreeDimensionalTextures:
+        return true;
+    case QRhi::TextureArrays:
+        return true;
     default:
         Q_UNREACHABLE();
         return false;
@@ -3069,6 +3566,10 @@ int QRhiVulkan::resourceSizeLimit(QRhi::ResourceSizeLimit limit) const
         return 1;
     case QRhi::TextureSizeMax:
         return physDevProperties.limits.maxImageDimension2D;
+    case QRhi::PushConstantsSizeMax:
+        return physDevProperties.limits.maxPushConstantsSize;
+    case QRhi::TextureArraySizeMax:
+        return physDevProperties.limits.maxImageArrayLayers;
     default:
         Q_UNREACHABLE();
         return 0;
@@ -3122,6 +3623,11 @@ QRhiGraphicsPipeline *QRhiVulkan::createGraphicsPipeline()
     return new QVkGraphicsPipeline(this);
 }
 
+QRhiComputePipeline *QRhiVulkan::createComputePipeline()
+{
+    return new QVkComputePipeline(this);
+}
+
 QRhiShaderResourceBindings *QRhiVulkan::createShaderResourceBindings()
 {
     return new QVkShaderResourceBindings(this);
@@ -3143,17 +3649,42 @@ void QRhiVulkan::setGraphicsPipeline(QRhiCommandBuffer *cb, QRhiGraphicsPipeline
     psD->lastActiveFrameSlot = currentFrameSlot;
 }
 
+void QRhiVulkan::setComputePipeline(QRhiCommandBuffer *cb, QRhiComputePipeline *ps)
+{
+    Q_ASSERT(inComputePass);
+    QVkComputePipeline *psD = QRHI_RES(QVkComputePipeline, ps);
+    Q_ASSERT(psD->pipeline);
+    QVkCommandBuffer *cbD = QRHI_RES(QVkCommandBuffer, cb);
+
+    if (cbD->currentComputePipeline != ps || cbD->currentComputePipelineGeneration != psD->generation) {
+        df->vkCmdBindPipeline(cbD->cb, VK_PIPELINE_BIND_POINT_COMPUTE, psD->pipeline);
+        cbD->currentComputePipeline = ps;
+        cbD->currentComputePipelineGeneration = psD->generation;
+    }
+
+    psD->lastActiveFrameSlot = currentFrameSlot;
+}
+
 void QRhiVulkan::setShaderResources(QRhiCommandBuffer *cb, QRhiShaderResourceBindings *srb,
                                     const QVector<QRhiCommandBuffer::DynamicOffset> &dynamicOffsets)
 {
-    Q_ASSERT(inPass);
+    Q_ASSERT(inPass || inComputePass);
 
     QVkCommandBuffer *cbD = QRHI_RES(QVkCommandBuffer, cb);
-    Q_ASSERT(cbD->currentPipeline);
-    QVkGraphicsPipeline *psD = QRHI_RES(QVkGraphicsPipeline, cbD->currentPipeline);
-
-    if (!srb)
-        srb = psD->m_shaderResourceBindings;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    if (inComputePass) {
+        Q_ASSERT(cbD->currentComputePipeline);
+        QVkComputePipeline *psD = QRHI_RES(QVkComputePipeline, cbD->currentComputePipeline);
+        if (!srb)
+            srb = psD->m_shaderResourceBindings;
+        pipelineLayout = psD->layout;
+    } else {
+        Q_ASSERT(cbD->currentPipeline);
+        QVkGraphicsPipeline *psD = QRHI_RES(QVkGraphicsPipeline, cbD->currentPipeline);
+        if (!srb)
+            srb = psD->m_shaderResourceBindings;
+        pipelineLayout = psD->layout;
+    }
 
     QVkShaderResourceBindings *srbD = QRHI_RES(QVkShaderResourceBindings, srb);
     bool hasSlottedResourceInSrb = false;
@@ -3168,6 +3699,14 @@ void QRhiVulkan::setShaderResources(QRhiCommandBuffer *cb, QRhiShaderResourceBin
             if (b->u.ubuf.hasDynamicOffset)
                 hasDynamicOffsetInSrb = true;
             break;
+        case QRhiShaderResourceBinding::BufferLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferLoadStore:
+            if (QRHI_RES(QVkBuffer, b->u.sbuf.buf)->m_type == QRhiBuffer::Dynamic)
+                hasSlottedResourceInSrb = true;
+            break;
         default:
             break;
         }
@@ -3222,6 +3761,56 @@ void QRhiVulkan::setShaderResources(QRhiCommandBuffer *cb, QRhiShaderResourceBin
             }
         }
             break;
+        case QRhiShaderResourceBinding::ImageLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::ImageLoadStore:
+        {
+            QVkTexture *texD = QRHI_RES(QVkTexture, b->u.simage.tex);
+            Q_ASSERT(texD->m_flags.testFlag(QRhiTexture::UsedWithLoadStore));
+            texD->lastActiveFrameSlot = currentFrameSlot;
+
+            // Storage images must be in GENERAL layout. No layout
+            // transitions are possible inside a render pass, so image
+            // load/store is effectively limited to compute passes.
+            if (inComputePass && texD->layout != VK_IMAGE_LAYOUT_GENERAL) {
+                imageBarrier(cb, texD, VK_IMAGE_LAYOUT_GENERAL,
+                             VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                             VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+                if (!computePassGeneralImages.contains(texD))
+                    computePassGeneralImages.append(texD);
+            }
+
+            if (texD->generation != bd.simage.generation || texD->m_id != bd.simage.id) {
+                rewriteDescSet = true;
+                bd.simage.id = texD->m_id;
+                bd.simage.generation = texD->generation;
+            }
+        }
+            break;
+        case QRhiShaderResourceBinding::BufferLoad:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferStore:
+            Q_FALLTHROUGH();
+        case QRhiShaderResourceBinding::BufferLoadStore:
+        {
+            QVkBuffer *bufD = QRHI_RES(QVkBuffer, b->u.sbuf.buf);
+            Q_ASSERT(bufD->m_usage.testFlag(QRhiBuffer::StorageBuffer));
+            bufD->lastActiveFrameSlot = currentFrameSlot;
+
+            if (bufD->m_type == QRhiBuffer::Dynamic)
+                executeBufferHostWritesForCurrentFrame(bufD);
+
+            if (bufD->generation != bd.sbuf.generation || bufD->m_id != bd.sbuf.id) {
+                rewriteDescSet = true;
+                bd.sbuf.id = bufD->m_id;
+                bd.sbuf.generation = bufD->generation;
+            }
+        }
+            break;
         default:
             Q_UNREACHABLE();
             break;
@@ -3229,8 +3818,11 @@ void QRhiVulkan::setShaderResources(QRhiCommandBuffer *cb, QRhiShaderResourceBin
     }
 
     // write descriptor sets, if needed
-    if (rewriteDescSet)
+    if (rewriteDescSet) {
         updateShaderResourceBindings(srb, descSetIdx);
+        QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
+        QRHI_PROF_F(frameStats.descriptorSetUpdates++);
+    }
 
     // make sure the descriptors for the correct slot will get bound.
     // also, dynamic offsets always need a bind.
@@ -3258,7 +3850,9 @@ void QRhiVulkan::setShaderResources(QRhiCommandBuffer *cb, QRhiShaderResourceBin
             }
         }
 
-        df->vkCmdBindDescriptorSets(cbD->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, psD->layout, 0, 1,
+        df->vkCmdBindDescriptorSets(cbD->cb,
+                                    inComputePass ? VK_PIPELINE_BIND_POINT_COMPUTE : VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                    pipelineLayout, 0, 1,
                                     &srbD->descSets[descSetIdx],
                                     dynOfs.count(), dynOfs.isEmpty() ? nullptr : dynOfs.constData());
 
@@ -3395,6 +3989,38 @@ void QRhiVulkan::setStencilRef(QRhiCommandBuffer *cb, quint32 refValue)
     df->vkCmdSetStencilReference(QRHI_RES(QVkCommandBuffer, cb)->cb, VK_STENCIL_FRONT_AND_BACK, refValue);
 }
 
+void QRhiVulkan::setPushConstants(QRhiCommandBuffer *cb, QRhiShaderResourceBinding::StageFlags stages,
+                                  quint32 offset, quint32 size, const void *data)
+{
+    Q_ASSERT(inPass || inComputePass);
+    QVkCommandBuffer *cbD = QRHI_RES(QVkCommandBuffer, cb);
+
+    VkPipelineLayout layout;
+    VkPushConstantRange range;
+    if (inComputePass) {
+        QVkComputePipeline *psD = QRHI_RES(QVkComputePipeline, cbD->currentComputePipeline);
+        Q_ASSERT(psD);
+        layout = psD->layout;
+        range = psD->pushConstantRange;
+    } else {
+        QVkGraphicsPipeline *psD = QRHI_RES(QVkGraphicsPipeline, cbD->currentPipeline);
+        Q_ASSERT(psD);
+        layout = psD->layout;
+        range = psD->pushConstantRange;
+    }
+
+    if (offset + size > range.size) {
+        qWarning("Push constant update (offset %u, size %u) exceeds the %u bytes declared by the pipeline",
+                 offset, size, range.size);
+        return;
+    }
+
+    // The layout has a single range covering all stages that use push
+    // constants, and the spec requires stageFlags to include all of those.
+    Q_UNUSED(stages);
+    df->vkCmdPushConstants(cbD->cb, layout, range.stageFlags, offset, size, data);
+}
+
 void QRhiVulkan::draw(QRhiCommandBuffer *cb, quint32 vertexCount,
                 quint32 instanceCount, quint32 firstVertex, quint32 firstInstance)
 {
@@ -3409,8 +4035,132 @@ void QRhiVulkan::drawIndexed(QRhiCommandBuffer *cb, quint32 indexCount,
     df->vkCmdDrawIndexed(QRHI_RES(QVkCommandBuffer, cb)->cb, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
 }
 
+void QRhiVulkan::drawIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                              quint32 indirectBufferOffset, quint32 drawCount, quint32 stride)
+{
+    Q_ASSERT(inPass);
+    QVkCommandBuffer *cbD = QRHI_RES(QVkCommandBuffer, cb);
+    QVkBuffer *bufD = QRHI_RES(QVkBuffer, indirectBuffer);
+    Q_ASSERT(bufD->m_usage.testFlag(QRhiBuffer::IndirectBuffer));
+    bufD->lastActiveFrameSlot = currentFrameSlot;
+    if (bufD->m_type == QRhiBuffer::Dynamic)
+        executeBufferHostWritesForCurrentFrame(bufD);
+
+    const VkBuffer vkbuf = bufD->buffers[bufD->m_type == QRhiBuffer::Dynamic ? currentFrameSlot : 0];
+    if (multiDrawIndirectAvailable) {
+        df->vkCmdDrawIndirect(cbD->cb, vkbuf, indirectBufferOffset, drawCount, stride);
+    } else {
+        for (quint32 i = 0; i < drawCount; ++i)
+            df->vkCmdDrawIndirect(cbD->cb, vkbuf, indirectBufferOffset + i * stride, 1, stride);
+    }
+}
+
+void QRhiVulkan::drawIndexedIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                                     quint32 indirectBufferOffset, quint32 drawCount, quint32 stride)
+{
+    Q_ASSERT(inPass);
+    QVkCommandBuffer *cbD = QRHI_RES(QVkCommandBuffer, cb);
+    QVkBuffer *bufD = QRHI_RES(QVkBuffer, indirectBuffer);
+    Q_ASSERT(bufD->m_usage.testFlag(QRhiBuffer::IndirectBuffer));
+    bufD->lastActiveFrameSlot = currentFrameSlot;
+    if (bufD->m_type == QRhiBuffer::Dynamic)
+        executeBufferHostWritesForCurrentFrame(bufD);
+
+    const VkBuffer vkbuf = bufD->buffers[bufD->m_type == QRhiBuffer::Dynamic ? currentFrameSlot : 0];
+    if (multiDrawIndirectAvailable) {
+        df->vkCmdDrawIndexedIndirect(cbD->cb, vkbuf, indirectBufferOffset, drawCount, stride);
+    } else {
+        for (quint32 i = 0; i < drawCount; ++i)
+            df->vkCmdDrawIndexedIndirect(cbD->cb, vkbuf, indirectBufferOffset + i * stride, 1, stride);
+    }
+}
+
+void QRhiVulkan::dispatch(QRhiCommandBuffer *cb, int x, int y, int z)
+{
+    Q_ASSERT(inComputePass);
+    QVkCommandBuffer *cbD = QRHI_RES(QVkCommandBuffer, cb);
+
+    // Dispatches in a pass are assumed to depend on each other's results.
+    if (cbD->dispatchCount > 0) {
+        memoryBarrier(cb,
+                      VK_ACCESS_SHADER_WRITE_BIT,
+                      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    df->vkCmdDispatch(cbD->cb, uint32_t(x), uint32_t(y), uint32_t(z));
+    cbD->dispatchCount += 1;
+}
+
+void QRhiVulkan::resolveMarkerTimestamps(QVkSwapChain *swapChainD, QVkSwapChain::FrameResources *frame)
+{
+    QRhiProfilerPrivate *rhiP = profilerPrivateOrNull();
+    const quint64 serial = frame->markerFrameSerial;
+    frame->markerFrameSerial = 0;
+    if (!rhiP || !frame->markerQueryCount)
+        return;
+
+    QVarLengthArray<quint64, 64> timestamps(frame->markerQueryCount);
+    VkResult err = df->vkGetQueryPoolResults(dev, frame->markerQueryPool, 0, uint32_t(frame->markerQueryCount),
+                                             size_t(timestamps.count()) * sizeof(quint64), timestamps.data(),
+                                             sizeof(quint64), VK_QUERY_RESULT_64_BIT);
+    if (err != VK_SUCCESS) {
+        qWarning("Failed to query marker timestamps: %d", err);
+        return;
+    }
+
+    quint64 mask = 0;
+    for (quint64 i = 0; i < timestampValidBits; i += 8)
+        mask |= 0xFFULL << i;
+    const float nsecsPerTick = physDevProperties.limits.timestampPeriod;
+    const quint64 first = timestamps[0] & mask;
+
+    QVector<QRhiProfilerPrivate::MarkerGpuTime> times(frame->markerScopeCount);
+    for (const QVkSwapChain::FrameResources::MarkerScope &s : qAsConst(frame->markerScopes)) {
+        if (s.beginQuery < 0 || s.endQuery < 0)
+            continue;
+        const quint64 ts0 = timestamps[s.beginQuery] & mask;
+        const quint64 ts1 = timestamps[s.endQuery] & mask;
+        times[s.scope].start = float(ts0 - first) * nsecsPerTick / 1000000.0f;
+        times[s.scope].duration = float(ts1 - ts0) * nsecsPerTick / 1000000.0f;
+    }
+
+    QRHI_PROF_F(resolveMarkerGpuTimes(swapChainD, serial, times));
+}
+
+void QRhiVulkan::writeMarkerTimestamp(QVkCommandBuffer *cbD, bool begin)
+{
+    // Only the swapchain frames are timed. Scopes are numbered in
+    // debugMarkBegin order, like in the profiler, also when running out of
+    // queries; those just do not get a GPU time.
+    if (!currentSwapChain || cbD != &currentSwapChain->cbWrapper)
+        return;
+
+    QVkSwapChain::FrameResources &frame(currentSwapChain->frameRes[currentSwapChain->currentFrameSlot]);
+    if (!frame.markerTimingActive)
+        return;
+
+    int query = -1;
+    if (frame.markerQueryCount < QVK_MAX_MARKER_TIMESTAMPS) {
+        query = frame.markerQueryCount++;
+        df->vkCmdWriteTimestamp(cbD->cb, begin ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                frame.markerQueryPool, uint32_t(query));
+    }
+
+    if (begin) {
+        frame.markerStack.append({ frame.markerScopeCount++, query, -1 });
+    } else if (!frame.markerStack.isEmpty()) {
+        QVkSwapChain::FrameResources::MarkerScope s = frame.markerStack.takeLast();
+        s.endQuery = query;
+        frame.markerScopes.append(s);
+    }
+}
+
 void QRhiVulkan::debugMarkBegin(QRhiCommandBuffer *cb, const QByteArray &name)
 {
+    writeMarkerTimestamp(QRHI_RES(QVkCommandBuffer, cb), true);
+
     if (!debugMarkers || !debugMarkersAvailable)
         return;
 
@@ -3423,6 +4173,8 @@ void QRhiVulkan::debugMarkBegin(QRhiCommandBuffer *cb, const QByteArray &name)
 
 void QRhiVulkan::debugMarkEnd(QRhiCommandBuffer *cb)
 {
+    writeMarkerTimestamp(QRHI_RES(QVkCommandBuffer, cb), false);
+
     if (!debugMarkers || !debugMarkersAvailable)
         return;
 
@@ -3469,6 +4221,10 @@ static inline VkBufferUsageFlagBits toVkBufferUsage(QRhiBuffer::UsageFlags usage
         u |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
     if (usage.testFlag(QRhiBuffer::UniformBuffer))
         u |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    if (usage.testFlag(QRhiBuffer::StorageBuffer))
+        u |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    if (usage.testFlag(QRhiBuffer::IndirectBuffer))
+        u |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
     return VkBufferUsageFlagBits(u);
 }
 
@@ -3519,6 +4275,18 @@ static inline VkSamplerAddressMode toVkAddressMode(QRhiSampler::AddressMode m)
     }
 }
 
+// Merges the push constant blocks of all stages into one range, which keeps
+// vkCmdPushConstants valid for any sub-range as long as the union of the
+// stages is passed in.
+static inline void addToPushConstantRange(VkPushConstantRange *range, const QShaderDescription &desc,
+                                          VkShaderStageFlags stage)
+{
+    for (const QShaderDescription::PushConstantBlock &block : desc.pushConstantBlocks()) {
+        range->stageFlags |= stage;
+        range->size = qMax(range->size, uint32_t(block.size));
+    }
+}
+
 static inline VkShaderStageFlagBits toVkShaderStage(QRhiGraphicsShaderStage::Type type)
 {
     switch (type) {
@@ -3538,29 +4306,6 @@ static inline VkShaderStageFlagBits toVkShaderStage(QRhiGraphicsShaderStage::Typ
     }
 }
 
-static inline VkFormat toVkAttributeFormat(QRhiVertexInputAttribute::Format format)
-{
-    switch (format) {
-    case QRhiVertexInputAttribute::Float4:
-        return VK_FORMAT_R32G32B32A32_SFLOAT;
-    case QRhiVertexInputAttribute::Float3:
-        return VK_FORMAT_R32G32B32_SFLOAT;
-    case QRhiVertexInputAttribute::Float2:
-        return VK_FORMAT_R32G32_SFLOAT;
-    case QRhiVertexInputAttribute::Float:
-        return VK_FORMAT_R32_SFLOAT;
-    case QRhiVertexInputAttribute::UNormByte4:
-        return VK_FORMAT_R8G8B8A8_UNORM;
-    case QRhiVertexInputAttribute::UNormByte2:
-        return VK_FORMAT_R8G8_UNORM;
-    case QRhiVertexInputAttribute::UNormByte:
-        return VK_FORMAT_R8_UNORM;
-    default:
-        Q_UNREACHABLE();
-        return VK_FORMAT_R32G32B32A32_SFLOAT;
-    }
-}
-
 static inline VkPrimitiveTopology toVkTopology(QRhiGraphicsPipeline::Topology t)
 {
     switch (t) {
@@ -3754,6 +4499,18 @@ static inline VkDescriptorType toVkDescriptorType(const QRhiShaderResourceBindin
                                           : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     case QRhiShaderResourceBinding::SampledTexture:
         return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    case QRhiShaderResourceBinding::ImageLoad:
+        Q_FALLTHROUGH();
+    case QRhiShaderResourceBinding::ImageStore:
+        Q_FALLTHROUGH();
+    case QRhiShaderResourceBinding::ImageLoadStore:
+        return VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    case QRhiShaderResourceBinding::BufferLoad:
+        Q_FALLTHROUGH();
+    case QRhiShaderResourceBinding::BufferStore:
+        Q_FALLTHROUGH();
+    case QRhiShaderResourceBinding::BufferLoadStore:
+        return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     default:
         Q_UNREACHABLE();
         return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
@@ -3773,6 +4530,8 @@ static inline VkShaderStageFlags toVkShaderStageFlags(QRhiShaderResourceBinding:
         s |= VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
     if (stage.testFlag(QRhiShaderResourceBinding::TessellationEvaluationStage))
         s |= VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+    if (stage.testFlag(QRhiShaderResourceBinding::ComputeStage))
+        s |= VK_SHADER_STAGE_COMPUTE_BIT;
     return VkShaderStageFlags(s);
 }
 
@@ -3831,6 +4590,9 @@ void QVkBuffer::release()
 
         QRHI_PROF;
         QRHI_PROF_F(releaseBuffer(this));
+        rhiD->removeBufferMemory(this);
+        for (int i = 0; i < QVK_FRAMES_IN_FLIGHT; ++i)
+            rhiD->removeStagingMemory(this, i);
 
         rhiD->unregisterResource(this);
     } else {
@@ -3862,7 +4624,8 @@ bool QVkBuffer::build()
         allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
     } else {
         allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-        bufferInfo.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        // transfer source for readBackBuffer()
+        bufferInfo.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
     }
 
     QRHI_RES_RHI(QRhiVulkan);
@@ -3892,6 +4655,7 @@ bool QVkBuffer::build()
 
     QRHI_PROF;
     QRHI_PROF_F(newBuffer(this, nonZeroSize, m_type != Dynamic ? 1 : QVK_FRAMES_IN_FLIGHT, 0));
+    rhiD->addBufferMemory(this, nonZeroSize, m_type != Dynamic ? 1 : QVK_FRAMES_IN_FLIGHT);
 
     lastActiveFrameSlot = -1;
     generation += 1;
@@ -3943,6 +4707,7 @@ void QVkRenderBuffer::release()
 
         QRHI_PROF;
         QRHI_PROF_F(releaseRenderBuffer(this));
+        rhiD->removeRenderBufferMemory(this);
 
         rhiD->unregisterResource(this);
     } else {
@@ -3972,16 +4737,19 @@ bool QVkRenderBuffer::build()
             backingTexture = QRHI_RES(QVkTexture, rhiD->createTexture(QRhiTexture::RGBA8,
                                                                       m_pixelSize,
                                                                       m_sampleCount,
-                                                                      QRhiTexture::RenderTarget | QRhiTexture::UsedAsTransferSource));
+                                                                      QRhiTexture::RenderTarget));
         } else {
             backingTexture->setPixelSize(m_pixelSize);
             backingTexture->setSampleCount(m_sampleCount);
         }
+        backingTexture->setFlags(QRhiTexture::RenderTarget
+                                 | (m_flags.testFlag(Transient) ? QRhiTexture::Transient
+                                                                : QRhiTexture::UsedAsTransferSource));
         backingTexture->setName(m_objectName);
         if (!backingTexture->build())
             return false;
         vkformat = backingTexture->vkformat;
-        QRHI_PROF_F(newRenderBuffer(this, false, false, samples));
+        QRHI_PROF_F(newRenderBuffer(this, backingTexture->lazilyAllocated, false, samples));
     }
         break;
     case QRhiRenderBuffer::DepthStencil:
@@ -4000,6 +4768,8 @@ bool QVkRenderBuffer::build()
         }
         rhiD->setObjectName(reinterpret_cast<uint64_t>(image), VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_EXT, m_objectName);
         QRHI_PROF_F(newRenderBuffer(this, true, false, samples));
+        // Color is not recorded here since the backing texture is already accounted for
+        rhiD->addRenderBufferMemory(this, samples);
         break;
     default:
         Q_UNREACHABLE();
@@ -4024,6 +4794,8 @@ QVkTexture::QVkTexture(QRhiImplementation *rhi, Format format, const QSize &pixe
         stagingBuffers[i] = VK_NULL_HANDLE;
         stagingAllocations[i] = nullptr;
     }
+    for (int i = 0; i < QVK_MAX_MIP_LEVELS; ++i)
+        perLevelImageViews[i] = VK_NULL_HANDLE;
 }
 
 bool QVkTexture::isShareable() const
@@ -4045,6 +4817,11 @@ void QVkTexture::release()
     e.texture.imageView = imageView;
     e.texture.allocation = owns ? imageAlloc : nullptr;
 
+    for (int i = 0; i < QVK_MAX_MIP_LEVELS; ++i) {
+        e.texture.perLevelImageViews[i] = perLevelImageViews[i];
+        perLevelImageViews[i] = VK_NULL_HANDLE;
+    }
+
     for (int i = 0; i < QVK_FRAMES_IN_FLIGHT; ++i) {
         e.texture.stagingBuffers[i] = stagingBuffers[i];
         e.texture.stagingAllocations[i] = stagingAllocations[i];
@@ -4065,6 +4842,9 @@ void QVkTexture::release()
 
         QRHI_PROF;
         QRHI_PROF_F(releaseTexture(this));
+        rhiD->removeTextureMemory(this);
+        for (int i = 0; i < QVK_FRAMES_IN_FLIGHT; ++i)
+            rhiD->removeStagingMemory(this, i);
 
         rhiD->unregisterResource(this);
     } else {
@@ -4093,13 +4873,39 @@ bool QVkTexture::prepareBuild(QSize *adjustedSize)
 
     const QSize size = m_pixelSize.isEmpty() ? QSize(1, 1) : m_pixelSize;
     const bool isCube = m_flags.testFlag(CubeMap);
+    const bool is3D = m_flags.testFlag(ThreeDimensional);
+    const bool isArray = m_flags.testFlag(TextureArray);
     const bool hasMipMaps = m_flags.testFlag(MipMapped);
 
+    if (int(isCube) + int(is3D) + int(isArray) > 1) {
+        qWarning("Texture cannot be more than one of cubemap, 3D, and array");
+        return false;
+    }
+    if (is3D && hasMipMaps) {
+        qWarning("3D texture cannot have mipmaps");
+        return false;
+    }
+    if (m_flags.testFlag(Transient)) {
+        if (!m_flags.testFlag(RenderTarget)) {
+            qWarning("Transient texture must be a render target");
+            return false;
+        }
+        if (isCube || is3D || isArray || hasMipMaps) {
+            qWarning("Transient texture cannot be a cubemap, 3D, array, or mipmapped texture");
+            return false;
+        }
+    }
+    if (isArray && uint(layerCount()) > rhiD->physDevProperties.limits.maxImageArrayLayers) {
+        qWarning("Texture array size %d exceeds the limit of %u",
+                 layerCount(), rhiD->physDevProperties.limits.maxImageArrayLayers);
+        return false;
+    }
+
     mipLevelCount = hasMipMaps ? rhiD->q->mipLevelsForSize(size) : 1;
     samples = rhiD->effectiveSampleCount(m_sampleCount);
     if (samples > VK_SAMPLE_COUNT_1_BIT) {
-        if (isCube) {
-            qWarning("Cubemap texture cannot be multisample");
+        if (isCube || is3D || isArray) {
+            qWarning("Cubemap, 3D, and array textures cannot be multisample");
             return false;
         }
         if (hasMipMaps) {
@@ -4119,13 +4925,12 @@ bool QVkTexture::finishBuild()
     QRHI_RES_RHI(QRhiVulkan);
 
     const bool isDepth = isDepthTextureFormat(m_format);
-    const bool isCube = m_flags.testFlag(CubeMap);
 
     VkImageViewCreateInfo viewInfo;
     memset(&viewInfo, 0, sizeof(viewInfo));
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     viewInfo.image = image;
-    viewInfo.viewType = isCube ? VK_IMAGE_VIEW_TYPE_CUBE : VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.viewType = viewType();
     viewInfo.format = vkformat;
     viewInfo.components.r = VK_COMPONENT_SWIZZLE_R;
     viewInfo.components.g = VK_COMPONENT_SWIZZLE_G;
@@ -4133,7 +4938,7 @@ bool QVkTexture::finishBuild()
     viewInfo.components.a = VK_COMPONENT_SWIZZLE_A;
     viewInfo.subresourceRange.aspectMask = isDepth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
     viewInfo.subresourceRange.levelCount = mipLevelCount;
-    viewInfo.subresourceRange.layerCount = isCube ? 6 : 1;
+    viewInfo.subresourceRange.layerCount = arrayLayerCount();
 
     VkResult err = rhiD->df->vkCreateImageView(rhiD->dev, &viewInfo, nullptr, &imageView);
     if (err != VK_SUCCESS) {
@@ -4149,6 +4954,39 @@ bool QVkTexture::finishBuild()
     return true;
 }
 
+VkImageView QVkTexture::imageViewForLevel(int level)
+{
+    Q_ASSERT(level >= 0 && level < int(mipLevelCount));
+    if (perLevelImageViews[level] != VK_NULL_HANDLE)
+        return perLevelImageViews[level];
+
+    VkImageViewCreateInfo viewInfo;
+    memset(&viewInfo, 0, sizeof(viewInfo));
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = viewType();
+    viewInfo.format = vkformat;
+    viewInfo.components.r = VK_COMPONENT_SWIZZLE_R;
+    viewInfo.components.g = VK_COMPONENT_SWIZZLE_G;
+    viewInfo.components.b = VK_COMPONENT_SWIZZLE_B;
+    viewInfo.components.a = VK_COMPONENT_SWIZZLE_A;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = level;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.layerCount = arrayLayerCount();
+
+    VkImageView v = VK_NULL_HANDLE;
+    QRHI_RES_RHI(QRhiVulkan);
+    VkResult err = rhiD->df->vkCreateImageView(rhiD->dev, &viewInfo, nullptr, &v);
+    if (err != VK_SUCCESS) {
+        qWarning("Failed to create image view: %d", err);
+        return VK_NULL_HANDLE;
+    }
+
+    perLevelImageViews[level] = v;
+    return v;
+}
+
 bool QVkTexture::build()
 {
     QSize size;
@@ -4158,57 +4996,85 @@ bool QVkTexture::build()
     const bool isRenderTarget = m_flags.testFlag(QRhiTexture::RenderTarget);
     const bool isDepth = isDepthTextureFormat(m_format);
     const bool isCube = m_flags.testFlag(CubeMap);
+    const bool is3D = m_flags.testFlag(ThreeDimensional);
+    const bool isTransient = m_flags.testFlag(Transient);
 
+    QRHI_RES_RHI(QRhiVulkan);
     VkImageCreateInfo imageInfo;
     memset(&imageInfo, 0, sizeof(imageInfo));
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.flags = isCube ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    if (isCube)
+        imageInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+    // allows 2D views on the slices, needed for rendering into a slice
+    if (is3D && isRenderTarget && rhiD->maintenance1Available)
+        imageInfo.flags = VK_IMAGE_CREATE_2D_ARRAY_COMPATIBLE_BIT_KHR;
+    imageInfo.imageType = is3D ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D;
     imageInfo.format = vkformat;
     imageInfo.extent.width = size.width();
     imageInfo.extent.height = size.height();
-    imageInfo.extent.depth = 1;
+    imageInfo.extent.depth = is3D ? qMax(1, m_depth) : 1;
     imageInfo.mipLevels = mipLevelCount;
-    imageInfo.arrayLayers = isCube ? 6 : 1;
+    imageInfo.arrayLayers = arrayLayerCount();
     imageInfo.samples = samples;
     imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
 
-    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-    if (isRenderTarget) {
-        if (isDepth)
-            imageInfo.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-        else
-            imageInfo.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-    }
-    if (m_flags.testFlag(QRhiTexture::UsedAsTransferSource))
-        imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-    if (m_flags.testFlag(QRhiTexture::UsedWithGenerateMips))
-        imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-
     VmaAllocationCreateInfo allocInfo;
     memset(&allocInfo, 0, sizeof(allocInfo));
     allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
 
-    QRHI_RES_RHI(QRhiVulkan);
+    if (isTransient) {
+        // contents never leave the renderpass so only the attachment usage
+        // is needed, which in turn allows lazily allocated memory
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT
+                | (isDepth ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+        // the transient memory type is not worth suballocating from
+        allocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+        allocInfo.preferredFlags = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    } else {
+        imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        if (m_flags.testFlag(QRhiTexture::UsedWithLoadStore))
+            imageInfo.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+        if (isRenderTarget) {
+            if (isDepth)
+                imageInfo.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+            else
+                imageInfo.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        }
+        if (m_flags.testFlag(QRhiTexture::UsedAsTransferSource))
+            imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        if (m_flags.testFlag(QRhiTexture::UsedWithGenerateMips))
+            imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+
     VmaAllocation allocation;
-    VkResult err = vmaCreateImage(toVmaAllocator(rhiD->allocator), &imageInfo, &allocInfo, &image, &allocation, nullptr);
+    VmaAllocationInfo allocationInfo;
+    VkResult err = vmaCreateImage(toVmaAllocator(rhiD->allocator), &imageInfo, &allocInfo, &image, &allocation, &allocationInfo);
     if (err != VK_SUCCESS) {
         qWarning("Failed to create image: %d", err);
         return false;
     }
     imageAlloc = allocation;
 
+    lazilyAllocated = false;
+    if (isTransient) {
+        VkMemoryPropertyFlags memFlags = 0;
+        vmaGetMemoryTypeProperties(toVmaAllocator(rhiD->allocator), allocationInfo.memoryType, &memFlags);
+        lazilyAllocated = (memFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+    }
+
     if (!finishBuild())
         return false;
 
     rhiD->setObjectName(reinterpret_cast<uint64_t>(image), VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_EXT, m_objectName);
 
     QRHI_PROF;
-    QRHI_PROF_F(newTexture(this, true, mipLevelCount, isCube ? 6 : 1, samples));
+    QRHI_PROF_F(newTexture(this, true, lazilyAllocated, mipLevelCount, layerCount(), samples));
+    rhiD->addTextureMemory(this, mipLevelCount, layerCount(), samples);
 
     owns = true;
-    layout = VK_IMAGE_LAYOUT_PREINITIALIZED;
+    layout = imageInfo.initialLayout;
     rhiD->registerResource(this);
     return true;
 }
@@ -4228,7 +5094,7 @@ bool QVkTexture::buildFrom(const QRhiNativeHandles *src)
         return false;
 
     QRHI_PROF;
-    QRHI_PROF_F(newTexture(this, false, mipLevelCount, m_flags.testFlag(CubeMap) ? 6 : 1, samples));
+    QRHI_PROF_F(newTexture(this, false, false, mipLevelCount, layerCount(), samples));
 
     owns = false;
     layout = h->layout;
@@ -4237,6 +5103,23 @@ bool QVkTexture::buildFrom(const QRhiNativeHandles *src)
     return true;
 }
 
+VkImageViewType QVkTexture::viewType() const
+{
+    if (m_flags.testFlag(CubeMap))
+        return VK_IMAGE_VIEW_TYPE_CUBE;
+    if (m_flags.testFlag(ThreeDimensional))
+        return VK_IMAGE_VIEW_TYPE_3D;
+    if (m_flags.testFlag(TextureArray))
+        return VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    return VK_IMAGE_VIEW_TYPE_2D;
+}
+
+uint QVkTexture::arrayLayerCount() const
+{
+    // the slices of a 3D image are not array layers
+    return m_flags.testFlag(ThreeDimensional) ? 1 : uint(layerCount());
+}
+
 const QRhiNativeHandles *QVkTexture::nativeHandles()
 {
     nativeHandlesStruct.layout = layout;
@@ -4404,13 +5287,7 @@ QRhiRenderPassDescriptor *QVkTextureRenderTarget::newCompatibleRenderPassDescrip
 
     QRHI_RES_RHI(QRhiVulkan);
     QVkRenderPassDescriptor *rp = new QVkRenderPassDescriptor(m_rhi);
-    if (!rhiD->createOffscreenRenderPass(&rp->rp,
-                                         m_desc.colorAttachments(),
-                                         m_flags.testFlag(QRhiTextureRenderTarget::PreserveColorContents),
-                                         m_flags.testFlag(QRhiTextureRenderTarget::PreserveDepthStencilContents),
-                                         m_desc.depthStencilBuffer(),
-                                         m_desc.depthTexture()))
-    {
+    if (!rhiD->createOffscreenRenderPass(&rp->rp, this)) {
         delete rp;
         return nullptr;
     }
@@ -4440,6 +5317,10 @@ bool QVkTextureRenderTarget::build()
         Q_ASSERT(texD || rbD);
         if (texD) {
             Q_ASSERT(texD->flags().testFlag(QRhiTexture::RenderTarget));
+            if (texD->flags().testFlag(QRhiTexture::ThreeDimensional) && !rhiD->maintenance1Available) {
+                qWarning("Rendering into a 3D texture slice needs VK_KHR_maintenance1");
+                return false;
+            }
             VkImageViewCreateInfo viewInfo;
             memset(&viewInfo, 0, sizeof(viewInfo));
             viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -4649,6 +5530,7 @@ bool QVkShaderResourceBindings::build()
 QVkGraphicsPipeline::QVkGraphicsPipeline(QRhiImplementation *rhi)
     : QRhiGraphicsPipeline(rhi)
 {
+    memset(&pushConstantRange, 0, sizeof(pushConstantRange));
 }
 
 void QVkGraphicsPipeline::release()
@@ -4681,6 +5563,25 @@ bool QVkGraphicsPipeline::build()
     if (!rhiD->ensurePipelineCache())
         return false;
 
+    memset(&pushConstantRange, 0, sizeof(pushConstantRange));
+    for (const QRhiGraphicsShaderStage &shaderStage : m_shaderStages)
+        addToPushConstantRange(&pushConstantRange, shaderStage.shader().description(), toVkShaderStage(shaderStage.type()));
+
+    if (pushConstantRange.size > rhiD->physDevProperties.limits.maxPushConstantsSize) {
+        qWarning("Push constant blocks of %u bytes exceed the limit of %u bytes",
+                 pushConstantRange.size, rhiD->physDevProperties.limits.maxPushConstantsSize);
+        return false;
+    }
+
+    memset(&pushConstantRange, 0, sizeof(pushConstantRange));
+    addToPushConstantRange(&pushConstantRange, m_shader.description(), VK_SHADER_STAGE_COMPUTE_BIT);
+
+    if (pushConstantRange.size > rhiD->physDevProperties.limits.maxPushConstantsSize) {
+        qWarning("Push constant blocks of %u bytes exceed the limit of %u bytes",
+                 pushConstantRange.size, rhiD->physDevProperties.limits.maxPushConstantsSize);
+        return false;
+    }
+
     VkPipelineLayoutCreateInfo pipelineLayoutInfo;
     memset(&pipelineLayoutInfo, 0, sizeof(pipelineLayoutInfo));
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -4688,6 +5589,14 @@ bool QVkGraphicsPipeline::build()
     QVkShaderResourceBindings *srbD = QRHI_RES(QVkShaderResourceBindings, m_shaderResourceBindings);
     Q_ASSERT(m_shaderResourceBindings && srbD->layout);
     pipelineLayoutInfo.pSetLayouts = &srbD->layout;
+    if (pushConstantRange.size) {
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    }
+    if (pushConstantRange.size) {
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    }
     VkResult err = rhiD->df->vkCreatePipelineLayout(rhiD->dev, &pipelineLayoutInfo, nullptr, &layout);
     if (err != VK_SUCCESS) {
         qWarning("Failed to create pipeline layout: %d", err);
@@ -4882,6 +5791,92 @@ bool QVkGraphicsPipeline::build()
     return true;
 }
 
+QVkComputePipeline::QVkComputePipeline(QRhiImplementation *rhi)
+    : QRhiComputePipeline(rhi)
+{
+    memset(&pushConstantRange, 0, sizeof(pushConstantRange));
+}
+
+void QVkComputePipeline::release()
+{
+    if (!pipeline && !layout)
+        return;
+
+    QRhiVulkan::DeferredReleaseEntry e;
+    e.type = QRhiVulkan::DeferredReleaseEntry::Pipeline;
+    e.lastActiveFrameSlot = lastActiveFrameSlot;
+
+    e.pipelineState.pipeline = pipeline;
+    e.pipelineState.layout = layout;
+
+    pipeline = VK_NULL_HANDLE;
+    layout = VK_NULL_HANDLE;
+
+    QRHI_RES_RHI(QRhiVulkan);
+    rhiD->releaseQueue.append(e);
+
+    rhiD->unregisterResource(this);
+}
+
+bool QVkComputePipeline::build()
+{
+    if (pipeline)
+        release();
+
+    QRHI_RES_RHI(QRhiVulkan);
+    if (!rhiD->ensurePipelineCache())
+        return false;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo;
+    memset(&pipelineLayoutInfo, 0, sizeof(pipelineLayoutInfo));
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    QVkShaderResourceBindings *srbD = QRHI_RES(QVkShaderResourceBindings, m_shaderResourceBindings);
+    Q_ASSERT(m_shaderResourceBindings && srbD->layout);
+    pipelineLayoutInfo.pSetLayouts = &srbD->layout;
+    VkResult err = rhiD->df->vkCreatePipelineLayout(rhiD->dev, &pipelineLayoutInfo, nullptr, &layout);
+    if (err != VK_SUCCESS) {
+        qWarning("Failed to create pipeline layout: %d", err);
+        return false;
+    }
+
+    const QBakedShaderCode spirv = m_shader.shader({ QBakedShaderKey::SpirvShader, 100, m_shaderVariant });
+    if (spirv.shader().isEmpty()) {
+        qWarning() << "No SPIR-V 1.0 shader code found in baked shader" << m_shader;
+        return false;
+    }
+    if (m_shader.stage() != QBakedShader::ComputeStage) {
+        qWarning("Compute pipeline requires a compute shader, got stage %d", int(m_shader.stage()));
+        return false;
+    }
+    VkShaderModule shader = rhiD->createShader(spirv.shader());
+    if (!shader)
+        return false;
+
+    VkComputePipelineCreateInfo pipelineInfo;
+    memset(&pipelineInfo, 0, sizeof(pipelineInfo));
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shader;
+    pipelineInfo.stage.pName = spirv.entryPoint().constData();
+    pipelineInfo.layout = layout;
+
+    err = rhiD->df->vkCreateComputePipelines(rhiD->dev, rhiD->pipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
+
+    rhiD->df->vkDestroyShaderModule(rhiD->dev, shader, nullptr);
+
+    if (err != VK_SUCCESS) {
+        qWarning("Failed to create compute pipeline: %d", err);
+        return false;
+    }
+
+    lastActiveFrameSlot = -1;
+    generation += 1;
+    rhiD->registerResource(this);
+    return true;
+}
+
 QVkCommandBuffer::QVkCommandBuffer(QRhiImplementation *rhi)
     : QRhiCommandBuffer(rhi)
 {
@@ -56,8 +56,15 @@ static const int QVK_FRAMES_IN_FLIGHT = 2;
 static const int QVK_DESC_SETS_PER_POOL = 128;
 static const int QVK_UNIFORM_BUFFERS_PER_POOL = 256;
 static const int QVK_COMBINED_IMAGE_SAMPLERS_PER_POOL = 256;
+static const int QVK_STORAGE_BUFFERS_PER_POOL = 128;
+static const int QVK_STORAGE_IMAGES_PER_POOL = 128;
+
+static const int QVK_MAX_MIP_LEVELS = 16; // enough for max 32k x 32k
 
 static const int QVK_MAX_ACTIVE_TIMESTAMP_PAIRS = 16;
+static const int QVK_MAX_MARKER_TIMESTAMPS = 256; // per swapchain frame slot
+
+static const quint64 QVK_MAX_POOLED_READBACK_BYTES = 64 * 1024 * 1024;
 
 // no vk_mem_alloc.h available here, void* is good enough
 typedef void * QVkAlloc;
@@ -114,13 +121,18 @@ struct QVkTexture : public QRhiTexture
 
     bool prepareBuild(QSize *adjustedSize = nullptr);
     bool finishBuild();
+    VkImageView imageViewForLevel(int level);
+    VkImageViewType viewType() const;
+    uint arrayLayerCount() const;
 
     VkImage image = VK_NULL_HANDLE;
     VkImageView imageView = VK_NULL_HANDLE;
+    VkImageView perLevelImageViews[QVK_MAX_MIP_LEVELS];
     QVkAlloc imageAlloc = nullptr;
     VkBuffer stagingBuffers[QVK_FRAMES_IN_FLIGHT];
     QVkAlloc stagingAllocations[QVK_FRAMES_IN_FLIGHT];
     bool owns = true;
+    bool lazilyAllocated = false;
     QRhiVulkanTextureNativeHandles nativeHandlesStruct;
     VkImageLayout layout = VK_IMAGE_LAYOUT_PREINITIALIZED;
     VkFormat vkformat;
@@ -223,10 +235,20 @@ struct QVkShaderResourceBindings : public QRhiShaderResourceBindings
         quint64 samplerId;
         uint samplerGeneration;
     };
+    struct BoundStorageImageData {
+        quint64 id;
+        uint generation;
+    };
+    struct BoundStorageBufferData {
+        quint64 id;
+        uint generation;
+    };
     struct BoundResourceData {
         union {
             BoundUniformBufferData ubuf;
             BoundSampledTextureData stex;
+            BoundStorageImageData simage;
+            BoundStorageBufferData sbuf;
         };
     };
     QVector<BoundResourceData> boundResourceData[QVK_FRAMES_IN_FLIGHT];
@@ -244,6 +266,21 @@ struct QVkGraphicsPipeline : public QRhiGraphicsPipeline
 
     VkPipelineLayout layout = VK_NULL_HANDLE;
     VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPushConstantRange pushConstantRange;
+    int lastActiveFrameSlot = -1;
+    uint generation = 0;
+    friend class QRhiVulkan;
+};
+
+struct QVkComputePipeline : public QRhiComputePipeline
+{
+    QVkComputePipeline(QRhiImplementation *rhi);
+    void release() override;
+    bool build() override;
+
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPushConstantRange pushConstantRange;
     int lastActiveFrameSlot = -1;
     uint generation = 0;
     friend class QRhiVulkan;
@@ -260,6 +297,9 @@ struct QVkCommandBuffer : public QRhiCommandBuffer
         currentTarget = nullptr;
         currentPipeline = nullptr;
         currentPipelineGeneration = 0;
+        currentComputePipeline = nullptr;
+        currentComputePipelineGeneration = 0;
+        dispatchCount = 0;
         currentSrb = nullptr;
         currentSrbGeneration = 0;
         currentDescSetSlot = -1;
@@ -273,6 +313,9 @@ struct QVkCommandBuffer : public QRhiCommandBuffer
     QRhiRenderTarget *currentTarget;
     QRhiGraphicsPipeline *currentPipeline;
     uint currentPipelineGeneration;
+    QRhiComputePipeline *currentComputePipeline;
+    uint currentComputePipelineGeneration;
+    int dispatchCount; // in the current compute pass
     QRhiShaderResourceBindings *currentSrb;
     uint currentSrbGeneration;
     int currentDescSetSlot;
@@ -341,6 +384,19 @@ struct QVkSwapChain : public QRhiSwapChain
         bool imageSemWaitable = false;
         quint32 imageIndex = 0;
         int timestampQueryIndex = -1;
+        // debug marker scope timing, see QRhiProfiler::setMarkerTimingEnabled()
+        struct MarkerScope {
+            int scope;
+            int beginQuery;
+            int endQuery;
+        };
+        VkQueryPool markerQueryPool = VK_NULL_HANDLE;
+        bool markerTimingActive = false;
+        int markerQueryCount = 0;
+        int markerScopeCount = 0;
+        QVector<MarkerScope> markerStack;
+        QVector<MarkerScope> markerScopes;
+        quint64 markerFrameSerial = 0;
     } frameRes[QVK_FRAMES_IN_FLIGHT];
 
     quint32 currentImageIndex = 0; // index in imageRes
@@ -359,6 +415,7 @@ public:
     void destroy() override;
 
     QRhiGraphicsPipeline *createGraphicsPipeline() override;
+    QRhiComputePipeline *createComputePipeline() override;
     QRhiShaderResourceBindings *createShaderResourceBindings() override;
     QRhiBuffer *createBuffer(QRhiBuffer::Type type,
                              QRhiBuffer::UsageFlags usage,
@@ -394,8 +451,13 @@ public:
                    QRhiResourceUpdateBatch *resourceUpdates) override;
     void endPass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) override;
 
+    void beginComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) override;
+    void endComputePass(QRhiCommandBuffer *cb, QRhiResourceUpdateBatch *resourceUpdates) override;
+
     void setGraphicsPipeline(QRhiCommandBuffer *cb,
                              QRhiGraphicsPipeline *ps) override;
+    void setComputePipeline(QRhiCommandBuffer *cb,
+                            QRhiComputePipeline *ps) override;
 
     void setShaderResources(QRhiCommandBuffer *cb,
                             QRhiShaderResourceBindings *srb,
@@ -410,6 +472,8 @@ public:
     void setScissor(QRhiCommandBuffer *cb, const QRhiScissor &scissor) override;
     void setBlendConstants(QRhiCommandBuffer *cb, const QVector4D &c) override;
     void setStencilRef(QRhiCommandBuffer *cb, quint32 refValue) override;
+    void setPushConstants(QRhiCommandBuffer *cb, QRhiShaderResourceBinding::StageFlags stages,
+                          quint32 offset, quint32 size, const void *data) override;
 
     void draw(QRhiCommandBuffer *cb, quint32 vertexCount,
               quint32 instanceCount, quint32 firstVertex, quint32 firstInstance) override;
@@ -418,6 +482,13 @@ public:
                      quint32 instanceCount, quint32 firstIndex,
                      qint32 vertexOffset, quint32 firstInstance) override;
 
+    void drawIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                      quint32 indirectBufferOffset, quint32 drawCount, quint32 stride) override;
+    void drawIndexedIndirect(QRhiCommandBuffer *cb, QRhiBuffer *indirectBuffer,
+                             quint32 indirectBufferOffset, quint32 drawCount, quint32 stride) override;
+
+    void dispatch(QRhiCommandBuffer *cb, int x, int y, int z) override;
+
     void debugMarkBegin(QRhiCommandBuffer *cb, const QByteArray &name) override;
     void debugMarkEnd(QRhiCommandBuffer *cb) override;
     void debugMarkMsg(QRhiCommandBuffer *cb, const QByteArray &msg) override;
@@ -428,6 +499,7 @@ public:
     bool isYUpInNDC() const override;
     QMatrix4x4 clipSpaceCorrMatrix() const override;
     bool isTextureFormatSupported(QRhiTexture::Format format, QRhiTexture::Flags flags) const override;
+    bool isVertexFormatSupported(QRhiVertexInputAttribute::Format format) const override;
     bool isFeatureSupported(QRhi::Feature feature) const override;
     int resourceSizeLimit(QRhi::ResourceSizeLimit limit) const override;
     const QRhiNativeHandles *nativeHandles() override;
@@ -442,6 +514,8 @@ public:
 
     bool recreateSwapChain(QRhiSwapChain *swapChain);
     void releaseSwapChainResources(QRhiSwapChain *swapChain);
+    void resolveMarkerTimestamps(QVkSwapChain *swapChainD, QVkSwapChain::FrameResources *frame);
+    void writeMarkerTimestamp(QVkCommandBuffer *cbD, bool begin);
 
     VkFormat optimalDepthStencilFormat();
     VkSampleCountFlagBits effectiveSampleCount(int sampleCount);
@@ -449,12 +523,7 @@ public:
                                  bool hasDepthStencil,
                                  VkSampleCountFlagBits samples,
                                  VkFormat colorFormat);
-    bool createOffscreenRenderPass(VkRenderPass *rp,
-                                   const QVector<QRhiColorAttachment> &colorAttachments,
-                                   bool preserveColor,
-                                   bool preserveDs,
-                                   QRhiRenderBuffer *depthStencilBuffer,
-                                   QRhiTexture *depthTexture);
+    bool createOffscreenRenderPass(VkRenderPass *rp, const QRhiTextureRenderTarget *rt);
     bool ensurePipelineCache();
     VkShaderModule createShader(const QByteArray &spirv);
 
@@ -477,6 +546,9 @@ public:
     void deactivateTextureRenderTarget(QRhiCommandBuffer *cb, QRhiTextureRenderTarget *rt);
     void executeDeferredReleases(bool forced = false);
     void finishActiveReadbacks(bool forced = false);
+    bool acquireReadbackBuffer(quint32 size, QRhiResource *src, ReadbackBuffer *rbuf);
+    void recycleReadbackBuffer(const ReadbackBuffer &rbuf);
+    void destroyReadbackBuffer(const ReadbackBuffer &rbuf);
 
     void setObjectName(uint64_t object, VkDebugReportObjectTypeEXT type, const QByteArray &name, int slot = -1);
     void bufferBarrier(QRhiCommandBuffer *cb, QRhiBuffer *buf);
@@ -490,6 +562,9 @@ public:
                       VkImageLayout newLayout,
                       VkAccessFlags srcAccess, VkAccessFlags dstAccess,
                       VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage);
+    void memoryBarrier(QRhiCommandBuffer *cb,
+                       VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+                       VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage);
 
     // Lighter than release+build, does not allow layout change, but pulls in
     // any new underlying resources from the referenced buffers, textures, etc.
@@ -516,6 +591,8 @@ public:
 
     bool debugMarkersAvailable = false;
     bool vertexAttribDivisorAvailable = false;
+    bool multiDrawIndirectAvailable = false;
+    bool maintenance1Available = false;
     PFN_vkCmdDebugMarkerBeginEXT vkCmdDebugMarkerBegin = nullptr;
     PFN_vkCmdDebugMarkerEndEXT vkCmdDebugMarkerEnd = nullptr;
     PFN_vkCmdDebugMarkerInsertEXT vkCmdDebugMarkerInsert = nullptr;
@@ -551,6 +628,8 @@ public:
     int currentFrameSlot = 0; // 0..FRAMES_IN_FLIGHT-1
     bool inFrame = false;
     bool inPass = false;
+    bool inComputePass = false;
+    QVector<QVkTexture *> computePassGeneralImages; // images transitioned to GENERAL in the current compute pass
     QVkSwapChain *currentSwapChain = nullptr;
     QSet<QVkSwapChain *> swapchains;
     QRhiVulkanNativeHandles nativeHandlesStruct;
@@ -562,18 +641,35 @@ public:
         VkFence cmdFence = VK_NULL_HANDLE;
     } ofr;
 
+    // persistently mapped, host visible buffer, recycled via readbackBufferPool
+    struct ReadbackBuffer {
+        VkBuffer buf = VK_NULL_HANDLE;
+        QVkAlloc alloc = nullptr;
+        void *p = nullptr;
+        quint32 sizeClass = 0;
+    };
+    QVector<ReadbackBuffer> readbackBufferPool; // unused buffers, least recently used first
+    quint64 readbackBufferPoolBytes = 0;
+
     struct ActiveReadback {
         int activeFrameSlot = -1;
         QRhiReadbackDescription desc;
         QRhiReadbackResult *result;
-        VkBuffer buf;
-        QVkAlloc bufAlloc;
+        ReadbackBuffer buf;
         quint32 bufSize;
         QSize pixelSize;
         QRhiTexture::Format format;
     };
     QVector<ActiveReadback> activeReadbacks;
 
+    struct ActiveBufferReadback {
+        int activeFrameSlot = -1;
+        QRhiBufferReadbackResult *result;
+        int size;
+        ReadbackBuffer buf; // buf.buf is null when already copied from a Dynamic buffer
+    };
+    QVector<ActiveBufferReadback> activeBufferReadbacks;
+
     struct DeferredReleaseEntry {
         enum Type {
             Pipeline,
@@ -611,6 +707,7 @@ public:
             struct {
                 VkImage image;
                 VkImageView imageView;
+                VkImageView perLevelImageViews[QVK_MAX_MIP_LEVELS];
                 QVkAlloc allocation;
                 VkBuffer stagingBuffers[QVK_FRAMES_IN_FLIGHT];
                 QVkAlloc stagingAllocations[QVK_FRAMES_IN_FLIGHT];
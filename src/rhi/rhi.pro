@@ -12,12 +12,15 @@ HEADERS += \
     qrhirsh_p.h \
     qrhiprofiler.h \
     qrhiprofiler_p.h \
+    qrhicapture.h \
+    qrhicapture_p.h \
     qrhinull.h \
     qrhinull_p.h
 
 SOURCES += \
     qrhi.cpp \
     qrhiprofiler.cpp \
+    qrhicapture.cpp \
     qrhinull.cpp
 
 qtConfig(opengl) {
@@ -0,0 +1,20 @@
+#version 440
+
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec2 instTranslate;
+layout(location = 2) in vec3 instColor;
+
+layout(location = 0) out vec3 v_color;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 mvp;
+    float opacity;
+} ubuf;
+
+out gl_PerVertex { vec4 gl_Position; };
+
+void main()
+{
+    v_color = instColor;
+    gl_Position = ubuf.mvp * vec4(position.xy + instTranslate, 0.0, 1.0);
+}
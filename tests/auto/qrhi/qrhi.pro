@@ -0,0 +1,12 @@
+TARGET = tst_qrhi
+CONFIG += testcase
+
+QT += testlib shadertools rhi-private
+
+# the replay part of qrhireplay, for the capture round-trip test
+REPLAY_DIR = $$PWD/../../../tools/qrhireplay
+INCLUDEPATH += $$REPLAY_DIR
+HEADERS += $$REPLAY_DIR/qrhireplayer.h
+SOURCES += tst_qrhi.cpp $$REPLAY_DIR/qrhireplayer.cpp
+
+RESOURCES += qrhi.qrc
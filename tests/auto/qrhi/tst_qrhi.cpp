@@ -0,0 +1,870 @@
+/****************************************************************************
+**
+** Copyright (C) 2019 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtRhi/QRhi>
+#include <QtRhi/QRhiNullInitParams>
+#include <QtRhi/QRhiProfiler>
+#include <QtRhi/QRhiCapture>
+#include <QtRhi/private/qrhiprofiler_p.h>
+#include <QtShaderTools/QShaderBaker>
+#include <QtGui/QImage>
+#include "qrhireplayer.h"
+
+#ifndef QT_NO_OPENGL
+#include <QtRhi/QRhiGles2InitParams>
+#include <QtGui/QOffscreenSurface>
+#endif
+
+struct ResourceDeleter
+{
+    static void cleanup(QRhiResource *resource)
+    {
+        if (resource)
+            resource->releaseAndDestroy();
+    }
+};
+
+template<typename T>
+using ResourcePtr = QScopedPointer<T, ResourceDeleter>;
+
+// A 64x64 RGBA8 texture render target, optionally with a shaderless pipeline
+// using a single vertex stage uniform buffer. The pipeline is only usable with
+// the Null backend.
+struct TestTarget
+{
+    bool build(QRhi *r,
+               QRhiTexture::Flags textureFlags = QRhiTexture::Flags(),
+               QRhiTextureRenderTarget::Flags rtFlags = QRhiTextureRenderTarget::Flags());
+    bool buildPipeline(QRhi *r);
+
+    const QSize size = QSize(64, 64);
+    ResourcePtr<QRhiTexture> texture;
+    ResourcePtr<QRhiTextureRenderTarget> rt;
+    ResourcePtr<QRhiRenderPassDescriptor> rp;
+    ResourcePtr<QRhiBuffer> ubuf;
+    ResourcePtr<QRhiShaderResourceBindings> srb;
+    ResourcePtr<QRhiGraphicsPipeline> ps;
+};
+
+bool TestTarget::build(QRhi *r, QRhiTexture::Flags textureFlags, QRhiTextureRenderTarget::Flags rtFlags)
+{
+    texture.reset(r->newTexture(QRhiTexture::RGBA8, size, 1, QRhiTexture::RenderTarget | textureFlags));
+    if (!texture->build())
+        return false;
+    rt.reset(r->newTextureRenderTarget({ texture.data() }, rtFlags));
+    rp.reset(rt->newCompatibleRenderPassDescriptor());
+    rt->setRenderPassDescriptor(rp.data());
+    return rt->build();
+}
+
+bool TestTarget::buildPipeline(QRhi *r)
+{
+    ubuf.reset(r->newBuffer(QRhiBuffer::Dynamic, QRhiBuffer::UniformBuffer, 16));
+    if (!ubuf->build())
+        return false;
+    srb.reset(r->newShaderResourceBindings());
+    srb->setBindings({
+        QRhiShaderResourceBinding::uniformBuffer(0, QRhiShaderResourceBinding::VertexStage, ubuf.data())
+    });
+    if (!srb->build())
+        return false;
+    ps.reset(r->newGraphicsPipeline());
+    ps->setShaderResourceBindings(srb.data());
+    ps->setRenderPassDescriptor(rp.data());
+    return ps->build();
+}
+
+class tst_QRhi : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+    void nullIndirectDraw();
+    void nullFrameCounters();
+    void histogramPercentiles_data();
+    void histogramPercentiles();
+    void nullFrameTimePercentiles();
+    void nullCostModel_data();
+    void nullCostModel();
+    void nullMemoryStatistics();
+    void nullCaptureReplay();
+    void gles2InstancedGrid();
+    void gles2TextureUploadReadback();
+    void gles2StorageBufferCompute();
+
+private:
+    QRhi *createNull(bool costModel, QRhi::Flags flags = QRhi::Flags());
+    const QRhiNullStatistics *nullStatistics(QRhi *r);
+    QRhi *createGles2();
+
+#ifndef QT_NO_OPENGL
+    QScopedPointer<QOffscreenSurface> fallbackSurface;
+#endif
+};
+
+static QBakedShader bakeShader(const QString &name, const QVector<QShaderBaker::GeneratedShader> &targets)
+{
+    QShaderBaker baker;
+    baker.setSourceFileName(name);
+    baker.setGeneratedShaders(targets);
+    baker.setGeneratedShaderVariants({ QBakedShaderKey::StandardShader });
+    QBakedShader bs = baker.bake();
+    if (!bs.isValid())
+        qWarning("Failed to bake %s: %s", qPrintable(name), qPrintable(baker.errorMessage()));
+
+    return bs;
+}
+
+static QBakedShader bakeGlGraphicsShader(const QString &name)
+{
+    return bakeShader(name, {
+        { QBakedShaderKey::GlslShader, QBakedShaderVersion(100, QBakedShaderVersion::GlslEs) },
+        { QBakedShaderKey::GlslShader, QBakedShaderVersion(120) }
+    });
+}
+
+// Returns the RGBA8 pixel at the given normalized device coordinates,
+// regardless of the framebuffer's Y direction.
+static const uchar *pixelAt(QRhi *r, const QRhiReadbackResult &rb, float x, float y)
+{
+    const int w = rb.pixelSize.width();
+    const int h = rb.pixelSize.height();
+    const int px = qBound(0, int((x + 1.0f) * 0.5f * w), w - 1);
+    int py = qBound(0, int((1.0f - y) * 0.5f * h), h - 1);
+    if (r->isYUpInFramebuffer())
+        py = h - 1 - py;
+    return reinterpret_cast<const uchar *>(rb.data.constData()) + (py * w + px) * 4;
+}
+
+static bool fuzzyCompareColor(const uchar *pixel, int r, int g, int b)
+{
+    return qAbs(pixel[0] - r) <= 2 && qAbs(pixel[1] - g) <= 2 && qAbs(pixel[2] - b) <= 2;
+}
+
+void tst_QRhi::initTestCase()
+{
+#ifndef QT_NO_OPENGL
+    fallbackSurface.reset(QRhiGles2InitParams::newFallbackSurface());
+#endif
+}
+
+void tst_QRhi::cleanup()
+{
+}
+
+QRhi *tst_QRhi::createNull(bool costModel, QRhi::Flags flags)
+{
+    QRhiNullInitParams params;
+    params.enableCostModel = costModel;
+    return QRhi::create(QRhi::Null, &params, flags);
+}
+
+const QRhiNullStatistics *tst_QRhi::nullStatistics(QRhi *r)
+{
+    return static_cast<const QRhiNullNativeHandles *>(r->nativeHandles())->statistics;
+}
+
+void tst_QRhi::nullMemoryStatistics()
+{
+    QScopedPointer<QRhi> r(createNull(false));
+    QVERIFY(r);
+    QCOMPARE(r->memoryStatistics().totalBytes(), qint64(0));
+
+    ResourcePtr<QRhiBuffer> buf(r->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::VertexBuffer, 256));
+    QVERIFY(buf->build());
+    ResourcePtr<QRhiTexture> tex(r->newTexture(QRhiTexture::RGBA8, QSize(64, 64)));
+    QVERIFY(tex->build());
+    // 64x64 down to 1x1 is 16384 + 4096 + 1024 + 256 + 64 + 16 + 4 bytes
+    ResourcePtr<QRhiTexture> mipTex(r->newTexture(QRhiTexture::RGBA8, QSize(64, 64), 1, QRhiTexture::MipMapped));
+    QVERIFY(mipTex->build());
+
+    QRhiMemoryStatistics stats = r->memoryStatistics();
+    QCOMPARE(stats.bufferBytes, qint64(256));
+    QCOMPARE(stats.textureBytes, qint64(16384 + 21844));
+    QCOMPARE(stats.renderBufferBytes, qint64(0));
+    QCOMPARE(stats.totalBytes(), qint64(256 + 16384 + 21844));
+
+    // a rebuild replaces the previous size
+    buf->setSize(512);
+    QVERIFY(buf->build());
+    QCOMPARE(r->memoryStatistics().bufferBytes, qint64(512));
+
+    buf.reset();
+    mipTex.reset();
+    stats = r->memoryStatistics();
+    QCOMPARE(stats.bufferBytes, qint64(0));
+    QCOMPARE(stats.textureBytes, qint64(16384));
+
+    int pressureCount = 0;
+    QRhiMemoryStatistics pressureStats;
+    r->setMemoryPressureCallback([&pressureCount, &pressureStats](const QRhiMemoryStatistics &s) {
+        ++pressureCount;
+        pressureStats = s;
+    });
+    r->setMemoryBudget(16384 + 1024);
+
+    // exceeding the budget only invokes the callback in the next frame
+    buf.reset(r->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::VertexBuffer, 2048));
+    QVERIFY(buf->build());
+    QCOMPARE(pressureCount, 0);
+
+    QRhiCommandBuffer *cb = nullptr;
+    QCOMPARE(r->beginOffscreenFrame(&cb), QRhi::FrameOpSuccess);
+    QCOMPARE(pressureCount, 1);
+    QCOMPARE(pressureStats.totalBytes(), qint64(16384 + 2048));
+    QCOMPARE(r->endOffscreenFrame(), QRhi::FrameOpSuccess);
+
+    // still over the budget, but no new crossing
+    QCOMPARE(r->beginOffscreenFrame(&cb), QRhi::FrameOpSuccess);
+    QCOMPARE(r->endOffscreenFrame(), QRhi::FrameOpSuccess);
+    QCOMPARE(pressureCount, 1);
+
+    // back under the budget, then over again
+    buf.reset();
+    buf.reset(r->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::VertexBuffer, 4096));
+    QVERIFY(buf->build());
+    QCOMPARE(r->beginOffscreenFrame(&cb), QRhi::FrameOpSuccess);
+    QCOMPARE(r->endOffscreenFrame(), QRhi::FrameOpSuccess);
+    QCOMPARE(pressureCount, 2);
+    QCOMPARE(pressureStats.totalBytes(), qint64(16384 + 4096));
+}
+
+// Returns null when OpenGL is not available.
+QRhi *tst_QRhi::createGles2()
+{
+#ifndef QT_NO_OPENGL
+    QRhiGles2InitParams params;
+    params.fallbackSurface = fallbackSurface.data();
+    return QRhi::create(QRhi::OpenGLES2, &params);
+#else
+    return nullptr;
+#endif
+}
+
+void tst_QRhi::nullCaptureReplay()
+{
+    QScopedPointer<QRhi> r(createNull(true));
+    QVERIFY(r);
+
+    QBuffer captureBuffer;
+    QVERIFY(captureBuffer.open(QIODevice::WriteOnly));
+    r->capture()->setDevice(&captureBuffer);
+    QVERIFY(!r->capture()->isActive());
+
+    TestTarget target;
+    QVERIFY(target.build(r.data()));
+    QVERIFY(target.buildPipeline(r.data()));
+
+    const QByteArray zeroes(16, '\0');
+    auto frame = [&](int pipelineBinds) {
+        QRhiCommandBuffer *cb = nullptr;
+        if (r->beginOffscreenFrame(&cb) != QRhi::FrameOpSuccess)
+            return false;
+        QRhiResourceUpdateBatch *u = r->nextResourceUpdateBatch();
+        u->updateDynamicBuffer(target.ubuf.data(), 0, 16, zeroes.constData());
+        cb->beginPass(target.rt.data(), { 0, 0, 0, 1 }, { 1, 0 }, u);
+        for (int i = 0; i < pipelineBinds; ++i) {
+            cb->setGraphicsPipeline(target.ps.data());
+            cb->setShaderResources();
+            cb->draw(3);
+        }
+        cb->endPass();
+        return r->endOffscreenFrame() == QRhi::FrameOpSuccess;
+    };
+
+    QVERIFY(frame(3));
+    QVERIFY(r->capture()->isActive());
+
+    // rebuilt with a different topology, described again
+    target.ps->setTopology(QRhiGraphicsPipeline::Lines);
+    QVERIFY(target.ps->build());
+    QVERIFY(frame(2));
+
+    // rebuilt with the same properties, checked but not described again
+    QVERIFY(target.ps->build());
+    QVERIFY(frame(1));
+
+    r->capture()->setDevice(nullptr);
+    QVERIFY(!r->capture()->isActive());
+    const QRhiNullStatistics captured = *nullStatistics(r.data());
+    QCOMPARE(captured.drawCount, quint64(6));
+
+    captureBuffer.close();
+    QVERIFY(captureBuffer.open(QIODevice::ReadOnly));
+    qint32 backend = -1;
+    QVector<CaptureRecord> records;
+    QVERIFY(readCapture(&captureBuffer, &backend, &records));
+    QCOMPARE(backend, qint32(QRhi::Null));
+
+    int pipelineDescriptions = 0;
+    int pipelineBinds = 0;
+    int frames = 0;
+    for (const CaptureRecord &record : qAsConst(records)) {
+        if (record.op == QRhiCapture::GraphicsPipeline)
+            ++pipelineDescriptions;
+        else if (record.op == QRhiCapture::SetGraphicsPipeline)
+            ++pipelineBinds;
+        else if (record.op == QRhiCapture::EndOffscreenFrame)
+            ++frames;
+    }
+    QCOMPARE(pipelineDescriptions, 2);
+    QCOMPARE(pipelineBinds, 6);
+    QCOMPARE(frames, 3);
+
+    QScopedPointer<QRhi> replayRhi(createNull(true));
+    QVERIFY(replayRhi);
+    QVector<FrameSample> samples;
+    {
+        Replayer replayer(replayRhi.data());
+        QVERIFY(replayer.run(records, &samples));
+    }
+    QCOMPARE(samples.count(), 3);
+
+    const QRhiNullStatistics *replayed = nullStatistics(replayRhi.data());
+    QCOMPARE(replayed->renderPassCount, captured.renderPassCount);
+    QCOMPARE(replayed->drawCount, captured.drawCount);
+    QCOMPARE(replayed->uploadedBytes, captured.uploadedBytes);
+}
+
+void tst_QRhi::nullIndirectDraw()
+{
+    QScopedPointer<QRhi> r(createNull(true));
+    QVERIFY(r);
+    QVERIFY(r->isFeatureSupported(QRhi::DrawIndirect));
+
+    TestTarget target;
+    QVERIFY(target.build(r.data()));
+
+    // three commands with a stride larger than the command itself
+    const quint32 stride = 5 * sizeof(quint32);
+    quint32 commands[3 * 5];
+    for (int i = 0; i < 3; ++i) {
+        commands[i * 5] = 3; // vertexCount
+        commands[i * 5 + 1] = 1; // instanceCount
+        commands[i * 5 + 2] = quint32(i * 3); // firstVertex
+        commands[i * 5 + 3] = 0; // firstInstance
+        commands[i * 5 + 4] = 0xDEADBEEF; // padding
+    }
+    ResourcePtr<QRhiBuffer> buf(r->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::IndirectBuffer, sizeof(commands)));
+    QVERIFY(buf->build());
+
+    QRhiCommandBuffer *cb = nullptr;
+    QCOMPARE(r->beginOffscreenFrame(&cb), QRhi::FrameOpSuccess);
+    QVERIFY(cb);
+
+    QRhiResourceUpdateBatch *u = r->nextResourceUpdateBatch();
+    u->uploadStaticBuffer(buf.data(), commands);
+    QRhiBufferReadbackResult readResult;
+    u->readBackBuffer(buf.data(), 0, 0, &readResult);
+    cb->beginPass(target.rt.data(), { 0, 0, 0, 1 }, { 1, 0 }, u);
+
+    // all three commands
+    cb->drawIndirect(buf.data(), 0, 3, stride);
+    QCOMPARE(nullStatistics(r.data())->drawCount, quint64(3));
+
+    // starting from the second, the third command is the last one in range
+    QTest::ignoreMessage(QtWarningMsg, "Indirect draw command 2 is out of range (buffer size 60)");
+    cb->drawIndirect(buf.data(), stride, 3, stride);
+    QCOMPARE(nullStatistics(r.data())->drawCount, quint64(5));
+
+    // an offset where offset + i * stride would wrap around in 32 bits
+    QTest::ignoreMessage(QtWarningMsg, "Indirect draw command 0 is out of range (buffer size 60)");
+    cb->drawIndirect(buf.data(), 0xFFFFFFF0u, 1, stride);
+    QTest::ignoreMessage(QtWarningMsg, "Indirect draw command 1 is out of range (buffer size 60)");
+    cb->drawIndirect(buf.data(), 0, 2, 0xFFFFFFF0u);
+    QCOMPARE(nullStatistics(r.data())->drawCount, quint64(6));
+
+    cb->endPass();
+    QCOMPARE(r->endOffscreenFrame(), QRhi::FrameOpSuccess);
+
+    // indirect buffers keep their contents with the Null backend
+    QCOMPARE(readResult.data, QByteArray(reinterpret_cast<const char *>(commands), sizeof(commands)));
+}
+
+void tst_QRhi::nullFrameCounters()
+{
+    QScopedPointer<QRhi> r(createNull(true, QRhi::EnableProfiling));
+    QVERIFY(r);
+    QVERIFY(r->profiler());
+
+    TestTarget target;
+    QVERIFY(target.build(r.data(), QRhiTexture::UsedAsTransferSource));
+    QVERIFY(target.buildPipeline(r.data()));
+
+    ResourcePtr<QRhiBuffer> vbuf(r->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::VertexBuffer, 64));
+    QVERIFY(vbuf->build());
+    ResourcePtr<QRhiBuffer> ibuf(r->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::IndexBuffer, 12));
+    QVERIFY(ibuf->build());
+    const QRhiCommandBuffer::DrawIndirectCommand commands[2] = {
+        { 3, 1, 0, 0 },
+        { 3, 1, 3, 0 }
+    };
+    ResourcePtr<QRhiBuffer> indirectBuf(r->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::IndirectBuffer, sizeof(commands)));
+    QVERIFY(indirectBuf->build());
+
+    QRhiCommandBuffer *cb = nullptr;
+    QCOMPARE(r->beginOffscreenFrame(&cb), QRhi::FrameOpSuccess);
+
+    const QByteArray zeroes(64, '\0');
+    QRhiResourceUpdateBatch *u = r->nextResourceUpdateBatch();
+    u->uploadStaticBuffer(vbuf.data(), zeroes.constData());
+    u->uploadStaticBuffer(ibuf.data(), zeroes.constData());
+    u->uploadStaticBuffer(indirectBuf.data(), commands);
+    u->updateDynamicBuffer(target.ubuf.data(), 0, 16, zeroes.constData());
+    cb->beginPass(target.rt.data(), { 0, 0, 0, 1 }, { 1, 0 }, u);
+
+    cb->setGraphicsPipeline(target.ps.data());
+    cb->setGraphicsPipeline(target.ps.data());
+    cb->setShaderResources();
+    cb->setVertexInput(0, { { vbuf.data(), 0 } }, ibuf.data(), 0, QRhiCommandBuffer::IndexUInt16);
+    cb->draw(3);
+    cb->drawIndexed(6);
+    cb->drawIndirect(indirectBuf.data(), 0, 2, sizeof(QRhiCommandBuffer::DrawIndirectCommand));
+
+    u = r->nextResourceUpdateBatch();
+    QRhiReadbackResult readResult;
+    u->readBackTexture(QRhiReadbackDescription(target.texture.data()), &readResult);
+    cb->endPass(u);
+
+    QCOMPARE(r->endOffscreenFrame(), QRhi::FrameOpSuccess);
+
+    const QRhiProfiler::FrameStatistics fs = r->profiler()->frameStatistics(nullptr);
+    QCOMPARE(fs.drawCalls, 4);
+    QCOMPARE(fs.dispatchCalls, 0);
+    QCOMPARE(fs.passes, 1);
+    QCOMPARE(fs.pipelineBinds, 2);
+    QCOMPARE(fs.shaderResourceBinds, 1);
+    QCOMPARE(fs.vertexInputBinds, 1);
+    QCOMPARE(fs.uploadBytes, qint64(64 + 12 + sizeof(commands) + 16));
+    QCOMPARE(fs.readbacks, 1);
+
+    // indirect draws are counted per command by both
+    QCOMPARE(nullStatistics(r.data())->drawCount, quint64(fs.drawCalls));
+}
+
+void tst_QRhi::histogramPercentiles_data()
+{
+    QTest::addColumn<float>("scale");
+
+    QTest::newRow("microseconds") << 0.001f; // up to 0.1 ms, exact
+    QTest::newRow("milliseconds") << 1.0f;
+    QTest::newRow("seconds") << 100.0f;
+}
+
+void tst_QRhi::histogramPercentiles()
+{
+    QFETCH(float, scale);
+
+    // 1..100 times scale, in a scrambled order, so the nth percentile is n * scale
+    QRhiProfilerHistogram h;
+    for (int i = 0; i < 100; ++i)
+        h.record(((i * 37) % 100 + 1) * scale, 0);
+    QCOMPARE(h.count, qint64(100));
+
+    const double percentiles[] = { 50, 95, 99 };
+    for (double p : percentiles) {
+        const float expected = float(p) * scale;
+        const float actual = h.percentile(p);
+        // the documented bound, plus the truncation to whole microseconds
+        const float bound = expected / 128.0f + 0.001f;
+        QVERIFY2(qAbs(actual - expected) <= bound,
+                 qPrintable(QString::asprintf("p%g is %f, expected %f", p, actual, expected)));
+    }
+
+    h.reset();
+    QCOMPARE(h.count, qint64(0));
+    QCOMPARE(h.percentile(50), 0.0f);
+}
+
+void tst_QRhi::nullFrameTimePercentiles()
+{
+    QScopedPointer<QRhi> r(createNull(false, QRhi::EnableProfiling));
+    QVERIFY(r);
+    QRhiProfiler *profiler = r->profiler();
+    QVERIFY(profiler);
+    profiler->setFrameTimeBudget(0);
+
+    const int FRAME_COUNT = 20;
+    for (int i = 0; i < FRAME_COUNT; ++i) {
+        QRhiCommandBuffer *cb = nullptr;
+        QCOMPARE(r->beginOffscreenFrame(&cb), QRhi::FrameOpSuccess);
+        QCOMPARE(r->endOffscreenFrame(), QRhi::FrameOpSuccess);
+    }
+
+    // all frames have a build time, the first frame has no delta
+    const QRhiProfiler::FrameTimePercentiles build = profiler->frameBuildPercentiles(nullptr);
+    QCOMPARE(build.frameCount, qint64(FRAME_COUNT));
+    QCOMPARE(build.overBudgetCount, qint64(0));
+    QVERIFY(build.p50 >= 0);
+    QVERIFY(build.p50 <= build.p90);
+    QVERIFY(build.p90 <= build.p99);
+    QVERIFY(build.p99 <= build.p999);
+
+    const QRhiProfiler::FrameTimePercentiles delta = profiler->frameToFramePercentiles(nullptr);
+    QCOMPARE(delta.frameCount, qint64(FRAME_COUNT - 1));
+    QVERIFY(delta.p50 <= delta.p99);
+
+    profiler->resetFrameTimeHistograms();
+    QCOMPARE(profiler->frameBuildPercentiles(nullptr).frameCount, qint64(0));
+    QCOMPARE(profiler->frameToFramePercentiles(nullptr).frameCount, qint64(0));
+}
+
+void tst_QRhi::nullCostModel_data()
+{
+    QTest::addColumn<bool>("costModel");
+
+    QTest::newRow("enabled") << true;
+    QTest::newRow("disabled") << false;
+}
+
+void tst_QRhi::nullCostModel()
+{
+    QFETCH(bool, costModel);
+
+    QScopedPointer<QRhi> r(createNull(costModel));
+    QVERIFY(r);
+    const QRhiNullStatistics *stats = nullStatistics(r.data());
+    QVERIFY(stats);
+
+    // 64x64 RGBA8 is 16384 bytes, loaded, stored and read back once each
+    const quint64 texBytes = 64 * 64 * 4;
+    TestTarget target;
+    QVERIFY(target.build(r.data(), QRhiTexture::UsedAsTransferSource,
+                         QRhiTextureRenderTarget::PreserveColorContents));
+    QVERIFY(target.buildPipeline(r.data()));
+
+    ResourcePtr<QRhiBuffer> vbuf(r->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::VertexBuffer, 64));
+    QVERIFY(vbuf->build());
+
+    QRhiCommandBuffer *cb = nullptr;
+    QCOMPARE(r->beginOffscreenFrame(&cb), QRhi::FrameOpSuccess);
+
+    const QByteArray zeroes(64, '\0');
+    QRhiResourceUpdateBatch *u = r->nextResourceUpdateBatch();
+    u->uploadStaticBuffer(vbuf.data(), zeroes.constData());
+    u->updateDynamicBuffer(target.ubuf.data(), 0, 16, zeroes.constData());
+    cb->beginPass(target.rt.data(), { 0, 0, 0, 1 }, { 1, 0 }, u);
+
+    // every state is set twice, the second call is redundant
+    for (int i = 0; i < 2; ++i) {
+        cb->setGraphicsPipeline(target.ps.data());
+        cb->setShaderResources();
+        cb->setVertexInput(0, { { vbuf.data(), 0 } });
+        cb->setViewport({ 0, 0, 64, 64 });
+    }
+    cb->setScissor({ 0, 0, 32, 32 });
+    cb->draw(3);
+    cb->draw(3);
+
+    u = r->nextResourceUpdateBatch();
+    QRhiReadbackResult readResult;
+    u->readBackTexture(QRhiReadbackDescription(target.texture.data()), &readResult);
+    cb->endPass(u);
+
+    cb->beginComputePass();
+    cb->dispatch(1, 1, 1);
+    cb->endComputePass();
+
+    QCOMPARE(r->endOffscreenFrame(), QRhi::FrameOpSuccess);
+
+    // collected regardless of the cost model
+    QCOMPARE(stats->renderPassCount, quint64(1));
+    QCOMPARE(stats->discardedColorStores, quint64(0));
+    QCOMPARE(stats->discardedStoreBytes, quint64(0));
+
+    if (costModel) {
+        QCOMPARE(stats->frameCount, quint64(1));
+        QCOMPARE(stats->drawCount, quint64(2));
+        QCOMPARE(stats->dispatchCount, quint64(1));
+        QCOMPARE(stats->pipelineChanges, quint64(1));
+        QCOMPARE(stats->redundantPipelineBinds, quint64(1));
+        QCOMPARE(stats->shaderResourceChanges, quint64(1));
+        QCOMPARE(stats->redundantShaderResourceBinds, quint64(1));
+        QCOMPARE(stats->vertexInputChanges, quint64(1));
+        QCOMPARE(stats->redundantVertexInputBinds, quint64(1));
+        QCOMPARE(stats->dynamicStateChanges, quint64(2));
+        QCOMPARE(stats->redundantDynamicStateChanges, quint64(1));
+        QCOMPARE(stats->uploadedBytes, quint64(64 + 16));
+        QCOMPARE(stats->copiedBytes, quint64(0));
+        QCOMPARE(stats->readBackBytes, texBytes);
+        QCOMPARE(stats->attachmentLoadBytes, texBytes);
+        QCOMPARE(stats->attachmentStoreBytes, texBytes);
+        QCOMPARE(stats->memoryBytes, texBytes + 64 + 16);
+        QCOMPARE(stats->peakMemoryBytes, texBytes + 64 + 16);
+    } else {
+        const QRhiNullStatistics zero;
+        QCOMPARE(stats->frameCount, zero.frameCount);
+        QCOMPARE(stats->drawCount, zero.drawCount);
+        QCOMPARE(stats->dispatchCount, zero.dispatchCount);
+        QCOMPARE(stats->pipelineChanges, zero.pipelineChanges);
+        QCOMPARE(stats->redundantPipelineBinds, zero.redundantPipelineBinds);
+        QCOMPARE(stats->shaderResourceChanges, zero.shaderResourceChanges);
+        QCOMPARE(stats->redundantShaderResourceBinds, zero.redundantShaderResourceBinds);
+        QCOMPARE(stats->vertexInputChanges, zero.vertexInputChanges);
+        QCOMPARE(stats->redundantVertexInputBinds, zero.redundantVertexInputBinds);
+        QCOMPARE(stats->dynamicStateChanges, zero.dynamicStateChanges);
+        QCOMPARE(stats->redundantDynamicStateChanges, zero.redundantDynamicStateChanges);
+        QCOMPARE(stats->uploadedBytes, zero.uploadedBytes);
+        QCOMPARE(stats->copiedBytes, zero.copiedBytes);
+        QCOMPARE(stats->readBackBytes, zero.readBackBytes);
+        QCOMPARE(stats->attachmentLoadBytes, zero.attachmentLoadBytes);
+        QCOMPARE(stats->attachmentStoreBytes, zero.attachmentStoreBytes);
+        QCOMPARE(stats->memoryBytes, zero.memoryBytes);
+        QCOMPARE(stats->peakMemoryBytes, zero.peakMemoryBytes);
+    }
+
+    // the readback completes either way
+    QCOMPARE(readResult.pixelSize, target.size);
+    QCOMPARE(quint64(readResult.data.size()), texBytes);
+}
+
+// Renders a grid of quads with a single instanced draw call, taking the
+// position and color of each cell from a per-instance vertex buffer, then
+// reads the result back and checks the center of each cell.
+void tst_QRhi::gles2InstancedGrid()
+{
+    QScopedPointer<QRhi> r(createGles2());
+    if (!r)
+        QSKIP("OpenGL is not available");
+    if (!r->isFeatureSupported(QRhi::Instancing))
+        QSKIP("Instancing is not supported");
+
+    const int COLS = 4;
+    const int ROWS = 3;
+    const float CELL_W = 2.0f / COLS;
+    const float CELL_H = 2.0f / ROWS;
+
+    const float qw = CELL_W * 0.25f;
+    const float qh = CELL_H * 0.25f;
+    const float quad[] = {
+        -qw, -qh,   qw, -qh,   -qw, qh,
+        -qw, qh,    qw, -qh,   qw, qh
+    };
+
+    float instData[COLS * ROWS * 5];
+    for (int row = 0; row < ROWS; ++row) {
+        for (int col = 0; col < COLS; ++col) {
+            float *p = instData + (row * COLS + col) * 5;
+            p[0] = -1.0f + (col + 0.5f) * CELL_W;
+            p[1] = -1.0f + (row + 0.5f) * CELL_H;
+            p[2] = col / float(COLS - 1);
+            p[3] = row / float(ROWS - 1);
+            p[4] = 1.0f;
+        }
+    }
+
+    const QBakedShader vs = bakeGlGraphicsShader(QLatin1String(":/data/instanced.vert"));
+    QVERIFY(vs.isValid());
+    const QBakedShader fs = bakeGlGraphicsShader(QLatin1String(":/data/color.frag"));
+    QVERIFY(fs.isValid());
+
+    TestTarget target;
+    QVERIFY(target.build(r.data(), QRhiTexture::UsedAsTransferSource));
+
+    ResourcePtr<QRhiBuffer> vbuf(r->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::VertexBuffer, sizeof(quad)));
+    QVERIFY(vbuf->build());
+    ResourcePtr<QRhiBuffer> instBuf(r->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::VertexBuffer, sizeof(instData)));
+    QVERIFY(instBuf->build());
+    ResourcePtr<QRhiBuffer> ubuf(r->newBuffer(QRhiBuffer::Dynamic, QRhiBuffer::UniformBuffer, 68));
+    QVERIFY(ubuf->build());
+
+    ResourcePtr<QRhiShaderResourceBindings> srb(r->newShaderResourceBindings());
+    srb->setBindings({
+        QRhiShaderResourceBinding::uniformBuffer(0, QRhiShaderResourceBinding::VertexStage | QRhiShaderResourceBinding::FragmentStage, ubuf.data())
+    });
+    QVERIFY(srb->build());
+
+    ResourcePtr<QRhiGraphicsPipeline> ps(r->newGraphicsPipeline());
+    ps->setShaderStages({
+        { QRhiGraphicsShaderStage::Vertex, vs },
+        { QRhiGraphicsShaderStage::Fragment, fs }
+    });
+    QRhiVertexInputLayout inputLayout;
+    inputLayout.setBindings({
+        { 2 * sizeof(float) },
+        { 5 * sizeof(float), QRhiVertexInputBinding::PerInstance }
+    });
+    inputLayout.setAttributes({
+        { 0, 0, QRhiVertexInputAttribute::Float2, 0 },
+        { 1, 1, QRhiVertexInputAttribute::Float2, 0 },
+        { 1, 2, QRhiVertexInputAttribute::Float3, 2 * sizeof(float) }
+    });
+    ps->setVertexInputLayout(inputLayout);
+    ps->setShaderResourceBindings(srb.data());
+    ps->setRenderPassDescriptor(target.rp.data());
+    QVERIFY(ps->build());
+
+    QRhiCommandBuffer *cb = nullptr;
+    QCOMPARE(r->beginOffscreenFrame(&cb), QRhi::FrameOpSuccess);
+
+    QRhiResourceUpdateBatch *u = r->nextResourceUpdateBatch();
+    u->uploadStaticBuffer(vbuf.data(), quad);
+    u->uploadStaticBuffer(instBuf.data(), instData);
+    const QMatrix4x4 mvp = r->clipSpaceCorrMatrix();
+    u->updateDynamicBuffer(ubuf.data(), 0, 64, mvp.constData());
+    const float opacity = 1.0f;
+    u->updateDynamicBuffer(ubuf.data(), 64, 4, &opacity);
+
+    cb->beginPass(target.rt.data(), { 0, 0, 0, 1 }, { 1, 0 }, u);
+    cb->setGraphicsPipeline(ps.data());
+    cb->setViewport({ 0, 0, float(target.size.width()), float(target.size.height()) });
+    cb->setShaderResources();
+    cb->setVertexInput(0, { { vbuf.data(), 0 }, { instBuf.data(), 0 } });
+    cb->draw(6, COLS * ROWS);
+
+    u = r->nextResourceUpdateBatch();
+    QRhiReadbackResult readResult;
+    u->readBackTexture(QRhiReadbackDescription(target.texture.data()), &readResult);
+    cb->endPass(u);
+
+    QCOMPARE(r->endOffscreenFrame(), QRhi::FrameOpSuccess);
+    QCOMPARE(readResult.pixelSize, target.size);
+
+    for (int i = 0; i < COLS * ROWS; ++i) {
+        const float *p = instData + i * 5;
+        const uchar *pixel = pixelAt(r.data(), readResult, p[0], p[1]);
+        QVERIFY2(fuzzyCompareColor(pixel, qRound(p[2] * 255), qRound(p[3] * 255), qRound(p[4] * 255)),
+                 qPrintable(QString::asprintf("instance %d has color %d %d %d", i, pixel[0], pixel[1], pixel[2])));
+    }
+
+    // the corners are outside of all the quads
+    QVERIFY(fuzzyCompareColor(pixelAt(r.data(), readResult, -0.99f, -0.99f), 0, 0, 0));
+}
+
+// Uploads two explicitly provided mip levels into a texture, which uses
+// immutable storage when available, then reads back both levels.
+void tst_QRhi::gles2TextureUploadReadback()
+{
+    QScopedPointer<QRhi> r(createGles2());
+    if (!r)
+        QSKIP("OpenGL is not available");
+
+    const QSize size(256, 128);
+    QImage level0(size, QImage::Format_RGBA8888);
+    level0.fill(Qt::red);
+    for (int y = 0; y < size.height() / 2; ++y) {
+        for (int x = 0; x < size.width() / 2; ++x)
+            level0.setPixel(x, y, qRgba(0, 0, 255, 255));
+    }
+    QImage level1(size / 2, QImage::Format_RGBA8888);
+    level1.fill(QColor(255, 255, 0));
+
+    ResourcePtr<QRhiTexture> tex(r->newTexture(QRhiTexture::RGBA8, size, 1,
+                                               QRhiTexture::MipMapped | QRhiTexture::UsedAsTransferSource));
+    QVERIFY(tex->build());
+
+    QRhiCommandBuffer *cb = nullptr;
+    QCOMPARE(r->beginOffscreenFrame(&cb), QRhi::FrameOpSuccess);
+
+    QRhiResourceUpdateBatch *u = r->nextResourceUpdateBatch();
+    QRhiTextureLayer layer;
+    layer.setMipImages({ QRhiTextureMipLevel(level0), QRhiTextureMipLevel(level1) });
+    QRhiTextureUploadDescription desc({ layer });
+    u->uploadTexture(tex.data(), desc);
+    QRhiReadbackResult readResult[2];
+    for (int level = 0; level < 2; ++level) {
+        QRhiReadbackDescription rb(tex.data());
+        rb.setLevel(level);
+        u->readBackTexture(rb, &readResult[level]);
+    }
+    cb->resourceUpdate(u);
+
+    QCOMPARE(r->endOffscreenFrame(), QRhi::FrameOpSuccess);
+
+    const QImage *expected[2] = { &level0, &level1 };
+    for (int level = 0; level < 2; ++level) {
+        const QRhiReadbackResult &result(readResult[level]);
+        QCOMPARE(result.pixelSize, expected[level]->size());
+        const QImage image(reinterpret_cast<const uchar *>(result.data.constData()),
+                           result.pixelSize.width(), result.pixelSize.height(), QImage::Format_RGBA8888);
+        QCOMPARE(image, *expected[level]);
+    }
+}
+
+// Runs a compute shader on a storage buffer and reads the results back.
+void tst_QRhi::gles2StorageBufferCompute()
+{
+    QScopedPointer<QRhi> r(createGles2());
+    if (!r)
+        QSKIP("OpenGL is not available");
+    if (!r->isFeatureSupported(QRhi::Compute))
+        QSKIP("Compute is not supported");
+
+    const int COUNT = 256;
+    quint32 values[COUNT];
+    for (int i = 0; i < COUNT; ++i)
+        values[i] = quint32(i * 3);
+
+    const QBakedShader cs = bakeShader(QLatin1String(":/data/buffer.comp"), {
+        { QBakedShaderKey::GlslShader, QBakedShaderVersion(310, QBakedShaderVersion::GlslEs) },
+        { QBakedShaderKey::GlslShader, QBakedShaderVersion(430) }
+    });
+    QVERIFY(cs.isValid());
+
+    ResourcePtr<QRhiBuffer> buf(r->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::StorageBuffer, sizeof(values)));
+    QVERIFY(buf->build());
+
+    ResourcePtr<QRhiShaderResourceBindings> srb(r->newShaderResourceBindings());
+    srb->setBindings({
+        QRhiShaderResourceBinding::bufferLoadStore(0, QRhiShaderResourceBinding::ComputeStage, buf.data())
+    });
+    QVERIFY(srb->build());
+
+    ResourcePtr<QRhiComputePipeline> ps(r->newComputePipeline());
+    ps->setShader(cs);
+    ps->setShaderResourceBindings(srb.data());
+    QVERIFY(ps->build());
+
+    QRhiCommandBuffer *cb = nullptr;
+    QCOMPARE(r->beginOffscreenFrame(&cb), QRhi::FrameOpSuccess);
+
+    QRhiResourceUpdateBatch *u = r->nextResourceUpdateBatch();
+    u->uploadStaticBuffer(buf.data(), values);
+    cb->beginComputePass(u);
+    cb->setComputePipeline(ps.data());
+    cb->setShaderResources();
+    cb->dispatch(COUNT / 64, 1, 1);
+
+    u = r->nextResourceUpdateBatch();
+    QRhiBufferReadbackResult readResult;
+    u->readBackBuffer(buf.data(), 0, 0, &readResult);
+    cb->endComputePass(u);
+
+    QCOMPARE(r->endOffscreenFrame(), QRhi::FrameOpSuccess);
+
+    QCOMPARE(readResult.data.size(), int(sizeof(values)));
+    const quint32 *result = reinterpret_cast<const quint32 *>(readResult.data.constData());
+    for (int i = 0; i < COUNT; ++i)
+        QCOMPARE(result[i], values[i] * 2 + quint32(i));
+}
+
+#include <tst_qrhi.moc>
+QTEST_MAIN(tst_QRhi)
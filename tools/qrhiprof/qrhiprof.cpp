@@ -0,0 +1,760 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the tools applications of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qcommandlineparser.h>
+#include <QtCore/qtextstream.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qmap.h>
+#include <QtCore/qvector.h>
+#include <QtCore/qmath.h>
+#include <QtCore/qdebug.h>
+#include <QtRhi/qrhiprofiler.h>
+#include <algorithm>
+
+// Analyzes QRhiProfiler streams written in QRhiProfiler::TextFormat or
+// QRhiProfiler::BinaryFormat. The Chrome trace output is meant for viewers
+// and is not supported here.
+
+struct Entry
+{
+    int op = 0;
+    qint64 timestamp = 0; // nanoseconds
+    quint64 res = 0;
+    QByteArray name;
+    QVector<QPair<QByteArray, double> > pairs;
+
+    double value(const char *key, double defaultValue = 0) const
+    {
+        for (const auto &p : pairs) {
+            if (p.first == key)
+                return p.second;
+        }
+        return defaultValue;
+    }
+};
+
+enum MemoryCategory {
+    BufferMemory,
+    TextureMemory,
+    RenderBufferMemory,
+    SwapChainMemory,
+    StagingMemory,
+    ReadbackMemory,
+    MemoryCategoryCount
+};
+
+static const char *categoryStr(int cat)
+{
+    switch (cat) {
+    case BufferMemory:
+        return "buffers";
+    case TextureMemory:
+        return "textures";
+    case RenderBufferMemory:
+        return "renderbuffers";
+    case SwapChainMemory:
+        return "swapchains";
+    case StagingMemory:
+        return "staging";
+    case ReadbackMemory:
+        return "readback";
+    default:
+        Q_UNREACHABLE();
+        return "";
+    }
+}
+
+struct ResourceKey
+{
+    int category;
+    quint64 res;
+    qint64 sub; // staging slot or readback id
+};
+
+static inline bool operator==(const ResourceKey &a, const ResourceKey &b)
+{
+    return a.category == b.category && a.res == b.res && a.sub == b.sub;
+}
+
+static inline uint qHash(const ResourceKey &k, uint seed = 0)
+{
+    return qHash(k.res, seed) ^ uint(k.category) ^ uint(k.sub);
+}
+
+struct LiveResource
+{
+    int op;
+    QByteArray name;
+    qint64 byteSize;
+    qint64 created;
+};
+
+struct Distribution
+{
+    QVector<double> samples;
+
+    void add(double v) { samples.append(v); }
+    void sort() { std::sort(samples.begin(), samples.end()); }
+    bool isEmpty() const { return samples.isEmpty(); }
+    double min() const { return samples.isEmpty() ? 0 : samples.first(); }
+    double max() const { return samples.isEmpty() ? 0 : samples.last(); }
+    double avg() const
+    {
+        if (samples.isEmpty())
+            return 0;
+        double total = 0;
+        for (double v : samples)
+            total += v;
+        return total / samples.count();
+    }
+    // nearest-rank, expects sort() to have been called
+    double percentile(double p) const
+    {
+        if (samples.isEmpty())
+            return 0;
+        const int idx = qCeil(p / 100.0 * samples.count()) - 1;
+        return samples[qBound(0, idx, samples.count() - 1)];
+    }
+};
+
+struct SwapChainFrames
+{
+    QByteArray name;
+    qint64 lastBegin = -1;
+    Distribution frameToFrame;
+    Distribution build;
+    Distribution gpu;
+};
+
+struct TimelinePoint
+{
+    qint64 timestamp;
+    qint64 bytes[MemoryCategoryCount];
+};
+
+struct Analysis
+{
+    bool millisecondTimestamps = false;
+    qint64 duration = 0;
+    int entryCount = 0;
+
+    qint64 currentBytes[MemoryCategoryCount] = {};
+    qint64 peakBytes[MemoryCategoryCount] = {};
+    qint64 peakTotalBytes = 0;
+    QVector<TimelinePoint> timeline;
+
+    int vmemSampleCount = 0;
+    qint64 peakVmemTotal = 0;
+    qint64 peakVmemUnused = 0;
+    qint64 lastVmemTotal = 0;
+    qint64 lastVmemUnused = 0;
+
+    QHash<ResourceKey, LiveResource> live;
+
+    int frameCount = 0;
+    Distribution stagingCreatesPerFrame;
+    Distribution stagingBytesPerFrame;
+    Distribution uploadBytesPerFrame;
+    int stagingCreates = 0;
+    qint64 stagingBytes = 0;
+
+    QMap<quint64, SwapChainFrames> swapchains;
+    Distribution allFrameToFrame;
+    Distribution allBuild;
+    Distribution allGpu;
+};
+
+template<typename T>
+static inline bool readRaw(const QByteArray &buf, int *pos, T *v)
+{
+    if (*pos + int(sizeof(T)) > buf.size())
+        return false;
+    memcpy(v, buf.constData() + *pos, sizeof(T));
+    *pos += int(sizeof(T));
+    return true;
+}
+
+static inline bool readShortString(const QByteArray &buf, int *pos, QByteArray *s)
+{
+    quint8 len;
+    if (!readRaw(buf, pos, &len) || *pos + len > buf.size())
+        return false;
+    *s = buf.mid(*pos, len);
+    *pos += len;
+    return true;
+}
+
+static bool parseBinary(const QByteArray &buf, QVector<Entry> *entries)
+{
+    int pos = 8;
+    quint32 version;
+    if (!readRaw(buf, &pos, &version) || version != 1) {
+        qWarning("Unsupported binary profiler stream version");
+        return false;
+    }
+    while (pos < buf.size()) {
+        Entry e;
+        quint16 op = 0;
+        quint16 pairCount = 0;
+        bool ok = readRaw(buf, &pos, &op) && readRaw(buf, &pos, &pairCount)
+                && readRaw(buf, &pos, &e.timestamp) && readRaw(buf, &pos, &e.res)
+                && readShortString(buf, &pos, &e.name);
+        e.op = op;
+        for (int i = 0; ok && i < pairCount; ++i) {
+            QByteArray key;
+            ok = readShortString(buf, &pos, &key);
+            if (!ok)
+                break;
+            if (key.startsWith('F')) {
+                double f;
+                ok = readRaw(buf, &pos, &f);
+                e.pairs.append(qMakePair(key, f));
+            } else {
+                qint64 v;
+                ok = readRaw(buf, &pos, &v);
+                e.pairs.append(qMakePair(key, double(v)));
+            }
+        }
+        if (!ok) {
+            // the application may have been killed while writing
+            qWarning("Truncated entry at offset %d, ignoring the rest of the stream", pos);
+            break;
+        }
+        entries->append(e);
+    }
+    return true;
+}
+
+static bool parseText(const QByteArray &buf, QVector<Entry> *entries)
+{
+    const QList<QByteArray> lines = buf.split('\n');
+    int lineNo = 0;
+    for (const QByteArray &line : lines) {
+        ++lineNo;
+        if (line.trimmed().isEmpty())
+            continue;
+        const QList<QByteArray> fields = line.split(',');
+        if (fields.count() < 4) {
+            qWarning("Malformed entry on line %d, skipping", lineNo);
+            continue;
+        }
+        Entry e;
+        bool ok = true;
+        e.op = fields[0].toInt(&ok);
+        if (ok)
+            e.timestamp = fields[1].toLongLong(&ok) * 1000000;
+        if (ok)
+            e.res = fields[2].toULongLong(&ok);
+        if (!ok) {
+            qWarning("Malformed entry on line %d, skipping", lineNo);
+            continue;
+        }
+        e.name = fields[3];
+        // each line ends with a comma, so there is an empty last field
+        for (int i = 4; i + 1 < fields.count(); i += 2)
+            e.pairs.append(qMakePair(fields[i], fields[i + 1].toDouble()));
+        entries->append(e);
+    }
+    return true;
+}
+
+static bool readCapture(const QString &fn, QVector<Entry> *entries, bool *millisecondTimestamps)
+{
+    QFile f(fn);
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning("Failed to open %s", qPrintable(fn));
+        return false;
+    }
+    const QByteArray buf = f.readAll();
+
+    *millisecondTimestamps = false;
+    if (buf.startsWith("QRHIPROF"))
+        return parseBinary(buf, entries);
+
+    if (buf.trimmed().startsWith('[')) {
+        qWarning("%s is a Chrome trace. Record with QRhiProfiler::TextFormat or BinaryFormat instead.",
+                 qPrintable(fn));
+        return false;
+    }
+
+    *millisecondTimestamps = true;
+    return parseText(buf, entries);
+}
+
+static void addLive(Analysis *a, const Entry &e, int category, qint64 sub, qint64 byteSize)
+{
+    const ResourceKey key = { category, e.res, sub };
+    auto it = a->live.find(key);
+    if (it != a->live.end()) // resized swapchain, or a rebuilt resource without release
+        a->currentBytes[category] -= it->byteSize;
+    a->live[key] = { e.op, e.name, byteSize, e.timestamp };
+    a->currentBytes[category] += byteSize;
+}
+
+static void removeLive(Analysis *a, int category, quint64 res, qint64 sub)
+{
+    auto it = a->live.find({ category, res, sub });
+    if (it == a->live.end())
+        return;
+    a->currentBytes[category] -= it->byteSize;
+    a->live.erase(it);
+}
+
+static void recordMemory(Analysis *a, qint64 timestamp)
+{
+    TimelinePoint p;
+    p.timestamp = timestamp;
+    qint64 total = 0;
+    for (int i = 0; i < MemoryCategoryCount; ++i) {
+        p.bytes[i] = a->currentBytes[i];
+        a->peakBytes[i] = qMax(a->peakBytes[i], a->currentBytes[i]);
+        total += a->currentBytes[i];
+    }
+    a->peakTotalBytes = qMax(a->peakTotalBytes, total);
+    if (!a->timeline.isEmpty() && a->timeline.last().timestamp == timestamp)
+        a->timeline.last() = p;
+    else
+        a->timeline.append(p);
+}
+
+static void finishFrame(Analysis *a, int stagingCreates, qint64 stagingBytes, qint64 uploadBytes, bool hasCounters)
+{
+    a->frameCount += 1;
+    a->stagingCreatesPerFrame.add(stagingCreates);
+    a->stagingBytesPerFrame.add(double(stagingBytes));
+    if (hasCounters)
+        a->uploadBytesPerFrame.add(double(uploadBytes));
+}
+
+static void analyze(const QVector<Entry> &entries, Analysis *a)
+{
+    a->entryCount = entries.count();
+    if (!entries.isEmpty())
+        a->duration = entries.last().timestamp - entries.first().timestamp;
+
+    QHash<quint64, qint64> frameBegin;
+    bool inFrame = false;
+    int frameStagingCreates = 0;
+    qint64 frameStagingBytes = 0;
+    qint64 frameUploadBytes = 0;
+    bool frameHasCounters = false;
+
+    for (const Entry &e : entries) {
+        bool memoryChanged = true;
+        switch (e.op) {
+        case QRhiProfiler::NewBuffer:
+        {
+            const qint64 backingCount = qint64(e.value("backing_gpu_buf_count") + e.value("backing_cpu_buf_count"));
+            addLive(a, e, BufferMemory, 0, qint64(e.value("effective_size")) * qMax<qint64>(1, backingCount));
+        }
+            break;
+        case QRhiProfiler::ReleaseBuffer:
+            removeLive(a, BufferMemory, e.res, 0);
+            break;
+        case QRhiProfiler::NewTexture:
+            addLive(a, e, TextureMemory, 0, qint64(e.value("approx_byte_size")));
+            break;
+        case QRhiProfiler::ReleaseTexture:
+            removeLive(a, TextureMemory, e.res, 0);
+            break;
+        case QRhiProfiler::NewRenderBuffer:
+            addLive(a, e, RenderBufferMemory, 0, qint64(e.value("approx_byte_size")));
+            break;
+        case QRhiProfiler::ReleaseRenderBuffer:
+            removeLive(a, RenderBufferMemory, e.res, 0);
+            break;
+        case QRhiProfiler::ResizeSwapChain:
+            addLive(a, e, SwapChainMemory, 0, qint64(e.value("approx_total_byte_size")));
+            break;
+        case QRhiProfiler::ReleaseSwapChain:
+            removeLive(a, SwapChainMemory, e.res, 0);
+            break;
+        case QRhiProfiler::NewBufferStagingArea:
+            Q_FALLTHROUGH();
+        case QRhiProfiler::NewTextureStagingArea:
+        {
+            const qint64 size = qint64(e.value("size"));
+            addLive(a, e, StagingMemory, qint64(e.value("slot")) * 2 + (e.op == QRhiProfiler::NewTextureStagingArea), size);
+            a->stagingCreates += 1;
+            a->stagingBytes += size;
+            frameStagingCreates += 1;
+            frameStagingBytes += size;
+        }
+            break;
+        case QRhiProfiler::ReleaseBufferStagingArea:
+            Q_FALLTHROUGH();
+        case QRhiProfiler::ReleaseTextureStagingArea:
+            removeLive(a, StagingMemory, e.res,
+                       qint64(e.value("slot")) * 2 + (e.op == QRhiProfiler::ReleaseTextureStagingArea));
+            break;
+        case QRhiProfiler::NewReadbackBuffer:
+        {
+            // res is the source of the readback, the release refers to the id only
+            Entry keyed = e;
+            keyed.res = 0;
+            const qint64 size = qint64(e.value("size"));
+            addLive(a, keyed, ReadbackMemory, qint64(e.value("id")), size);
+            a->stagingCreates += 1;
+            a->stagingBytes += size;
+            frameStagingCreates += 1;
+            frameStagingBytes += size;
+        }
+            break;
+        case QRhiProfiler::ReleaseReadbackBuffer:
+            removeLive(a, ReadbackMemory, 0, qint64(e.value("id")));
+            break;
+        case QRhiProfiler::VMemAllocStats:
+        {
+            memoryChanged = false;
+            a->vmemSampleCount += 1;
+            a->lastVmemTotal = qint64(e.value("totalSize"));
+            a->lastVmemUnused = qint64(e.value("unusedSize"));
+            a->peakVmemTotal = qMax(a->peakVmemTotal, a->lastVmemTotal);
+            a->peakVmemUnused = qMax(a->peakVmemUnused, a->lastVmemUnused);
+        }
+            break;
+        case QRhiProfiler::BeginFrame:
+        {
+            memoryChanged = false;
+            if (inFrame)
+                finishFrame(a, frameStagingCreates, frameStagingBytes, frameUploadBytes, frameHasCounters);
+            inFrame = true;
+            frameStagingCreates = 0;
+            frameStagingBytes = 0;
+            frameUploadBytes = 0;
+            frameHasCounters = false;
+            SwapChainFrames &sc(a->swapchains[e.res]);
+            if (sc.lastBegin >= 0) {
+                const double ms = (e.timestamp - sc.lastBegin) / 1000000.0;
+                sc.frameToFrame.add(ms);
+                a->allFrameToFrame.add(ms);
+            }
+            sc.lastBegin = e.timestamp;
+            frameBegin[e.res] = e.timestamp;
+        }
+            break;
+        case QRhiProfiler::EndFrame:
+        {
+            memoryChanged = false;
+            auto it = frameBegin.find(e.res);
+            if (it != frameBegin.end()) {
+                const double ms = (e.timestamp - *it) / 1000000.0;
+                a->swapchains[e.res].build.add(ms);
+                a->allBuild.add(ms);
+                frameBegin.erase(it);
+            }
+        }
+            break;
+        case QRhiProfiler::GpuFrameTimeSample:
+        {
+            memoryChanged = false;
+            const double ms = e.value("Fgpu_ms");
+            a->swapchains[e.res].gpu.add(ms);
+            a->allGpu.add(ms);
+        }
+            break;
+        case QRhiProfiler::FrameCounters:
+            memoryChanged = false;
+            if (e.res) {
+                frameUploadBytes += qint64(e.value("upload_bytes"));
+                frameHasCounters = true;
+            }
+            break;
+        default:
+            memoryChanged = false;
+            break;
+        }
+        if (memoryChanged)
+            recordMemory(a, e.timestamp);
+        if (!e.name.isEmpty() && (e.op == QRhiProfiler::ResizeSwapChain || e.op == QRhiProfiler::BeginFrame))
+            a->swapchains[e.res].name = e.name;
+    }
+
+    if (inFrame)
+        finishFrame(a, frameStagingCreates, frameStagingBytes, frameUploadBytes, frameHasCounters);
+
+    // swapchains only seen via ResizeSwapChain have no frames to report
+    for (auto it = a->swapchains.begin(); it != a->swapchains.end(); ) {
+        if (it->frameToFrame.isEmpty() && it->build.isEmpty() && it->gpu.isEmpty()) {
+            it = a->swapchains.erase(it);
+        } else {
+            it->frameToFrame.sort();
+            it->build.sort();
+            it->gpu.sort();
+            ++it;
+        }
+    }
+    a->allFrameToFrame.sort();
+    a->allBuild.sort();
+    a->allGpu.sort();
+    a->stagingCreatesPerFrame.sort();
+    a->stagingBytesPerFrame.sort();
+    a->uploadBytesPerFrame.sort();
+}
+
+static QString sizeStr(double bytes)
+{
+    if (qAbs(bytes) >= 1024.0 * 1024.0)
+        return QString::number(bytes / (1024.0 * 1024.0), 'f', 2) + QLatin1String(" MB");
+    if (qAbs(bytes) >= 1024.0)
+        return QString::number(bytes / 1024.0, 'f', 2) + QLatin1String(" KB");
+    return QString::number(qint64(bytes)) + QLatin1String(" B");
+}
+
+static void printDistribution(QTextStream &ts, const char *title, const Distribution &d)
+{
+    if (d.isEmpty())
+        return;
+    ts << "    " << title << ": " << d.samples.count() << " samples, min " << d.min()
+       << " avg " << d.avg() << " p50 " << d.percentile(50) << " p90 " << d.percentile(90)
+       << " p99 " << d.percentile(99) << " max " << d.max() << " ms\n";
+}
+
+static void report(const QString &fn, const Analysis &a, int maxLeaks)
+{
+    QTextStream ts(stdout);
+    ts.setRealNumberPrecision(3);
+    ts.setRealNumberNotation(QTextStream::FixedNotation);
+
+    ts << fn << ": " << a.entryCount << " entries over " << a.duration / 1000000000.0 << " s\n\n";
+
+    ts << "Memory (peak / at end):\n";
+    for (int i = 0; i < MemoryCategoryCount; ++i)
+        ts << "    " << categoryStr(i) << ": " << sizeStr(a.peakBytes[i]) << " / " << sizeStr(a.currentBytes[i]) << "\n";
+    ts << "    total peak: " << sizeStr(a.peakTotalBytes) << "\n";
+    if (a.vmemSampleCount) {
+        ts << "    allocator: peak " << sizeStr(a.peakVmemTotal) << " (" << sizeStr(a.peakVmemUnused)
+           << " unused), at end " << sizeStr(a.lastVmemTotal) << " (" << sizeStr(a.lastVmemUnused) << " unused)\n";
+    }
+    ts << "\n";
+
+    ts << "Resources never released: " << a.live.count() << "\n";
+    QVector<QPair<ResourceKey, LiveResource> > leaks;
+    for (auto it = a.live.cbegin(), end = a.live.cend(); it != end; ++it)
+        leaks.append(qMakePair(it.key(), it.value()));
+    std::sort(leaks.begin(), leaks.end(), [](const QPair<ResourceKey, LiveResource> &x,
+                                             const QPair<ResourceKey, LiveResource> &y) {
+        return x.second.byteSize > y.second.byteSize;
+    });
+    for (int i = 0; i < leaks.count() && i < maxLeaks; ++i) {
+        const QPair<ResourceKey, LiveResource> &l(leaks[i]);
+        ts << "    " << categoryStr(l.first.category) << " 0x" << QString::number(l.first.res, 16)
+           << " \"" << l.second.name << "\" " << sizeStr(l.second.byteSize)
+           << ", created at " << l.second.created / 1000000.0 << " ms\n";
+    }
+    if (leaks.count() > maxLeaks)
+        ts << "    ... and " << leaks.count() - maxLeaks << " more\n";
+    ts << "\n";
+
+    ts << "Staging churn: " << a.stagingCreates << " upload and readback staging areas, "
+       << sizeStr(a.stagingBytes) << " in total\n";
+    if (a.frameCount) {
+        ts << "    per frame (" << a.frameCount << " frames): avg " << a.stagingCreatesPerFrame.avg()
+           << " areas / " << sizeStr(a.stagingBytesPerFrame.avg()) << ", p99 "
+           << a.stagingCreatesPerFrame.percentile(99) << " / " << sizeStr(a.stagingBytesPerFrame.percentile(99))
+           << ", max " << a.stagingCreatesPerFrame.max() << " / " << sizeStr(a.stagingBytesPerFrame.max()) << "\n";
+    }
+    if (!a.uploadBytesPerFrame.isEmpty()) {
+        ts << "    uploads per frame: avg " << sizeStr(a.uploadBytesPerFrame.avg())
+           << ", p99 " << sizeStr(a.uploadBytesPerFrame.percentile(99))
+           << ", max " << sizeStr(a.uploadBytesPerFrame.max()) << "\n";
+    }
+    ts << "\n";
+
+    ts << "Frame times:";
+    if (a.swapchains.isEmpty())
+        ts << " no BeginFrame/EndFrame or GpuFrameTimeSample entries";
+    else if (a.millisecondTimestamps)
+        ts << " (CPU times have millisecond resolution in text captures, prefer BinaryFormat)";
+    ts << "\n";
+    for (auto it = a.swapchains.cbegin(), end = a.swapchains.cend(); it != end; ++it) {
+        ts << "  swapchain 0x" << QString::number(it.key(), 16);
+        if (!it->name.isEmpty())
+            ts << " \"" << it->name << "\"";
+        ts << "\n";
+        printDistribution(ts, "frame to frame", it->frameToFrame);
+        printDistribution(ts, "frame build", it->build);
+        printDistribution(ts, "gpu", it->gpu);
+    }
+}
+
+static void writeTimeline(const Analysis &a)
+{
+    QTextStream ts(stdout);
+    ts << "time_ms";
+    for (int i = 0; i < MemoryCategoryCount; ++i)
+        ts << ',' << categoryStr(i);
+    ts << ",total\n";
+    for (const TimelinePoint &p : a.timeline) {
+        ts << p.timestamp / 1000000;
+        qint64 total = 0;
+        for (int i = 0; i < MemoryCategoryCount; ++i) {
+            ts << ',' << p.bytes[i];
+            total += p.bytes[i];
+        }
+        ts << ',' << total << '\n';
+    }
+}
+
+struct Metric
+{
+    QString name;
+    double value;
+    bool regressionCandidate; // larger is worse and it is worth failing on
+};
+
+// Resource addresses differ between runs, so captures are compared on
+// aggregates: all swapchains' frames are taken together.
+static QVector<Metric> metrics(const Analysis &a)
+{
+    QVector<Metric> m;
+    for (int i = 0; i < MemoryCategoryCount; ++i)
+        m.append({ QLatin1String("peak ") + QLatin1String(categoryStr(i)) + QLatin1String(" bytes"), double(a.peakBytes[i]), true });
+    m.append({ QLatin1String("peak total bytes"), double(a.peakTotalBytes), true });
+    m.append({ QLatin1String("peak allocator bytes"), double(a.peakVmemTotal), true });
+    m.append({ QLatin1String("unreleased resources"), double(a.live.count()), true });
+    m.append({ QLatin1String("staging areas per frame"), a.stagingCreatesPerFrame.avg(), true });
+    m.append({ QLatin1String("staging bytes per frame"), a.stagingBytesPerFrame.avg(), true });
+    m.append({ QLatin1String("upload bytes per frame"), a.uploadBytesPerFrame.avg(), false });
+    const struct {
+        const char *name;
+        const Distribution *d;
+    } dists[] = {
+        { "frame to frame", &a.allFrameToFrame },
+        { "frame build", &a.allBuild },
+        { "gpu", &a.allGpu }
+    };
+    for (const auto &d : dists) {
+        const QString prefix = QLatin1String(d.name) + QLatin1Char(' ');
+        m.append({ prefix + QLatin1String("avg ms"), d.d->avg(), false });
+        m.append({ prefix + QLatin1String("p50 ms"), d.d->percentile(50), true });
+        m.append({ prefix + QLatin1String("p90 ms"), d.d->percentile(90), true });
+        m.append({ prefix + QLatin1String("p99 ms"), d.d->percentile(99), true });
+        m.append({ prefix + QLatin1String("max ms"), d.d->max(), false });
+    }
+    return m;
+}
+
+static int diff(const Analysis &base, const Analysis &current, double threshold)
+{
+    QTextStream ts(stdout);
+    ts.setRealNumberPrecision(3);
+    ts.setRealNumberNotation(QTextStream::FixedNotation);
+
+    const QVector<Metric> a = metrics(base);
+    const QVector<Metric> b = metrics(current);
+    int regressions = 0;
+    ts << qSetFieldWidth(32) << left << "metric" << qSetFieldWidth(16) << right
+       << "base" << "current" << "delta" << "delta %" << qSetFieldWidth(0) << "\n";
+    for (int i = 0; i < a.count(); ++i) {
+        const double delta = b[i].value - a[i].value;
+        const double pct = a[i].value != 0 ? delta / a[i].value * 100.0 : 0.0;
+        const bool regressed = threshold >= 0 && a[i].regressionCandidate && a[i].value != 0 && pct > threshold;
+        if (regressed)
+            ++regressions;
+        ts << qSetFieldWidth(32) << left << a[i].name << qSetFieldWidth(16) << right
+           << a[i].value << b[i].value << delta << pct << qSetFieldWidth(0)
+           << (regressed ? "  REGRESSION" : "") << "\n";
+    }
+    if (threshold >= 0)
+        ts << "\n" << regressions << " metric(s) regressed by more than " << threshold << "%\n";
+    return regressions ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser cmdLineParser;
+    cmdLineParser.setApplicationDescription(QObject::tr("QRhiProfiler stream analyzer"));
+    cmdLineParser.addHelpOption();
+    cmdLineParser.addPositionalArgument(QLatin1String("file"),
+                                        QObject::tr("Profiler output in text or binary format. With --diff, the baseline and the current capture."),
+                                        QObject::tr("file [file2]"));
+    QCommandLineOption timelineOption({ "t", "timeline" }, QObject::tr("Prints the memory timeline per resource type as CSV instead of the report."));
+    cmdLineParser.addOption(timelineOption);
+    QCommandLineOption leaksOption({ "l", "leaks" },
+                                   QObject::tr("Maximum number of unreleased resources to list. Defaults to 20."),
+                                   QObject::tr("count"), QLatin1String("20"));
+    cmdLineParser.addOption(leaksOption);
+    QCommandLineOption diffOption({ "d", "diff" }, QObject::tr("Compares two captures."));
+    cmdLineParser.addOption(diffOption);
+    QCommandLineOption thresholdOption({ "r", "regression-threshold" },
+                                       QObject::tr("With --diff, exits with 1 when a peak memory, leak, staging or frame time percentile metric grows by more than the given percentage."),
+                                       QObject::tr("percent"));
+    cmdLineParser.addOption(thresholdOption);
+
+    cmdLineParser.process(app);
+
+    const QStringList files = cmdLineParser.positionalArguments();
+    if (files.isEmpty()) {
+        cmdLineParser.showHelp();
+        return 0;
+    }
+
+    if (cmdLineParser.isSet(diffOption)) {
+        if (files.count() != 2) {
+            qWarning("--diff needs exactly two files");
+            return 1;
+        }
+        Analysis analysis[2];
+        for (int i = 0; i < 2; ++i) {
+            QVector<Entry> entries;
+            if (!readCapture(files[i], &entries, &analysis[i].millisecondTimestamps))
+                return 1;
+            analyze(entries, &analysis[i]);
+        }
+        double threshold = -1;
+        if (cmdLineParser.isSet(thresholdOption)) {
+            bool ok = false;
+            threshold = cmdLineParser.value(thresholdOption).toDouble(&ok);
+            if (!ok || threshold < 0) {
+                qWarning("Invalid regression threshold %s", qPrintable(cmdLineParser.value(thresholdOption)));
+                return 1;
+            }
+        }
+        return diff(analysis[0], analysis[1], threshold);
+    }
+
+    const int maxLeaks = qMax(0, cmdLineParser.value(leaksOption).toInt());
+    for (const QString &fn : files) {
+        QVector<Entry> entries;
+        Analysis analysis;
+        if (!readCapture(fn, &entries, &analysis.millisecondTimestamps))
+            return 1;
+        analyze(entries, &analysis);
+        if (cmdLineParser.isSet(timelineOption))
+            writeTimeline(analysis);
+        else
+            report(fn, analysis, maxLeaks);
+    }
+
+    return 0;
+}
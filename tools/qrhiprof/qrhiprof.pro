@@ -0,0 +1,5 @@
+SOURCES += qrhiprof.cpp
+
+QT = core rhi
+
+load(qt_tool)
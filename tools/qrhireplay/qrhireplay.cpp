@@ -0,0 +1,351 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the tools applications of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qrhireplayer.h"
+#include <QtGui/qguiapplication.h>
+#include <QtCore/qcommandlineparser.h>
+#include <QtCore/qtextstream.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qscopedpointer.h>
+#include <QtCore/qdebug.h>
+#include <QtRhi/qrhicapture.h>
+#include <QtRhi/qrhiprofiler.h>
+#include <QtRhi/qrhinull.h>
+#include <algorithm>
+
+#ifndef QT_NO_OPENGL
+#include <QtRhi/qrhigles2.h>
+#include <QtGui/qoffscreensurface.h>
+#endif
+
+#if QT_CONFIG(vulkan)
+#include <QtRhi/qrhivulkan.h>
+#include <QtGui/qvulkaninstance.h>
+#endif
+
+#ifdef Q_OS_WIN
+#include <QtRhi/qrhid3d11.h>
+#endif
+
+#ifdef Q_OS_DARWIN
+#include <QtRhi/qrhimetal.h>
+#endif
+
+static const char *backendStr(int backend)
+{
+    switch (backend) {
+    case QRhi::Null:
+        return "Null";
+    case QRhi::Vulkan:
+        return "Vulkan";
+    case QRhi::OpenGLES2:
+        return "OpenGL";
+    case QRhi::D3D11:
+        return "D3D11";
+    case QRhi::Metal:
+        return "Metal";
+    default:
+        return "unknown";
+    }
+}
+
+struct TimeStats
+{
+    double min = 0;
+    double avg = 0;
+    double p50 = 0;
+    double p90 = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+static TimeStats timeStats(QVector<double> v)
+{
+    TimeStats s;
+    if (v.isEmpty())
+        return s;
+
+    std::sort(v.begin(), v.end());
+    double sum = 0;
+    for (double t : qAsConst(v))
+        sum += t;
+    auto percentile = [&v](double p) { return v[qMin(v.count() - 1, int(p * v.count()))]; };
+    s.min = v.first();
+    s.avg = sum / v.count();
+    s.p50 = percentile(0.5);
+    s.p90 = percentile(0.9);
+    s.p99 = percentile(0.99);
+    s.max = v.last();
+    return s;
+}
+
+int main(int argc, char **argv)
+{
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser cmdLineParser;
+    cmdLineParser.setApplicationDescription(QLatin1String("Replays a QRhiCapture stream and reports frame timings"));
+    cmdLineParser.addHelpOption();
+    cmdLineParser.addPositionalArgument(QLatin1String("file"), QLatin1String("Capture file."), QLatin1String("file"));
+    QCommandLineOption nullOption({ "n", "null" }, QLatin1String("Null backend"));
+    cmdLineParser.addOption(nullOption);
+    QCommandLineOption glOption({ "g", "opengl" }, QLatin1String("OpenGL (2.x)"));
+    cmdLineParser.addOption(glOption);
+    QCommandLineOption vkOption({ "v", "vulkan" }, QLatin1String("Vulkan"));
+    cmdLineParser.addOption(vkOption);
+    QCommandLineOption d3dOption({ "d", "d3d11" }, QLatin1String("Direct3D 11"));
+    cmdLineParser.addOption(d3dOption);
+    QCommandLineOption mtlOption({ "m", "metal" }, QLatin1String("Metal"));
+    cmdLineParser.addOption(mtlOption);
+    QCommandLineOption loopsOption({ "l", "loops" }, QLatin1String("Replay the capture <n> times. Defaults to 1."),
+                                   QLatin1String("n"), QLatin1String("1"));
+    cmdLineParser.addOption(loopsOption);
+    QCommandLineOption warmupOption({ "w", "warmup" }, QLatin1String("Replay <n> times before measuring. Defaults to 1."),
+                                    QLatin1String("n"), QLatin1String("1"));
+    cmdLineParser.addOption(warmupOption);
+    QCommandLineOption csvOption("csv", QLatin1String("Write per-frame timings to <file> as CSV."),
+                                 QLatin1String("file"));
+    cmdLineParser.addOption(csvOption);
+    QCommandLineOption profileOption("profile", QLatin1String("Write the QRhiProfiler stream of the measured loops "
+                                                              "to <file> in binary format, for qrhiprof."),
+                                     QLatin1String("file"));
+    cmdLineParser.addOption(profileOption);
+    cmdLineParser.process(app);
+
+    if (cmdLineParser.positionalArguments().count() != 1)
+        cmdLineParser.showHelp(1);
+
+    qint32 capturedBackend = 0;
+    QVector<CaptureRecord> records;
+    const QString fn = cmdLineParser.positionalArguments().first();
+    QFile f(fn);
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning("Failed to open %s", qPrintable(fn));
+        return 1;
+    }
+    if (!readCapture(&f, &capturedBackend, &records)) {
+        qWarning("Failed to read %s", qPrintable(fn));
+        return 1;
+    }
+
+    int frameCount = 0;
+    for (const CaptureRecord &record : qAsConst(records)) {
+        if (record.op == QRhiCapture::EndFrame || record.op == QRhiCapture::EndOffscreenFrame)
+            ++frameCount;
+    }
+    if (!frameCount) {
+        qWarning("No complete frames in %s", qPrintable(fn));
+        return 1;
+    }
+
+    QRhi::Implementation backend = QRhi::Null;
+    if (cmdLineParser.isSet(glOption))
+        backend = QRhi::OpenGLES2;
+    if (cmdLineParser.isSet(vkOption))
+        backend = QRhi::Vulkan;
+    if (cmdLineParser.isSet(d3dOption))
+        backend = QRhi::D3D11;
+    if (cmdLineParser.isSet(mtlOption))
+        backend = QRhi::Metal;
+
+    const int loops = qMax(1, cmdLineParser.value(loopsOption).toInt());
+    const int warmup = qMax(0, cmdLineParser.value(warmupOption).toInt());
+
+    QRhi *r = nullptr;
+    const QRhi::Flags flags = QRhi::EnableProfiling;
+
+    if (backend == QRhi::Null) {
+        QRhiNullInitParams params;
+        params.enableCostModel = true;
+        r = QRhi::create(QRhi::Null, &params, flags);
+    }
+
+#ifndef QT_NO_OPENGL
+    QScopedPointer<QOffscreenSurface> offscreenSurface;
+    if (backend == QRhi::OpenGLES2) {
+        offscreenSurface.reset(QRhiGles2InitParams::newFallbackSurface());
+        QRhiGles2InitParams params;
+        params.fallbackSurface = offscreenSurface.data();
+        r = QRhi::create(QRhi::OpenGLES2, &params, flags);
+    }
+#endif
+
+#if QT_CONFIG(vulkan)
+    // no validation layers, they would skew the timings
+    QVulkanInstance inst;
+    if (backend == QRhi::Vulkan) {
+        if (inst.create()) {
+            QRhiVulkanInitParams params;
+            params.inst = &inst;
+            r = QRhi::create(QRhi::Vulkan, &params, flags);
+        } else {
+            qWarning("Failed to create Vulkan instance");
+        }
+    }
+#endif
+
+#ifdef Q_OS_WIN
+    if (backend == QRhi::D3D11) {
+        QRhiD3D11InitParams params;
+        r = QRhi::create(QRhi::D3D11, &params, flags);
+    }
+#endif
+
+#ifdef Q_OS_DARWIN
+    if (backend == QRhi::Metal) {
+        QRhiMetalInitParams params;
+        r = QRhi::create(QRhi::Metal, &params, flags);
+    }
+#endif
+
+    if (!r) {
+        qWarning("Failed to initialize the %s backend", backendStr(backend));
+        return 1;
+    }
+
+    QFile profileFile;
+    if (cmdLineParser.isSet(profileOption)) {
+        profileFile.setFileName(cmdLineParser.value(profileOption));
+        if (!profileFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            qWarning("Failed to open %s", qPrintable(profileFile.fileName()));
+    }
+
+    QVector<FrameSample> samples;
+    QRhiNullStatistics nullStatsBefore;
+    bool ok = true;
+    {
+        Replayer replayer(r);
+        for (int loop = 0; ok && loop < warmup + loops; ++loop) {
+            if (loop == warmup) {
+                if (backend == QRhi::Null)
+                    nullStatsBefore = *static_cast<const QRhiNullNativeHandles *>(r->nativeHandles())->statistics;
+                r->profiler()->resetFrameTimeHistograms();
+                if (profileFile.isOpen()) {
+                    r->profiler()->setOutputFormat(QRhiProfiler::BinaryFormat);
+                    r->profiler()->setDevice(&profileFile);
+                }
+            }
+            ok = replayer.run(records, loop >= warmup ? &samples : nullptr);
+        }
+    }
+
+    QTextStream out(stdout);
+    out << "Capture: " << fn << ", recorded on " << backendStr(capturedBackend) << ", "
+        << frameCount << " frames, " << records.count() << " records\n";
+    out << "Replay: " << backendStr(backend) << ", " << loops << " loops after "
+        << warmup << " warm-up loops\n";
+    if (!ok)
+        out << "Replay stopped early due to errors, the results are partial\n";
+
+    if (cmdLineParser.isSet(csvOption)) {
+        QFile csvFile(cmdLineParser.value(csvOption));
+        if (csvFile.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
+            QTextStream csv(&csvFile);
+            csv << "loop,frame,captured_ms,replay_ms\n";
+            for (int i = 0; i < samples.count(); ++i) {
+                csv << (i / frameCount) << ',' << (i % frameCount) << ','
+                    << samples[i].capturedMs << ',' << samples[i].replayMs << '\n';
+            }
+        } else {
+            qWarning("Failed to open %s", qPrintable(csvFile.fileName()));
+        }
+    }
+
+    QVector<double> captured, replayed;
+    // the captured times are the same on every loop, take the first one only
+    for (int i = 0; i < qMin(frameCount, samples.count()); ++i)
+        captured.append(samples[i].capturedMs);
+    for (const FrameSample &sample : qAsConst(samples))
+        replayed.append(sample.replayMs);
+
+    out.setRealNumberNotation(QTextStream::FixedNotation);
+    out.setRealNumberPrecision(3);
+    out << '\n' << qSetFieldWidth(22) << left << "Frame times (ms)" << qSetFieldWidth(11) << right
+        << "min" << "avg" << "p50" << "p90" << "p99" << "max" << qSetFieldWidth(0) << '\n';
+    auto printStats = [&out](const char *label, const QVector<double> &v) {
+        const TimeStats s = timeStats(v);
+        out << qSetFieldWidth(22) << left << label << qSetFieldWidth(11) << right
+            << s.min << s.avg << s.p50 << s.p90 << s.p99 << s.max
+            << qSetFieldWidth(0) << '\n';
+    };
+    printStats("  captured", captured);
+    printStats("  replayed", replayed);
+
+    const QRhiProfiler::FrameTimePercentiles build = r->profiler()->frameBuildPercentiles(nullptr);
+    const QRhiProfiler::FrameTimePercentiles gpu = r->profiler()->gpuFramePercentiles(nullptr);
+    out << '\n' << qSetFieldWidth(22) << left << "Profiler (ms)" << qSetFieldWidth(11) << right
+        << "p50" << "p90" << "p99" << "p99.9" << "frames" << qSetFieldWidth(0) << '\n';
+    auto printPercentiles = [&out](const char *label, const QRhiProfiler::FrameTimePercentiles &p) {
+        out << qSetFieldWidth(22) << left << label << qSetFieldWidth(11) << right
+            << p.p50 << p.p90 << p.p99 << p.p999 << p.frameCount
+            << qSetFieldWidth(0) << '\n';
+    };
+    printPercentiles("  frame build", build);
+    if (gpu.frameCount)
+        printPercentiles("  gpu", gpu);
+    else
+        out << "  gpu                 no timestamps from this backend\n";
+
+    if (backend == QRhi::Null) {
+        // the cost model counters of the measured loops, per frame
+        const QRhiNullStatistics &after(*static_cast<const QRhiNullNativeHandles *>(r->nativeHandles())->statistics);
+        const double n = qMax(1, samples.count());
+        auto printCost = [&out, n](const char *label, quint64 before, quint64 after) {
+            out << qSetFieldWidth(32) << left << label << qSetFieldWidth(14) << right
+                << (after - before) / n << qSetFieldWidth(0) << '\n';
+        };
+        out << '\n' << qSetFieldWidth(32) << left << "Null cost model" << qSetFieldWidth(14) << right
+            << "per frame" << qSetFieldWidth(0) << '\n';
+        const QRhiNullStatistics &b(nullStatsBefore);
+        printCost("  render passes", b.renderPassCount, after.renderPassCount);
+        printCost("  draw calls", b.drawCount, after.drawCount);
+        printCost("  dispatches", b.dispatchCount, after.dispatchCount);
+        printCost("  pipeline changes", b.pipelineChanges, after.pipelineChanges);
+        printCost("  redundant pipeline binds", b.redundantPipelineBinds, after.redundantPipelineBinds);
+        printCost("  srb changes", b.shaderResourceChanges, after.shaderResourceChanges);
+        printCost("  redundant srb binds", b.redundantShaderResourceBinds, after.redundantShaderResourceBinds);
+        printCost("  vertex input changes", b.vertexInputChanges, after.vertexInputChanges);
+        printCost("  redundant vertex input binds", b.redundantVertexInputBinds, after.redundantVertexInputBinds);
+        printCost("  dynamic state changes", b.dynamicStateChanges, after.dynamicStateChanges);
+        printCost("  redundant dynamic state", b.redundantDynamicStateChanges, after.redundantDynamicStateChanges);
+        printCost("  uploaded bytes", b.uploadedBytes, after.uploadedBytes);
+        printCost("  copied bytes", b.copiedBytes, after.copiedBytes);
+        printCost("  read back bytes", b.readBackBytes, after.readBackBytes);
+        printCost("  attachment load bytes", b.attachmentLoadBytes, after.attachmentLoadBytes);
+        printCost("  attachment store bytes", b.attachmentStoreBytes, after.attachmentStoreBytes);
+        printCost("  discarded store bytes", b.discardedStoreBytes, after.discardedStoreBytes);
+        out << qSetFieldWidth(32) << left << "  peak memory bytes" << qSetFieldWidth(14) << right
+            << after.peakMemoryBytes << qSetFieldWidth(0) << '\n';
+    }
+    out.flush();
+
+    r->profiler()->setDevice(nullptr);
+    delete r;
+
+    return ok ? 0 : 2;
+}
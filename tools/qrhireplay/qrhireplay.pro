@@ -0,0 +1,6 @@
+HEADERS += qrhireplayer.h
+SOURCES += qrhireplay.cpp qrhireplayer.cpp
+
+QT = gui rhi shadertools
+
+load(qt_tool)
@@ -0,0 +1,1142 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the tools applications of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qrhireplayer.h"
+#include <QtGui/qimage.h>
+#include <QtGui/qvector4d.h>
+#include <QtCore/qdatastream.h>
+#include <QtCore/qdebug.h>
+#include <QtRhi/qrhicapture.h>
+#include <QtShaderTools/qbakedshader.h>
+
+Replayer::~Replayer()
+{
+    if (m_cb)
+        m_r->endOffscreenFrame();
+
+    qDeleteAll(m_readbacks);
+    qDeleteAll(m_bufferReadbacks);
+
+    // dependents first
+    for (QRhiGraphicsPipeline *ps : qAsConst(m_graphicsPipelines))
+        ps->releaseAndDestroyLater();
+    for (QRhiComputePipeline *ps : qAsConst(m_computePipelines))
+        ps->releaseAndDestroyLater();
+    for (QRhiShaderResourceBindings *srb : qAsConst(m_srbs))
+        srb->releaseAndDestroyLater();
+    for (QRhiTextureRenderTarget *rt : qAsConst(m_renderTargets))
+        rt->releaseAndDestroyLater();
+    for (QRhiRenderPassDescriptor *rp : qAsConst(m_renderPassDescriptors))
+        rp->releaseAndDestroyLater();
+    for (auto it = m_swapChains.begin(), itEnd = m_swapChains.end(); it != itEnd; ++it)
+        releaseSwapChain(&it.value());
+    for (QRhiSampler *sampler : qAsConst(m_samplers))
+        sampler->releaseAndDestroyLater();
+    for (QRhiRenderBuffer *rb : qAsConst(m_renderBuffers))
+        rb->releaseAndDestroyLater();
+    for (QRhiTexture *tex : qAsConst(m_textures))
+        tex->releaseAndDestroyLater();
+    for (QRhiBuffer *buf : qAsConst(m_buffers))
+        buf->releaseAndDestroyLater();
+}
+
+void Replayer::releaseSwapChain(ReplaySwapChain *sc)
+{
+    if (sc->rt)
+        sc->rt->releaseAndDestroyLater();
+    if (sc->rp)
+        sc->rp->releaseAndDestroyLater();
+    if (sc->ds)
+        sc->ds->releaseAndDestroyLater();
+    if (sc->msaaBuffer)
+        sc->msaaBuffer->releaseAndDestroyLater();
+    if (sc->tex)
+        sc->tex->releaseAndDestroyLater();
+    *sc = ReplaySwapChain();
+}
+
+bool Replayer::run(const QVector<CaptureRecord> &records, QVector<FrameSample> *samples)
+{
+    m_samples = samples;
+    for (const CaptureRecord &record : records) {
+        if (!execute(record))
+            return false;
+    }
+    m_samples = nullptr;
+    return true;
+}
+
+// Resources are described again whenever they get rebuilt with different
+// properties. When looping, the records from the previous iteration are
+// still valid, so skip the ones that would not change anything.
+bool Replayer::isUnchanged(quint64 id, const QByteArray &payload)
+{
+    auto it = m_descriptions.find(id);
+    if (it != m_descriptions.end() && it.value() == payload)
+        return true;
+
+    m_descriptions.insert(id, payload);
+    return false;
+}
+
+QRhiRenderTarget *Replayer::renderTarget(quint64 id) const
+{
+    auto it = m_swapChainRenderTargets.constFind(id);
+    if (it != m_swapChainRenderTargets.constEnd())
+        return m_swapChains.value(it.value()).rt;
+
+    return m_renderTargets.value(id);
+}
+
+QRhiRenderPassDescriptor *Replayer::renderPassDescriptor(quint64 id) const
+{
+    auto it = m_swapChainRenderTargets.constFind(id);
+    if (it != m_swapChainRenderTargets.constEnd())
+        return m_swapChains.value(it.value()).rp;
+
+    return m_renderPassDescriptors.value(id);
+}
+
+QRhiTexture *Replayer::swapChainTexture() const
+{
+    return m_swapChains.value(m_currentSwapChain).tex;
+}
+
+void Replayer::buffer(QDataStream &ds)
+{
+    quint64 id;
+    qint32 type, usage, size;
+    ds >> id >> type >> usage >> size;
+
+    QRhiBuffer *buf = m_buffers.value(id);
+    if (!buf) {
+        buf = m_r->newBuffer(QRhiBuffer::Type(type), QRhiBuffer::UsageFlags(usage), size);
+        m_buffers.insert(id, buf);
+    } else {
+        buf->setType(QRhiBuffer::Type(type));
+        buf->setUsage(QRhiBuffer::UsageFlags(usage));
+        buf->setSize(size);
+    }
+
+    if (!buf->build())
+        qWarning("Failed to build buffer %llu", id);
+}
+
+void Replayer::texture(QDataStream &ds)
+{
+    quint64 id;
+    qint32 format, depth, arraySize, sampleCount, flags;
+    QSize pixelSize;
+    ds >> id >> format >> pixelSize >> depth >> arraySize >> sampleCount >> flags;
+
+    QRhiTexture *tex = m_textures.value(id);
+    if (!tex) {
+        tex = m_r->newTexture(QRhiTexture::Format(format), pixelSize, sampleCount, QRhiTexture::Flags(flags));
+        m_textures.insert(id, tex);
+    } else {
+        tex->setFormat(QRhiTexture::Format(format));
+        tex->setPixelSize(pixelSize);
+        tex->setSampleCount(sampleCount);
+        tex->setFlags(QRhiTexture::Flags(flags));
+    }
+    tex->setDepth(depth);
+    tex->setArraySize(arraySize);
+
+    if (!tex->build())
+        qWarning("Failed to build texture %llu", id);
+
+    rebuildRenderTargets(tex);
+}
+
+void Replayer::sampler(QDataStream &ds)
+{
+    quint64 id;
+    qint32 magFilter, minFilter, mipmapMode, u, v, w;
+    ds >> id >> magFilter >> minFilter >> mipmapMode >> u >> v >> w;
+
+    QRhiSampler *sampler = m_samplers.value(id);
+    if (!sampler) {
+        sampler = m_r->newSampler(QRhiSampler::Filter(magFilter), QRhiSampler::Filter(minFilter),
+                                  QRhiSampler::Filter(mipmapMode), QRhiSampler::AddressMode(u),
+                                  QRhiSampler::AddressMode(v), QRhiSampler::AddressMode(w));
+        m_samplers.insert(id, sampler);
+    } else {
+        sampler->setMagFilter(QRhiSampler::Filter(magFilter));
+        sampler->setMinFilter(QRhiSampler::Filter(minFilter));
+        sampler->setMipmapMode(QRhiSampler::Filter(mipmapMode));
+        sampler->setAddressU(QRhiSampler::AddressMode(u));
+        sampler->setAddressV(QRhiSampler::AddressMode(v));
+        sampler->setAddressW(QRhiSampler::AddressMode(w));
+    }
+
+    if (!sampler->build())
+        qWarning("Failed to build sampler %llu", id);
+}
+
+void Replayer::renderBuffer(QDataStream &ds)
+{
+    quint64 id;
+    qint32 type, sampleCount, flags;
+    QSize pixelSize;
+    ds >> id >> type >> pixelSize >> sampleCount >> flags;
+
+    QRhiRenderBuffer *rb = m_renderBuffers.value(id);
+    if (!rb) {
+        rb = m_r->newRenderBuffer(QRhiRenderBuffer::Type(type), pixelSize, sampleCount,
+                                  QRhiRenderBuffer::Flags(flags));
+        m_renderBuffers.insert(id, rb);
+    } else {
+        rb->setType(QRhiRenderBuffer::Type(type));
+        rb->setPixelSize(pixelSize);
+        rb->setSampleCount(sampleCount);
+        rb->setFlags(QRhiRenderBuffer::Flags(flags));
+    }
+
+    if (!rb->build())
+        qWarning("Failed to build renderbuffer %llu", id);
+
+    rebuildRenderTargets(rb);
+}
+
+// The capture describes a render target only when its own properties change,
+// while the application rebuilds it after resizing its attachments as well.
+// Do the same here.
+void Replayer::rebuildRenderTargets(QRhiResource *attachment)
+{
+    for (QRhiTextureRenderTarget *rt : qAsConst(m_renderTargets)) {
+        const QRhiTextureRenderTargetDescription desc = rt->description();
+        bool uses = desc.depthStencilBuffer() == attachment || desc.depthTexture() == attachment;
+        for (const QRhiColorAttachment &att : desc.colorAttachments()) {
+            if (att.texture() == attachment || att.renderBuffer() == attachment || att.resolveTexture() == attachment)
+                uses = true;
+        }
+        if (uses)
+            rt->build();
+    }
+}
+
+void Replayer::textureRenderTarget(QDataStream &ds)
+{
+    quint64 id;
+    qint32 flags, colorCount;
+    ds >> id >> flags >> colorCount;
+
+    QRhiTextureRenderTargetDescription desc;
+    QVector<QRhiColorAttachment> colorAttachments;
+    for (qint32 i = 0; i < colorCount; ++i) {
+        quint64 texId, rbId, resolveTexId;
+        qint32 layer, level, resolveLayer, resolveLevel, loadOp, storeOp;
+        ds >> texId >> rbId >> layer >> level >> resolveTexId >> resolveLayer >> resolveLevel
+           >> loadOp >> storeOp;
+        QRhiColorAttachment att;
+        att.setTexture(m_textures.value(texId));
+        att.setRenderBuffer(m_renderBuffers.value(rbId));
+        att.setLayer(layer);
+        att.setLevel(level);
+        att.setResolveTexture(m_textures.value(resolveTexId));
+        att.setResolveLayer(resolveLayer);
+        att.setResolveLevel(resolveLevel);
+        att.setLoadOp(QRhiColorAttachment::LoadOp(loadOp));
+        att.setStoreOp(QRhiColorAttachment::StoreOp(storeOp));
+        colorAttachments.append(att);
+    }
+    desc.setColorAttachments(colorAttachments);
+
+    quint64 dsId, depthTexId;
+    qint32 dsLoadOp, dsStoreOp;
+    ds >> dsId >> depthTexId >> dsLoadOp >> dsStoreOp;
+    desc.setDepthStencilBuffer(m_renderBuffers.value(dsId));
+    desc.setDepthTexture(m_textures.value(depthTexId));
+    desc.setDepthStencilLoadOp(QRhiColorAttachment::LoadOp(dsLoadOp));
+    desc.setDepthStencilStoreOp(QRhiColorAttachment::StoreOp(dsStoreOp));
+
+    QRhiTextureRenderTarget *rt = m_renderTargets.value(id);
+    if (!rt) {
+        rt = m_r->newTextureRenderTarget(desc, QRhiTextureRenderTarget::Flags(flags));
+        QRhiRenderPassDescriptor *rp = rt->newCompatibleRenderPassDescriptor();
+        rt->setRenderPassDescriptor(rp);
+        m_renderTargets.insert(id, rt);
+        m_renderPassDescriptors.insert(id, rp);
+    } else {
+        rt->setDescription(desc);
+        rt->setFlags(QRhiTextureRenderTarget::Flags(flags));
+    }
+
+    if (!rt->build())
+        qWarning("Failed to build texture render target %llu", id);
+}
+
+void Replayer::swapChain(QDataStream &ds)
+{
+    quint64 id;
+    QSize pixelSize;
+    qint32 sampleCount, flags;
+    bool hasDepthStencil;
+    ds >> id >> pixelSize >> sampleCount >> flags >> hasDepthStencil;
+    Q_UNUSED(flags);
+
+    ReplaySwapChain &sc(m_swapChains[id]);
+
+    if (!sc.tex) {
+        sc.tex = m_r->newTexture(QRhiTexture::RGBA8, pixelSize, 1,
+                                 QRhiTexture::RenderTarget | QRhiTexture::UsedAsTransferSource);
+    } else {
+        sc.tex->setPixelSize(pixelSize);
+    }
+    sc.tex->build();
+
+    if (sampleCount > 1) {
+        if (!sc.msaaBuffer) {
+            sc.msaaBuffer = m_r->newRenderBuffer(QRhiRenderBuffer::Color, pixelSize, sampleCount);
+        } else {
+            sc.msaaBuffer->setPixelSize(pixelSize);
+            sc.msaaBuffer->setSampleCount(sampleCount);
+        }
+        sc.msaaBuffer->build();
+    } else if (sc.msaaBuffer) {
+        sc.msaaBuffer->releaseAndDestroyLater();
+        sc.msaaBuffer = nullptr;
+    }
+
+    if (hasDepthStencil) {
+        if (!sc.ds) {
+            sc.ds = m_r->newRenderBuffer(QRhiRenderBuffer::DepthStencil, pixelSize, sampleCount);
+        } else {
+            sc.ds->setPixelSize(pixelSize);
+            sc.ds->setSampleCount(sampleCount);
+        }
+        sc.ds->build();
+    } else if (sc.ds) {
+        sc.ds->releaseAndDestroyLater();
+        sc.ds = nullptr;
+    }
+
+    QRhiColorAttachment att;
+    if (sc.msaaBuffer) {
+        att.setRenderBuffer(sc.msaaBuffer);
+        att.setResolveTexture(sc.tex);
+    } else {
+        att.setTexture(sc.tex);
+    }
+    QRhiTextureRenderTargetDescription desc(att);
+    desc.setDepthStencilBuffer(sc.ds);
+
+    if (!sc.rt) {
+        sc.rt = m_r->newTextureRenderTarget(desc);
+        sc.rp = sc.rt->newCompatibleRenderPassDescriptor();
+        sc.rt->setRenderPassDescriptor(sc.rp);
+    } else {
+        sc.rt->setDescription(desc);
+    }
+
+    if (!sc.rt->build())
+        qWarning("Failed to build render target substituting swapchain %llu", id);
+}
+
+void Replayer::swapChainRenderTarget(QDataStream &ds)
+{
+    quint64 id, scId;
+    ds >> id >> scId;
+    m_swapChainRenderTargets.insert(id, scId);
+}
+
+void Replayer::shaderResourceBindings(QDataStream &ds)
+{
+    quint64 id;
+    qint32 count;
+    ds >> id >> count;
+
+    QVector<QRhiShaderResourceBinding> bindings;
+    bindings.reserve(count);
+    for (qint32 i = 0; i < count; ++i) {
+        qint32 binding, stage, type;
+        ds >> binding >> stage >> type;
+        const QRhiShaderResourceBinding::StageFlags stages(stage);
+        switch (type) {
+        case QRhiShaderResourceBinding::UniformBuffer:
+        {
+            quint64 bufId;
+            qint32 offset, size;
+            bool hasDynamicOffset;
+            ds >> bufId >> offset >> size >> hasDynamicOffset;
+            QRhiBuffer *buf = m_buffers.value(bufId);
+            if (hasDynamicOffset)
+                bindings.append(QRhiShaderResourceBinding::uniformBufferWithDynamicOffset(binding, stages, buf, size));
+            else if (size > 0)
+                bindings.append(QRhiShaderResourceBinding::uniformBuffer(binding, stages, buf, offset, size));
+            else
+                bindings.append(QRhiShaderResourceBinding::uniformBuffer(binding, stages, buf));
+        }
+            break;
+        case QRhiShaderResourceBinding::SampledTexture:
+        {
+            quint64 texId, samplerId;
+            ds >> texId >> samplerId;
+            bindings.append(QRhiShaderResourceBinding::sampledTexture(binding, stages, m_textures.value(texId),
+                                                                      m_samplers.value(samplerId)));
+        }
+            break;
+        case QRhiShaderResourceBinding::ImageLoad:
+        case QRhiShaderResourceBinding::ImageStore:
+        case QRhiShaderResourceBinding::ImageLoadStore:
+        {
+            quint64 texId;
+            qint32 level;
+            ds >> texId >> level;
+            QRhiTexture *tex = m_textures.value(texId);
+            if (type == QRhiShaderResourceBinding::ImageLoad)
+                bindings.append(QRhiShaderResourceBinding::imageLoad(binding, stages, tex, level));
+            else if (type == QRhiShaderResourceBinding::ImageStore)
+                bindings.append(QRhiShaderResourceBinding::imageStore(binding, stages, tex, level));
+            else
+                bindings.append(QRhiShaderResourceBinding::imageLoadStore(binding, stages, tex, level));
+        }
+            break;
+        case QRhiShaderResourceBinding::BufferLoad:
+        case QRhiShaderResourceBinding::BufferStore:
+        case QRhiShaderResourceBinding::BufferLoadStore:
+        {
+            quint64 bufId;
+            qint32 offset, size;
+            ds >> bufId >> offset >> size;
+            QRhiBuffer *buf = m_buffers.value(bufId);
+            QRhiShaderResourceBinding b;
+            if (size > 0) {
+                if (type == QRhiShaderResourceBinding::BufferLoad)
+                    b = QRhiShaderResourceBinding::bufferLoad(binding, stages, buf, offset, size);
+                else if (type == QRhiShaderResourceBinding::BufferStore)
+                    b = QRhiShaderResourceBinding::bufferStore(binding, stages, buf, offset, size);
+                else
+                    b = QRhiShaderResourceBinding::bufferLoadStore(binding, stages, buf, offset, size);
+            } else {
+                if (type == QRhiShaderResourceBinding::BufferLoad)
+                    b = QRhiShaderResourceBinding::bufferLoad(binding, stages, buf);
+                else if (type == QRhiShaderResourceBinding::BufferStore)
+                    b = QRhiShaderResourceBinding::bufferStore(binding, stages, buf);
+                else
+                    b = QRhiShaderResourceBinding::bufferLoadStore(binding, stages, buf);
+            }
+            bindings.append(b);
+        }
+            break;
+        default:
+            qWarning("Unknown shader resource binding type %d in srb %llu", type, id);
+            return;
+        }
+    }
+
+    QRhiShaderResourceBindings *srb = m_srbs.value(id);
+    if (!srb) {
+        srb = m_r->newShaderResourceBindings();
+        m_srbs.insert(id, srb);
+    }
+    srb->setBindings(bindings);
+
+    if (!srb->build())
+        qWarning("Failed to build shader resource bindings %llu", id);
+}
+
+void Replayer::graphicsPipeline(QDataStream &ds)
+{
+    quint64 id, rtId;
+    qint32 flags, topology, cullMode, frontFace, blendCount;
+    ds >> id >> rtId >> flags >> topology >> cullMode >> frontFace >> blendCount;
+
+    QVector<QRhiGraphicsPipeline::TargetBlend> targetBlends;
+    for (qint32 i = 0; i < blendCount; ++i) {
+        qint32 colorWrite, srcColor, dstColor, opColor, srcAlpha, dstAlpha, opAlpha;
+        QRhiGraphicsPipeline::TargetBlend b;
+        ds >> colorWrite >> b.enable >> srcColor >> dstColor >> opColor >> srcAlpha >> dstAlpha >> opAlpha;
+        b.colorWrite = QRhiGraphicsPipeline::ColorMask(colorWrite);
+        b.srcColor = QRhiGraphicsPipeline::BlendFactor(srcColor);
+        b.dstColor = QRhiGraphicsPipeline::BlendFactor(dstColor);
+        b.opColor = QRhiGraphicsPipeline::BlendOp(opColor);
+        b.srcAlpha = QRhiGraphicsPipeline::BlendFactor(srcAlpha);
+        b.dstAlpha = QRhiGraphicsPipeline::BlendFactor(dstAlpha);
+        b.opAlpha = QRhiGraphicsPipeline::BlendOp(opAlpha);
+        targetBlends.append(b);
+    }
+
+    bool depthTest, depthWrite, stencilTest;
+    qint32 depthOp, sampleCount;
+    qint32 stencilOps[8];
+    quint32 stencilReadMask, stencilWriteMask;
+    ds >> depthTest >> depthWrite >> depthOp >> stencilTest;
+    for (qint32 &op : stencilOps)
+        ds >> op;
+    ds >> stencilReadMask >> stencilWriteMask >> sampleCount;
+    QRhiGraphicsPipeline::StencilOpState stencilFront;
+    stencilFront.failOp = QRhiGraphicsPipeline::StencilOp(stencilOps[0]);
+    stencilFront.depthFailOp = QRhiGraphicsPipeline::StencilOp(stencilOps[1]);
+    stencilFront.passOp = QRhiGraphicsPipeline::StencilOp(stencilOps[2]);
+    stencilFront.compareOp = QRhiGraphicsPipeline::CompareOp(stencilOps[3]);
+    QRhiGraphicsPipeline::StencilOpState stencilBack;
+    stencilBack.failOp = QRhiGraphicsPipeline::StencilOp(stencilOps[4]);
+    stencilBack.depthFailOp = QRhiGraphicsPipeline::StencilOp(stencilOps[5]);
+    stencilBack.passOp = QRhiGraphicsPipeline::StencilOp(stencilOps[6]);
+    stencilBack.compareOp = QRhiGraphicsPipeline::CompareOp(stencilOps[7]);
+
+    qint32 bindingCount;
+    ds >> bindingCount;
+    QVector<QRhiVertexInputBinding> inputBindings;
+    for (qint32 i = 0; i < bindingCount; ++i) {
+        quint32 stride;
+        qint32 classification, stepRate;
+        ds >> stride >> classification >> stepRate;
+        inputBindings.append(QRhiVertexInputBinding(stride, QRhiVertexInputBinding::Classification(classification), stepRate));
+    }
+    qint32 attributeCount;
+    ds >> attributeCount;
+    QVector<QRhiVertexInputAttribute> inputAttributes;
+    for (qint32 i = 0; i < attributeCount; ++i) {
+        qint32 binding, location, format;
+        quint32 offset;
+        ds >> binding >> location >> format >> offset;
+        inputAttributes.append(QRhiVertexInputAttribute(binding, location, QRhiVertexInputAttribute::Format(format), offset));
+    }
+    QRhiVertexInputLayout inputLayout;
+    inputLayout.setBindings(inputBindings);
+    inputLayout.setAttributes(inputAttributes);
+
+    quint64 srbId;
+    qint32 stageCount;
+    ds >> srbId >> stageCount;
+    QVector<QPair<qint32, qint32> > stageKeys;
+    for (qint32 i = 0; i < stageCount; ++i) {
+        qint32 type, variant;
+        ds >> type >> variant;
+        stageKeys.append(qMakePair(type, variant));
+    }
+    QVector<QRhiGraphicsShaderStage> stages;
+    for (const auto &stageKey : qAsConst(stageKeys)) {
+        QByteArray serialized;
+        ds >> serialized;
+        stages.append(QRhiGraphicsShaderStage(QRhiGraphicsShaderStage::Type(stageKey.first),
+                                              QBakedShader::fromSerialized(serialized),
+                                              QBakedShaderKey::ShaderVariant(stageKey.second)));
+    }
+
+    QRhiGraphicsPipeline *ps = m_graphicsPipelines.value(id);
+    if (!ps) {
+        ps = m_r->newGraphicsPipeline();
+        m_graphicsPipelines.insert(id, ps);
+    }
+    ps->setFlags(QRhiGraphicsPipeline::Flags(flags));
+    ps->setTopology(QRhiGraphicsPipeline::Topology(topology));
+    ps->setCullMode(QRhiGraphicsPipeline::CullMode(cullMode));
+    ps->setFrontFace(QRhiGraphicsPipeline::FrontFace(frontFace));
+    ps->setTargetBlends(targetBlends);
+    ps->setDepthTest(depthTest);
+    ps->setDepthWrite(depthWrite);
+    ps->setDepthOp(QRhiGraphicsPipeline::CompareOp(depthOp));
+    ps->setStencilTest(stencilTest);
+    ps->setStencilFront(stencilFront);
+    ps->setStencilBack(stencilBack);
+    ps->setStencilReadMask(stencilReadMask);
+    ps->setStencilWriteMask(stencilWriteMask);
+    ps->setSampleCount(sampleCount);
+    ps->setShaderStages(stages);
+    ps->setVertexInputLayout(inputLayout);
+    ps->setShaderResourceBindings(m_srbs.value(srbId));
+    ps->setRenderPassDescriptor(renderPassDescriptor(rtId));
+
+    if (!ps->build())
+        qWarning("Failed to build graphics pipeline %llu", id);
+}
+
+void Replayer::computePipeline(QDataStream &ds)
+{
+    quint64 id, srbId;
+    qint32 variant;
+    QByteArray serialized;
+    ds >> id >> srbId >> variant >> serialized;
+
+    QRhiComputePipeline *ps = m_computePipelines.value(id);
+    if (!ps) {
+        ps = m_r->newComputePipeline();
+        m_computePipelines.insert(id, ps);
+    }
+    ps->setShader(QBakedShader::fromSerialized(serialized));
+    ps->setShaderVariant(QBakedShaderKey::ShaderVariant(variant));
+    ps->setShaderResourceBindings(m_srbs.value(srbId));
+
+    if (!ps->build())
+        qWarning("Failed to build compute pipeline %llu", id);
+}
+
+void Replayer::destroyResource(QDataStream &ds)
+{
+    quint64 id;
+    ds >> id;
+
+    m_descriptions.remove(id);
+
+    if (QRhiBuffer *buf = m_buffers.take(id))
+        buf->releaseAndDestroyLater();
+    else if (QRhiTexture *tex = m_textures.take(id))
+        tex->releaseAndDestroyLater();
+    else if (QRhiSampler *sampler = m_samplers.take(id))
+        sampler->releaseAndDestroyLater();
+    else if (QRhiRenderBuffer *rb = m_renderBuffers.take(id))
+        rb->releaseAndDestroyLater();
+    else if (QRhiShaderResourceBindings *srb = m_srbs.take(id))
+        srb->releaseAndDestroyLater();
+    else if (QRhiGraphicsPipeline *ps = m_graphicsPipelines.take(id))
+        ps->releaseAndDestroyLater();
+    else if (QRhiComputePipeline *cps = m_computePipelines.take(id))
+        cps->releaseAndDestroyLater();
+    else if (QRhiTextureRenderTarget *rt = m_renderTargets.take(id))
+        rt->releaseAndDestroyLater();
+
+    // Pipelines created later may still want the render pass descriptor of
+    // a render target that is gone (that is legal in QRhi as long as the
+    // descriptor lives), so keep it around until the end.
+
+    auto scIt = m_swapChains.find(id);
+    if (scIt != m_swapChains.end()) {
+        releaseSwapChain(&scIt.value());
+        m_swapChains.erase(scIt);
+    }
+
+    m_swapChainRenderTargets.remove(id);
+}
+
+bool Replayer::beginFrame(qint64 timestamp)
+{
+    if (m_cb) {
+        qWarning("Frame begins while another one is recorded, the capture is corrupt");
+        return false;
+    }
+
+    m_capturedFrameStart = timestamp;
+    m_frameTimer.start();
+    if (m_r->beginOffscreenFrame(&m_cb) != QRhi::FrameOpSuccess) {
+        qWarning("Failed to begin frame");
+        m_cb = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool Replayer::endFrame(qint64 timestamp)
+{
+    if (!m_cb)
+        return true;
+
+    const QRhi::FrameOpResult result = m_r->endOffscreenFrame();
+    const qint64 elapsed = m_frameTimer.nsecsElapsed();
+    m_cb = nullptr;
+
+    // offscreen frames wait for completion, all readbacks are done by now
+    qDeleteAll(m_readbacks);
+    m_readbacks.clear();
+    qDeleteAll(m_bufferReadbacks);
+    m_bufferReadbacks.clear();
+
+    if (result != QRhi::FrameOpSuccess) {
+        qWarning("Failed to end frame");
+        return false;
+    }
+
+    if (m_samples) {
+        FrameSample sample;
+        sample.capturedMs = (timestamp - m_capturedFrameStart) / 1000000.0;
+        sample.replayMs = elapsed / 1000000.0;
+        m_samples->append(sample);
+    }
+    return true;
+}
+
+QRhiResourceUpdateBatch *Replayer::readBatch(QDataStream &ds)
+{
+    quint32 count;
+    ds >> count;
+    if (!count)
+        return nullptr;
+
+    QRhiResourceUpdateBatch *u = m_r->nextResourceUpdateBatch();
+    if (!u) {
+        qWarning("Out of resource update batches");
+        return nullptr;
+    }
+
+    for (quint32 i = 0; i < count; ++i) {
+        quint8 op;
+        ds >> op;
+        switch (op) {
+        case QRhiCapture::DynamicBufferUpdate:
+        case QRhiCapture::StaticBufferUpload:
+        {
+            quint64 bufId;
+            qint32 offset;
+            QByteArray data;
+            ds >> bufId >> offset >> data;
+            QRhiBuffer *buf = m_buffers.value(bufId);
+            if (!buf)
+                break;
+            if (op == QRhiCapture::DynamicBufferUpdate)
+                u->updateDynamicBuffer(buf, offset, data.size(), data.constData());
+            else
+                u->uploadStaticBuffer(buf, offset, data.size(), data.constData());
+        }
+            break;
+        case QRhiCapture::BufferReadback:
+        {
+            quint64 bufId;
+            qint32 offset, size;
+            ds >> bufId >> offset >> size;
+            QRhiBuffer *buf = m_buffers.value(bufId);
+            if (!buf)
+                break;
+            QRhiBufferReadbackResult *result = new QRhiBufferReadbackResult;
+            m_bufferReadbacks.append(result);
+            u->readBackBuffer(buf, offset, size, result);
+        }
+            break;
+        case QRhiCapture::TextureUpload:
+        {
+            quint64 texId;
+            qint32 layerCount;
+            ds >> texId >> layerCount;
+            QVector<QRhiTextureLayer> layers;
+            for (qint32 layer = 0; layer < layerCount; ++layer) {
+                qint32 mipCount;
+                ds >> mipCount;
+                QVector<QRhiTextureMipLevel> mipImages;
+                for (qint32 level = 0; level < mipCount; ++level) {
+                    QRhiTextureMipLevel mipImage;
+                    bool hasImage;
+                    ds >> hasImage;
+                    if (hasImage) {
+                        qint32 format, bpl;
+                        QSize size;
+                        char *bits = nullptr;
+                        uint len = 0;
+                        ds >> format >> size >> bpl;
+                        ds.readBytes(bits, len);
+                        if (bits) {
+                            mipImage.setImage(QImage(reinterpret_cast<const uchar *>(bits), size.width(), size.height(),
+                                                     bpl, QImage::Format(format)).copy());
+                            delete[] bits;
+                        }
+                    } else {
+                        QByteArray compressedData;
+                        ds >> compressedData;
+                        mipImage.setCompressedData(compressedData);
+                    }
+                    QPoint dstTopLeft, srcTopLeft;
+                    QSize srcSize;
+                    ds >> dstTopLeft >> srcSize >> srcTopLeft;
+                    mipImage.setDestinationTopLeft(dstTopLeft);
+                    mipImage.setSourceSize(srcSize);
+                    mipImage.setSourceTopLeft(srcTopLeft);
+                    mipImages.append(mipImage);
+                }
+                layers.append(QRhiTextureLayer(mipImages));
+            }
+            if (QRhiTexture *tex = m_textures.value(texId))
+                u->uploadTexture(tex, QRhiTextureUploadDescription(layers));
+        }
+            break;
+        case QRhiCapture::TextureCopy:
+        {
+            quint64 dstId, srcId;
+            QSize pixelSize;
+            qint32 srcLayer, srcLevel, dstLayer, dstLevel;
+            QPoint srcTopLeft, dstTopLeft;
+            ds >> dstId >> srcId >> pixelSize >> srcLayer >> srcLevel >> srcTopLeft
+               >> dstLayer >> dstLevel >> dstTopLeft;
+            QRhiTexture *dst = m_textures.value(dstId);
+            QRhiTexture *src = m_textures.value(srcId);
+            if (!dst || !src)
+                break;
+            QRhiTextureCopyDescription desc;
+            desc.setPixelSize(pixelSize);
+            desc.setSourceLayer(srcLayer);
+            desc.setSourceLevel(srcLevel);
+            desc.setSourceTopLeft(srcTopLeft);
+            desc.setDestinationLayer(dstLayer);
+            desc.setDestinationLevel(dstLevel);
+            desc.setDestinationTopLeft(dstTopLeft);
+            u->copyTexture(dst, src, desc);
+        }
+            break;
+        case QRhiCapture::TextureReadback:
+        {
+            quint64 texId;
+            qint32 layer, level;
+            QRect rect;
+            ds >> texId >> layer >> level >> rect;
+            // 0 is the current swapchain, read from its substitute instead
+            QRhiTexture *tex = texId ? m_textures.value(texId) : swapChainTexture();
+            if (!tex)
+                break;
+            QRhiReadbackDescription rb(tex);
+            rb.setLayer(layer);
+            rb.setLevel(level);
+            rb.setRect(rect);
+            QRhiReadbackResult *result = new QRhiReadbackResult;
+            m_readbacks.append(result);
+            u->readBackTexture(rb, result);
+        }
+            break;
+        case QRhiCapture::GenerateMips:
+        {
+            quint64 texId;
+            ds >> texId;
+            if (QRhiTexture *tex = m_textures.value(texId))
+                u->generateMips(tex);
+        }
+            break;
+        default:
+            // the size of an unknown op is not known either, drop the rest
+            qWarning("Unknown resource update op %d", op);
+            return u;
+        }
+    }
+
+    return u;
+}
+
+bool Replayer::execute(const CaptureRecord &record)
+{
+    QDataStream ds(record.payload);
+    ds.setVersion(QDataStream::Qt_5_10);
+
+    switch (record.op) {
+    case QRhiCapture::Buffer:
+    case QRhiCapture::Texture:
+    case QRhiCapture::Sampler:
+    case QRhiCapture::RenderBuffer:
+    case QRhiCapture::TextureRenderTarget:
+    case QRhiCapture::SwapChain:
+    case QRhiCapture::SwapChainRenderTarget:
+    case QRhiCapture::ShaderResourceBindings:
+    case QRhiCapture::GraphicsPipeline:
+    case QRhiCapture::ComputePipeline:
+    {
+        quint64 id;
+        {
+            QDataStream idStream(record.payload);
+            idStream >> id;
+        }
+        if (isUnchanged(id, record.payload))
+            return true;
+    }
+        break;
+    default:
+        break;
+    }
+
+    switch (record.op) {
+    case QRhiCapture::Buffer:
+        buffer(ds);
+        return true;
+    case QRhiCapture::Texture:
+        texture(ds);
+        return true;
+    case QRhiCapture::Sampler:
+        sampler(ds);
+        return true;
+    case QRhiCapture::RenderBuffer:
+        renderBuffer(ds);
+        return true;
+    case QRhiCapture::TextureRenderTarget:
+        textureRenderTarget(ds);
+        return true;
+    case QRhiCapture::SwapChain:
+        swapChain(ds);
+        return true;
+    case QRhiCapture::SwapChainRenderTarget:
+        swapChainRenderTarget(ds);
+        return true;
+    case QRhiCapture::ShaderResourceBindings:
+        shaderResourceBindings(ds);
+        return true;
+    case QRhiCapture::GraphicsPipeline:
+        graphicsPipeline(ds);
+        return true;
+    case QRhiCapture::ComputePipeline:
+        computePipeline(ds);
+        return true;
+    case QRhiCapture::DestroyResource:
+        destroyResource(ds);
+        return true;
+
+    case QRhiCapture::BeginFrame:
+    {
+        quint64 scId;
+        qint64 timestamp;
+        ds >> scId >> timestamp;
+        m_currentSwapChain = scId;
+        return beginFrame(timestamp);
+    }
+    case QRhiCapture::EndFrame:
+    {
+        quint64 scId;
+        qint64 timestamp;
+        ds >> scId >> timestamp;
+        return endFrame(timestamp);
+    }
+    case QRhiCapture::BeginOffscreenFrame:
+    {
+        qint64 timestamp;
+        ds >> timestamp;
+        m_currentSwapChain = 0;
+        return beginFrame(timestamp);
+    }
+    case QRhiCapture::EndOffscreenFrame:
+    {
+        qint64 timestamp;
+        ds >> timestamp;
+        return endFrame(timestamp);
+    }
+    case QRhiCapture::Finish:
+        m_r->finish();
+        return true;
+    default:
+        break;
+    }
+
+    // everything else is recorded on the command buffer of the current frame
+    if (!m_cb) {
+        qWarning("Command %d outside of a frame, skipping", record.op);
+        return true;
+    }
+
+    switch (record.op) {
+    case QRhiCapture::ResourceUpdate:
+        m_cb->resourceUpdate(readBatch(ds));
+        break;
+    case QRhiCapture::BeginPass:
+    {
+        quint64 rtId;
+        QVector4D rgba;
+        float depth;
+        quint32 stencil;
+        ds >> rtId >> rgba >> depth >> stencil;
+        QRhiRenderTarget *rt = renderTarget(rtId);
+        if (!rt) {
+            qWarning("Pass on unknown render target %llu", rtId);
+            return false;
+        }
+        m_cb->beginPass(rt, QRhiColorClearValue(rgba), QRhiDepthStencilClearValue(depth, stencil), readBatch(ds));
+    }
+        break;
+    case QRhiCapture::EndPass:
+        m_cb->endPass(readBatch(ds));
+        break;
+    case QRhiCapture::BeginComputePass:
+        m_cb->beginComputePass(readBatch(ds));
+        break;
+    case QRhiCapture::EndComputePass:
+        m_cb->endComputePass(readBatch(ds));
+        break;
+    case QRhiCapture::SetGraphicsPipeline:
+    {
+        quint64 id;
+        ds >> id;
+        m_cb->setGraphicsPipeline(m_graphicsPipelines.value(id));
+    }
+        break;
+    case QRhiCapture::SetComputePipeline:
+    {
+        quint64 id;
+        ds >> id;
+        m_cb->setComputePipeline(m_computePipelines.value(id));
+    }
+        break;
+    case QRhiCapture::SetShaderResources:
+    {
+        quint64 srbId;
+        qint32 count;
+        ds >> srbId >> count;
+        QVector<QRhiCommandBuffer::DynamicOffset> dynamicOffsets;
+        for (qint32 i = 0; i < count; ++i) {
+            qint32 binding;
+            quint32 offset;
+            ds >> binding >> offset;
+            dynamicOffsets.append(qMakePair(int(binding), offset));
+        }
+        m_cb->setShaderResources(m_srbs.value(srbId), dynamicOffsets);
+    }
+        break;
+    case QRhiCapture::SetVertexInput:
+    {
+        qint32 startBinding, count;
+        ds >> startBinding >> count;
+        QVector<QRhiCommandBuffer::VertexInput> bindings;
+        for (qint32 i = 0; i < count; ++i) {
+            quint64 bufId;
+            quint32 offset;
+            ds >> bufId >> offset;
+            bindings.append(qMakePair(m_buffers.value(bufId), offset));
+        }
+        quint64 indexBufId;
+        quint32 indexOffset;
+        qint32 indexFormat;
+        ds >> indexBufId >> indexOffset >> indexFormat;
+        m_cb->setVertexInput(startBinding, bindings, m_buffers.value(indexBufId), indexOffset,
+                             QRhiCommandBuffer::IndexFormat(indexFormat));
+    }
+        break;
+    case QRhiCapture::SetViewport:
+    {
+        QVector4D v;
+        float minDepth, maxDepth;
+        ds >> v >> minDepth >> maxDepth;
+        m_cb->setViewport(QRhiViewport(v.x(), v.y(), v.z(), v.w(), minDepth, maxDepth));
+    }
+        break;
+    case QRhiCapture::SetScissor:
+    {
+        QVector4D v;
+        ds >> v;
+        QRhiScissor scissor;
+        scissor.setScissor(v);
+        m_cb->setScissor(scissor);
+    }
+        break;
+    case QRhiCapture::SetBlendConstants:
+    {
+        QVector4D c;
+        ds >> c;
+        m_cb->setBlendConstants(c);
+    }
+        break;
+    case QRhiCapture::SetStencilRef:
+    {
+        quint32 refValue;
+        ds >> refValue;
+        m_cb->setStencilRef(refValue);
+    }
+        break;
+    case QRhiCapture::SetPushConstants:
+    {
+        qint32 stages;
+        quint32 offset;
+        QByteArray data;
+        ds >> stages >> offset >> data;
+        m_cb->setPushConstants(QRhiShaderResourceBinding::StageFlags(stages), offset,
+                               quint32(data.size()), data.constData());
+    }
+        break;
+    case QRhiCapture::Draw:
+    {
+        quint32 vertexCount, instanceCount, firstVertex, firstInstance;
+        ds >> vertexCount >> instanceCount >> firstVertex >> firstInstance;
+        m_cb->draw(vertexCount, instanceCount, firstVertex, firstInstance);
+    }
+        break;
+    case QRhiCapture::DrawIndexed:
+    {
+        quint32 indexCount, instanceCount, firstIndex, firstInstance;
+        qint32 vertexOffset;
+        ds >> indexCount >> instanceCount >> firstIndex >> vertexOffset >> firstInstance;
+        m_cb->drawIndexed(indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+    }
+        break;
+    case QRhiCapture::DrawIndirect:
+    case QRhiCapture::DrawIndexedIndirect:
+    {
+        quint64 bufId;
+        quint32 offset, drawCount, stride;
+        ds >> bufId >> offset >> drawCount >> stride;
+        QRhiBuffer *buf = m_buffers.value(bufId);
+        if (!buf)
+            break;
+        if (record.op == QRhiCapture::DrawIndirect)
+            m_cb->drawIndirect(buf, offset, drawCount, stride);
+        else
+            m_cb->drawIndexedIndirect(buf, offset, drawCount, stride);
+    }
+        break;
+    case QRhiCapture::Dispatch:
+    {
+        qint32 x, y, z;
+        ds >> x >> y >> z;
+        m_cb->dispatch(x, y, z);
+    }
+        break;
+    case QRhiCapture::DebugMarkBegin:
+    {
+        QByteArray name;
+        ds >> name;
+        m_cb->debugMarkBegin(name);
+    }
+        break;
+    case QRhiCapture::DebugMarkEnd:
+        m_cb->debugMarkEnd();
+        break;
+    case QRhiCapture::DebugMarkMsg:
+    {
+        QByteArray msg;
+        ds >> msg;
+        m_cb->debugMarkMsg(msg);
+    }
+        break;
+    default:
+        // newer stream, the payload tells the size so just move on
+        break;
+    }
+
+    return true;
+}
+
+bool readCapture(QIODevice *device, qint32 *backend, QVector<CaptureRecord> *records)
+{
+    QDataStream ds(device);
+    ds.setVersion(QDataStream::Qt_5_10);
+    quint32 magic, version;
+    ds >> magic >> version >> *backend;
+    if (ds.status() != QDataStream::Ok || magic != QRhiCapture::Magic) {
+        qWarning("Not a QRhiCapture stream");
+        return false;
+    }
+    if (version > QRhiCapture::Version) {
+        qWarning("Stream version %u, only %u is supported", version, QRhiCapture::Version);
+        return false;
+    }
+
+    int lastFrameEnd = 0;
+    while (!ds.atEnd()) {
+        CaptureRecord record;
+        ds >> record.op >> record.payload;
+        if (ds.status() != QDataStream::Ok) {
+            qWarning("Capture is truncated after %d records", records->count());
+            break;
+        }
+        records->append(record);
+        if (record.op == QRhiCapture::EndFrame || record.op == QRhiCapture::EndOffscreenFrame)
+            lastFrameEnd = records->count();
+    }
+
+    // drop the incomplete frame, if any, at the end of the capture
+    records->resize(lastFrameEnd);
+    return true;
+}
@@ -0,0 +1,131 @@
+/****************************************************************************
+**
+** Copyright (C) 2018 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the tools applications of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QRHIREPLAYER_H
+#define QRHIREPLAYER_H
+
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qvector.h>
+#include <QtRhi/qrhi.h>
+
+QT_BEGIN_NAMESPACE
+class QDataStream;
+class QIODevice;
+QT_END_NAMESPACE
+
+// Replays a stream written by QRhiCapture on any backend and reports frame
+// timings. Every frame, including the ones that went to a swapchain when
+// capturing, is replayed as an offscreen frame. Swapchains are substituted
+// by RGBA8 textures of the same size, with a multisample color buffer and a
+// depth-stencil buffer when the original had those.
+
+struct CaptureRecord
+{
+    quint8 op = 0;
+    QByteArray payload;
+};
+
+struct FrameSample
+{
+    double capturedMs = 0; // from the Begin/End*Frame timestamps in the capture
+    double replayMs = 0;   // begin*Frame() to end*Frame() when replaying
+};
+
+struct ReplaySwapChain
+{
+    QRhiTexture *tex = nullptr;
+    QRhiRenderBuffer *msaaBuffer = nullptr;
+    QRhiRenderBuffer *ds = nullptr;
+    QRhiTextureRenderTarget *rt = nullptr;
+    QRhiRenderPassDescriptor *rp = nullptr;
+};
+
+class Replayer
+{
+public:
+    Replayer(QRhi *rhi) : m_r(rhi) { }
+    ~Replayer();
+
+    bool run(const QVector<CaptureRecord> &records, QVector<FrameSample> *samples);
+
+private:
+    bool execute(const CaptureRecord &record);
+    bool isUnchanged(quint64 id, const QByteArray &payload);
+
+    void buffer(QDataStream &ds);
+    void texture(QDataStream &ds);
+    void sampler(QDataStream &ds);
+    void renderBuffer(QDataStream &ds);
+    void textureRenderTarget(QDataStream &ds);
+    void swapChain(QDataStream &ds);
+    void swapChainRenderTarget(QDataStream &ds);
+    void shaderResourceBindings(QDataStream &ds);
+    void graphicsPipeline(QDataStream &ds);
+    void computePipeline(QDataStream &ds);
+    void destroyResource(QDataStream &ds);
+    void rebuildRenderTargets(QRhiResource *attachment);
+
+    bool beginFrame(qint64 timestamp);
+    bool endFrame(qint64 timestamp);
+    QRhiResourceUpdateBatch *readBatch(QDataStream &ds);
+
+    QRhiRenderTarget *renderTarget(quint64 id) const;
+    QRhiRenderPassDescriptor *renderPassDescriptor(quint64 id) const;
+    QRhiTexture *swapChainTexture() const;
+    void releaseSwapChain(ReplaySwapChain *sc);
+
+    QRhi *m_r;
+    QRhiCommandBuffer *m_cb = nullptr;
+    QVector<FrameSample> *m_samples = nullptr;
+    QElapsedTimer m_frameTimer;
+    qint64 m_capturedFrameStart = 0;
+    quint64 m_currentSwapChain = 0;
+
+    QHash<quint64, QByteArray> m_descriptions;
+    QHash<quint64, QRhiBuffer *> m_buffers;
+    QHash<quint64, QRhiTexture *> m_textures;
+    QHash<quint64, QRhiSampler *> m_samplers;
+    QHash<quint64, QRhiRenderBuffer *> m_renderBuffers;
+    QHash<quint64, QRhiTextureRenderTarget *> m_renderTargets;
+    QHash<quint64, QRhiRenderPassDescriptor *> m_renderPassDescriptors;
+    QHash<quint64, ReplaySwapChain> m_swapChains;
+    QHash<quint64, quint64> m_swapChainRenderTargets; // rt id -> swapchain id
+    QHash<quint64, QRhiShaderResourceBindings *> m_srbs;
+    QHash<quint64, QRhiGraphicsPipeline *> m_graphicsPipelines;
+    QHash<quint64, QRhiComputePipeline *> m_computePipelines;
+
+    QVector<QRhiReadbackResult *> m_readbacks;
+    QVector<QRhiBufferReadbackResult *> m_bufferReadbacks;
+};
+
+// Reads the header and the records of a capture. The incomplete frame at
+// the end, if any, is dropped.
+bool readCapture(QIODevice *device, qint32 *backend, QVector<CaptureRecord> *records);
+
+#endif
@@ -1,2 +1,2 @@
 TEMPLATE = subdirs
-SUBDIRS += qsb
+SUBDIRS += qsb qrhiprof qrhireplay